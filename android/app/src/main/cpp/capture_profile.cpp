@@ -0,0 +1,122 @@
+#include "capture_profile.h"
+
+#include <sys/system_properties.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+namespace aas {
+
+namespace {
+
+/// Bump when the file layout or the probe's meaning changes.
+constexpr int kProfileVersion = 1;
+
+std::string property(const char* name) {
+    char value[PROP_VALUE_MAX] = {};
+    __system_property_get(name, value);
+    return value;
+}
+
+} // namespace
+
+const char* capturePathName(CapturePath path) {
+    switch (path) {
+    case CapturePath::kMmapExclusive:
+        return "mmap-exclusive";
+    case CapturePath::kAAudioShared:
+        return "aaudio-shared";
+    case CapturePath::kOpenSLES:
+        return "opensles";
+    case CapturePath::kCount:
+        break;
+    }
+    return "unknown";
+}
+
+std::string CaptureProfileCache::deviceKey() {
+    return property("ro.product.manufacturer") + "/" + property("ro.product.model") + "/" +
+           property("ro.build.fingerprint");
+}
+
+bool CaptureProfileCache::load(const std::string& key, CaptureProbeResult& out) const {
+    std::ifstream in(path_);
+    if (!in) {
+        return false;
+    }
+    CaptureProbeResult result;
+    bool keyMatches = false;
+    int version = 0;
+    int path = -1;
+    std::string line;
+    while (std::getline(in, line)) {
+        const std::size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            continue;
+        }
+        const std::string name = line.substr(0, eq);
+        const std::string value = line.substr(eq + 1);
+        const char* v = value.c_str();
+        if (name == "version") {
+            version = std::atoi(v);
+        } else if (name == "device") {
+            keyMatches = (value == key);
+        } else if (name == "path") {
+            path = std::atoi(v);
+        } else if (name == "mmap") {
+            result.mmap = std::atoi(v) != 0;
+        } else if (name == "sample_rate") {
+            result.sampleRate = std::atoi(v);
+        } else if (name == "channels") {
+            result.channels = std::atoi(v);
+        } else if (name == "reported_burst") {
+            result.reportedBurstFrames = std::atoi(v);
+        } else if (name == "measured_burst") {
+            result.measuredBurstFrames = std::atoi(v);
+        } else if (name == "latency_ms") {
+            result.latencyMs = std::strtod(v, nullptr);
+        } else if (name == "latency_measured") {
+            result.latencyMeasured = std::atoi(v) != 0;
+        }
+    }
+    if (version != kProfileVersion || !keyMatches || path < 0 ||
+        path >= static_cast<int>(CapturePath::kCount)) {
+        return false;
+    }
+    result.path = static_cast<CapturePath>(path);
+    result.ok = true;
+    out = result;
+    return true;
+}
+
+bool CaptureProfileCache::store(const std::string& key, const CaptureProbeResult& result) const {
+    // Write-then-rename so a crash mid-write never leaves a half file that
+    // parses as a different device's profile.
+    const std::string tmp = path_ + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << "version=" << kProfileVersion << '\n'
+            << "device=" << key << '\n'
+            << "path=" << static_cast<int>(result.path) << '\n'
+            << "mmap=" << (result.mmap ? 1 : 0) << '\n'
+            << "sample_rate=" << result.sampleRate << '\n'
+            << "channels=" << result.channels << '\n'
+            << "reported_burst=" << result.reportedBurstFrames << '\n'
+            << "measured_burst=" << result.measuredBurstFrames << '\n'
+            << "latency_ms=" << result.latencyMs << '\n'
+            << "latency_measured=" << (result.latencyMeasured ? 1 : 0) << '\n';
+        if (!out.flush()) {
+            return false;
+        }
+    }
+    return std::rename(tmp.c_str(), path_.c_str()) == 0;
+}
+
+void CaptureProfileCache::invalidate() const { std::remove(path_.c_str()); }
+
+} // namespace aas
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+namespace aas {
+
+/// Rungs of the capture fallback ladder, fastest first.
+enum class CapturePath : std::uint8_t {
+    kMmapExclusive = 0,  ///< AAudio, exclusive sharing, MMAP data path
+    kAAudioShared = 1,   ///< AAudio through the shared mixer
+    kOpenSLES = 2,       ///< OpenSL ES (pre-AAudio devices, broken AAudio HALs)
+    kCount,
+};
+
+const char* capturePathName(CapturePath path);
+
+/// Outcome of probing one rung, and what gets cached for the device.
+struct CaptureProbeResult {
+    CapturePath path = CapturePath::kOpenSLES;
+    bool ok = false;
+    /// The stream really ran on MMAP (only meaningful for AAudio paths).
+    bool mmap = false;
+    std::int32_t sampleRate = 0;
+    std::int32_t channels = 0;
+    /// Burst size as reported by the stream and as seen in callbacks.
+    std::int32_t reportedBurstFrames = 0;
+    std::int32_t measuredBurstFrames = 0;
+    /// Input latency from calculateLatencyMillis(), or an estimate from the
+    /// buffer size where the API cannot report it (OpenSL ES).
+    double latencyMs = 0.0;
+    bool latencyMeasured = false;
+};
+
+/// The capture path chosen for this device, persisted so later launches
+/// skip probing.
+///
+/// Stored as a small key=value text file in the app's files directory. The
+/// key is the device manufacturer and model plus the build fingerprint, so
+/// an OS update (which often replaces the audio HAL) triggers a fresh probe.
+class CaptureProfileCache {
+public:
+    explicit CaptureProfileCache(std::string path) : path_(std::move(path)) {}
+
+    /// Identity of the running device, from system properties.
+    static std::string deviceKey();
+
+    /// Loads the cached result for `key`. False if missing, for another
+    /// device, or unreadable.
+    bool load(const std::string& key, CaptureProbeResult& out) const;
+    bool store(const std::string& key, const CaptureProbeResult& result) const;
+    /// Forgets the cached choice, e.g. after the cached path fails to open.
+    void invalidate() const;
+
+private:
+    std::string path_;
+};
+
+} // namespace aas
@@ -0,0 +1,84 @@
+#include "clock_responder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "aas/clock.h"
+#include "aas/packet_header.h"
+#include "udp_sender.h"
+
+namespace aas {
+
+std::size_t ClockResponder::poll(UdpSender& sender) {
+    std::uint8_t buffer[kMaxDatagramBytes];
+    std::size_t taken = 0;
+    for (;;) {
+        const std::size_t size = sender.receive(buffer, sizeof(buffer));
+        if (size == 0) {
+            break;
+        }
+        // Stamp before parsing: t2 should be as close to arrival as the
+        // poll loop allows.
+        if (onDatagram(buffer, size, monotonicMicros())) {
+            ++taken;
+        }
+    }
+    return taken;
+}
+
+bool ClockResponder::onDatagram(const std::uint8_t* data, std::size_t size, std::uint64_t t2) {
+    PacketHeader header;
+    if (!readPacketHeader(data, size, header) || !header.hasFlag(kFlagTiming) ||
+        size < kPacketHeaderBytes + kTimingMessageBytes) {
+        ++malformed_;
+        return false;
+    }
+    TimingMessage request;
+    std::memcpy(&request, data + size - kTimingMessageBytes, kTimingMessageBytes);
+    if (request.kind != TimingKind::kRequest) {
+        ++malformed_;
+        return false;
+    }
+
+    if (pendingCount_ == kMaxPending) {
+        std::move(pending_.begin() + 1, pending_.end(), pending_.begin());
+        --pendingCount_;
+    }
+    Pending& slot = pending_[pendingCount_++];
+    slot.message = request;
+    slot.message.kind = TimingKind::kResponse;
+    slot.message.t2 = t2;
+    slot.message.t3 = 0;
+    slot.streamId = header.streamId;
+    return true;
+}
+
+void ClockResponder::attach(DatagramRing& ring, UdpSender& sender, std::size_t window) {
+    if (pendingCount_ == 0) {
+        return;
+    }
+    const std::size_t queued = std::min(ring.readAvailable(), window);
+    std::size_t next = 0;
+    for (std::size_t i = 0; i < pendingCount_; ++i) {
+        Pending& response = pending_[i];
+        response.message.t3 = monotonicMicros();
+
+        bool attached = false;
+        while (!attached && next < queued) {
+            Datagram& dg = ring.peek(next++);
+            std::size_t size = dg.size;
+            if (appendTimingTrailer(dg.bytes, size, response.message)) {
+                dg.size = static_cast<std::uint16_t>(size);
+                attached = true;
+            }
+        }
+        if (!attached) {
+            std::uint8_t standalone[kPacketHeaderBytes + kTimingMessageBytes];
+            const std::size_t size = writeTimingDatagram(response.message, response.streamId, standalone);
+            sender.sendRaw(standalone, size);
+        }
+    }
+    pendingCount_ = 0;
+}
+
+} // namespace aas
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/timing.h"
+
+namespace aas {
+
+class UdpSender;
+
+/// Sender side of the clock exchange (docs/protocol.md, Clock
+/// Synchronisation). Runs on the send thread, which owns the socket.
+///
+/// poll() reads the PC's requests and stamps t2 on arrival. attach(),
+/// called immediately before UdpSender::flush(), stamps t3 and appends each
+/// pending response as a trailer to one of the queued media datagrams, so
+/// tracking costs no extra packets while audio flows. With nothing queued
+/// (or no room left) the response goes out alone through sendRaw().
+class ClockResponder {
+public:
+    /// Requests arrive every 250 ms in tracking and 5 ms apart during the
+    /// handshake; more than this many unanswered means something stalled and
+    /// the oldest are stale anyway.
+    static constexpr std::size_t kMaxPending = 4;
+
+    /// Drains every datagram waiting on the socket. Returns the number of
+    /// timing requests taken.
+    std::size_t poll(UdpSender& sender);
+
+    /// Takes one datagram already read from a socket at sender time `t2`
+    /// (PathSelector drains several sockets itself). Returns true if it was
+    /// a timing request.
+    bool onDatagram(const std::uint8_t* data, std::size_t size, std::uint64_t t2);
+
+    /// Sends every pending response, riding on the first `window` queued
+    /// datagrams of `ring` where possible: the ones about to be flushed,
+    /// so a paced datagram held back does not carry a stale t3.
+    void attach(DatagramRing& ring, UdpSender& sender, std::size_t window = SIZE_MAX);
+
+    std::size_t pending() const { return pendingCount_; }
+    std::uint64_t malformed() const { return malformed_; }
+
+private:
+    struct Pending {
+        TimingMessage message;
+        std::uint8_t streamId;
+    };
+
+    std::array<Pending, kMaxPending> pending_{};
+    std::size_t pendingCount_ = 0;
+    std::uint64_t malformed_ = 0;
+};
+
+} // namespace aas
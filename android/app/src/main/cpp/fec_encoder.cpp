@@ -0,0 +1,170 @@
+#include "fec_encoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace aas {
+
+namespace {
+
+struct FecLevel {
+    float enterLoss;
+    std::uint8_t parityGroupSize;
+    bool redundantFrame;
+};
+
+// Group sizes stay small because a parity repair lands only after the whole
+// group has been sent; at N=4 that is still inside a typical 3-4 frame
+// jitter-buffer depth. Level 0 (clean link) sends no redundancy at all.
+constexpr FecLevel kLevels[] = {
+    {0.000f, 0, false},
+    {0.005f, 0, true},
+    {0.020f, 4, true},
+    {0.050f, 3, true},
+    {0.100f, 2, true},
+};
+constexpr int kLevelCount = static_cast<int>(sizeof(kLevels) / sizeof(kLevels[0]));
+
+} // namespace
+
+const FecSettings& FecController::update(float lossFraction) {
+    int wanted = 0;
+    for (int i = 1; i < kLevelCount; ++i) {
+        if (lossFraction >= kLevels[i].enterLoss) {
+            wanted = i;
+        }
+    }
+
+    if (wanted > level_) {
+        level_ = wanted;
+        reportsBelow_ = 0;
+    } else if (wanted < level_) {
+        if (++reportsBelow_ >= kStepDownReports) {
+            --level_;
+            reportsBelow_ = 0;
+        }
+    } else {
+        reportsBelow_ = 0;
+    }
+
+    settings_.parityGroupSize = kLevels[level_].parityGroupSize;
+    settings_.redundantFrame = kLevels[level_].redundantFrame;
+    settings_.opusPacketLossPerc =
+        std::clamp(static_cast<int>(std::lround(lossFraction * 100.0f)), 0, 100);
+    return settings_;
+}
+
+Datagram* FecEncoder::beginMedia(DatagramRing& ring) { return ring.writeSlot(); }
+
+void FecEncoder::commitMedia(DatagramRing& ring, Datagram* dg, PacketHeader header,
+                             std::size_t primarySize, const TraceTrailer* trace) {
+    const std::uint8_t shape = parityShape(header.frameUnits, header.hasFlag(kFlagAggregate));
+    if (groupCount_ == 0) {
+        active_ = pending_;
+    }
+
+    std::uint8_t* payload = dg->bytes + kPacketHeaderBytes;
+    std::uint8_t* primary = payload + kRedundancyPrefixBytes;
+    std::size_t payloadSize = 0;
+    header.flags &= static_cast<std::uint8_t>(~(kFlagFecParity | kFlagRedundant | kFlagTrace));
+
+    if (active_.redundantFrame) {
+        header.flags |= kFlagRedundant;
+        const auto length = static_cast<std::uint16_t>(primarySize);
+        std::memcpy(payload, &length, sizeof(length));
+        const bool contiguous = havePrevious_ && previousShape_ == shape &&
+                                previousSeq_ == static_cast<std::uint16_t>(header.seq - header.frameUnits);
+        const std::size_t redundantSize = contiguous ? previousSize_ : 0;
+        std::memcpy(primary + primarySize, previous_, redundantSize);
+        payloadSize = kRedundancyPrefixBytes + primarySize + redundantSize;
+    } else {
+        // Encoder always writes after the prefix; close the gap so a
+        // packet without redundancy carries no dead bytes.
+        std::memmove(payload, primary, primarySize);
+        primary = payload;
+        payloadSize = primarySize;
+    }
+
+    writePacketHeader(header, dg->bytes);
+    dg->size = static_cast<std::uint16_t>(kPacketHeaderBytes + payloadSize);
+    if (trace != nullptr) {
+        appendTraceTrailer(*dg, *trace);
+    }
+
+    std::memcpy(previous_, primary, primarySize);
+    previousSize_ = primarySize;
+    previousSeq_ = header.seq;
+    previousShape_ = shape;
+    havePrevious_ = true;
+
+    ring.publish();
+
+    if (groupCount_ != 0 && shape != groupShape_) {
+        // Batch size changed mid-group. The parity header describes one
+        // shape for every member, so close the group with what it has
+        // (behind this packet, whose slot was already taken) and let this
+        // packet start the next one.
+        if (groupCount_ >= kMinParityGroup) {
+            emitParity(ring);
+        }
+        groupCount_ = 0;
+    }
+    if (active_.parityGroupSize >= kMinParityGroup) {
+        if (groupCount_ == 0) {
+            startGroup(header);
+        }
+        xorInto(parity_, primary, primarySize);
+        parityLength_ = std::max(parityLength_, primarySize);
+        lengthXor_ ^= static_cast<std::uint16_t>(primarySize);
+        sampleClockXor_ ^= header.sampleClock;
+        ++groupCount_;
+    }
+
+    if (groupCount_ != 0 && groupCount_ == active_.parityGroupSize) {
+        emitParity(ring);
+        groupCount_ = 0;
+    }
+}
+
+void FecEncoder::endTalkspurt(DatagramRing& ring) {
+    if (groupCount_ >= kMinParityGroup) {
+        emitParity(ring);
+    }
+    groupCount_ = 0;
+    havePrevious_ = false;
+}
+
+void FecEncoder::startGroup(const PacketHeader& header) {
+    std::memset(parity_, 0, sizeof(parity_));
+    parityLength_ = 0;
+    lengthXor_ = 0;
+    sampleClockXor_ = 0;
+    groupHeader_ = header;
+    groupShape_ = parityShape(header.frameUnits, header.hasFlag(kFlagAggregate));
+}
+
+void FecEncoder::emitParity(DatagramRing& ring) {
+    Datagram* dg = ring.writeSlot();
+    if (dg == nullptr) {
+        ++parityDropped_;
+        return;
+    }
+
+    PacketHeader header = groupHeader_;
+    header.flags = kFlagFecParity;
+    std::uint8_t* out = writePacketHeader(header, dg->bytes);
+
+    FecParityHeader parity{};
+    parity.groupSize = groupCount_;
+    parity.shape = groupShape_;
+    parity.lengthXor = lengthXor_;
+    parity.sampleClockXor = sampleClockXor_;
+    std::memcpy(out, &parity, kFecParityHeaderBytes);
+    std::memcpy(out + kFecParityHeaderBytes, parity_, parityLength_);
+
+    dg->size = static_cast<std::uint16_t>(kPacketHeaderBytes + kFecParityHeaderBytes + parityLength_);
+    ring.publish();
+}
+
+} // namespace aas
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/fec_format.h"
+#include "aas/latency_trace.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// Protection level applied by FecEncoder.
+struct FecSettings {
+    /// Media packets per XOR parity packet; 0 disables parity.
+    std::uint8_t parityGroupSize = 0;
+    /// Piggy-back a copy of the previous frame on every packet.
+    bool redundantFrame = false;
+    /// Expected loss for the Opus encoder (OPUS_SET_PACKET_LOSS_PERC). The
+    /// encoder also enables OPUS_SET_INBAND_FEC when it is not in CELT-only
+    /// mode, since LBRR exists only in the SILK layer.
+    int opusPacketLossPerc = 0;
+
+    bool operator==(const FecSettings& o) const {
+        return parityGroupSize == o.parityGroupSize && redundantFrame == o.redundantFrame &&
+               opusPacketLossPerc == o.opusPacketLossPerc;
+    }
+    bool operator!=(const FecSettings& o) const { return !(*this == o); }
+};
+
+/// Chooses FecSettings from the loss fraction reported by the receiver.
+///
+/// Protection steps up as soon as a report crosses the next threshold and
+/// steps down only after kStepDownReports consecutive reports below the
+/// current level's threshold, so a brief clean spell in the middle of
+/// interference does not strip protection right before the next burst.
+class FecController {
+public:
+    static constexpr int kStepDownReports = 10;
+
+    /// Feeds one loss report (0.0-1.0). Returns the settings to apply.
+    const FecSettings& update(float lossFraction);
+    const FecSettings& settings() const { return settings_; }
+    int level() const { return level_; }
+
+private:
+    int level_ = 0;
+    int reportsBelow_ = 0;
+    FecSettings settings_;
+};
+
+/// FEC stage of the Android pipeline, between the encoder and UdpSender.
+///
+/// The encoder asks beginMedia() for a slot and encodes straight into
+/// primaryPayload(); commitMedia() then writes the header, appends the
+/// redundant copy of the previous frame if enabled, publishes the datagram,
+/// and publishes a parity datagram behind it when a parity group completes.
+/// New settings take effect at the next group boundary so the receiver never
+/// sees a group whose size changed midway; a change of packet shape (frame
+/// units, aggregate or not) closes the group early for the same reason.
+/// Aggregates from PacketAggregator are protected like any other primary.
+/// Encode thread only.
+class FecEncoder {
+public:
+    void configure(const FecSettings& settings) { pending_ = settings; }
+    const FecSettings& active() const { return active_; }
+
+    /// Next free datagram, or nullptr if the send stage is full.
+    Datagram* beginMedia(DatagramRing& ring);
+
+    /// Where the encoder writes the primary frame inside `dg`.
+    static std::uint8_t* primaryPayload(Datagram* dg) {
+        return dg->bytes + kPacketHeaderBytes + kRedundancyPrefixBytes;
+    }
+
+    /// Largest primary frame that still leaves room for redundancy.
+    static constexpr std::size_t kMaxPrimaryBytes =
+        (kMaxDatagramBytes - kPacketHeaderBytes - kRedundancyPrefixBytes) / 2;
+
+    /// Completes the datagram from the last beginMedia(). `header` carries
+    /// seq, sample clock, codec, frame units and any caller flags (e.g.
+    /// kFlagMarker, kFlagAggregate); the FEC and trace flags are managed
+    /// here. In latency
+    /// test mode `trace` is appended after the FEC framing.
+    void commitMedia(DatagramRing& ring, Datagram* dg, PacketHeader header, std::size_t primarySize,
+                     const TraceTrailer* trace = nullptr);
+
+    /// The sender is going silent (DtxController): sends parity for the
+    /// partial group and forgets the previous frame, so neither a parity
+    /// group nor a redundant copy spans the gap.
+    void endTalkspurt(DatagramRing& ring);
+
+    std::uint64_t parityDropped() const { return parityDropped_; }
+
+private:
+    void startGroup(const PacketHeader& header);
+    void emitParity(DatagramRing& ring);
+
+    FecSettings active_;
+    FecSettings pending_;
+
+    // Previous primary frame for the redundant copy.
+    std::uint8_t previous_[kMaxPayloadBytes];
+    std::size_t previousSize_ = 0;
+    std::uint16_t previousSeq_ = 0;
+    std::uint8_t previousShape_ = 0;
+    bool havePrevious_ = false;
+
+    // Running parity over the current group.
+    std::uint8_t parity_[kMaxPayloadBytes];
+    std::size_t parityLength_ = 0;
+    std::uint16_t lengthXor_ = 0;
+    std::uint32_t sampleClockXor_ = 0;
+    std::uint8_t groupCount_ = 0;
+    PacketHeader groupHeader_{};
+    std::uint8_t groupShape_ = 0;
+
+    std::uint64_t parityDropped_ = 0;
+};
+
+} // namespace aas
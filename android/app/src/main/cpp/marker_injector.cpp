@@ -0,0 +1,41 @@
+#include "marker_injector.h"
+
+namespace aas {
+
+MarkerInjector::MarkerInjector(std::uint32_t intervalFrames, float level)
+    : chips_(makeMarker()), intervalFrames_(intervalFrames == 0 ? 1 : intervalFrames), level_(level) {}
+
+void MarkerInjector::setEnabled(bool enabled) {
+    enabled_ = enabled;
+    frameCounter_ = 0;
+    chipPos_ = kMarkerLength;
+}
+
+bool MarkerInjector::process(AudioFrame& frame) {
+    if (!enabled_) {
+        return false;
+    }
+
+    const bool starts = (frameCounter_ == 0);
+    if (starts) {
+        chipPos_ = 0;
+        frame.flags |= kAudioFrameMarker;
+    }
+    frameCounter_ = (frameCounter_ + 1) % intervalFrames_;
+
+    // Silence between markers keeps the detector's correlation clean;
+    // test mode measures the pipeline, not the programme audio.
+    const std::size_t channels = frame.channels;
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        float value = 0.0f;
+        if (chipPos_ < kMarkerLength) {
+            value = level_ * chips_[chipPos_++];
+        }
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            frame.samples[i * channels + ch] = value;
+        }
+    }
+    return starts;
+}
+
+} // namespace aas
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/latency_marker.h"
+
+namespace aas {
+
+/// Latency test mode on the sender: replaces the captured audio with the
+/// MLS marker once every `intervalFrames` frames, starting on a frame
+/// boundary, and flags that frame with kAudioFrameMarker so the encoder can
+/// mark its packet. Runs on the capture thread right after the callback.
+class MarkerInjector {
+public:
+    /// 400 frames = one marker per second at 2.5 ms frames.
+    explicit MarkerInjector(std::uint32_t intervalFrames = 400, float level = 0.5f);
+
+    void setEnabled(bool enabled);
+    bool enabled() const { return enabled_; }
+
+    /// Overwrites `frame` with marker chips (or silence between markers).
+    /// Returns true when a marker starts in this frame.
+    bool process(AudioFrame& frame);
+
+private:
+    std::array<float, kMarkerLength> chips_;
+    std::uint32_t intervalFrames_;
+    float level_;
+    bool enabled_ = false;
+    std::uint32_t frameCounter_ = 0;
+    std::size_t chipPos_ = kMarkerLength;
+};
+
+} // namespace aas
@@ -0,0 +1,168 @@
+#include "noise_suppressor.h"
+
+#include <rnnoise.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "aas/clock.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AAS_NS_NEON 1
+#endif
+
+namespace aas {
+
+namespace {
+
+/// RNNoise expects samples on the int16 scale.
+constexpr float kToRnnoise = 32768.0f;
+constexpr float kFromRnnoise = 1.0f / 32768.0f;
+
+/// Mono, int16-scaled copy of one frame.
+void downmix(const AudioFrame& frame, float* out) {
+    const std::size_t channels = frame.channels;
+    const float* in = frame.samples;
+    std::size_t i = 0;
+#if defined(AAS_NS_NEON)
+    if (channels == 1) {
+        for (; i + 4 <= kFrameSamples; i += 4) {
+            vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(in + i), kToRnnoise));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= kFrameSamples; i += 4) {
+            const float32x4x2_t lr = vld2q_f32(in + 2 * i);
+            vst1q_f32(out + i, vmulq_n_f32(vaddq_f32(lr.val[0], lr.val[1]), 0.5f * kToRnnoise));
+        }
+    }
+#endif
+    const float scale = kToRnnoise / static_cast<float>(channels);
+    for (; i < kFrameSamples; ++i) {
+        float sum = 0.0f;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            sum += in[i * channels + ch];
+        }
+        out[i] = sum * scale;
+    }
+}
+
+/// Scales filtered mono back and writes it to every channel of `frame`.
+void fanOut(const float* in, AudioFrame& frame) {
+    const std::size_t channels = frame.channels;
+    float* out = frame.samples;
+    std::size_t i = 0;
+#if defined(AAS_NS_NEON)
+    if (channels == 1) {
+        for (; i + 4 <= kFrameSamples; i += 4) {
+            vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(in + i), kFromRnnoise));
+        }
+    } else if (channels == 2) {
+        for (; i + 4 <= kFrameSamples; i += 4) {
+            const float32x4_t v = vmulq_n_f32(vld1q_f32(in + i), kFromRnnoise);
+            vst2q_f32(out + 2 * i, float32x4x2_t{{v, v}});
+        }
+    }
+#endif
+    for (; i < kFrameSamples; ++i) {
+        const float v = in[i] * kFromRnnoise;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            out[i * channels + ch] = v;
+        }
+    }
+}
+
+} // namespace
+
+NoiseSuppressor::~NoiseSuppressor() { stop(); }
+
+bool NoiseSuppressor::start(int core) {
+    stop();
+    state_ = rnnoise_create(nullptr);
+    if (state_ == nullptr) {
+        return false;
+    }
+    framesIn_ = 0;
+    blocks_.store(0, std::memory_order_relaxed);
+    maxBlockUs_.store(0, std::memory_order_relaxed);
+    running_.store(true, std::memory_order_release);
+    RtThreadConfig rt;
+    rt.role = ThreadRole::kNoiseSuppress;
+    rt.budgetUs = kFrameDurationUs;
+    rt.core = core;
+    thread_.start(rt, [this](RtScope& scope) { run(scope); });
+    return true;
+}
+
+void NoiseSuppressor::stop() {
+    running_.store(false, std::memory_order_release);
+    thread_.join();
+    if (state_ != nullptr) {
+        rnnoise_destroy(state_);
+        state_ = nullptr;
+    }
+}
+
+void NoiseSuppressor::run(RtScope& rt) {
+    while (running_.load(std::memory_order_acquire)) {
+        const AudioFrame* frame = in_.readSlot();
+        if (frame == nullptr) {
+            std::this_thread::sleep_for(std::chrono::microseconds(kPollUs));
+            continue;
+        }
+        const std::uint64_t startUs = rt.begin();
+        if (telemetry_ != nullptr && startUs > frame->callbackUs) {
+            telemetry_->record(TelemetryStage::kCaptureWait, startUs - frame->callbackUs);
+        }
+        process(*frame);
+        in_.release();
+        rt.end(startUs);
+    }
+}
+
+void NoiseSuppressor::process(const AudioFrame& frame) {
+    const std::uint64_t i = framesIn_++;
+    info_[i % info_.size()] =
+        FrameInfo{frame.sampleClock, frame.channels, frame.flags, frame.captureUs, frame.callbackUs};
+    const std::size_t slot = static_cast<std::size_t>(i % kFramesPerBlock);
+    downmix(frame, block_ + slot * kFrameSamples);
+
+    if (slot == kFramesPerBlock - 1) {
+        // Output is the previous block: RNNoise's synthesis lags one frame.
+        if (enabled_.load(std::memory_order_relaxed)) {
+            const std::uint64_t t0 = monotonicMicros();
+            voiceProbability_.store(rnnoise_process_frame(state_, filtered_, block_),
+                                    std::memory_order_relaxed);
+            const auto took = static_cast<std::uint32_t>(monotonicMicros() - t0);
+            if (took > maxBlockUs_.load(std::memory_order_relaxed)) {
+                maxBlockUs_.store(took, std::memory_order_relaxed);
+            }
+        } else {
+            std::memcpy(filtered_, previous_, sizeof(filtered_));
+        }
+        std::memcpy(previous_, block_, sizeof(previous_));
+        blocks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (i < kDelayFrames) {
+        return;  // the first block out of RNNoise is its zero history
+    }
+    const std::uint64_t j = i - kDelayFrames;
+    AudioFrame* out = out_.writeSlot();
+    if (out == nullptr) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    const FrameInfo& source = info_[j % info_.size()];
+    out->sampleClock = source.sampleClock;
+    out->channels = source.channels;
+    out->flags = source.flags;
+    out->captureUs = source.captureUs;
+    out->callbackUs = source.callbackUs;
+    fanOut(filtered_ + static_cast<std::size_t>(j % kFramesPerBlock) * kFrameSamples, *out);
+    out_.publish();
+}
+
+} // namespace aas
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/codec_info.h"
+#include "aas/spsc_ring.h"
+#include "aas/telemetry.h"
+#include "rt_thread.h"
+
+struct DenoiseState;
+
+namespace aas {
+
+/// Mic-mode RNNoise stage between capture and the encoder, on its own core.
+///
+/// RNNoise works on 480-sample (10 ms) frames, so four pipeline frames are
+/// gathered into one block, and the block filtered by each call is the one
+/// before, because of RNNoise's overlap-add synthesis. To keep that delay
+/// constant the stage sends one frame out per frame in, each carrying the
+/// audio (and the sample clock and capture timestamps) of the frame seven
+/// frames earlier:
+///
+///   bridging  360 samples   7.5 ms   waiting for the rest of the block
+///   synthesis 480 samples  10.0 ms   RNNoise's one-frame overlap
+///   total     840 samples  17.5 ms   kAddedDelaySamples
+///
+/// Since the timestamps travel with the audio, the latency report's Encode
+/// row measures this cost directly, and codecLatencyEstimateMs(info, true)
+/// includes it for the codec menu. The RNNoise MLS-marker caveat: the
+/// marker is noise-like and gets suppressed, so run the marker row with
+/// suppression off.
+///
+/// The worker polls the capture ring every kPollUs instead of being woken,
+/// so the capture callback stays free of syscalls; each frame must be
+/// through within one frame period (its ThreadStats deadline). The GRU and
+/// FFT run in RNNoise's own NEON build; this stage's NEON code is the
+/// downmix/scale in and the scale/fan-out back to the frame's channels.
+class NoiseSuppressor {
+public:
+    static constexpr std::size_t kBlockSamples = 480;
+    static constexpr std::size_t kFramesPerBlock = kBlockSamples / kFrameSamples;
+    static constexpr std::size_t kDelayFrames = 2 * kFramesPerBlock - 1;
+    static constexpr std::uint32_t kAddedDelaySamples =
+        static_cast<std::uint32_t>(kDelayFrames * kFrameSamples);
+    static constexpr std::uint32_t kPollUs = 500;
+
+    static_assert(kBlockSamples % kFrameSamples == 0, "blocks must hold whole frames");
+    static_assert(kAddedDelaySamples * 1000.0 / kSampleRateHz == kRnnoiseAddedMs,
+                  "codec menu estimate must match the stage's real delay");
+
+    NoiseSuppressor(FrameRing& in, FrameRing& out) : in_(in), out_(out) {}
+    ~NoiseSuppressor();
+    NoiseSuppressor(const NoiseSuppressor&) = delete;
+    NoiseSuppressor& operator=(const NoiseSuppressor&) = delete;
+
+    /// Creates the RNNoise state and starts the worker, pinned to `core`
+    /// (-1 = the big cluster). Returns false if RNNoise could not be
+    /// created.
+    bool start(int core);
+    void stop();
+    bool running() const { return running_.load(std::memory_order_relaxed); }
+
+    /// Bypasses RNNoise without stopping the stage (the quality governor's
+    /// RNNoise step). Bypassed blocks go out unfiltered with the same
+    /// kAddedDelaySamples, so the stream's timeline does not jump; the
+    /// switch lands on the next block boundary.
+    /// Records kCaptureWait (capture callback to pickup) for each frame.
+    /// Set before start().
+    void setTelemetry(StageTelemetry* telemetry) { telemetry_ = telemetry; }
+
+    void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+    bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+    /// RNNoise's speech probability for the last block, 0-1.
+    float voiceProbability() const { return voiceProbability_.load(std::memory_order_relaxed); }
+    std::uint64_t blocks() const { return blocks_.load(std::memory_order_relaxed); }
+    /// Longest rnnoise_process_frame() call so far; it delays the frame
+    /// that completes a block on top of kAddedDelaySamples.
+    std::uint32_t maxBlockUs() const { return maxBlockUs_.load(std::memory_order_relaxed); }
+    std::uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+private:
+    struct FrameInfo {
+        std::uint32_t sampleClock;
+        std::uint16_t channels;
+        std::uint16_t flags;
+        std::uint64_t captureUs;
+        std::uint64_t callbackUs;
+    };
+
+    void run(RtScope& rt);
+    void process(const AudioFrame& frame);
+
+    FrameRing& in_;
+    FrameRing& out_;
+    DenoiseState* state_ = nullptr;
+    RtThread thread_;
+    StageTelemetry* telemetry_ = nullptr;
+    std::atomic<bool> running_{false};
+    std::atomic<bool> enabled_{true};
+
+    // Worker state.
+    std::uint64_t framesIn_ = 0;
+    std::array<FrameInfo, kDelayFrames + 1> info_{};
+    alignas(16) float block_[kBlockSamples] = {};
+    alignas(16) float filtered_[kBlockSamples] = {};
+    alignas(16) float previous_[kBlockSamples] = {};  // last block in, for bypass
+
+    std::atomic<float> voiceProbability_{0.0f};
+    std::atomic<std::uint64_t> blocks_{0};
+    std::atomic<std::uint32_t> maxBlockUs_{0};
+    std::atomic<std::uint64_t> overruns_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,362 @@
+#include "oboe_capture.h"
+
+#include <oboe/OboeExtensions.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#include "aas/clock.h"
+
+namespace aas {
+
+namespace {
+
+/// Counts what a probe stream delivers; data is discarded.
+class ProbeCallback : public oboe::AudioStreamDataCallback {
+public:
+    oboe::DataCallbackResult onAudioReady(oboe::AudioStream*, void*, std::int32_t numFrames) override {
+        callbacks.fetch_add(1, std::memory_order_relaxed);
+        frames.fetch_add(numFrames, std::memory_order_relaxed);
+        return oboe::DataCallbackResult::Continue;
+    }
+
+    std::atomic<std::int64_t> callbacks{0};
+    std::atomic<std::int64_t> frames{0};
+};
+
+std::int32_t clampChannels(std::int32_t channels) {
+    return std::clamp<std::int32_t>(channels, 1, static_cast<std::int32_t>(kMaxFrameChannels));
+}
+
+void configure(oboe::AudioStreamBuilder& builder, CapturePath path, const CaptureConfig& config) {
+    builder.setDirection(oboe::Direction::Input)
+        ->setFormat(oboe::AudioFormat::Float)
+        ->setSampleRate(static_cast<std::int32_t>(kSampleRateHz))
+        // Devices without a native 48 kHz input still feed the pipeline its
+        // rate; the probe's latency figure includes the converter's cost.
+        ->setSampleRateConversionQuality(oboe::SampleRateConversionQuality::Fastest)
+        ->setChannelCount(clampChannels(config.channels))
+        ->setPerformanceMode(oboe::PerformanceMode::LowLatency)
+        ->setInputPreset(config.inputPreset);
+
+    switch (path) {
+    case CapturePath::kMmapExclusive:
+        oboe::OboeExtensions::setMMapEnabled(true);
+        builder.setAudioApi(oboe::AudioApi::AAudio)->setSharingMode(oboe::SharingMode::Exclusive);
+        break;
+    case CapturePath::kAAudioShared:
+        // The legacy (non-MMAP) AAudio path, so this rung still works on
+        // HALs whose MMAP implementation is the thing that is broken.
+        oboe::OboeExtensions::setMMapEnabled(false);
+        builder.setAudioApi(oboe::AudioApi::AAudio)->setSharingMode(oboe::SharingMode::Shared);
+        break;
+    case CapturePath::kOpenSLES:
+    case CapturePath::kCount:
+        builder.setAudioApi(oboe::AudioApi::OpenSLES)->setSharingMode(oboe::SharingMode::Shared);
+        break;
+    }
+}
+
+/// True when the opened stream is really the rung that was asked for:
+/// Oboe quietly downgrades exclusive to shared and MMAP to legacy.
+bool matchesPath(oboe::AudioStream& stream, CapturePath path) {
+    if (stream.getSampleRate() != static_cast<std::int32_t>(kSampleRateHz)) {
+        return false;
+    }
+    switch (path) {
+    case CapturePath::kMmapExclusive:
+        return stream.getAudioApi() == oboe::AudioApi::AAudio &&
+               stream.getSharingMode() == oboe::SharingMode::Exclusive &&
+               oboe::OboeExtensions::isMMapUsed(&stream);
+    case CapturePath::kAAudioShared:
+        return stream.getAudioApi() == oboe::AudioApi::AAudio;
+    case CapturePath::kOpenSLES:
+        return stream.getAudioApi() == oboe::AudioApi::OpenSLES;
+    case CapturePath::kCount:
+        break;
+    }
+    return false;
+}
+
+} // namespace
+
+OboeCapture::~OboeCapture() { stop(); }
+
+CaptureProbeResult OboeCapture::probe(CapturePath path, const CaptureConfig& config) {
+    CaptureProbeResult result;
+    result.path = path;
+    if (path == CapturePath::kMmapExclusive && !oboe::OboeExtensions::isMMapSupported()) {
+        return result;
+    }
+
+    ProbeCallback callback;
+    oboe::AudioStreamBuilder builder;
+    configure(builder, path, config);
+    builder.setDataCallback(&callback);
+    std::shared_ptr<oboe::AudioStream> stream;
+    const oboe::Result opened = builder.openStream(stream);
+    oboe::OboeExtensions::setMMapEnabled(true);
+    if (opened != oboe::Result::OK) {
+        return result;
+    }
+    if (!matchesPath(*stream, path) || stream->requestStart() != oboe::Result::OK) {
+        stream->close();
+        return result;
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(config.probeDurationMs));
+
+    // Latency is only meaningful once data has flowed.
+    const auto latency = stream->calculateLatencyMillis();
+    result.mmap = stream->getAudioApi() == oboe::AudioApi::AAudio &&
+                  oboe::OboeExtensions::isMMapUsed(stream.get());
+    result.sampleRate = stream->getSampleRate();
+    result.channels = stream->getChannelCount();
+    result.reportedBurstFrames = stream->getFramesPerBurst();
+    stream->stop();
+    stream->close();
+
+    const std::int64_t callbacks = callback.callbacks.load(std::memory_order_relaxed);
+    if (callbacks == 0) {
+        // Opened and "started" but never delivered audio.
+        return result;
+    }
+    result.measuredBurstFrames =
+        static_cast<std::int32_t>(callback.frames.load(std::memory_order_relaxed) / callbacks);
+    if (latency) {
+        result.latencyMs = latency.value();
+        result.latencyMeasured = true;
+    } else {
+        // OpenSL ES cannot timestamp input; the buffer bounds what it adds.
+        result.latencyMs = 1000.0 * std::max(result.reportedBurstFrames, result.measuredBurstFrames) /
+                           static_cast<double>(kSampleRateHz);
+    }
+    result.ok = true;
+    return result;
+}
+
+CaptureProbeResult OboeCapture::probeLadder(const CaptureConfig& config) {
+    // Latencies closer than this are treated as a tie, and the earlier
+    // (more direct) rung wins it.
+    constexpr double kTieMs = 0.5;
+
+    CaptureProbeResult best;
+    for (int i = 0; i < static_cast<int>(CapturePath::kCount); ++i) {
+        const CaptureProbeResult result = probe(static_cast<CapturePath>(i), config);
+        if (result.ok && (!best.ok || result.latencyMs < best.latencyMs - kTieMs)) {
+            best = result;
+        }
+    }
+    return best;
+}
+
+bool OboeCapture::start(const CaptureConfig& config) {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (stream_ != nullptr && !started_ && clampChannels(config.channels) == config_.channels &&
+            config.inputPreset == config_.inputPreset) {
+            // Warm: the stream is open and idle; only the start is left.
+            frame_ = nullptr;
+            fill_ = 0;
+            haveTimestamp_ = false;
+            // The stream's frame counter (which timestamps refer to) kept
+            // running across the stop.
+            framesRead_ = stream_->getFramesRead();
+            lastError_ = stream_->requestStart();
+            started_ = lastError_ == oboe::Result::OK;
+            if (started_) {
+                return true;
+            }
+        }
+    }
+    stop();
+    config_ = config;
+    config_.channels = clampChannels(config.channels);
+    return openConfigured(true);
+}
+
+bool OboeCapture::prepare(const CaptureConfig& config) {
+    stop();
+    config_ = config;
+    config_.channels = clampChannels(config.channels);
+    return openConfigured(false);
+}
+
+void OboeCapture::standby() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (stream_ != nullptr && started_) {
+        stream_->requestStop();
+        started_ = false;
+    }
+}
+
+bool OboeCapture::openConfigured(bool startNow) {
+    const CaptureProfileCache cache(config_.profilePath);
+    const std::string key = CaptureProfileCache::deviceKey();
+    const bool useCache = !config_.profilePath.empty();
+
+    CaptureProbeResult choice;
+    if (useCache && !config_.forceProbe && cache.load(key, choice) &&
+        choice.channels == config_.channels) {
+        std::lock_guard<std::mutex> guard(lock_);
+        if (open(choice, startNow)) {
+            return true;
+        }
+        // The cached path stopped working (OS update with the same
+        // fingerprint, another app holding the exclusive stream, ...).
+        cache.invalidate();
+    }
+
+    choice = probeLadder(config_);
+    if (!choice.ok) {
+        return false;
+    }
+    if (useCache) {
+        cache.store(key, choice);
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    return open(choice, startNow);
+}
+
+bool OboeCapture::open(const CaptureProbeResult& choice, bool startNow) {
+    oboe::AudioStreamBuilder builder;
+    configure(builder, choice.path, config_);
+    builder.setDataCallback(this)->setErrorCallback(this);
+    std::shared_ptr<oboe::AudioStream> stream;
+    lastError_ = builder.openStream(stream);
+    oboe::OboeExtensions::setMMapEnabled(true);
+    if (lastError_ != oboe::Result::OK) {
+        return false;
+    }
+    if (!matchesPath(*stream, choice.path)) {
+        lastError_ = oboe::Result::ErrorUnavailable;
+        stream->close();
+        return false;
+    }
+
+    // Callback state is reset before the stream can call back.
+    frame_ = nullptr;
+    fill_ = 0;
+    channels_ = static_cast<std::size_t>(stream->getChannelCount());
+    framesRead_ = 0;
+    haveTimestamp_ = false;
+
+    if (startNow) {
+        lastError_ = stream->requestStart();
+        if (lastError_ != oboe::Result::OK) {
+            stream->close();
+            return false;
+        }
+    }
+    started_ = startNow;
+    active_ = choice;
+    active_.reportedBurstFrames = stream->getFramesPerBurst();
+    stats_.budgetUs.store(
+        static_cast<std::uint32_t>(active_.reportedBurstFrames * 1000000ll / kSampleRateHz / 2),
+        std::memory_order_relaxed);
+    stream_ = std::move(stream);
+    return true;
+}
+
+void OboeCapture::stop() {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (stream_ != nullptr) {
+        stream_->stop();
+        stream_->close();
+        stream_.reset();
+    }
+    started_ = false;
+}
+
+void OboeCapture::refreshTimestamp(oboe::AudioStream* stream) {
+    const auto ts = stream->getTimestamp(CLOCK_MONOTONIC);
+    if (ts) {
+        timestampPosition_ = ts.value().position;
+        timestampNs_ = ts.value().timestamp;
+        haveTimestamp_ = true;
+    }
+}
+
+oboe::DataCallbackResult OboeCapture::onAudioReady(oboe::AudioStream* stream, void* audioData,
+                                                   std::int32_t numFrames) {
+    const std::uint64_t nowUs = monotonicMicros();
+    refreshTimestamp(stream);
+
+    const float* in = static_cast<const float*>(audioData);
+    const std::size_t channels = channels_;
+    std::int32_t done = 0;
+    while (done < numFrames) {
+        if (frame_ == nullptr) {
+            frame_ = ring_.writeSlot();
+            if (frame_ == nullptr) {
+                frame_ = &scratch_;
+                overruns_.fetch_add(1, std::memory_order_relaxed);
+            }
+            frame_->sampleClock = sampleClock_;
+            frame_->channels = static_cast<std::uint16_t>(channels);
+            frame_->flags = 0;
+            // Converter time of the frame's first sample, from the stream's
+            // (position, time) pair; unknown when the API has no timestamps.
+            const std::int64_t firstFrame = framesRead_ + done;
+            frame_->captureUs =
+                haveTimestamp_
+                    ? static_cast<std::uint64_t>(
+                          (timestampNs_ + (firstFrame - timestampPosition_) * 1000000000ll /
+                                              static_cast<std::int64_t>(kSampleRateHz)) /
+                          1000)
+                    : 0;
+        }
+
+        const std::size_t take =
+            std::min(kFrameSamples - fill_, static_cast<std::size_t>(numFrames - done));
+        std::memcpy(frame_->samples + fill_ * channels, in + static_cast<std::size_t>(done) * channels,
+                    take * channels * sizeof(float));
+        fill_ += take;
+        done += static_cast<std::int32_t>(take);
+
+        if (fill_ == kFrameSamples) {
+            frame_->callbackUs = nowUs;
+            if (frame_ != &scratch_) {
+                ring_.publish();
+            }
+            frame_ = nullptr;
+            fill_ = 0;
+            sampleClock_ += static_cast<std::uint32_t>(kFrameSamples);
+        }
+    }
+    framesRead_ += numFrames;
+    if (switcher_ != nullptr) {
+        switcher_->pump(source_);
+    }
+    stats_.record(monotonicMicros() - nowUs);
+    return oboe::DataCallbackResult::Continue;
+}
+
+void OboeCapture::onErrorAfterClose(oboe::AudioStream* stream, oboe::Result error) {
+    std::lock_guard<std::mutex> guard(lock_);
+    if (stream != stream_.get()) {
+        return;
+    }
+    stream_.reset();
+    lastError_ = error;
+    if (error != oboe::Result::ErrorDisconnected) {
+        return;
+    }
+    // Route change or device removal: reopen on the same rung, then fall
+    // one rung at a time if it is gone (e.g. the exclusive stream was
+    // taken by another app).
+    // A stream in standby comes back in standby.
+    const bool startNow = started_;
+    for (int i = static_cast<int>(active_.path); i < static_cast<int>(CapturePath::kCount); ++i) {
+        CaptureProbeResult choice = active_;
+        choice.path = static_cast<CapturePath>(i);
+        if (open(choice, startNow)) {
+            return;
+        }
+    }
+    started_ = false;
+}
+
+} // namespace aas
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <oboe/Oboe.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "aas/audio_format.h"
+#include "aas/spsc_ring.h"
+#include "aas/thread_stats.h"
+#include "capture_profile.h"
+#include "source_switcher.h"
+
+namespace aas {
+
+struct CaptureConfig {
+    std::int32_t channels = 1;
+    oboe::InputPreset inputPreset = oboe::InputPreset::Unprocessed;
+    /// Where the chosen path is cached (app files directory).
+    std::string profilePath;
+    /// How long each rung runs while probing.
+    std::uint32_t probeDurationMs = 300;
+    /// Ignore the cache and run the full ladder.
+    bool forceProbe = false;
+};
+
+/// Capture stage of the Android pipeline on Oboe.
+///
+/// On first launch on a device, start() probes every rung of the fallback
+/// ladder (MMAP exclusive, AAudio shared, OpenSL ES): each one is opened,
+/// run for probeDurationMs, and must actually deliver callbacks to count as
+/// working, since several HALs accept an MMAP open and then never call back.
+/// The working path with the lowest input latency wins and is cached per
+/// device; later launches open it directly and only re-probe if it fails.
+///
+/// The data callback re-blocks whatever burst size the device uses into
+/// 120-sample AudioFrames, written in place into the capture FrameRing and
+/// stamped with the converter time from the stream's timestamp. It never
+/// blocks or allocates; a full ring drops the frame and counts an overrun.
+/// A disconnected stream (headset unplug, route change) is reopened on the
+/// same path from Oboe's error thread. Each callback's run time is counted
+/// against half a burst in the capture ThreadStats.
+///
+/// For a warm start, prepare() does the slow part (ladder or cache lookup
+/// and the open, together hundreds of milliseconds) ahead of time, and
+/// standby() stops a running stream without closing it; start() on an open
+/// stream with the same config is then a single requestStart().
+class OboeCapture : public oboe::AudioStreamDataCallback, public oboe::AudioStreamErrorCallback {
+public:
+    explicit OboeCapture(FrameRing& ring)
+        : ring_(ring), stats_(ThreadRegistry::instance().claim(ThreadRole::kCapture, 0)) {
+        // AAudio schedules its own callback thread; only its cycles are ours.
+        stats_.grant.store(RtGrant::kExternal, std::memory_order_relaxed);
+    }
+    ~OboeCapture() override;
+    OboeCapture(const OboeCapture&) = delete;
+    OboeCapture& operator=(const OboeCapture&) = delete;
+
+    /// Probes (or loads) the capture path and starts streaming into the ring.
+    /// Reuses the stream left open by prepare() or standby() when `config`
+    /// matches.
+    bool start(const CaptureConfig& config);
+    /// Probes (or loads) the path and opens the stream without starting it.
+    bool prepare(const CaptureConfig& config);
+    /// Stops the stream but keeps it open for the next start().
+    void standby();
+    /// Stops and closes the stream.
+    void stop();
+    bool running() const { return stream_ != nullptr && started_; }
+    /// The stream is open (running or in standby).
+    bool isOpen() const { return stream_ != nullptr; }
+
+    /// Probes a single rung. Opens, runs and closes a throwaway stream.
+    static CaptureProbeResult probe(CapturePath path, const CaptureConfig& config);
+    /// Runs the whole ladder and returns the fastest working rung (ok=false
+    /// if none works).
+    static CaptureProbeResult probeLadder(const CaptureConfig& config);
+
+    /// Pumps `switcher` as `source` after every callback, so this stream
+    /// can take part in a crossfaded source switch. Set before start().
+    void setSwitcher(SourceSwitcher* switcher, CaptureSource source) {
+        switcher_ = switcher;
+        source_ = source;
+    }
+
+    /// Path and measurements of the running stream.
+    const CaptureProbeResult& active() const { return active_; }
+    std::uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+    oboe::Result lastError() const { return lastError_; }
+
+    oboe::DataCallbackResult onAudioReady(oboe::AudioStream* stream, void* audioData,
+                                          std::int32_t numFrames) override;
+    void onErrorAfterClose(oboe::AudioStream* stream, oboe::Result error) override;
+
+private:
+    /// Finds the path for config_ (cache or ladder) and opens it.
+    bool openConfigured(bool startNow);
+    bool open(const CaptureProbeResult& choice, bool startNow);
+    void refreshTimestamp(oboe::AudioStream* stream);
+
+    FrameRing& ring_;
+    ThreadStats& stats_;
+    std::mutex lock_;  // stream lifetime: start/stop vs the error thread
+    CaptureConfig config_;
+    CaptureProbeResult active_;
+    std::shared_ptr<oboe::AudioStream> stream_;
+    oboe::Result lastError_ = oboe::Result::OK;
+    bool started_ = false;
+
+    // Callback-thread state.
+    AudioFrame* frame_ = nullptr;
+    AudioFrame scratch_;  // absorbs a frame when the ring is full
+    std::size_t fill_ = 0;
+    std::size_t channels_ = 1;
+    bool haveTimestamp_ = false;
+    std::int64_t timestampPosition_ = 0;
+    std::int64_t timestampNs_ = 0;
+    std::uint32_t sampleClock_ = 0;
+    std::int64_t framesRead_ = 0;
+    std::atomic<std::uint64_t> overruns_{0};
+    SourceSwitcher* switcher_ = nullptr;
+    CaptureSource source_ = CaptureSource::kMic;
+};
+
+} // namespace aas
@@ -0,0 +1,136 @@
+#include "packet_aggregator.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+float BatchController::costUs(std::uint8_t frames, std::uint8_t current, const BatchInputs& in) const {
+    const float network = in.backlogUs + 2.0f * in.jitterUs;
+    const bool airtimeLimited = in.backlogUs * static_cast<float>(current) >= config_.airtimeLimitedUs;
+    const float scaled = airtimeLimited ? network * static_cast<float>(current) / static_cast<float>(frames)
+                                        : network;
+    return scaled + static_cast<float>((frames - 1) * kFrameDurationUs);
+}
+
+std::uint8_t BatchController::update(std::uint64_t nowUs, const BatchInputs& in) {
+    std::uint8_t best = 1;
+    float bestCost = costUs(1, frames_, in);
+    for (std::uint8_t n = 2; n <= config_.maxFramesPerPacket; ++n) {
+        const float cost = costUs(n, frames_, in);
+        if (cost < bestCost) {
+            best = n;
+            bestCost = cost;
+        }
+    }
+
+    const int direction = best > frames_ ? 1 : (best < frames_ ? -1 : 0);
+    if (direction == 0 || direction != direction_) {
+        direction_ = direction;
+        directionSinceUs_ = nowUs;
+        return frames_;
+    }
+    const std::uint64_t hold = direction > 0 ? config_.stepUpHoldUs : config_.stepDownHoldUs;
+    if (nowUs - directionSinceUs_ >= hold) {
+        frames_ = direction > 0 ? best : static_cast<std::uint8_t>(frames_ - 1);
+        // Each further step down needs its own hold.
+        directionSinceUs_ = nowUs;
+    }
+    return frames_;
+}
+
+float BatchController::backlogUs(std::size_t queuedBytes, std::size_t datagramBytes,
+                                 std::uint8_t framesPerPacket) {
+    if (datagramBytes == 0) {
+        return 0.0f;
+    }
+    return static_cast<float>(queuedBytes) / static_cast<float>(datagramBytes) *
+           static_cast<float>(framesPerPacket * kFrameDurationUs);
+}
+
+void PacketAggregator::configure(std::uint8_t framesPerPacket) {
+    frames_ = std::clamp<std::uint8_t>(framesPerPacket, 1, kMaxAggregateFrames);
+}
+
+std::uint8_t* PacketAggregator::frameBase() const {
+    const std::size_t table = batch_ > 1 ? aggregateTableBytes(batch_) : 0;
+    return FecEncoder::primaryPayload(dg_) + table;
+}
+
+std::uint8_t* PacketAggregator::beginFrame(DatagramRing& ring, const PacketHeader& header,
+                                           std::size_t& capacity) {
+    if (dg_ != nullptr && count_ > 0) {
+        const std::size_t left = kPacketBytes - aggregateTableBytes(batch_) - used_;
+        if (header.hasFlag(kFlagMarker) || left < largest_ + largest_ / 4) {
+            flush(ring);
+        }
+    }
+    if (dg_ == nullptr) {
+        dg_ = fec_.beginMedia(ring);
+        if (dg_ == nullptr) {
+            return nullptr;
+        }
+        batch_ = frames_;
+        count_ = 0;
+        used_ = 0;
+        largest_ = 0;
+        haveTrace_ = false;
+    }
+    next_ = header;
+    const std::size_t table = batch_ > 1 ? aggregateTableBytes(batch_) : 0;
+    capacity = kPacketBytes - table - used_;
+    return frameBase() + used_;
+}
+
+void PacketAggregator::commitFrame(DatagramRing& ring, std::size_t size, const TraceTrailer* trace) {
+    if (dg_ == nullptr) {
+        return;
+    }
+    if (count_ == 0) {
+        header_ = next_;
+        haveTrace_ = trace != nullptr;
+        if (haveTrace_) {
+            trace_ = *trace;
+        }
+    } else if (haveTrace_ && trace != nullptr) {
+        const std::uint64_t firstCallbackUs = trace_.captureUs + trace_.callbackDeltaUs;
+        const std::uint64_t encodedUs = trace->captureUs + trace->callbackDeltaUs + trace->encodeDeltaUs;
+        trace_.encodeDeltaUs = traceDelta(encodedUs, firstCallbackUs);
+    }
+    sizes_[count_++] = static_cast<std::uint16_t>(size);
+    used_ += size;
+    largest_ = std::max(largest_, size);
+    if (count_ == batch_) {
+        flush(ring);
+    }
+}
+
+void PacketAggregator::flush(DatagramRing& ring) {
+    if (dg_ == nullptr || count_ == 0) {
+        return;
+    }
+    std::uint8_t* primary = FecEncoder::primaryPayload(dg_);
+    PacketHeader header = header_;
+    header.flags &= static_cast<std::uint8_t>(~kFlagAggregate);
+    std::size_t primarySize = used_;
+    if (count_ == 1) {
+        // Plain packet; keeps the caller's frame units so a longer codec
+        // frame passes through untouched.
+        std::memmove(primary, frameBase(), used_);
+    } else {
+        const std::size_t table = aggregateTableBytes(count_);
+        std::memmove(primary + table, frameBase(), used_);
+        writeAggregateTable(primary, count_, sizes_);
+        primarySize += table;
+        header.flags |= kFlagAggregate;
+        header.frameUnits = count_;
+    }
+    fec_.commitMedia(ring, dg_, header, primarySize, haveTrace_ ? &trace_ : nullptr);
+    dg_ = nullptr;
+    count_ = 0;
+    used_ = 0;
+}
+
+} // namespace aas
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/aggregate.h"
+#include "aas/datagram.h"
+#include "aas/latency_trace.h"
+#include "aas/packet_header.h"
+#include "fec_encoder.h"
+
+namespace aas {
+
+/// One BatchController sample.
+struct BatchInputs {
+    /// How long the unsent backlog takes to leave at the packet rate
+    /// (backlogUs()). It grows once each packet costs more airtime
+    /// (contention, retries) than the packet interval allows.
+    float backlogUs = 0.0f;
+    /// Active path's probe jitter (PathStats::jitterUs).
+    float jitterUs = 0.0f;
+};
+
+struct BatchControllerConfig {
+    /// Backlog, scaled to one frame per packet, below which the link is
+    /// not airtime-limited: batching would only add delay.
+    float airtimeLimitedUs = 1'000.0f;
+    /// How long a larger batch must keep winning before it is used.
+    std::uint64_t stepUpHoldUs = 500'000;
+    /// How long a smaller batch must keep winning before stepping down one.
+    std::uint64_t stepDownHoldUs = 10'000'000;
+    std::uint8_t maxFramesPerPacket = kMaxAggregateFrames;
+};
+
+/// Picks how many 2.5 ms frames go in one packet from the measured
+/// per-packet airtime cost against the jitter it causes.
+///
+/// On a contended link the per-packet overhead (channel access, preamble,
+/// ACK) dominates, so backlog and jitter scale with the packet rate: at n
+/// frames per packet they are about current/n of what is measured now.
+/// Playout has to cover the backlog plus twice the jitter, while batching
+/// holds frames back for (n - 1) x 2.5 ms, and the controller picks the n
+/// with the smallest total. Below airtimeLimitedUs the link is taken to be
+/// limited by something batching does not fix (interference, distance),
+/// and the answer is one frame. Larger batches are taken after
+/// stepUpHoldUs; steps back down go one at a time after stepDownHoldUs.
+class BatchController {
+public:
+    explicit BatchController(const BatchControllerConfig& config = {}) : config_(config) {}
+
+    /// Feeds one measurement (one per probe interval is plenty). Returns
+    /// the frames per packet to use.
+    std::uint8_t update(std::uint64_t nowUs, const BatchInputs& in);
+    std::uint8_t framesPerPacket() const { return frames_; }
+
+    /// Predicted backlog + 2 x jitter + batching delay at `frames` per
+    /// packet, from inputs measured at `current`.
+    float costUs(std::uint8_t frames, std::uint8_t current, const BatchInputs& in) const;
+
+    /// BatchInputs::backlogUs from UdpSender::queuedBytes(), the typical
+    /// datagram size and the current frames per packet.
+    static float backlogUs(std::size_t queuedBytes, std::size_t datagramBytes, std::uint8_t framesPerPacket);
+
+private:
+    BatchControllerConfig config_;
+    std::uint8_t frames_ = 1;
+    /// Which way the best size has pointed since directionSinceUs_.
+    int direction_ = 0;
+    std::uint64_t directionSinceUs_ = 0;
+};
+
+/// Whether `codec` should batch by encoding one longer frame instead of
+/// aggregating: Opus has 5 and 10 ms frames (cheaper than 2 or 4 separate
+/// ones, with fewer CELT overlaps), PCM splits at any slot. Lossless frames
+/// are always 2.5 ms, so it and 7.5 ms batches aggregate.
+inline bool batchAsLongerFrame(CodecId codec, std::uint8_t frames) {
+    switch (codec) {
+    case CodecId::kOpus:
+        return frames == 2 || frames == 4;
+    case CodecId::kPcm16:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/// Micro-batching in front of FecEncoder: collects up to four separately
+/// encoded 2.5 ms frames into one kFlagAggregate packet (aas/aggregate.h).
+///
+/// The encoder asks beginFrame() where to write the next frame and encodes
+/// straight into the datagram; commitFrame() hands the packet to the
+/// FecEncoder once the batch is full. With one frame per packet every frame
+/// goes straight through, identical to calling FecEncoder directly. A new
+/// size applies from the next batch. A batch closes early when the next
+/// frame might not fit, and before a latency-marker frame so the marker
+/// keeps its packet's sample clock. A batch of one is sent as a plain
+/// packet. The packet's seq and sample clock are its first frame's; frame
+/// units count its frames. Encode thread only.
+class PacketAggregator {
+public:
+    explicit PacketAggregator(FecEncoder& fec) : fec_(fec) {}
+
+    /// Frames per packet from the next batch on, clamped to 1-4.
+    void configure(std::uint8_t framesPerPacket);
+    std::uint8_t framesPerPacket() const { return frames_; }
+
+    /// Where to encode the frame described by `header` (seq, sample clock,
+    /// codec, caller flags), with room for `capacity` bytes. Returns
+    /// nullptr if the send stage is full.
+    std::uint8_t* beginFrame(DatagramRing& ring, const PacketHeader& header, std::size_t& capacity);
+
+    /// Adds the frame from the last beginFrame(), `size` bytes. In latency
+    /// test mode the packet's trailer is the first frame's, with the encode
+    /// time extended to the last frame's.
+    void commitFrame(DatagramRing& ring, std::size_t size, const TraceTrailer* trace = nullptr);
+
+    /// Sends a partly filled batch now (stream stop or a size change).
+    void flush(DatagramRing& ring);
+
+private:
+    /// Primary bytes one packet may use; the rest of the datagram is kept
+    /// for a redundant copy.
+    static constexpr std::size_t kPacketBytes = FecEncoder::kMaxPrimaryBytes;
+
+    std::uint8_t* frameBase() const;
+
+    FecEncoder& fec_;
+    std::uint8_t frames_ = 1;
+
+    // The batch being filled.
+    Datagram* dg_ = nullptr;
+    std::uint8_t batch_ = 0;
+    std::uint8_t count_ = 0;
+    std::size_t used_ = 0;
+    std::size_t largest_ = 0;
+    std::uint16_t sizes_[kMaxAggregateFrames] = {};
+    PacketHeader header_{};
+    PacketHeader next_{};
+    TraceTrailer trace_{};
+    bool haveTrace_ = false;
+};
+
+} // namespace aas
@@ -0,0 +1,340 @@
+#include "path_selector.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cmath>
+#include <cstring>
+
+#include "aas/clock.h"
+#include "aas/control_channel.h"
+#include "aas/packet_header.h"
+#include "clock_responder.h"
+
+namespace aas {
+
+const char* pathKindName(PathKind kind) {
+    switch (kind) {
+    case PathKind::kInfrastructure:
+        return "infrastructure";
+    case PathKind::kWifiDirect:
+        return "wifi-direct";
+    default:
+        return "unknown";
+    }
+}
+
+PathSelector::PathSelector(std::uint8_t streamId, const QosMarkingConfig& qos,
+                           const TransmitPacerConfig& pacing)
+    : streamId_(streamId), pacer_(pacing) {
+    for (Path& path : paths_) {
+        path.marking = QosMarking(qos);
+    }
+    // Without it wake() does nothing and control waits for the next poll
+    // timeout, as it would without a channel at all.
+    wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+PathSelector::~PathSelector() {
+    if (wakeFd_ >= 0) {
+        ::close(wakeFd_);
+    }
+}
+
+bool PathSelector::open(PathKind kind, const PathConfig& config) {
+    Path& path = paths_[index(kind)];
+    path.stats.open.store(false, std::memory_order_relaxed);
+    path.stats.usable.store(false, std::memory_order_relaxed);
+    if (!path.sender.open(reinterpret_cast<const sockaddr*>(&config.dest), config.destLen,
+                          config.netHandle)) {
+        return false;
+    }
+    path.nextProbeUs = 0;
+    path.openedUs = monotonicMicros();
+    path.lastEchoUs = 0;
+    path.sentUs.fill(0);
+    path.srttUs = 0.0;
+    path.jitterUs = 0.0;
+    path.loss = 0.0;
+    path.marking.reset();
+    applyMarking(index(kind));
+    path.stats.open.store(true, std::memory_order_relaxed);
+    if (!haveActive_) {
+        active_ = kind;
+        haveActive_ = true;
+    }
+    return true;
+}
+
+void PathSelector::close(PathKind kind) {
+    Path& path = paths_[index(kind)];
+    path.sender.close();
+    path.stats.open.store(false, std::memory_order_relaxed);
+    path.stats.usable.store(false, std::memory_order_relaxed);
+    if (haveActive_ && active_ == kind) {
+        // Hand media to whatever is left; evaluate() takes over from here.
+        haveActive_ = false;
+        for (std::size_t i = 0; i < kPaths; ++i) {
+            if (paths_[i].sender.isOpen()) {
+                active_ = static_cast<PathKind>(i);
+                haveActive_ = true;
+                failovers_.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+}
+
+void PathSelector::probe(std::size_t i, std::uint64_t nowUs) {
+    Path& path = paths_[i];
+    const std::uint16_t id = path.nextProbeId++;
+    std::uint64_t& slot = path.sentUs[id % kProbeSlots];
+    if (slot != 0) {
+        // Its slot came round unanswered: count the probe lost.
+        path.loss += (1.0 - path.loss) / kProbeSlots;
+    }
+    slot = nowUs;
+
+    TimingMessage message{};
+    message.kind = TimingKind::kProbe;
+    message.reserved = static_cast<std::uint8_t>(i);
+    message.pingId = id;
+    message.t1 = nowUs;
+    std::uint8_t datagram[kPacketHeaderBytes + kTimingMessageBytes];
+    path.sender.sendRaw(datagram, writeTimingDatagram(message, streamId_, datagram));
+    path.stats.probesSent.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PathSelector::onEcho(std::size_t i, const TimingMessage& echo, std::uint64_t t4) {
+    Path& path = paths_[i];
+    std::uint64_t& slot = path.sentUs[echo.pingId % kProbeSlots];
+    if (echo.reserved != i || slot != echo.t1 || t4 < echo.t1 || echo.t3 < echo.t2) {
+        return;  // stale, duplicated or for the other path
+    }
+    slot = 0;
+    const std::uint64_t held = echo.t3 - echo.t2;
+    const double rtt = static_cast<double>(t4 - echo.t1 > held ? t4 - echo.t1 - held : 0);
+    if (path.lastEchoUs == 0) {
+        path.srttUs = rtt;
+        path.jitterUs = rtt / 2.0;
+    } else {
+        path.jitterUs += (std::fabs(rtt - path.srttUs) - path.jitterUs) / 4.0;
+        path.srttUs += (rtt - path.srttUs) / 8.0;
+    }
+    path.loss -= path.loss / kProbeSlots;
+    path.lastEchoUs = t4;
+    path.stats.srttUs.store(static_cast<std::uint32_t>(path.srttUs), std::memory_order_relaxed);
+    path.stats.jitterUs.store(static_cast<std::uint32_t>(path.jitterUs), std::memory_order_relaxed);
+    path.stats.lossPermille.store(static_cast<std::uint32_t>(path.loss * 1000.0), std::memory_order_relaxed);
+    path.stats.echoes.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PathSelector::applyMarking(std::size_t i) {
+    Path& path = paths_[i];
+    const std::uint8_t dscp = path.marking.dscp();
+    // A socket that refuses the option keeps sending unmarked; the next
+    // report then shows DSCP 0 like any stripped marking.
+    path.sender.setTrafficClass(tosForDscp(dscp));
+    path.stats.markedDscp.store(dscp, std::memory_order_relaxed);
+    path.stats.receivedDscp.store(0, std::memory_order_relaxed);
+    path.stats.qos.store(path.marking.verdict(), std::memory_order_relaxed);
+}
+
+void PathSelector::onQosReport(std::size_t i, const QosReport& report) {
+    if (!haveActive_ || i != index(active_)) {
+        return;  // covers the mirrored copies of a switch overlap, or stale
+    }
+    Path& path = paths_[i];
+    path.stats.qosReports.fetch_add(1, std::memory_order_relaxed);
+    path.stats.remoteDelayP50Us.store(report.delayP50Us, std::memory_order_relaxed);
+    path.stats.remoteDelayP99Us.store(report.delayP99Us, std::memory_order_relaxed);
+    if (path.marking.onReport(report)) {
+        applyMarking(i);
+        path.stats.remarks.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    path.stats.receivedDscp.store(path.marking.receivedDscp(), std::memory_order_relaxed);
+    path.stats.qos.store(path.marking.verdict(), std::memory_order_relaxed);
+}
+
+void PathSelector::drain(std::size_t i, ClockResponder& responder) {
+    Path& path = paths_[i];
+    std::uint8_t buffer[kMaxDatagramBytes];
+    for (;;) {
+        const std::size_t size = path.sender.receive(buffer, sizeof(buffer));
+        if (size == 0) {
+            break;
+        }
+        const std::uint64_t arrivalUs = monotonicMicros();
+        PacketHeader header;
+        const bool parsed = readPacketHeader(buffer, size, header);
+        if (parsed && header.hasFlag(kFlagControl) && header.frameUnits == 0) {
+            if (control_ != nullptr) {
+                control_->onDatagram(buffer, size, arrivalUs);
+            }
+            continue;
+        }
+        if (parsed && header.hasFlag(kFlagTiming) &&
+            size >= kPacketHeaderBytes + kTimingMessageBytes) {
+            TimingMessage message;
+            std::memcpy(&message, buffer + size - kTimingMessageBytes, kTimingMessageBytes);
+            if (message.kind == TimingKind::kProbeEcho) {
+                onEcho(i, message, arrivalUs);
+                continue;
+            }
+            QosReport report;
+            if (readQosReport(buffer, size, report)) {
+                onQosReport(i, report);
+                continue;
+            }
+        }
+        responder.onDatagram(buffer, size, arrivalUs);
+    }
+}
+
+bool PathSelector::usable(std::size_t i, std::uint64_t nowUs) const {
+    const Path& path = paths_[i];
+    // Echoes are stamped after the caller's nowUs, so compare by adding.
+    return path.sender.isOpen() && path.lastEchoUs != 0 && nowUs < path.lastEchoUs + kDeadUs;
+}
+
+bool PathSelector::dead(std::size_t i, std::uint64_t nowUs) const {
+    const Path& path = paths_[i];
+    const std::uint64_t since = path.lastEchoUs > path.openedUs ? path.lastEchoUs : path.openedUs;
+    return !path.sender.isOpen() || nowUs >= since + kDeadUs;
+}
+
+double PathSelector::score(std::size_t i) const {
+    const Path& path = paths_[i];
+    return path.srttUs + 4.0 * path.jitterUs + path.loss * kLossPenaltyUs;
+}
+
+void PathSelector::switchTo(std::size_t i, std::uint64_t nowUs) {
+    previous_ = active_;
+    active_ = static_cast<PathKind>(i);
+    overlapUntilUs_ = nowUs + kOverlapUs;
+    better_ = false;
+    switches_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PathSelector::evaluate(std::uint64_t nowUs) {
+    for (std::size_t i = 0; i < kPaths; ++i) {
+        paths_[i].stats.usable.store(usable(i, nowUs), std::memory_order_relaxed);
+    }
+    if (!haveActive_) {
+        return;
+    }
+    const std::size_t current = index(active_);
+    const std::size_t other = (current + 1) % kPaths;
+    if (!usable(other, nowUs)) {
+        better_ = false;
+        return;
+    }
+    if (dead(current, nowUs)) {
+        failovers_.fetch_add(1, std::memory_order_relaxed);
+        switchTo(other, nowUs);
+        return;
+    }
+    if (!usable(current, nowUs)) {
+        better_ = false;
+        return;  // still waiting for the active path's first echo
+    }
+    if (score(other) + kSwitchMarginUs < score(current)) {
+        if (!better_) {
+            better_ = true;
+            betterSinceUs_ = nowUs;
+        } else if (nowUs - betterSinceUs_ >= kSwitchHoldUs) {
+            switchTo(other, nowUs);
+        }
+    } else {
+        better_ = false;
+    }
+}
+
+void PathSelector::service(std::uint64_t nowUs, ClockResponder& responder) {
+    for (std::size_t i = 0; i < kPaths; ++i) {
+        Path& path = paths_[i];
+        if (!path.sender.isOpen()) {
+            continue;
+        }
+        drain(i, responder);
+        if (nowUs >= path.nextProbeUs) {
+            probe(i, nowUs);
+            const bool idle = !haveActive_ || i != index(active_);
+            path.nextProbeUs = nowUs + (idle ? kIdleProbeUs : kActiveProbeUs);
+        }
+    }
+    sendControl(nowUs);
+    evaluate(nowUs);
+}
+
+void PathSelector::sendControl(std::uint64_t nowUs) {
+    if (control_ == nullptr || !haveActive_) {
+        return;
+    }
+    // Control follows media, so the PC answers on the path it listens to.
+    UdpSender& sender = active();
+    std::uint8_t datagram[kMaxDatagramBytes];
+    while (const std::size_t size = control_->poll(nowUs, streamId_, datagram)) {
+        sender.sendRaw(datagram, size);
+    }
+}
+
+std::size_t PathSelector::flush(std::uint64_t nowUs, DatagramRing& ring, ClockResponder& responder) {
+    const std::size_t queued = ring.readAvailable();
+    const std::size_t allowed = pacer_.allowance(nowUs, queued);
+    if (queued > 0 && allowed == 0) {
+        return 0;  // pending clock responses ride the next datagram out
+    }
+    UdpSender& sender = active();
+    responder.attach(ring, sender, allowed);
+    if (nowUs < overlapUntilUs_ && previous_ != active_) {
+        paths_[index(previous_)].sender.mirror(ring, allowed);
+    }
+    const std::size_t sent = sender.flush(ring, allowed);
+    pacer_.onSent(nowUs, sent);
+    return sent;
+}
+
+void PathSelector::wake() {
+    if (wakeFd_ >= 0) {
+        const std::uint64_t one = 1;
+        [[maybe_unused]] const ssize_t written = ::write(wakeFd_, &one, sizeof(one));
+    }
+}
+
+bool PathSelector::waitReadable(std::uint64_t timeoutUs) {
+    pollfd fds[kPaths + 1];
+    nfds_t count = 0;
+    for (const Path& path : paths_) {
+        if (path.sender.isOpen()) {
+            fds[count].fd = path.sender.fd();
+            fds[count].events = POLLIN;
+            fds[count].revents = 0;
+            ++count;
+        }
+    }
+    if (count == 0) {
+        return false;
+    }
+    const nfds_t sockets = count;
+    if (wakeFd_ >= 0) {
+        fds[count].fd = wakeFd_;
+        fds[count].events = POLLIN;
+        fds[count].revents = 0;
+        ++count;
+    }
+    timespec timeout{};
+    timeout.tv_sec = static_cast<time_t>(timeoutUs / 1000000);
+    timeout.tv_nsec = static_cast<long>((timeoutUs % 1000000) * 1000);
+    const bool ready = ::ppoll(fds, count, &timeout, nullptr) > 0;
+    if (count > sockets && (fds[sockets].revents & POLLIN) != 0) {
+        std::uint64_t wakes = 0;
+        [[maybe_unused]] const ssize_t drained = ::read(wakeFd_, &wakes, sizeof(wakes));
+    }
+    return ready;
+}
+
+} // namespace aas
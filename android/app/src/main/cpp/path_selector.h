@@ -0,0 +1,195 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/qos_report.h"
+#include "aas/timing.h"
+#include "qos_marking.h"
+#include "transmit_pacer.h"
+#include "udp_sender.h"
+
+namespace aas {
+
+class ClockResponder;
+class ControlChannel;
+
+/// Transport paths a session can run over at the same time.
+enum class PathKind : std::uint8_t {
+    kInfrastructure = 0,  ///< through the access point
+    kWifiDirect = 1,      ///< P2P group with the PC, no router hop
+    kCount,
+};
+
+const char* pathKindName(PathKind kind);
+
+/// Where one path sends. The Kotlin side forms the Wi-Fi Direct group
+/// (WifiP2pManager) and hands over the PC's address on it; the
+/// infrastructure path is bound to the Wi-Fi Network handle so it cannot
+/// leak onto cellular.
+struct PathConfig {
+    sockaddr_storage dest{};
+    socklen_t destLen = 0;
+    /// android.net.Network.getNetworkHandle(), or 0 to route by address.
+    std::uint64_t netHandle = 0;
+};
+
+/// Probe-derived quality of one path, readable from any thread.
+struct PathStats {
+    std::atomic<bool> open{false};
+    std::atomic<bool> usable{false};
+    std::atomic<std::uint32_t> srttUs{0};
+    std::atomic<std::uint32_t> jitterUs{0};
+    /// Smoothed probe loss, in 1/1000.
+    std::atomic<std::uint32_t> lossPermille{0};
+    std::atomic<std::uint64_t> probesSent{0};
+    std::atomic<std::uint64_t> echoes{0};
+
+    /// DSCP the path marks media with, and what the PC's last QoS report
+    /// saw of it (docs/protocol.md, QoS Reports).
+    std::atomic<std::uint8_t> markedDscp{0};
+    std::atomic<std::uint8_t> receivedDscp{0};
+    std::atomic<QosVerdict> qos{QosVerdict::kUnknown};
+    /// One-way delay above the fastest packet, as the PC measured it.
+    std::atomic<std::uint32_t> remoteDelayP50Us{0};
+    std::atomic<std::uint32_t> remoteDelayP99Us{0};
+    std::atomic<std::uint64_t> qosReports{0};
+    /// Times the marking moved down the ladder.
+    std::atomic<std::uint64_t> remarks{0};
+};
+
+/// Runs the send stage over an infrastructure and a Wi-Fi Direct path and
+/// keeps media on the better one (docs/protocol.md, Path Probing).
+///
+/// Both paths carry probes all the time, the idle one every
+/// kIdleProbeUs, so the switch decision is always based on current
+/// numbers. RTT and jitter are smoothed as in RFC 6298, and a path's
+/// score is srtt + 4 x jitter plus a loss penalty. Media fails over as
+/// soon as the active path has gone kDeadUs without an echo. It moves to a
+/// healthy path only after that path has scored kSwitchMarginUs better
+/// for kSwitchHoldUs, so two close paths do not flap. For kOverlapUs after
+/// any switch the old path gets a copy of every datagram. The receiver
+/// drops duplicates by sequence number, so nothing in flight is lost.
+///
+/// Media leaves through a TransmitPacer rather than in one burst per
+/// flush(), and each path runs its own QosMarking: the PC reports on the
+/// path media arrives over, and the marking ladder moves when the network
+/// rewrites the DSCP. A Wi-Fi Direct group usually keeps what the
+/// infrastructure path loses.
+///
+/// With a ControlChannel attached, control datagrams (kFlagControl) from
+/// any path go to it, and service() sends what it has due on the active
+/// path (docs/protocol.md, Control Channel).
+///
+/// Send thread only, like the UdpSenders it owns, except wake(): another
+/// thread that has posted a control message calls it to end the send
+/// thread's waitReadable() early.
+class PathSelector {
+public:
+    static constexpr std::size_t kPaths = static_cast<std::size_t>(PathKind::kCount);
+    static constexpr std::uint64_t kIdleProbeUs = 20'000;
+    static constexpr std::uint64_t kActiveProbeUs = 100'000;
+    static constexpr std::uint64_t kDeadUs = 300'000;
+    static constexpr std::uint64_t kSwitchHoldUs = 3'000'000;
+    static constexpr std::uint64_t kOverlapUs = 200'000;
+    static constexpr std::uint32_t kSwitchMarginUs = 2'000;
+    /// Score added at 100 % probe loss (so 5 % loss costs 1 ms).
+    static constexpr double kLossPenaltyUs = 20'000.0;
+
+    explicit PathSelector(std::uint8_t streamId, const QosMarkingConfig& qos = {},
+                          const TransmitPacerConfig& pacing = {});
+    ~PathSelector();
+    PathSelector(const PathSelector&) = delete;
+    PathSelector& operator=(const PathSelector&) = delete;
+
+    /// Opens (or reopens) one path. The first path opened becomes active.
+    bool open(PathKind kind, const PathConfig& config);
+    void close(PathKind kind);
+
+    void setControlChannel(ControlChannel* control) { control_ = control; }
+
+    /// Sends due probes, reads every socket (timing requests go to
+    /// `responder`, probe echoes and QoS reports update the stats, control
+    /// datagrams go to the channel), sends due control datagrams and
+    /// re-evaluates the active path. Call at least every kIdleProbeUs, and
+    /// every ControlChannel::kMinRtoUs while it has messages unacked.
+    void service(std::uint64_t nowUs, ClockResponder& responder);
+
+    /// Sends what the pacer allows of `ring` on the active path, with
+    /// pending clock responses attached, mirroring it to the previous path
+    /// during a switch overlap. Returns the number sent.
+    std::size_t flush(std::uint64_t nowUs, DatagramRing& ring, ClockResponder& responder);
+
+    /// When the next queued datagram may go. While the ring is not empty
+    /// the send thread sleeps no later than this.
+    std::uint64_t nextSendUs() const { return pacer_.nextDueUs(); }
+
+    /// Blocks until any open path is readable, wake() is called or
+    /// `timeoutUs` elapses.
+    bool waitReadable(std::uint64_t timeoutUs);
+
+    /// Any thread. Ends the current (or next) waitReadable().
+    void wake();
+
+    PathKind activeKind() const { return active_; }
+    UdpSender& active() { return paths_[index(active_)].sender; }
+    const PathStats& stats(PathKind kind) const { return paths_[index(kind)].stats; }
+    std::uint64_t switches() const { return switches_.load(std::memory_order_relaxed); }
+    std::uint64_t failovers() const { return failovers_.load(std::memory_order_relaxed); }
+    const TransmitPacerStats& pacerStats() const { return pacer_.stats(); }
+
+private:
+    static constexpr std::size_t kProbeSlots = 32;
+
+    struct Path {
+        UdpSender sender;
+        PathStats stats;
+        QosMarking marking;
+        std::uint16_t nextProbeId = 0;
+        std::uint64_t nextProbeUs = 0;
+        std::uint64_t openedUs = 0;
+        std::uint64_t lastEchoUs = 0;
+        std::array<std::uint64_t, kProbeSlots> sentUs{};
+        double srttUs = 0.0;
+        double jitterUs = 0.0;
+        double loss = 0.0;
+    };
+
+    static std::size_t index(PathKind kind) { return static_cast<std::size_t>(kind); }
+
+    void probe(std::size_t i, std::uint64_t nowUs);
+    void drain(std::size_t i, ClockResponder& responder);
+    void sendControl(std::uint64_t nowUs);
+    void onEcho(std::size_t i, const TimingMessage& echo, std::uint64_t t4);
+    void onQosReport(std::size_t i, const QosReport& report);
+    void applyMarking(std::size_t i);
+    bool usable(std::size_t i, std::uint64_t nowUs) const;
+    /// No echo for kDeadUs (counting from open(), so a path is not
+    /// written off before its first probe could come back).
+    bool dead(std::size_t i, std::uint64_t nowUs) const;
+    double score(std::size_t i) const;
+    void evaluate(std::uint64_t nowUs);
+    void switchTo(std::size_t i, std::uint64_t nowUs);
+
+    std::uint8_t streamId_;
+    std::array<Path, kPaths> paths_;
+    ControlChannel* control_ = nullptr;
+    int wakeFd_ = -1;
+    TransmitPacer pacer_;
+    PathKind active_ = PathKind::kInfrastructure;
+    bool haveActive_ = false;
+    PathKind previous_ = PathKind::kInfrastructure;
+    std::uint64_t overlapUntilUs_ = 0;
+    std::uint64_t betterSinceUs_ = 0;
+    bool better_ = false;
+
+    std::atomic<std::uint64_t> switches_{0};
+    std::atomic<std::uint64_t> failovers_{0};
+};
+
+} // namespace aas
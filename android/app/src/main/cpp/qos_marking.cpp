@@ -0,0 +1,77 @@
+#include "qos_marking.h"
+
+namespace aas {
+
+const char* qosVerdictName(QosVerdict verdict) {
+    switch (verdict) {
+    case QosVerdict::kUnknown:
+        return "unknown";
+    case QosVerdict::kHonoured:
+        return "honoured";
+    case QosVerdict::kRemarked:
+        return "remarked";
+    case QosVerdict::kStripped:
+        return "stripped";
+    default:
+        return "invalid";
+    }
+}
+
+QosMarking::QosMarking(const QosMarkingConfig& config) : config_(config) {
+    if (config_.ladder[0] == 0) {
+        config_.ladder[0] = kDscpCs5;
+    }
+}
+
+std::size_t QosMarking::rungs() const {
+    std::size_t n = 1;
+    while (n < config_.ladder.size() && config_.ladder[n] != 0) {
+        ++n;
+    }
+    return n;
+}
+
+bool QosMarking::onReport(const QosReport& report) {
+    if (report.datagrams == 0) {
+        return false;  // no media in the interval: nothing to judge
+    }
+    if ((report.flags & kQosTosKnown) == 0) {
+        verdict_ = QosVerdict::kUnknown;
+        remarkedRun_ = 0;
+        return false;
+    }
+    receivedDscp_ = dscpOfTos(report.tos);
+    const double share = static_cast<double>(report.tosMatching) / report.datagrams;
+    const bool honoured = receivedDscp_ == dscp() && share >= config_.honouredShare;
+    const bool voice = wmmAccessCategory(receivedDscp_) == WmmAccessCategory::kVoice;
+    if (honoured && (voice || !config_.requireVoice)) {
+        verdict_ = QosVerdict::kHonoured;
+        remarkedRun_ = 0;
+        return false;
+    }
+
+    if (++remarkedRun_ < config_.remarkedReports) {
+        if (verdict_ != QosVerdict::kStripped) {
+            verdict_ = honoured ? QosVerdict::kHonoured : QosVerdict::kRemarked;
+        }
+        return false;
+    }
+    remarkedRun_ = 0;
+    if (rung_ + 1 < rungs()) {
+        ++rung_;
+        verdict_ = QosVerdict::kRemarked;
+        return true;
+    }
+    // Honoured but not AC_VO with nothing left to try is still honoured.
+    verdict_ = honoured ? QosVerdict::kHonoured : QosVerdict::kStripped;
+    return false;
+}
+
+void QosMarking::reset() {
+    rung_ = 0;
+    remarkedRun_ = 0;
+    verdict_ = QosVerdict::kUnknown;
+    receivedDscp_ = 0;
+}
+
+} // namespace aas
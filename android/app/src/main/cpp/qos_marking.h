@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/qos_report.h"
+
+namespace aas {
+
+/// What the receiver's reports say about the marking a path sends.
+enum class QosVerdict : std::uint8_t {
+    kUnknown,    ///< no report yet, or the receiver cannot read TOS bytes
+    kHonoured,   ///< media arrives with the DSCP it was sent with
+    kRemarked,   ///< media arrives with another DSCP; trying the next marking
+    kStripped,   ///< every marking on the ladder arrived remarked
+};
+
+const char* qosVerdictName(QosVerdict verdict);
+
+struct QosMarkingConfig {
+    /// Markings tried in order, ending early at a zero entry. CS5 is the
+    /// spec's; EF is the one RFC 8325 puts in AC_VO and the one enterprise
+    /// voice policies tend to trust.
+    std::array<std::uint8_t, 3> ladder{kDscpCs5, kDscpEf, 0};
+    /// Consecutive remarked reports before moving down the ladder. The
+    /// first report after a change still covers some of the old marking.
+    std::uint32_t remarkedReports = 3;
+    /// Share of an interval's datagrams that must arrive with the marking
+    /// sent for it to count as honoured; Wi-Fi retries through a second
+    /// policy point can cost a few.
+    double honouredShare = 0.9;
+    /// Also step past a marking that is honoured but does not map to
+    /// AC_VO (CS5 lands in AC_VI under both mappings).
+    bool requireVoice = false;
+};
+
+/// Phone side of the QoS check (docs/protocol.md, QoS Reports): compares
+/// the DSCP the PC saw with the one the path sent, and walks a ladder of
+/// markings when the network rewrites it.
+///
+/// On the last rung it stays put and reports kStripped: downstream
+/// remarking cannot change the queue the phone's own radio uses, which its
+/// driver picks from the marking before anything else sees the packet, so
+/// a voice marking still buys the uplink hop. Send thread only.
+class QosMarking {
+public:
+    explicit QosMarking(const QosMarkingConfig& config = {});
+
+    /// DSCP to mark media with now.
+    std::uint8_t dscp() const { return config_.ladder[rung_]; }
+
+    /// Feeds one report from the receiver. Returns true when dscp() changed
+    /// and the socket needs the new traffic class.
+    bool onReport(const QosReport& report);
+
+    QosVerdict verdict() const { return verdict_; }
+    /// DSCP most of the last report's datagrams arrived with.
+    std::uint8_t receivedDscp() const { return receivedDscp_; }
+    /// Back to the first rung (the path was reopened, maybe elsewhere).
+    void reset();
+
+private:
+    std::size_t rungs() const;
+
+    QosMarkingConfig config_;
+    std::size_t rung_ = 0;
+    std::uint32_t remarkedRun_ = 0;
+    QosVerdict verdict_ = QosVerdict::kUnknown;
+    std::uint8_t receivedDscp_ = 0;
+};
+
+} // namespace aas
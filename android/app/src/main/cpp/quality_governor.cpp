@@ -0,0 +1,163 @@
+#include "quality_governor.h"
+
+#include <dlfcn.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace aas {
+
+namespace {
+
+constexpr int kLastLevel = static_cast<int>(kQualityLevels.size()) - 1;
+
+/// AThermal entry points, looked up at run time: the NDK symbols exist
+/// from API 30 (headroom from 31) and the app's minimum is 29.
+struct ThermalApi {
+    AThermalManager* (*acquire)() = nullptr;
+    void (*release)(AThermalManager*) = nullptr;
+    int (*status)(AThermalManager*) = nullptr;
+    float (*headroom)(AThermalManager*, int) = nullptr;
+
+    ThermalApi() {
+        void* lib = dlopen("libandroid.so", RTLD_NOW | RTLD_NOLOAD);
+        if (lib == nullptr) {
+            lib = dlopen("libandroid.so", RTLD_NOW);
+        }
+        if (lib == nullptr) {
+            return;
+        }
+        acquire = reinterpret_cast<decltype(acquire)>(dlsym(lib, "AThermal_acquireManager"));
+        release = reinterpret_cast<decltype(release)>(dlsym(lib, "AThermal_releaseManager"));
+        status = reinterpret_cast<decltype(status)>(dlsym(lib, "AThermal_getCurrentThermalStatus"));
+        headroom = reinterpret_cast<decltype(headroom)>(dlsym(lib, "AThermal_getThermalHeadroom"));
+        if (acquire == nullptr || release == nullptr) {
+            acquire = nullptr;
+        }
+    }
+};
+
+const ThermalApi& thermalApi() {
+    static const ThermalApi api;
+    return api;
+}
+
+/// First line of a sysfs attribute, or false.
+bool readLine(const char* path, char* out, std::size_t size) {
+    std::FILE* file = std::fopen(path, "r");
+    if (file == nullptr) {
+        return false;
+    }
+    const bool ok = std::fgets(out, static_cast<int>(size), file) != nullptr;
+    std::fclose(file);
+    return ok;
+}
+
+} // namespace
+
+QualityGovernor::QualityGovernor(const QualityGovernorConfig& config) : config_(config) {
+    const ThermalApi& api = thermalApi();
+    if (api.acquire != nullptr) {
+        thermal_ = api.acquire();
+    }
+}
+
+QualityGovernor::~QualityGovernor() {
+    if (thermal_ != nullptr) {
+        thermalApi().release(thermal_);
+    }
+}
+
+void QualityGovernor::attachEncodeStats(const ThreadStats* stats) {
+    encode_ = stats;
+    if (encode_ != nullptr) {
+        lastCycles_ = encode_->cycles.load(std::memory_order_relaxed);
+        lastMisses_ = encode_->misses.load(std::memory_order_relaxed);
+    }
+}
+
+QualityInputs QualityGovernor::sample() {
+    QualityInputs in;
+    const ThermalApi& api = thermalApi();
+    if (thermal_ != nullptr) {
+        if (api.status != nullptr) {
+            in.thermalStatus = api.status(thermal_);
+        }
+        if (api.headroom != nullptr) {
+            // NaN when unsupported or polled faster than the platform allows.
+            const float headroom = api.headroom(thermal_, config_.forecastSeconds);
+            in.thermalHeadroom = std::isnan(headroom) ? -1.0f : headroom;
+        }
+    }
+    if (encode_ != nullptr) {
+        const std::uint64_t cycles = encode_->cycles.load(std::memory_order_relaxed);
+        const std::uint64_t misses = encode_->misses.load(std::memory_order_relaxed);
+        if (cycles > lastCycles_) {
+            in.encodeMissRate =
+                static_cast<float>(misses - lastMisses_) / static_cast<float>(cycles - lastCycles_);
+        }
+        lastCycles_ = cycles;
+        lastMisses_ = misses;
+    }
+    char line[32];
+    if (readLine("/sys/class/power_supply/battery/capacity", line, sizeof(line))) {
+        in.batteryPercent = std::atoi(line);
+    }
+    if (readLine("/sys/class/power_supply/battery/status", line, sizeof(line))) {
+        in.discharging = std::strncmp(line, "Discharging", 11) == 0;
+    }
+    return in;
+}
+
+bool QualityGovernor::update(std::uint64_t nowUs) { return update(nowUs, sample()); }
+
+bool QualityGovernor::update(std::uint64_t nowUs, const QualityInputs& in) {
+    last_ = in;
+    const bool hot = in.thermalHeadroom >= config_.stepDownHeadroom ||
+                     in.thermalStatus >= config_.statusStepDown ||
+                     in.encodeMissRate >= config_.stepDownMissRate;
+    const bool cool = in.thermalHeadroom < config_.stepUpHeadroom &&
+                      in.thermalStatus < config_.statusStepDown && in.encodeMissRate == 0.0f;
+    const bool lowBattery =
+        in.discharging && in.batteryPercent >= 0 && in.batteryPercent <= config_.lowBatteryPercent;
+    const int minIndex = lowBattery ? config_.batteryFloor : 0;
+
+    const int index = index_.load(std::memory_order_relaxed);
+    int next = index;
+    if (index < minIndex) {
+        next = minIndex;
+    } else if (hot) {
+        if (index < kLastLevel && (!steppedDown_ || nowUs - lastDownUs_ >= config_.stepDownHoldUs)) {
+            next = index + 1;
+        }
+    } else if (cool && index > minIndex) {
+        if (!cool_) {
+            cool_ = true;
+            coolSinceUs_ = nowUs;
+        } else if (nowUs - coolSinceUs_ >= config_.stepUpHoldUs) {
+            next = index - 1;
+        }
+    }
+    if (!cool || hot) {
+        cool_ = false;
+    }
+
+    if (next == index) {
+        return false;
+    }
+    if (next > index) {
+        lastDownUs_ = nowUs;
+        steppedDown_ = true;
+        stepsDown_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        stepsUp_.fetch_add(1, std::memory_order_relaxed);
+    }
+    // Each step up needs its own full stepUpHoldUs of good readings.
+    cool_ = false;
+    index_.store(next, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace aas
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/thread_stats.h"
+#include "fec_encoder.h"
+
+struct AThermalManager;
+
+namespace aas {
+
+/// What the sender may spend at one governor level. The encode thread
+/// reads it every frame and applies it in place: Opus complexity and FEC
+/// through their setters, RNNoise by bypassing the stage, and frame size
+/// through the header's frameUnits, so no step restarts the stream.
+struct QualityLevel {
+    /// OPUS_SET_COMPLEXITY.
+    int opusComplexity;
+    /// Parity no denser than one packet per this many media packets; 0
+    /// disables parity.
+    std::uint8_t minParityGroupSize;
+    bool redundantFrame;
+    /// RNNoise stays on only if the user enabled it and the level allows it.
+    bool rnnoise;
+    /// Frame duration in 2.5 ms units (PacketHeader::frameUnits).
+    std::uint8_t frameUnits;
+
+    /// `wanted` (from the FecController) limited to this level.
+    FecSettings limit(FecSettings wanted) const {
+        if (minParityGroupSize == 0) {
+            wanted.parityGroupSize = 0;
+        } else if (wanted.parityGroupSize != 0 && wanted.parityGroupSize < minParityGroupSize) {
+            wanted.parityGroupSize = minParityGroupSize;
+        }
+        wanted.redundantFrame = wanted.redundantFrame && redundantFrame;
+        return wanted;
+    }
+};
+
+/// Full quality first. Each step trades the cheapest thing to lose for the
+/// most CPU: complexity, then parity density, then redundancy and RNNoise,
+/// and last the frame size, which halves per-packet work at +2.5 ms.
+inline constexpr std::array<QualityLevel, 5> kQualityLevels = {{
+    {8, 2, true, true, 1},
+    {6, 2, true, true, 1},
+    {4, 4, true, true, 1},
+    {3, 8, false, false, 1},
+    {2, 0, false, false, 2},
+}};
+
+/// One governor sample. Negative/NaN fields mean "not available".
+struct QualityInputs {
+    /// AThermal_getThermalHeadroom() forecast: 1.0 is where the device
+    /// reaches severe throttling.
+    float thermalHeadroom = -1.0f;
+    /// AThermal_getCurrentThermalStatus() (0 none .. 6 shutdown).
+    int thermalStatus = -1;
+    /// Encode-thread deadline misses per cycle since the last sample.
+    float encodeMissRate = 0.0f;
+    /// Battery percentage, and whether it is draining.
+    int batteryPercent = -1;
+    bool discharging = false;
+};
+
+struct QualityGovernorConfig {
+    /// Step down at or above this thermal headroom (or on a status of at
+    /// least statusStepDown); step up only below stepUpHeadroom.
+    float stepDownHeadroom = 0.85f;
+    float stepUpHeadroom = 0.65f;
+    int statusStepDown = 2;  ///< ATHERMAL_STATUS_MODERATE
+    /// Encode miss rate that counts as falling behind (1 %).
+    float stepDownMissRate = 0.01f;
+    /// Minimum time between two downward steps, so one step's effect can
+    /// show before the next.
+    std::uint64_t stepDownHoldUs = 3'000'000;
+    /// How long conditions must stay good before one step back up.
+    std::uint64_t stepUpHoldUs = 30'000'000;
+    /// Below this charge and discharging, keep levelIndex() at batteryFloor
+    /// or further down.
+    int lowBatteryPercent = 15;
+    int batteryFloor = 2;
+    /// Seconds ahead for the headroom forecast.
+    int forecastSeconds = 10;
+};
+
+/// Steps sender quality down as the phone heats up or the encode thread
+/// starts missing deadlines, and back up when headroom returns.
+///
+/// Phones throttle after 10-20 minutes of continuous encode; without this
+/// the encoder just starts dropping frames. Thermal data comes from the NDK
+/// thermal API (AThermal, looked up at run time: status from API 30,
+/// headroom from API 31), battery from sysfs, timing from the encode
+/// thread's ThreadStats. Stepping down is immediate, one level per
+/// stepDownHoldUs; stepping up waits stepUpHoldUs of good readings, so the
+/// level does not oscillate around the throttling point.
+///
+/// update() runs on the control thread about once a second (the platform
+/// rate-limits headroom queries to ~1 Hz); the encode thread only reads
+/// level(), a relaxed atomic.
+class QualityGovernor {
+public:
+    explicit QualityGovernor(const QualityGovernorConfig& config = {});
+    ~QualityGovernor();
+    QualityGovernor(const QualityGovernor&) = delete;
+    QualityGovernor& operator=(const QualityGovernor&) = delete;
+
+    /// Encode thread whose deadline misses drive the governor; nullptr
+    /// uses thermal and battery readings only.
+    void attachEncodeStats(const ThreadStats* stats);
+
+    /// Samples the platform and steps if due. Returns true if the level
+    /// changed.
+    bool update(std::uint64_t nowUs);
+    /// Same, with readings supplied by the caller.
+    bool update(std::uint64_t nowUs, const QualityInputs& inputs);
+
+    const QualityLevel& level() const {
+        return kQualityLevels[static_cast<std::size_t>(index_.load(std::memory_order_relaxed))];
+    }
+    int levelIndex() const { return index_.load(std::memory_order_relaxed); }
+    const QualityInputs& lastInputs() const { return last_; }
+
+    std::uint64_t stepsDown() const { return stepsDown_.load(std::memory_order_relaxed); }
+    std::uint64_t stepsUp() const { return stepsUp_.load(std::memory_order_relaxed); }
+
+private:
+    QualityInputs sample();
+
+    QualityGovernorConfig config_;
+    AThermalManager* thermal_ = nullptr;
+    const ThreadStats* encode_ = nullptr;
+    std::uint64_t lastCycles_ = 0;
+    std::uint64_t lastMisses_ = 0;
+
+    std::atomic<int> index_{0};
+    std::uint64_t lastDownUs_ = 0;
+    bool steppedDown_ = false;
+    std::uint64_t coolSinceUs_ = 0;
+    bool cool_ = false;
+    QualityInputs last_;
+
+    std::atomic<std::uint64_t> stepsDown_{0};
+    std::atomic<std::uint64_t> stepsUp_{0};
+};
+
+} // namespace aas
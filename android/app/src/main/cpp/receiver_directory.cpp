@@ -0,0 +1,368 @@
+#include "receiver_directory.h"
+
+#include <android/multinetwork.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "aas/clock.h"
+#include "aas/packet_header.h"
+#include "aas/timing.h"
+
+namespace aas {
+
+namespace {
+
+/// Added to the scores of receivers that cannot take a stream, so they
+/// keep their relative order at the bottom of the list.
+constexpr double kFullRankUs = 1e9;
+constexpr double kUnreachableRankUs = 2e9;
+
+bool sameEndpoint(const sockaddr_in& a, const sockaddr_in& b) {
+    return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+int openSocket(std::uint64_t netHandle) {
+    const int fd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (netHandle != 0 && android_setsocknetwork(static_cast<net_handle_t>(netHandle), fd) != 0) {
+        const int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    // Bind now so poll() sees answers even before the first send.
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    if (::bind(fd, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        errno = err;
+        return -1;
+    }
+    return fd;
+}
+
+} // namespace
+
+ReceiverDirectory::~ReceiverDirectory() { stop(); }
+
+bool ReceiverDirectory::start(const ReceiverDirectoryConfig& config) {
+    stop();
+    config_ = config;
+    config_.burstProbes = std::max<std::uint32_t>(config_.burstProbes, 1);
+    queryFd_ = openSocket(config_.netHandle);
+    probeFd_ = queryFd_ < 0 ? -1 : openSocket(config_.netHandle);
+    const int ttl = 255;
+    if (probeFd_ < 0 || ::setsockopt(queryFd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) != 0) {
+        lastError_ = errno;
+        closeSockets();
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopping_ = false;
+        refresh_ = false;
+    }
+    lastError_ = 0;
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void ReceiverDirectory::stop() {
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        thread_.join();
+    }
+    closeSockets();
+}
+
+void ReceiverDirectory::closeSockets() {
+    if (queryFd_ >= 0) {
+        ::close(queryFd_);
+        queryFd_ = -1;
+    }
+    if (probeFd_ >= 0) {
+        ::close(probeFd_);
+        probeFd_ = -1;
+    }
+}
+
+void ReceiverDirectory::addManual(const sockaddr_in& address, const std::string& name) {
+    DiscoveredReceiver receiver;
+    receiver.address = address;
+    receiver.advert.instance = name;
+    receiver.manual = true;
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        changes_.emplace_back(receiver, true);
+        refresh_ = true;
+    }
+    wake_.notify_all();
+}
+
+void ReceiverDirectory::remove(const sockaddr_in& address) {
+    DiscoveredReceiver receiver;
+    receiver.address = address;
+    std::lock_guard<std::mutex> guard(lock_);
+    changes_.emplace_back(receiver, false);
+}
+
+void ReceiverDirectory::refreshNow() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        refresh_ = true;
+    }
+    wake_.notify_all();
+}
+
+std::vector<DiscoveredReceiver> ReceiverDirectory::snapshot() const {
+    std::lock_guard<std::mutex> guard(lock_);
+    return published_;
+}
+
+bool ReceiverDirectory::best(DiscoveredReceiver& out) const {
+    std::lock_guard<std::mutex> guard(lock_);
+    // published_ is sorted, so the first usable entry is the best one.
+    if (published_.empty() || published_.front().scoreUs >= kFullRankUs) {
+        return false;
+    }
+    out = published_.front();
+    return true;
+}
+
+ReceiverDirectory::Entry* ReceiverDirectory::find(const sockaddr_in& address) {
+    for (Entry& entry : entries_) {
+        if (sameEndpoint(entry.info.address, address)) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void ReceiverDirectory::run() {
+    for (;;) {
+        std::vector<std::pair<DiscoveredReceiver, bool>> changes;
+        {
+            std::lock_guard<std::mutex> guard(lock_);
+            if (stopping_) {
+                return;
+            }
+            changes.swap(changes_);
+            refresh_ = false;
+        }
+        for (const auto& [receiver, add] : changes) {
+            Entry* existing = find(receiver.address);
+            if (add && existing != nullptr) {
+                existing->info.manual = true;
+            } else if (add && entries_.size() < kMaxReceivers) {
+                Entry entry;
+                entry.info = receiver;
+                entries_.push_back(entry);
+            } else if (!add && existing != nullptr) {
+                entries_.erase(entries_.begin() + (existing - entries_.data()));
+            }
+        }
+
+        round(monotonicMicros());
+        publish(monotonicMicros());
+        rounds_.fetch_add(1, std::memory_order_relaxed);
+
+        std::unique_lock<std::mutex> guard(lock_);
+        wake_.wait_for(guard, std::chrono::microseconds(config_.refreshUs),
+                       [this] { return stopping_ || refresh_; });
+    }
+}
+
+void ReceiverDirectory::round(std::uint64_t nowUs) {
+    expire(nowUs);
+    std::uint8_t query[kDnsSdMessageBytes];
+    const std::size_t size = writeMdnsQuery(nextQueryId_++, query, sizeof(query));
+    sockaddr_in group{};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(kMdnsPort);
+    group.sin_addr.s_addr = htonl(kMdnsGroupV4);
+    ::sendto(queryFd_, query, size, 0, reinterpret_cast<const sockaddr*>(&group), sizeof(group));
+
+    for (Entry& entry : entries_) {
+        entry.sent = 0;
+        entry.echoed = 0;
+    }
+    // Probes start one spacing in, so the first answers to the query are
+    // already in the table.
+    std::uint64_t nextUs = monotonicMicros() + kProbeSpacingUs;
+    for (std::uint32_t k = 0; k < config_.burstProbes; ++k) {
+        listen(nextUs);
+        nextUs += kProbeSpacingUs;
+        for (Entry& entry : entries_) {
+            TimingMessage probe{};
+            probe.kind = TimingKind::kProbe;
+            probe.pingId = nextProbeId_++;
+            probe.t1 = monotonicMicros();
+            std::uint8_t datagram[kPacketHeaderBytes + kTimingMessageBytes];
+            const std::size_t length = writeTimingDatagram(probe, 0, datagram);
+            const auto* to = reinterpret_cast<const sockaddr*>(&entry.info.address);
+            if (::sendto(probeFd_, datagram, length, 0, to, sizeof(entry.info.address)) ==
+                static_cast<ssize_t>(length)) {
+                ++entry.sent;
+            }
+        }
+    }
+    listen(monotonicMicros() + kSettleUs);
+
+    for (Entry& entry : entries_) {
+        if (entry.sent > 0) {
+            const std::uint32_t lost = entry.sent - std::min(entry.echoed, entry.sent);
+            entry.info.lossPermille = lost * 1000 / entry.sent;
+        }
+    }
+}
+
+void ReceiverDirectory::listen(std::uint64_t untilUs) {
+    pollfd fds[2] = {{queryFd_, POLLIN, 0}, {probeFd_, POLLIN, 0}};
+    std::uint8_t buffer[kMaxDatagramBytes];
+    for (;;) {
+        const std::uint64_t nowUs = monotonicMicros();
+        if (nowUs >= untilUs) {
+            return;
+        }
+        const int timeoutMs = static_cast<int>((untilUs - nowUs + 999) / 1000);
+        if (::poll(fds, 2, timeoutMs) <= 0) {
+            continue;
+        }
+        for (int i = 0; i < 2; ++i) {
+            if ((fds[i].revents & POLLIN) == 0) {
+                continue;
+            }
+            for (;;) {
+                sockaddr_in from{};
+                socklen_t fromLength = sizeof(from);
+                const ssize_t size = ::recvfrom(fds[i].fd, buffer, sizeof(buffer), 0,
+                                                reinterpret_cast<sockaddr*>(&from), &fromLength);
+                if (size <= 0) {
+                    break;
+                }
+                const std::uint64_t arrivalUs = monotonicMicros();
+                if (i == 0) {
+                    ReceiverAdvert advert;
+                    if (readReceiverAdvert(buffer, static_cast<std::size_t>(size), advert)) {
+                        onAdvert(advert, arrivalUs);
+                    }
+                } else {
+                    onEcho(from, buffer, static_cast<std::size_t>(size), arrivalUs);
+                }
+            }
+        }
+    }
+}
+
+void ReceiverDirectory::onAdvert(const ReceiverAdvert& advert, std::uint64_t nowUs) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = advert.ipv4;
+    address.sin_port = htons(advert.port);
+    Entry* entry = find(address);
+    if (entry == nullptr) {
+        // Same instance under a new address (DHCP renewal): move it.
+        for (Entry& candidate : entries_) {
+            if (!candidate.info.manual && candidate.info.advert.instance == advert.instance) {
+                entry = &candidate;
+                break;
+            }
+        }
+    }
+    if (advert.ttlSec == 0) {
+        if (entry != nullptr && !entry->info.manual) {
+            entries_.erase(entries_.begin() + (entry - entries_.data()));
+        }
+        return;
+    }
+    if (entry == nullptr) {
+        if (entries_.size() >= kMaxReceivers) {
+            return;
+        }
+        entries_.emplace_back();
+        entry = &entries_.back();
+    }
+    entry->info.advert = advert;
+    entry->info.address = address;
+    entry->expiresUs = nowUs + std::uint64_t{advert.ttlSec} * 1'000'000;
+}
+
+void ReceiverDirectory::onEcho(const sockaddr_in& from, const std::uint8_t* data, std::size_t size,
+                               std::uint64_t t4) {
+    PacketHeader header;
+    if (!readPacketHeader(data, size, header) || !header.hasFlag(kFlagTiming) ||
+        size < kPacketHeaderBytes + kTimingMessageBytes) {
+        return;
+    }
+    TimingMessage echo;
+    std::memcpy(&echo, data + size - kTimingMessageBytes, kTimingMessageBytes);
+    Entry* entry = find(from);
+    if (echo.kind != TimingKind::kProbeEcho || entry == nullptr || t4 < echo.t1 || echo.t3 < echo.t2) {
+        return;
+    }
+    const std::uint64_t held = echo.t3 - echo.t2;
+    const double rtt = static_cast<double>(t4 - echo.t1 > held ? t4 - echo.t1 - held : 0);
+    if (entry->lastEchoUs == 0) {
+        entry->srttUs = rtt;
+        entry->jitterUs = rtt / 2.0;
+    } else {
+        entry->jitterUs += (std::fabs(rtt - entry->srttUs) - entry->jitterUs) / 4.0;
+        entry->srttUs += (rtt - entry->srttUs) / 8.0;
+    }
+    entry->lastEchoUs = t4;
+    ++entry->echoed;
+}
+
+void ReceiverDirectory::expire(std::uint64_t nowUs) {
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [nowUs](const Entry& entry) {
+                                      return !entry.info.manual && nowUs >= entry.expiresUs;
+                                  }),
+                   entries_.end());
+}
+
+double ReceiverDirectory::score(const Entry& entry, std::uint64_t nowUs) {
+    const DiscoveredReceiver& info = entry.info;
+    double score = entry.srttUs + 4.0 * entry.jitterUs + info.lossPermille / 1000.0 * kLossPenaltyUs +
+                   info.advert.loadPercent / 100.0 * kLoadPenaltyUs;
+    if (entry.lastEchoUs == 0 || nowUs >= entry.lastEchoUs + kStaleUs) {
+        score += kUnreachableRankUs;
+    } else if (info.advert.maxStreams != 0 && info.advert.streams >= info.advert.maxStreams) {
+        score += kFullRankUs;
+    }
+    return score;
+}
+
+void ReceiverDirectory::publish(std::uint64_t nowUs) {
+    std::vector<DiscoveredReceiver> table;
+    table.reserve(entries_.size());
+    for (const Entry& entry : entries_) {
+        DiscoveredReceiver info = entry.info;
+        info.reachable = entry.lastEchoUs != 0 && nowUs < entry.lastEchoUs + kStaleUs;
+        info.srttUs = static_cast<std::uint32_t>(entry.srttUs);
+        info.jitterUs = static_cast<std::uint32_t>(entry.jitterUs);
+        info.scoreUs = score(entry, nowUs);
+        table.push_back(info);
+    }
+    std::sort(table.begin(), table.end(), [](const DiscoveredReceiver& a, const DiscoveredReceiver& b) {
+        return a.scoreUs < b.scoreUs;
+    });
+    std::lock_guard<std::mutex> guard(lock_);
+    published_.swap(table);
+}
+
+} // namespace aas
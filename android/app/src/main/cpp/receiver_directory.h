@@ -0,0 +1,149 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "aas/dns_sd.h"
+
+namespace aas {
+
+/// One receiver the phone can stream to, as last measured.
+struct DiscoveredReceiver {
+    ReceiverAdvert advert;
+    /// Media endpoint (advert address and port, or the entered one).
+    sockaddr_in address{};
+    /// Added with addManual() (typed address or a PairingProfile) rather
+    /// than advertised; kept while it stays unanswered.
+    bool manual = false;
+    /// Answered a probe within the last kStaleUs.
+    bool reachable = false;
+    std::uint32_t srttUs = 0;
+    std::uint32_t jitterUs = 0;
+    /// Probe loss over the last burst, in 1/1000.
+    std::uint32_t lossPermille = 0;
+    /// Rank key, lower is better (ReceiverDirectory::score()).
+    double scoreUs = 0.0;
+};
+
+struct ReceiverDirectoryConfig {
+    /// android.net.Network.getNetworkHandle() of the Wi-Fi network, or 0.
+    std::uint64_t netHandle = 0;
+    /// Interval between query + probe rounds.
+    std::uint64_t refreshUs = 3'000'000;
+    /// Probes per receiver per round, kProbeSpacingUs apart.
+    std::uint32_t burstProbes = 8;
+};
+
+/// Background table of receivers on the LAN, ranked by how well they would
+/// carry a stream right now (docs/protocol.md, Discovery).
+///
+/// A plain (non-realtime) thread runs one round every refreshUs: a
+/// one-shot kAasServiceType query to 224.0.0.251:5353 from an ephemeral
+/// port, so answers come back unicast and no WifiManager.MulticastLock is
+/// needed, then a burst of path probes (TimingKind::kProbe, the same
+/// messages PathSelector sends) to every known receiver's media port.
+/// RIO echoes probes from any address without claiming a stream slot, so
+/// a burst costs the receiver nothing. RTT and jitter are smoothed per
+/// echo as PathSelector does, so the ranking and the later path choice
+/// agree.
+///
+/// Rank is srtt + 4 x jitter plus loss and load penalties; receivers that
+/// are full (streams == maxStreams) or unanswered for kStaleUs sort last.
+/// Advertised entries expire at their record TTL (or at once on a
+/// goodbye); manual ones stay until removed.
+///
+/// snapshot() and best() copy the last published table under a mutex the
+/// discovery thread only holds to swap it, never across a socket call, so
+/// the UI thread can pick a receiver instantly.
+class ReceiverDirectory {
+public:
+    static constexpr std::size_t kMaxReceivers = 32;
+    static constexpr std::uint64_t kProbeSpacingUs = 5'000;
+    /// How long to keep listening after a round's last probe.
+    static constexpr std::uint64_t kSettleUs = 150'000;
+    static constexpr std::uint64_t kStaleUs = 10'000'000;
+    /// Score added at 100 % probe loss, as PathSelector::kLossPenaltyUs.
+    static constexpr double kLossPenaltyUs = 20'000.0;
+    /// Score added at 100 % decode load.
+    static constexpr double kLoadPenaltyUs = 2'000.0;
+
+    ReceiverDirectory() = default;
+    ~ReceiverDirectory();
+    ReceiverDirectory(const ReceiverDirectory&) = delete;
+    ReceiverDirectory& operator=(const ReceiverDirectory&) = delete;
+
+    /// Opens the sockets and starts the discovery thread. Returns false and
+    /// records errno in lastError() on failure.
+    bool start(const ReceiverDirectoryConfig& config = {});
+    void stop();
+    bool running() const { return thread_.joinable(); }
+
+    /// Adds a receiver by address; it is probed and ranked like the rest.
+    void addManual(const sockaddr_in& address, const std::string& name);
+    void remove(const sockaddr_in& address);
+    /// Starts the next round now (Start pressed, network changed).
+    void refreshNow();
+
+    /// Receivers, best first.
+    std::vector<DiscoveredReceiver> snapshot() const;
+    /// The top-ranked reachable receiver with a free stream slot.
+    bool best(DiscoveredReceiver& out) const;
+
+    std::uint64_t rounds() const { return rounds_.load(std::memory_order_relaxed); }
+    int lastError() const { return lastError_; }
+
+private:
+    struct Entry {
+        DiscoveredReceiver info;
+        std::uint64_t expiresUs = 0;
+        std::uint64_t lastEchoUs = 0;
+        std::uint32_t sent = 0;
+        std::uint32_t echoed = 0;
+        double srttUs = 0.0;
+        double jitterUs = 0.0;
+    };
+
+    void run();
+    void round(std::uint64_t nowUs);
+    /// Reads both sockets until `untilUs`.
+    void listen(std::uint64_t untilUs);
+    void onAdvert(const ReceiverAdvert& advert, std::uint64_t nowUs);
+    void onEcho(const sockaddr_in& from, const std::uint8_t* data, std::size_t size, std::uint64_t t4);
+    void expire(std::uint64_t nowUs);
+    void publish(std::uint64_t nowUs);
+    Entry* find(const sockaddr_in& address);
+    static double score(const Entry& entry, std::uint64_t nowUs);
+    void closeSockets();
+
+    ReceiverDirectoryConfig config_;
+    int queryFd_ = -1;
+    int probeFd_ = -1;
+    std::uint16_t nextQueryId_ = 1;
+    std::uint16_t nextProbeId_ = 0;
+
+    // Discovery thread only.
+    std::vector<Entry> entries_;
+
+    mutable std::mutex lock_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+    bool refresh_ = false;
+    std::vector<DiscoveredReceiver> published_;
+    /// addManual() / remove() requests for the discovery thread.
+    std::vector<std::pair<DiscoveredReceiver, bool>> changes_;
+    std::thread thread_;
+
+    std::atomic<std::uint64_t> rounds_{0};
+    int lastError_ = 0;
+};
+
+} // namespace aas
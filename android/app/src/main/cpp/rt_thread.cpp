@@ -0,0 +1,144 @@
+#include "rt_thread.h"
+
+#include <dlfcn.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+#include "aas/rt_check_hooks.h"
+
+struct APerformanceHintManager;
+
+namespace aas {
+
+namespace {
+
+constexpr int kUrgentAudioNice = -19;  // android.os.Process.THREAD_PRIORITY_URGENT_AUDIO
+constexpr int kMaxCpus = 16;
+
+/// APerformanceHint entry points, looked up at run time: the NDK symbols
+/// only exist from API 33 and the app's minimum is 29.
+struct HintApi {
+    APerformanceHintManager* (*getManager)() = nullptr;
+    APerformanceHintSession* (*createSession)(APerformanceHintManager*, const std::int32_t*, std::size_t,
+                                              std::int64_t) = nullptr;
+    int (*reportActual)(APerformanceHintSession*, std::int64_t) = nullptr;
+    void (*closeSession)(APerformanceHintSession*) = nullptr;
+    APerformanceHintManager* manager = nullptr;
+
+    HintApi() {
+        void* lib = dlopen("libandroid.so", RTLD_NOW | RTLD_NOLOAD);
+        if (lib == nullptr) {
+            lib = dlopen("libandroid.so", RTLD_NOW);
+        }
+        if (lib == nullptr) {
+            return;
+        }
+        getManager = reinterpret_cast<decltype(getManager)>(dlsym(lib, "APerformanceHint_getManager"));
+        createSession =
+            reinterpret_cast<decltype(createSession)>(dlsym(lib, "APerformanceHint_createSession"));
+        reportActual = reinterpret_cast<decltype(reportActual)>(
+            dlsym(lib, "APerformanceHint_reportActualWorkDuration"));
+        closeSession = reinterpret_cast<decltype(closeSession)>(dlsym(lib, "APerformanceHint_closeSession"));
+        if (getManager != nullptr && createSession != nullptr && reportActual != nullptr &&
+            closeSession != nullptr) {
+            manager = getManager();
+        }
+    }
+};
+
+const HintApi& hintApi() {
+    static const HintApi api;
+    return api;
+}
+
+long maxFrequencyKHz(int cpu) {
+    char path[96];
+    std::snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cpufreq/cpuinfo_max_freq", cpu);
+    std::FILE* file = std::fopen(path, "r");
+    if (file == nullptr) {
+        return -1;
+    }
+    long khz = -1;
+    if (std::fscanf(file, "%ld", &khz) != 1) {
+        khz = -1;
+    }
+    std::fclose(file);
+    return khz;
+}
+
+/// Cores of the fastest cluster, read once. Empty if cpufreq is hidden.
+const cpu_set_t& bigCores() {
+    static const cpu_set_t set = [] {
+        cpu_set_t big;
+        CPU_ZERO(&big);
+        long khz[kMaxCpus];
+        long top = -1;
+        for (int cpu = 0; cpu < kMaxCpus; ++cpu) {
+            khz[cpu] = maxFrequencyKHz(cpu);
+            top = khz[cpu] > top ? khz[cpu] : top;
+        }
+        for (int cpu = 0; cpu < kMaxCpus && top > 0; ++cpu) {
+            if (khz[cpu] == top) {
+                CPU_SET(cpu, &big);
+            }
+        }
+        return big;
+    }();
+    return set;
+}
+
+} // namespace
+
+RtScope::RtScope(const RtThreadConfig& config)
+    : stats_(ThreadRegistry::instance().claim(config.role, config.budgetUs)) {
+    if (config.core >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(config.core, &set);
+        if (sched_setaffinity(0, sizeof(set), &set) == 0) {
+            stats_.core.store(config.core, std::memory_order_relaxed);
+        }
+    } else if (config.bigCores && CPU_COUNT(&bigCores()) > 0) {
+        sched_setaffinity(0, sizeof(cpu_set_t), &bigCores());
+    }
+
+    sched_param param{};
+    param.sched_priority = config.fifoPriority;
+    if (sched_setscheduler(0, SCHED_FIFO, &param) == 0) {
+        stats_.grant.store(RtGrant::kFifo, std::memory_order_relaxed);
+    } else {
+        if (setpriority(PRIO_PROCESS, 0, kUrgentAudioNice) == 0) {
+            stats_.grant.store(RtGrant::kNice, std::memory_order_relaxed);
+        }
+        const HintApi& api = hintApi();
+        if (api.manager != nullptr && config.budgetUs > 0) {
+            const std::int32_t tid = gettid();
+            hint_ = api.createSession(api.manager, &tid, 1, static_cast<std::int64_t>(config.budgetUs) * 1000);
+            if (hint_ != nullptr) {
+                stats_.grant.store(RtGrant::kPerformanceHint, std::memory_order_relaxed);
+            }
+        }
+    }
+    // Tagged last: setting up the policy may allocate (dlopen), the thread
+    // must not afterwards.
+    RtCheck::enterRealtime(config.role);
+}
+
+RtScope::~RtScope() {
+    RtCheck::leaveRealtime();
+    if (hint_ != nullptr) {
+        hintApi().closeSession(hint_);
+    }
+}
+
+void RtScope::cycle(std::uint64_t activeUs) {
+    stats_.record(activeUs);
+    if (hint_ != nullptr) {
+        hintApi().reportActual(hint_, static_cast<std::int64_t>(activeUs) * 1000);
+    }
+}
+
+} // namespace aas
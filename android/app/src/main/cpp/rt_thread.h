@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "aas/clock.h"
+#include "aas/rt_check.h"
+#include "aas/thread_stats.h"
+
+struct APerformanceHintSession;
+
+namespace aas {
+
+/// Scheduling every sender thread asks for. One place decides it, so a
+/// stage cannot end up time-shared on a little core by accident.
+struct RtThreadConfig {
+    ThreadRole role = ThreadRole::kCount;
+    /// Longest a cycle may stay busy before it counts as a deadline miss,
+    /// and the target reported to the performance hint session; 0 = count
+    /// cycles only.
+    std::uint32_t budgetUs = 0;
+    /// Core to pin to; -1 uses the big cluster (or no pinning when
+    /// bigCores is false).
+    int core = -1;
+    bool bigCores = true;
+    /// SCHED_FIFO priority to ask for. AAudio's own callback threads sit at
+    /// 2; keeping ours at or below it leaves the device callback on top.
+    int fifoPriority = 2;
+};
+
+/// Applies an RtThreadConfig to the calling thread for the scope's
+/// lifetime and claims the thread's ThreadStats entry.
+///
+/// Placement: the given core, else every core of the highest-frequency
+/// cluster (cpuinfo_max_freq), so the thread never lands on a little core
+/// the scheduler has not ramped up. Priority, in order of preference:
+/// SCHED_FIFO (granted to apps only on some builds), else nice -19
+/// (THREAD_PRIORITY_URGENT_AUDIO) plus, on API 33+, an APerformanceHint
+/// session fed each cycle's actual duration so the governor raises clocks
+/// before the deadline is lost. Destroy on the thread that created it.
+class RtScope {
+public:
+    explicit RtScope(const RtThreadConfig& config);
+    ~RtScope();
+    RtScope(const RtScope&) = delete;
+    RtScope& operator=(const RtScope&) = delete;
+
+    ThreadStats& stats() { return stats_; }
+    RtGrant grant() const { return stats_.grant.load(std::memory_order_relaxed); }
+
+    /// Marks the start of a cycle's busy part (after the wait that ends
+    /// the previous one); returns the time to hand to end().
+    std::uint64_t begin() {
+        RtCheck::beginCycle();
+        return monotonicMicros();
+    }
+    /// Ends the cycle begun at `startUs`.
+    void end(std::uint64_t startUs) {
+        RtCheck::endCycle();
+        cycle(monotonicMicros() - startUs);
+    }
+
+    /// Ends one cycle that was busy for `activeUs`.
+    void cycle(std::uint64_t activeUs);
+
+private:
+    ThreadStats& stats_;
+    APerformanceHintSession* hint_ = nullptr;
+};
+
+/// std::thread that runs `body(RtScope&)` under `config`.
+class RtThread {
+public:
+    RtThread() = default;
+    ~RtThread() { join(); }
+    RtThread(const RtThread&) = delete;
+    RtThread& operator=(const RtThread&) = delete;
+
+    template <typename Body>
+    void start(const RtThreadConfig& config, Body&& body) {
+        join();
+        thread_ = std::thread([config, body = std::forward<Body>(body)]() mutable {
+            RtScope scope(config);
+            body(scope);
+        });
+    }
+
+    bool joinable() const { return thread_.joinable(); }
+    void join() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    std::thread thread_;
+};
+
+} // namespace aas
@@ -0,0 +1,71 @@
+#include "sender_control.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "path_selector.h"
+
+namespace aas {
+
+SenderControl::SenderControl(PathSelector& paths) : paths_(paths) {
+    fec_.store(fecController_.settings());
+    paths_.setControlChannel(&channel_);
+}
+
+SenderControl::~SenderControl() { paths_.setControlChannel(nullptr); }
+
+bool SenderControl::postGain(ControlType type, std::uint16_t value, std::uint16_t rampSamples) {
+    GainCommand command{};
+    command.value = value;
+    command.rampSamples = rampSamples;
+    if (!channel_.post(ControlMessage::make(type, command))) {
+        return false;
+    }
+    paths_.wake();
+    return true;
+}
+
+bool SenderControl::setReceiverVolume(float gain, std::uint16_t rampSamples) {
+    const float q12 = std::round(std::clamp(gain, 0.0f, kMaxRemoteGain) * kUnityGainQ12);
+    return postGain(ControlType::kVolume, static_cast<std::uint16_t>(q12), rampSamples);
+}
+
+bool SenderControl::pauseReceiver(bool paused, std::uint16_t rampSamples) {
+    return postGain(ControlType::kPause, paused ? 1 : 0, rampSamples);
+}
+
+void SenderControl::service() {
+    ControlMessage message;
+    while (channel_.receive(message)) {
+        if (applyGainCommand(message, setting_)) {
+            gain_.store(setting_);
+            continue;
+        }
+        if (message.type == ControlType::kCodecRequest) {
+            if (message.read(codec_.request)) {
+                ++codec_.serial;
+                codecChange_.store(codec_);
+            }
+            continue;
+        }
+        ReceiverReport report;
+        if (message.type == ControlType::kReceiverReport && message.read(report)) {
+            // Loss before FEC: what protection has to cover.
+            fec_.store(fecController_.update(static_cast<float>(report.lossPermille) / 1000.0f));
+            report_.store(report);
+            reports_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+bool SenderControl::takeCodecRequest(CodecRequest& out) {
+    const CodecChange change = codecChange_.load();
+    if (change.serial == codecTaken_) {
+        return false;
+    }
+    codecTaken_ = change.serial;
+    out = change.request;
+    return true;
+}
+
+} // namespace aas
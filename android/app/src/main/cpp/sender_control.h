@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/control_channel.h"
+#include "aas/gain_ramp.h"
+#include "aas/seqlock.h"
+#include "fec_encoder.h"
+
+namespace aas {
+
+class PathSelector;
+
+/// A codec or bitrate change the PC asked for; `serial` counts requests.
+struct CodecChange {
+    std::uint32_t serial = 0;
+    CodecRequest request{};
+};
+
+/// Phone end of the control channel (docs/protocol.md, Control Channel).
+///
+/// Owns the ControlChannel the PathSelector multiplexes on the media
+/// sockets and turns what arrives on it into settings for the encode
+/// thread:
+///   - volume and pause for the captured signal, applied sample-accurately
+///     by applyCaptureGain();
+///   - codec and bitrate requests, taken once each by takeCodecRequest();
+///   - receiver reports, fed to a FecController whose settings
+///     fecSettings() returns; lastReport() keeps the PC's delay figures for
+///     the BatchController and the UI.
+///
+/// Threads: the send thread (the one running the PathSelector) calls
+/// service() after every PathSelector::service(); the encode thread calls
+/// applyCaptureGain(), fecSettings() and takeCodecRequest(); one UI thread
+/// sends commands to the PC, which wake the send thread so they leave at
+/// once; anyone may read stats() and lastReport().
+class SenderControl {
+public:
+    /// Attaches the channel to `paths`, which must outlive this object.
+    explicit SenderControl(PathSelector& paths);
+    ~SenderControl();
+    SenderControl(const SenderControl&) = delete;
+    SenderControl& operator=(const SenderControl&) = delete;
+
+    /// UI thread: volume and pause of the PC's playout of this stream.
+    /// Each returns false when the command queue is full. `rampSamples` 0
+    /// ramps over one frame.
+    bool setReceiverVolume(float gain, std::uint16_t rampSamples = 0);
+    bool pauseReceiver(bool paused, std::uint16_t rampSamples = 0);
+
+    /// Send thread. Handles every message the channel has delivered.
+    void service();
+
+    /// Encode thread. Applies the PC's volume and pause to a captured frame.
+    void applyCaptureGain(AudioFrame& frame) { ramp_.apply(frame, gain_.load()); }
+    /// Encode thread. Protection for FecEncoder::configure(), following the
+    /// receiver's reports (no protection before the first).
+    FecSettings fecSettings() const { return fec_.load(); }
+    /// Encode thread. True, once per request, when the PC asked for another
+    /// codec, frame length or bitrate.
+    bool takeCodecRequest(CodecRequest& out);
+
+    /// The receiver's last report, and whether one has arrived.
+    ReceiverReport lastReport() const { return report_.load(); }
+    bool haveReport() const { return reports_.load(std::memory_order_relaxed) > 0; }
+    std::uint64_t reports() const { return reports_.load(std::memory_order_relaxed); }
+    const ControlChannelStats& stats() const { return channel_.stats(); }
+
+private:
+    bool postGain(ControlType type, std::uint16_t value, std::uint16_t rampSamples);
+
+    PathSelector& paths_;
+    ControlChannel channel_;
+
+    // Send thread.
+    GainSetting setting_{};
+    FecController fecController_;
+    CodecChange codec_{};
+
+    SeqLock<GainSetting> gain_;
+    SeqLock<FecSettings> fec_;
+    SeqLock<CodecChange> codecChange_;
+    SeqLock<ReceiverReport> report_;
+    std::atomic<std::uint64_t> reports_{0};
+
+    // Encode thread.
+    GainRamp ramp_;
+    std::uint32_t codecTaken_ = 0;
+};
+
+} // namespace aas
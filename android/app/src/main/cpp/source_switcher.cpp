@@ -0,0 +1,254 @@
+#include "source_switcher.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "aas/sample_format.h"
+
+namespace aas {
+
+namespace {
+
+constexpr double kHalfPi = 1.57079632679489661923;
+
+std::uint64_t samplesToUs(std::size_t samples) {
+    return static_cast<std::uint64_t>(samples) * 1'000'000ull / kSampleRateHz;
+}
+
+} // namespace
+
+SourceSwitcher::SourceSwitcher(FrameRing& system, FrameRing& mic, FrameRing& out,
+                               const SourceSwitcherConfig& config)
+    : system_(system), mic_(mic), out_(out), config_(config) {
+    config_.fadeSamples = std::clamp<std::uint32_t>(config_.fadeSamples, 1, kMaxFadeSamples);
+    config_.channels =
+        std::clamp<std::uint16_t>(config_.channels, 1, static_cast<std::uint16_t>(kMaxFrameChannels));
+    config_.maxHoldFrames = std::min<std::uint32_t>(config_.maxHoldFrames, kFrameRingSlots - 2);
+    const std::uint32_t n = config_.fadeSamples;
+    for (std::uint32_t k = 0; k <= n; ++k) {
+        fadeIn_[k] = static_cast<float>(std::sin(kHalfPi * k / n));
+    }
+}
+
+void SourceSwitcher::begin(CaptureSource initial) {
+    const auto source = static_cast<std::uint8_t>(initial);
+    state_.store(kIdle, std::memory_order_relaxed);
+    pending_.store(kNone, std::memory_order_relaxed);
+    offset_[0] = 0;
+    offset_[1] = 0;
+    active_.store(source, std::memory_order_release);
+    driver_.store(source, std::memory_order_release);
+}
+
+bool SourceSwitcher::requestSwitch(CaptureSource to) {
+    if (to == active() || switching()) {
+        return false;
+    }
+    pending_.store(static_cast<std::uint8_t>(to), std::memory_order_release);
+    return true;
+}
+
+std::size_t SourceSwitcher::available(std::uint8_t source) {
+    const std::size_t frames = ring(source).readAvailable();
+    return frames == 0 ? 0 : frames * kFrameSamples - offset_[source];
+}
+
+void SourceSwitcher::read(std::uint8_t source, AudioFrame& dst) {
+    FrameRing& in = ring(source);
+    std::size_t& offset = offset_[source];
+    const std::size_t channels = config_.channels;
+    const AudioFrame& first = in.peek(0);
+    dst.captureUs = first.captureUs == 0 ? 0 : first.captureUs + samplesToUs(offset);
+    dst.flags = offset == 0 ? first.flags : 0;
+
+    std::size_t done = 0;
+    while (done < kFrameSamples) {
+        const AudioFrame& frame = in.peek(0);
+        const std::size_t take = std::min(kFrameSamples - offset, kFrameSamples - done);
+        const ChannelMap map = ChannelMap::forChannels(frame.channels, channels);
+        remapChannels(frame.samples + offset * frame.channels, frame.channels, dst.samples + done * channels,
+                      channels, take, map);
+        dst.callbackUs = frame.callbackUs;
+        done += take;
+        offset += take;
+        if (offset == kFrameSamples) {
+            in.release();
+            offset = 0;
+        }
+    }
+}
+
+SourceSwitcher::Alignment SourceSwitcher::align(std::uint64_t targetUs) {
+    FrameRing& in = ring(incoming_);
+    offset_[incoming_] = 0;
+    for (std::size_t frames = in.readAvailable(); frames > 0; frames = in.readAvailable()) {
+        const AudioFrame& front = in.peek(0);
+        if (targetUs == 0 || front.captureUs == 0) {
+            // No timestamps to line up: join at the newest frame.
+            in.release(frames - 1);
+            return Alignment::kAligned;
+        }
+        if (front.captureUs + kFrameDurationUs <= targetUs) {
+            in.release();
+            continue;
+        }
+        if (front.captureUs <= targetUs) {
+            offset_[incoming_] = std::min<std::size_t>(
+                static_cast<std::size_t>((targetUs - front.captureUs) * kSampleRateHz / 1'000'000ull),
+                kFrameSamples - 1);
+            return Alignment::kAligned;
+        }
+        // The incoming stream starts after the target: close enough to
+        // start at its first sample, or the outgoing side has to catch up.
+        return front.captureUs - targetUs < kFrameDurationUs ? Alignment::kAligned : Alignment::kAhead;
+    }
+    return Alignment::kBehind;
+}
+
+AudioFrame& SourceSwitcher::beginOutput() {
+    AudioFrame* slot = out_.writeSlot();
+    outputIsScratch_ = slot == nullptr;
+    if (outputIsScratch_) {
+        overruns_.fetch_add(1, std::memory_order_relaxed);
+        return scratch_;
+    }
+    return *slot;
+}
+
+void SourceSwitcher::publish(AudioFrame& frame) {
+    frame.sampleClock = sampleClock_;
+    frame.channels = config_.channels;
+    if (!outputIsScratch_) {
+        out_.publish();
+    }
+    // The clock advances through a dropped frame, as capture's does.
+    sampleClock_ += static_cast<std::uint32_t>(kFrameSamples);
+}
+
+void SourceSwitcher::fade(AudioFrame& out, bool abandoning) {
+    const std::size_t channels = config_.channels;
+    const std::uint32_t n = config_.fadeSamples;
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        const float gainOut = fadeIn_[n - fadePos_];
+        const float gainIn = fadeIn_[fadePos_];
+        float* s = out.samples + i * channels;
+        std::size_t j = i;
+        if (abandoning) {
+            // The incoming stream has nothing new: its last frame, played
+            // back and forth from where it stopped, stays continuous while
+            // its gain runs down.
+            const std::size_t p = abandonPos_++ % (2 * kFrameSamples);
+            j = p < kFrameSamples ? kFrameSamples - 1 - p : p - kFrameSamples;
+        }
+        const float* in = incomingFrame_.samples + j * channels;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            s[ch] = gainOut * s[ch] + gainIn * in[ch];
+        }
+        if (abandoning) {
+            fadePos_ = fadePos_ > 0 ? fadePos_ - 1 : 0;
+        } else {
+            fadePos_ = std::min(fadePos_ + 1, n);
+        }
+    }
+}
+
+void SourceSwitcher::drain(std::uint8_t source) {
+    FrameRing& in = ring(source);
+    in.release(in.readAvailable());
+    offset_[source] = 0;
+}
+
+void SourceSwitcher::finishSwitch() {
+    state_.store(kIdle, std::memory_order_release);
+    switches_.fetch_add(1, std::memory_order_relaxed);
+    active_.store(incoming_, std::memory_order_release);
+    // Last store: from here on only the incoming stream's thread pumps.
+    driver_.store(incoming_, std::memory_order_release);
+}
+
+void SourceSwitcher::pump(CaptureSource source) {
+    const auto self = static_cast<std::uint8_t>(source);
+    if (self != driver_.load(std::memory_order_acquire)) {
+        return;
+    }
+    const std::uint8_t other = self ^ 1u;
+    if (state_.load(std::memory_order_relaxed) == kIdle) {
+        const std::uint8_t target = pending_.load(std::memory_order_acquire);
+        if (target != kNone) {
+            if (target == other) {
+                incoming_ = other;
+                aheadFrames_ = 0;
+                state_.store(kAligning, std::memory_order_release);
+            }
+            pending_.store(kNone, std::memory_order_release);
+        }
+    }
+
+    FrameRing& own = ring(self);
+    while (available(self) >= kFrameSamples) {
+        State state = static_cast<State>(state_.load(std::memory_order_relaxed));
+        if (state == kIdle) {
+            drain(other);
+            AudioFrame& out = beginOutput();
+            read(self, out);
+            publish(out);
+            continue;
+        }
+
+        if (state == kAligning) {
+            const AudioFrame& next = own.peek(0);
+            const std::uint64_t targetUs =
+                next.captureUs == 0 ? 0 : next.captureUs + samplesToUs(offset_[self]);
+            const Alignment alignment = align(targetUs);
+            if (alignment == Alignment::kBehind && own.readAvailable() <= config_.maxHoldFrames) {
+                break;
+            }
+            if (alignment == Alignment::kAhead && ++aheadFrames_ <= config_.maxHoldFrames) {
+                AudioFrame& out = beginOutput();
+                read(self, out);
+                publish(out);
+                continue;
+            }
+            if (alignment != Alignment::kAligned) {
+                // Waited long enough: join the incoming stream where it is.
+                offset_[incoming_] = 0;
+                if (available(incoming_) < kFrameSamples) {
+                    state_.store(kIdle, std::memory_order_release);
+                    abandoned_.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+            }
+            fadePos_ = 0;
+            state = kFading;
+            state_.store(kFading, std::memory_order_release);
+        }
+
+        if (state == kFading && available(incoming_) < kFrameSamples) {
+            if (own.readAvailable() <= config_.maxHoldFrames) {
+                break;
+            }
+            state = kAbandoning;
+            state_.store(kAbandoning, std::memory_order_release);
+            abandonPos_ = 0;
+        }
+
+        AudioFrame& out = beginOutput();
+        read(self, out);
+        if (state == kFading) {
+            read(incoming_, incomingFrame_);
+        }
+        fade(out, state == kAbandoning);
+        publish(out);
+
+        if (state == kFading && fadePos_ == config_.fadeSamples) {
+            finishSwitch();
+            return;
+        }
+        if (state == kAbandoning && fadePos_ == 0) {
+            state_.store(kIdle, std::memory_order_release);
+            abandoned_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace aas
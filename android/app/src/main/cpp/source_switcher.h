@@ -0,0 +1,158 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// The two capture streams a session can switch between.
+enum class CaptureSource : std::uint8_t {
+    kSystem,  ///< AudioPlaybackCapture (MediaProjection), fed from the Java reader
+    kMic,     ///< OboeCapture on the microphone
+    kCount,
+};
+
+struct SourceSwitcherConfig {
+    /// Equal-power crossfade length; 240 samples = 5 ms.
+    std::uint32_t fadeSamples = 240;
+    /// Channels of every output frame; a mono source feeds all of them.
+    std::uint16_t channels = 2;
+    /// How many outgoing frames may wait in their ring for the incoming
+    /// source to catch up (alignment, or a late burst mid-fade) before the
+    /// switcher stops waiting. Below kFrameRingSlots so the capture ring
+    /// never overruns while it waits.
+    std::uint32_t maxHoldFrames = 10;
+};
+
+/// Joins the system-audio and mic capture rings into the one ring the
+/// encoder reads, so a source switch never reaches the encoder: its output
+/// has one continuous sample clock and channel count, and the codec state
+/// and packet sequence carry straight across.
+///
+/// Opening the mic or playback-capture stream takes hundreds of
+/// milliseconds, so both streams run during a switch: start the incoming
+/// capture, call requestSwitch(), wait for switching() to clear, then stop
+/// the outgoing capture.
+///
+/// pump() runs on the capture thread, after each callback of the stream
+/// that currently drives the output; calls from the other stream's thread
+/// return at once. The driving thread is the consumer of both rings. It
+/// keeps the idle ring drained so a switch starts from fresh audio. On a
+/// switch it aligns the incoming stream to the outgoing one by capture
+/// timestamp (AudioFrame::captureUs, the converter time of each frame's
+/// first sample) to the nearest sample, holding outgoing frames in their
+/// ring while the incoming side is behind (RNNoise, say, delays the mic by
+/// 17.5 ms). It then crossfades with sin/cos gains over fadeSamples and
+/// hands the output to the incoming stream's thread. Without timestamps
+/// (OpenSL ES) the incoming stream is joined at its newest frame. Reading
+/// continues at the aligned offset, so the incoming frames are split across
+/// output frames from then on; that costs a copy, not latency. If the
+/// incoming stream stalls mid-fade for longer than maxHoldFrames, the
+/// outgoing gain ramps back up along the same curve and the switch is
+/// abandoned; the incoming side ramps down under it over the same span,
+/// from its last frame played back and forth, so it is not cut off at the
+/// gain it had reached.
+///
+/// Output frames carry the source's capture timestamps (adjusted for the
+/// offset) and its flags when they start on a source frame boundary. No
+/// allocation after construction.
+class SourceSwitcher {
+public:
+    static constexpr std::uint32_t kMaxFadeSamples = 960;
+
+    SourceSwitcher(FrameRing& system, FrameRing& mic, FrameRing& out,
+                   const SourceSwitcherConfig& config = {});
+
+    /// Selects the source that drives the output. Before either capture
+    /// starts.
+    void begin(CaptureSource initial);
+
+    /// Asks for a switch to `to` once its capture is running. False if
+    /// `to` already drives the output or a switch is still in progress.
+    /// Control thread.
+    bool requestSwitch(CaptureSource to);
+
+    /// Moves every frame `source` has ready to the output. Capture thread
+    /// of `source`.
+    void pump(CaptureSource source);
+
+    /// The source driving the output; changes when a crossfade completes.
+    CaptureSource active() const {
+        return static_cast<CaptureSource>(active_.load(std::memory_order_acquire));
+    }
+    bool switching() const {
+        return pending_.load(std::memory_order_acquire) != kNone ||
+               state_.load(std::memory_order_acquire) != kIdle;
+    }
+
+    std::uint64_t switches() const { return switches_.load(std::memory_order_relaxed); }
+    std::uint64_t abandoned() const { return abandoned_.load(std::memory_order_relaxed); }
+    /// Output frames dropped because the encoder ring was full.
+    std::uint64_t overruns() const { return overruns_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::uint8_t kNone = 0xff;
+
+    enum State : std::uint8_t {
+        kIdle,
+        kAligning,  ///< switch requested; finding the incoming sample
+        kFading,
+        kAbandoning,  ///< incoming stalled; outgoing gain back to one
+    };
+
+    enum class Alignment : std::uint8_t { kAligned, kBehind, kAhead };
+
+    FrameRing& ring(std::uint8_t source) { return source == 0 ? system_ : mic_; }
+
+    /// Samples readable from `source`'s ring after its cursor.
+    std::size_t available(std::uint8_t source);
+    /// Reads one frame's worth from `source` at its cursor into `dst`,
+    /// remapped to the output channels and stamped. Requires
+    /// available(source) >= kFrameSamples.
+    void read(std::uint8_t source, AudioFrame& dst);
+    /// Places the incoming cursor on the sample captured at `targetUs`.
+    Alignment align(std::uint64_t targetUs);
+    /// Next output slot, or the scratch frame when the encoder ring is full.
+    AudioFrame& beginOutput();
+    void publish(AudioFrame& frame);
+    /// One frame of the crossfade with incomingFrame_ (or its reversal
+    /// when abandoning).
+    void fade(AudioFrame& out, bool abandoning);
+    void drain(std::uint8_t source);
+    void finishSwitch();
+
+    FrameRing& system_;
+    FrameRing& mic_;
+    FrameRing& out_;
+    SourceSwitcherConfig config_;
+    /// fadeIn_[k] = sin(pi/2 * k / fadeSamples); the fade-out gain is
+    /// fadeIn_[fadeSamples - k].
+    std::array<float, kMaxFadeSamples + 1> fadeIn_{};
+
+    std::atomic<std::uint8_t> driver_{0};
+    std::atomic<std::uint8_t> active_{0};
+    std::atomic<std::uint8_t> pending_{kNone};
+    std::atomic<std::uint8_t> state_{kIdle};
+
+    // Owned by the driving thread (handed over with driver_).
+    std::uint8_t incoming_ = 0;
+    std::uint32_t fadePos_ = 0;
+    std::size_t abandonPos_ = 0;  // samples of incomingFrame_ replayed
+    std::size_t offset_[2] = {0, 0};
+    std::uint32_t sampleClock_ = 0;
+    std::uint32_t aheadFrames_ = 0;
+    AudioFrame incomingFrame_;
+    AudioFrame scratch_;
+    bool outputIsScratch_ = false;
+
+    std::atomic<std::uint64_t> switches_{0};
+    std::atomic<std::uint64_t> abandoned_{0};
+    std::atomic<std::uint64_t> overruns_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,42 @@
+#include "transmit_pacer.h"
+
+namespace aas {
+
+std::size_t TransmitPacer::allowance(std::uint64_t nowUs, std::size_t queued) {
+    if (queued == 0) {
+        headHeld_ = false;
+        excess_ = 0;
+        return 0;
+    }
+    const std::size_t excess = queued > config_.maxHeld ? queued - config_.maxHeld : 0;
+    const std::size_t paced = nowUs >= nextDueUs_ ? 1 : 0;
+    if (paced == 0 && !headHeld_) {
+        headHeld_ = true;
+        stats_.held.fetch_add(1, std::memory_order_relaxed);
+    }
+    excess_ = excess;
+    return excess + paced;
+}
+
+void TransmitPacer::onSent(std::uint64_t nowUs, std::size_t sent) {
+    if (sent == 0) {
+        return;
+    }
+    // From now, not from the missed slot: a late wake-up does not earn a
+    // burst to catch up with.
+    nextDueUs_ = nowUs + config_.gapUs;
+    headHeld_ = false;
+    stats_.released.fetch_add(sent, std::memory_order_relaxed);
+    if (excess_ > 0) {
+        stats_.overflow.fetch_add(sent < excess_ ? sent : excess_, std::memory_order_relaxed);
+        excess_ = 0;
+    }
+}
+
+void TransmitPacer::reset() {
+    nextDueUs_ = 0;
+    headHeld_ = false;
+    excess_ = 0;
+}
+
+} // namespace aas
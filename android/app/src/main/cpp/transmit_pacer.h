@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+struct TransmitPacerConfig {
+    /// Smallest spacing between two datagrams on the air. A quarter frame
+    /// leaves every frame's media datagram unheld (they come 2.5 ms
+    /// apart), and spreads what an encode emits at once (a parity packet
+    /// closing its group, or a frame and its aggregate flush) over the
+    /// frame instead of handing the AP a burst.
+    std::uint32_t gapUs = kFrameDurationUs / 4;
+    /// Datagrams the pacer may hold at once. Anything queued beyond this
+    /// is backlog from a stall; spacing it out would only make it later,
+    /// so it goes straight away.
+    std::size_t maxHeld = 4;
+};
+
+/// Counters, readable from any thread.
+struct TransmitPacerStats {
+    std::atomic<std::uint64_t> released{0};
+    /// Datagrams that had to wait for their slot.
+    std::atomic<std::uint64_t> held{0};
+    /// Datagrams sent unpaced because the backlog exceeded maxHeld.
+    std::atomic<std::uint64_t> overflow{0};
+};
+
+/// Per-datagram transmit schedule for the send thread: at most one
+/// datagram per `gapUs`, on the frame clock, instead of everything the
+/// encoder queued in one sendmmsg burst. Bursts queue behind each other in
+/// the AP's (and the phone's own) Wi-Fi queue and show up at the receiver
+/// as jitter the playout buffer then has to cover.
+///
+/// The send thread asks allowance() how many queued datagrams may go now,
+/// sends that many, reports the count through onSent(), and sleeps no
+/// longer than nextDueUs() while anything is still queued. Send thread only
+/// (stats() from anywhere).
+class TransmitPacer {
+public:
+    explicit TransmitPacer(const TransmitPacerConfig& config = {}) : config_(config) {}
+
+    /// Datagrams of the `queued` ones that may be sent at `nowUs`.
+    std::size_t allowance(std::uint64_t nowUs, std::size_t queued);
+
+    /// Records that `sent` of the allowed datagrams left at `nowUs`.
+    void onSent(std::uint64_t nowUs, std::size_t sent);
+
+    /// Earliest time the next datagram may go (0 before the first).
+    std::uint64_t nextDueUs() const { return nextDueUs_; }
+
+    const TransmitPacerStats& stats() const { return stats_; }
+    void reset();
+
+private:
+    TransmitPacerConfig config_;
+    std::uint64_t nextDueUs_ = 0;
+    /// The head of the queue was refused a slot (counted once as held).
+    bool headHeld_ = false;
+    /// Of the last allowance, how many were backlog beyond maxHeld.
+    std::size_t excess_ = 0;
+    TransmitPacerStats stats_;
+};
+
+} // namespace aas
@@ -0,0 +1,195 @@
+#include "udp_sender.h"
+
+#include <android/multinetwork.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+
+namespace aas {
+
+UdpSender::UdpSender() {
+    for (std::size_t i = 0; i < kBatch; ++i) {
+        messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+        messages_[i].msg_hdr.msg_iovlen = 1;
+    }
+}
+
+UdpSender::~UdpSender() { close(); }
+
+bool UdpSender::open(const sockaddr* dest, socklen_t destLen, std::uint64_t netHandle) {
+    close();
+    fd_ = ::socket(dest->sa_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        lastError_ = errno;
+        return false;
+    }
+    if (netHandle != 0 && android_setsocknetwork(static_cast<net_handle_t>(netHandle), fd_) != 0) {
+        lastError_ = errno;
+        close();
+        return false;
+    }
+    if (::connect(fd_, dest, destLen) != 0) {
+        lastError_ = errno;
+        close();
+        return false;
+    }
+    family_ = dest->sa_family;
+    tos_ = 0;
+    lastError_ = 0;
+    return true;
+}
+
+bool UdpSender::setTrafficClass(std::uint8_t tos) {
+    if (fd_ < 0) {
+        return false;
+    }
+    const int value = tos;
+    const int result = family_ == AF_INET6
+                           ? ::setsockopt(fd_, IPPROTO_IPV6, IPV6_TCLASS, &value, sizeof(value))
+                           : ::setsockopt(fd_, IPPROTO_IP, IP_TOS, &value, sizeof(value));
+    if (result != 0) {
+        lastError_ = errno;
+        return false;
+    }
+    tos_ = tos;
+    return true;
+}
+
+void UdpSender::close() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+std::size_t UdpSender::flush(DatagramRing& ring, std::size_t limit) {
+    std::size_t sent = 0;
+    while (fd_ >= 0 && sent < limit) {
+        const std::size_t count = std::min({ring.readAvailable(), limit - sent, kBatch});
+        if (count == 0) {
+            break;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            const Datagram& dg = ring.peek(i);
+            iovecs_[i].iov_base = const_cast<std::uint8_t*>(dg.bytes);
+            iovecs_[i].iov_len = dg.size;
+        }
+
+        const int result = ::sendmmsg(fd_, messages_.data(), static_cast<unsigned>(count),
+                                      MSG_DONTWAIT);
+        if (result > 0) {
+            ring.release(static_cast<std::size_t>(result));
+            sent += static_cast<std::size_t>(result);
+            if (static_cast<std::size_t>(result) < count) {
+                // Partial batch: the kernel buffer is full or the next
+                // datagram failed. Let the next call find out which.
+                break;
+            }
+            continue;
+        }
+
+        const int err = (result < 0) ? errno : EAGAIN;
+        if (err == EINTR) {
+            continue;
+        }
+        if (err == EAGAIN || err == EWOULDBLOCK || err == ENOBUFS) {
+            break;
+        }
+        // ECONNREFUSED from an ICMP unreachable, ENETUNREACH during a
+        // Wi-Fi handover, ...: drop the head datagram and keep going.
+        lastError_ = err;
+        ring.release(1);
+        --limit;
+    }
+    return sent;
+}
+
+std::size_t UdpSender::mirror(DatagramRing& ring, std::size_t limit) {
+    std::size_t sent = 0;
+    const std::size_t available = std::min(ring.readAvailable(), limit);
+    while (fd_ >= 0 && sent < available) {
+        const std::size_t count = std::min(available - sent, kBatch);
+        for (std::size_t i = 0; i < count; ++i) {
+            const Datagram& dg = ring.peek(sent + i);
+            iovecs_[i].iov_base = const_cast<std::uint8_t*>(dg.bytes);
+            iovecs_[i].iov_len = dg.size;
+        }
+        const int result = ::sendmmsg(fd_, messages_.data(), static_cast<unsigned>(count),
+                                      MSG_DONTWAIT);
+        if (result <= 0) {
+            if (result < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        sent += static_cast<std::size_t>(result);
+        if (static_cast<std::size_t>(result) < count) {
+            break;
+        }
+    }
+    return sent;
+}
+
+bool UdpSender::sendRaw(const std::uint8_t* data, std::size_t size) {
+    if (fd_ < 0) {
+        return false;
+    }
+    ssize_t result;
+    do {
+        result = ::send(fd_, data, size, MSG_DONTWAIT);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0) {
+        lastError_ = errno;
+        return false;
+    }
+    return true;
+}
+
+std::size_t UdpSender::receive(std::uint8_t* buffer, std::size_t capacity) {
+    while (fd_ >= 0) {
+        const ssize_t result = ::recv(fd_, buffer, capacity, MSG_DONTWAIT);
+        if (result > 0) {
+            return static_cast<std::size_t>(result);
+        }
+        if (result < 0 && errno == EINTR) {
+            continue;
+        }
+        if (result < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+            // ECONNREFUSED surfaces here after an ICMP unreachable; it has
+            // already been consumed, so the next call sees real data.
+            lastError_ = errno;
+        }
+        break;
+    }
+    return 0;
+}
+
+std::size_t UdpSender::queuedBytes() const {
+    int bytes = 0;
+    if (fd_ < 0 || ::ioctl(fd_, SIOCOUTQ, &bytes) != 0 || bytes < 0) {
+        return 0;
+    }
+    return static_cast<std::size_t>(bytes);
+}
+
+bool UdpSender::waitReadable(std::uint64_t timeoutUs) {
+    if (fd_ < 0) {
+        return false;
+    }
+    pollfd pfd{};
+    pfd.fd = fd_;
+    pfd.events = POLLIN;
+    timespec timeout{};
+    timeout.tv_sec = static_cast<time_t>(timeoutUs / 1000000);
+    timeout.tv_nsec = static_cast<long>((timeoutUs % 1000000) * 1000);
+    return ::ppoll(&pfd, 1, &timeout, nullptr) > 0 && (pfd.revents & POLLIN) != 0;
+}
+
+} // namespace aas
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+
+namespace aas {
+
+/// Send stage of the Android pipeline: drains the encoder's DatagramRing
+/// with sendmmsg, up to kBatch datagrams per syscall, straight from the
+/// ring slots (no staging copy).
+///
+/// The socket is connect()ed, so the mmsghdr array needs no per-message
+/// address and is filled once in open(); flush() only updates iovec
+/// pointers and lengths. Not thread-safe: one send thread owns it.
+class UdpSender {
+public:
+    static constexpr std::size_t kBatch = 16;
+
+    UdpSender();
+    ~UdpSender();
+    UdpSender(const UdpSender&) = delete;
+    UdpSender& operator=(const UdpSender&) = delete;
+
+    /// Opens a non-blocking UDP socket connected to `dest`. A non-zero
+    /// `netHandle` (android.net.Network.getNetworkHandle()) binds it to that
+    /// network first, so it cannot route over another interface. Returns
+    /// false and records errno in lastError() on failure.
+    bool open(const sockaddr* dest, socklen_t destLen, std::uint64_t netHandle = 0);
+    void close();
+    bool isOpen() const { return fd_ >= 0; }
+
+    /// Sets the IPv4 TOS / IPv6 traffic class byte (DSCP << 2) on every
+    /// datagram sent from now on. The socket keeps it across calls but not
+    /// across open().
+    bool setTrafficClass(std::uint8_t tos);
+    std::uint8_t trafficClass() const { return tos_; }
+
+    /// Sends up to `limit` of the datagrams currently published in `ring`
+    /// (all of them by default; TransmitPacer sets the limit). Returns the
+    /// number handed to the kernel. A full socket buffer leaves the rest
+    /// queued for the next call; any other error drops the datagram that
+    /// failed so a dead peer can never stall the encoder.
+    std::size_t flush(DatagramRing& ring, std::size_t limit = SIZE_MAX);
+
+    /// Sends a copy of up to `limit` of the datagrams published in `ring`
+    /// without releasing any, for the path-switch overlap. Best effort:
+    /// stops at the first batch the kernel refuses. Returns the number sent.
+    std::size_t mirror(DatagramRing& ring, std::size_t limit = SIZE_MAX);
+
+    /// Sends one datagram outside the ring (clock responses when no media
+    /// is queued). Returns false if the kernel did not take it.
+    bool sendRaw(const std::uint8_t* data, std::size_t size);
+
+    /// Reads one datagram from the peer without blocking. Returns its size,
+    /// or 0 when nothing is pending.
+    std::size_t receive(std::uint8_t* buffer, std::size_t capacity);
+
+    /// Blocks until the socket is readable or `timeoutUs` elapses. Lets the
+    /// send thread sleep between frames and still answer clock requests.
+    bool waitReadable(std::uint64_t timeoutUs);
+
+    /// Bytes handed to the kernel that the interface has not finished
+    /// transmitting (SIOCOUTQ; a UDP skb is charged to the socket until the
+    /// driver frees it after airtime). Near zero while the medium keeps up.
+    std::size_t queuedBytes() const;
+
+    int fd() const { return fd_; }
+    int lastError() const { return lastError_; }
+
+private:
+    int fd_ = -1;
+    int family_ = AF_UNSPEC;
+    std::uint8_t tos_ = 0;
+    int lastError_ = 0;
+    std::array<mmsghdr, kBatch> messages_{};
+    std::array<iovec, kBatch> iovecs_{};
+};
+
+} // namespace aas
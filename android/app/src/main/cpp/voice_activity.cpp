@@ -0,0 +1,154 @@
+#include "voice_activity.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aas {
+
+namespace {
+
+/// Weight of each non-speech frame in the noise averages (about 100 ms).
+constexpr float kNoiseAverage = 1.0f / 40.0f;
+
+std::uint32_t framesFor(std::uint64_t us) {
+    return static_cast<std::uint32_t>((us + kFrameDurationUs - 1) / kFrameDurationUs);
+}
+
+} // namespace
+
+bool VoiceActivityDetector::update(const AudioFrame& frame, float voiceProbability) {
+    const std::size_t channels = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+    float mono[kFrameSamples];
+    double power = 0.0;
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        float sum = 0.0f;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            sum += frame.samples[i * channels + ch];
+        }
+        mono[i] = sum / static_cast<float>(channels);
+        power += static_cast<double>(mono[i]) * mono[i];
+    }
+    power /= kFrameSamples;
+    levelDb_ = power > 1e-13 ? static_cast<float>(10.0 * std::log10(power)) : -127.0f;
+    float reflection[kComfortNoiseOrder];
+    flatness_ = lpcReflection(mono, kFrameSamples, reflection);
+
+    if (!haveFloor_) {
+        haveFloor_ = true;
+        floorDb_ = levelDb_;
+    }
+    const float aboveDb = levelDb_ - floorDb_;
+    bool speech = levelDb_ >= config_.minSpeechDb &&
+                  (aboveDb >= config_.loudDb ||
+                   (aboveDb >= config_.onsetDb && flatness_ < config_.flatnessRatio * noiseFlatness_));
+    if (voiceProbability >= config_.voiceProbabilityThreshold) {
+        speech = true;
+    }
+
+    if (levelDb_ < floorDb_) {
+        floorDb_ = levelDb_;
+    } else {
+        floorDb_ += config_.floorRiseDbPerSec * (kFrameDurationUs / 1e6f);
+    }
+
+    if (!speech) {
+        if (noisePower_ <= 0.0f) {
+            noisePower_ = static_cast<float>(power);
+            noiseFlatness_ = flatness_;
+            std::copy(reflection, reflection + kComfortNoiseOrder, noiseReflection_);
+        } else {
+            noisePower_ += (static_cast<float>(power) - noisePower_) * kNoiseAverage;
+            noiseFlatness_ += (flatness_ - noiseFlatness_) * kNoiseAverage;
+            for (std::size_t k = 0; k < kComfortNoiseOrder; ++k) {
+                noiseReflection_[k] += (reflection[k] - noiseReflection_[k]) * kNoiseAverage;
+            }
+        }
+    }
+    return speech;
+}
+
+ComfortNoiseDescriptor VoiceActivityDetector::noiseDescriptor(std::uint16_t channels) const {
+    ComfortNoiseDescriptor cn;
+    cn.channels = static_cast<std::uint8_t>(std::clamp<std::uint16_t>(channels, 1, kMaxFrameChannels));
+    const float db = noisePower_ > 1e-13f ? 10.0f * std::log10(noisePower_) : -127.0f;
+    cn.levelDb = static_cast<std::int8_t>(std::lround(std::clamp(db, -127.0f, 0.0f)));
+    for (std::size_t i = 0; i < kComfortNoiseOrder; ++i) {
+        const float k = std::clamp(noiseReflection_[i], -1.0f, 1.0f);
+        cn.reflection[i] = static_cast<std::int8_t>(std::lround(k * 127.0f));
+    }
+    return cn;
+}
+
+void VoiceActivityDetector::reset() {
+    haveFloor_ = false;
+    floorDb_ = -90.0f;
+    levelDb_ = -127.0f;
+    flatness_ = 1.0f;
+    noisePower_ = 0.0f;
+    noiseFlatness_ = 1.0f;
+    std::fill(noiseReflection_, noiseReflection_ + kComfortNoiseOrder, 0.0f);
+}
+
+DtxController::DtxController(const DtxConfig& config, const VoiceActivityConfig& vad) : vad_(vad) {
+    configure(config);
+}
+
+void DtxController::configure(const DtxConfig& config) {
+    config_ = config;
+    hangoverFrames_ = framesFor(config_.hangoverUs);
+    refreshFrames_ = std::max(framesFor(config_.sidRefreshUs), kSidRepeatFrames + 1);
+    if (!config_.enabled) {
+        silent_ = false;
+    }
+}
+
+DtxAction DtxController::update(const AudioFrame& frame, float voiceProbability) {
+    channels_ = frame.channels;
+    const bool speech = vad_.update(frame, voiceProbability);
+    if (!config_.enabled) {
+        return DtxAction::kSend;
+    }
+    if (speech) {
+        hangover_ = hangoverFrames_;
+        if (silent_) {
+            silent_ = false;
+            talkspurts_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return DtxAction::kSend;
+    }
+    if (!silent_) {
+        if (hangover_ > 0) {
+            --hangover_;
+            return DtxAction::kSend;
+        }
+        silent_ = true;
+        sinceSid_ = 0;
+        sidsThisSilence_ = 1;
+        return DtxAction::kSendSid;
+    }
+    ++sinceSid_;
+    if ((sidsThisSilence_ == 1 && sinceSid_ == kSidRepeatFrames) || sinceSid_ >= refreshFrames_) {
+        sinceSid_ = 0;
+        ++sidsThisSilence_;
+        return DtxAction::kSendSid;
+    }
+    skipped_.fetch_add(1, std::memory_order_relaxed);
+    return DtxAction::kSkip;
+}
+
+bool DtxController::writeSid(DatagramRing& ring, PacketHeader header) {
+    Datagram* dg = ring.writeSlot();
+    if (dg == nullptr) {
+        return false;
+    }
+    header.flags = kFlagSilence;
+    header.frameUnits = 1;
+    std::uint8_t* payload = writePacketHeader(header, dg->bytes);
+    dg->size = static_cast<std::uint16_t>(kPacketHeaderBytes +
+                                          writeComfortNoise(vad_.noiseDescriptor(channels_), payload));
+    ring.publish();
+    sids_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace aas
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/comfort_noise.h"
+#include "aas/datagram.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+struct VoiceActivityConfig {
+    /// Level above the noise floor that is speech on its own.
+    float loudDb = 12.0f;
+    /// Lower onset level, accepted when the frame is also much less flat
+    /// than the noise (voicing makes the spectrum peaky).
+    float onsetDb = 6.0f;
+    /// "Much less flat": flatness below this fraction of the noise's.
+    float flatnessRatio = 0.5f;
+    /// Frames quieter than this are never speech, whatever the floor.
+    float minSpeechDb = -65.0f;
+    /// How fast the floor may rise into louder noise, dB/s. It falls to
+    /// any quieter frame at once.
+    float floorRiseDbPerSec = 3.0f;
+    /// RNNoise speech probability that counts as speech when available.
+    float voiceProbabilityThreshold = 0.6f;
+};
+
+/// Per-frame speech/non-speech decision cheap enough for the encode thread:
+/// frame level against a tracked noise floor, plus the spectral flatness an
+/// order-4 LPC fit gives for free (lpcReflection()). The decision uses only
+/// the current 2.5 ms frame, so speech is detected on its first frame with
+/// no lookahead. When RNNoise runs (NoiseSuppressor::voiceProbability()),
+/// its probability is ORed in; it lags by up to one 10 ms block, so it
+/// only ever helps hold speech, never delays it.
+///
+/// Non-speech frames also feed a running average of level and envelope,
+/// which is the comfort-noise descriptor the receiver plays in DTX.
+class VoiceActivityDetector {
+public:
+    explicit VoiceActivityDetector(const VoiceActivityConfig& config = {}) : config_(config) {}
+
+    /// Classifies one frame. `voiceProbability` is RNNoise's 0-1 output,
+    /// or negative when RNNoise is off.
+    bool update(const AudioFrame& frame, float voiceProbability = -1.0f);
+
+    float levelDb() const { return levelDb_; }
+    float floorDb() const { return floorDb_; }
+    float flatness() const { return flatness_; }
+    /// The background as measured over recent non-speech frames.
+    ComfortNoiseDescriptor noiseDescriptor(std::uint16_t channels) const;
+
+    void reset();
+
+private:
+    VoiceActivityConfig config_;
+    bool haveFloor_ = false;
+    float floorDb_ = -90.0f;
+    float levelDb_ = -127.0f;
+    float flatness_ = 1.0f;
+    // Noise statistics, averaged over non-speech frames.
+    float noisePower_ = 0.0f;
+    float noiseFlatness_ = 1.0f;
+    float noiseReflection_[kComfortNoiseOrder] = {};
+};
+
+struct DtxConfig {
+    /// Mic mode only: system audio is music and games, where a VAD would
+    /// chop quiet passages.
+    bool enabled = false;
+    /// Speech tail kept after the last speech frame, so word endings and
+    /// short pauses go out as audio.
+    std::uint64_t hangoverUs = 200'000;
+    /// Descriptor refresh while silent; keeps the receiver's stream, jitter
+    /// statistics and noise level current.
+    std::uint64_t sidRefreshUs = 200'000;
+};
+
+enum class DtxAction : std::uint8_t {
+    kSend,     ///< encode and send as usual
+    kSendSid,  ///< close the talkspurt: flush batching and FEC, then writeSid()
+    kSkip,     ///< silent: nothing goes on the air for this slot
+};
+
+/// Discontinuous transmission for mic mode (docs/protocol.md,
+/// Discontinuous Transmission).
+///
+/// Runs on the encode thread in front of the encoder. Each frame gets a
+/// DtxAction. While speech (or its hangover) lasts, frames go out as usual.
+/// When it ends, the slot that would have carried the next frame carries a
+/// kFlagSilence packet with the noise descriptor instead, repeated
+/// kSidRepeatFrames later in case the first is lost, then refreshed every
+/// sidRefreshUs. Every other slot is skipped, cutting 400 packets/s to
+/// about 5. Skipped slots keep their seq and sample clock, so the
+/// receiver's playout carries straight on through them as comfort noise,
+/// and the first speech frame slots in at the usual jitter-buffer depth:
+/// no rebuffering and no added latency at onset.
+///
+/// Before writeSid() the caller flushes PacketAggregator and calls
+/// FecEncoder::endTalkspurt(), so no batch or parity group spans the gap.
+/// The encoder may keep encoding skipped frames so its state is warm for
+/// the onset; their output is dropped. Clock exchanges continue on
+/// standalone responses (ClockResponder sends alone when nothing is
+/// queued), so the estimate stays locked through silence.
+class DtxController {
+public:
+    static constexpr std::uint32_t kSidRepeatFrames = 2;
+
+    explicit DtxController(const DtxConfig& config = {}, const VoiceActivityConfig& vad = {});
+
+    void configure(const DtxConfig& config);
+    const DtxConfig& config() const { return config_; }
+
+    /// Decides what happens to `frame`'s slot.
+    DtxAction update(const AudioFrame& frame, float voiceProbability = -1.0f);
+
+    /// Publishes the silence packet for the slot described by `header`
+    /// (seq, sample clock, codec, stream id). Returns false if the send
+    /// stage is full.
+    bool writeSid(DatagramRing& ring, PacketHeader header);
+
+    bool silent() const { return silent_; }
+    const VoiceActivityDetector& detector() const { return vad_; }
+
+    std::uint64_t skipped() const { return skipped_.load(std::memory_order_relaxed); }
+    std::uint64_t sids() const { return sids_.load(std::memory_order_relaxed); }
+    std::uint64_t talkspurts() const { return talkspurts_.load(std::memory_order_relaxed); }
+
+private:
+    DtxConfig config_;
+    VoiceActivityDetector vad_;
+    std::uint32_t hangoverFrames_ = 0;
+    std::uint32_t refreshFrames_ = 0;
+    std::uint32_t hangover_ = 0;
+    std::uint32_t sinceSid_ = 0;
+    std::uint32_t sidsThisSilence_ = 0;
+    bool silent_ = false;
+    std::uint16_t channels_ = 1;
+
+    std::atomic<std::uint64_t> skipped_{0};
+    std::atomic<std::uint64_t> sids_{0};
+    std::atomic<std::uint64_t> talkspurts_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,122 @@
+#include "network_impairment.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aas {
+
+namespace {
+
+constexpr double kTwoPi = 6.28318530717958647692;
+/// Longest single delay drawn; a Pareto tail can otherwise produce hours.
+constexpr double kMaxJitterUs = 10e6;
+
+struct Arrival {
+    std::uint64_t timeUs;
+    std::size_t order;
+    const TracePacket* packet;
+};
+
+} // namespace
+
+NetworkImpairment::NetworkImpairment(const ImpairmentConfig& config) : config_(config), rng_(config.seed) {}
+
+double NetworkImpairment::uniform() {
+    // 53 random bits: [0, 1) with full double resolution.
+    return static_cast<double>(rng_() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double NetworkImpairment::exponential(double mean) { return -mean * std::log(1.0 - uniform()); }
+
+std::uint64_t NetworkImpairment::jitterUs() {
+    const double scale = config_.jitterUs;
+    double us = 0.0;
+    switch (config_.jitter) {
+    case JitterDistribution::kNone:
+        break;
+    case JitterDistribution::kUniform:
+        us = uniform() * scale;
+        break;
+    case JitterDistribution::kHalfNormal: {
+        const double r = std::sqrt(-2.0 * std::log(1.0 - uniform()));
+        us = std::fabs(r * std::cos(kTwoPi * uniform())) * scale;
+        break;
+    }
+    case JitterDistribution::kExponential:
+        us = exponential(scale);
+        break;
+    case JitterDistribution::kPareto: {
+        const double shape = std::max(config_.paretoShape, 1.01);
+        us = scale * (shape - 1.0) * (std::pow(1.0 - uniform(), -1.0 / shape) - 1.0);
+        break;
+    }
+    }
+    return static_cast<std::uint64_t>(std::min(us, kMaxJitterUs));
+}
+
+std::uint64_t NetworkImpairment::stallRelease(std::uint64_t sendUs) {
+    if (config_.stallsPerSec <= 0.0) {
+        return sendUs;
+    }
+    const double meanGapUs = 1e6 / config_.stallsPerSec;
+    if (!haveStall_) {
+        haveStall_ = true;
+        stallStartUs_ = sendUs + static_cast<std::uint64_t>(exponential(meanGapUs));
+        stallEndUs_ = stallStartUs_ + config_.stallUs;
+    }
+    while (sendUs >= stallEndUs_) {
+        stallStartUs_ = stallEndUs_ + static_cast<std::uint64_t>(exponential(meanGapUs));
+        stallEndUs_ = stallStartUs_ + config_.stallUs;
+    }
+    return sendUs >= stallStartUs_ ? stallEndUs_ : sendUs;
+}
+
+PacketTrace NetworkImpairment::apply(const PacketTrace& sent) {
+    std::vector<Arrival> arrivals;
+    arrivals.reserve(sent.size() + sent.size() / 8);
+    const double leaveBurst = 1.0 / std::max(config_.meanBurstPackets, 1.0);
+    std::uint64_t queueUs = 0;
+
+    for (const TracePacket& packet : sent) {
+        ++stats_.sent;
+        if (inBurst_) {
+            inBurst_ = !chance(leaveBurst);
+        } else {
+            inBurst_ = chance(config_.burstRate);
+        }
+        if (inBurst_ ? chance(config_.burstLossRate) : chance(config_.lossRate)) {
+            ++stats_.dropped;
+            stats_.burstDropped += inBurst_ ? 1 : 0;
+            continue;
+        }
+
+        const std::uint64_t releaseUs = stallRelease(packet.timeUs);
+        stats_.stalled += releaseUs != packet.timeUs ? 1 : 0;
+        std::uint64_t arrivalUs = releaseUs + config_.baseDelayUs + jitterUs();
+        if (chance(config_.reorderRate)) {
+            // Held outside the queue, e.g. a MAC retry; the queue moves on.
+            arrivalUs += config_.reorderUs;
+            ++stats_.reordered;
+        } else if (config_.fifo) {
+            arrivalUs = std::max(arrivalUs, queueUs);
+            queueUs = arrivalUs;
+        }
+        arrivals.push_back({arrivalUs, arrivals.size(), &packet});
+        if (chance(config_.duplicateRate)) {
+            arrivals.push_back({arrivalUs + config_.duplicateUs, arrivals.size(), &packet});
+            ++stats_.duplicated;
+        }
+    }
+
+    std::sort(arrivals.begin(), arrivals.end(), [](const Arrival& a, const Arrival& b) {
+        return a.timeUs != b.timeUs ? a.timeUs < b.timeUs : a.order < b.order;
+    });
+    PacketTrace out;
+    out.reserve(arrivals.size());
+    for (const Arrival& arrival : arrivals) {
+        out.push_back({arrival.timeUs, arrival.packet->bytes});
+    }
+    return out;
+}
+
+} // namespace aas
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+
+#include "packet_trace.h"
+
+namespace aas {
+
+/// Shape of the per-packet queueing delay added on top of the base delay.
+enum class JitterDistribution : std::uint8_t {
+    kNone,
+    kUniform,     ///< 0 to jitterUs
+    kHalfNormal,  ///< |N(0, jitterUs)|
+    kExponential, ///< mean jitterUs: a lightly loaded queue
+    kPareto,      ///< Lomax with mean jitterUs: the heavy tail of a busy Wi-Fi channel
+};
+
+struct ImpairmentConfig {
+    /// Same seed and config, same impaired trace, on any platform.
+    std::uint64_t seed = 1;
+
+    /// One-way transit of the fastest packet.
+    std::uint32_t baseDelayUs = 1500;
+    JitterDistribution jitter = JitterDistribution::kExponential;
+    std::uint32_t jitterUs = 300;
+    /// Tail index of kPareto; closer to 1 is heavier.
+    double paretoShape = 2.5;
+    /// Jitter is queueing, so a packet never overtakes the one before it
+    /// unless reordering picks it. False draws every delay independently.
+    bool fifo = true;
+
+    /// Gilbert-Elliott loss: `lossRate` while the link is good; each packet
+    /// enters a burst with probability `burstRate`, bursts last
+    /// `meanBurstPackets` on average and lose `burstLossRate` of theirs.
+    double lossRate = 0.0;
+    double burstRate = 0.0;
+    double meanBurstPackets = 4.0;
+    double burstLossRate = 1.0;
+
+    /// Fraction of packets held back `reorderUs`, letting later ones pass.
+    double reorderRate = 0.0;
+    std::uint32_t reorderUs = 3000;
+    /// Fraction of packets delivered twice, the copy `duplicateUs` later.
+    double duplicateRate = 0.0;
+    std::uint32_t duplicateUs = 500;
+
+    /// Link stalls (Wi-Fi scans, power-save wake-ups, retry storms) as a
+    /// Poisson process: everything sent during one is released in a burst
+    /// when it ends.
+    double stallsPerSec = 0.0;
+    std::uint32_t stallUs = 20000;
+};
+
+struct ImpairmentStats {
+    std::uint64_t sent = 0;
+    std::uint64_t dropped = 0;
+    std::uint64_t burstDropped = 0;
+    std::uint64_t reordered = 0;
+    std::uint64_t duplicated = 0;
+    std::uint64_t stalled = 0;
+};
+
+/// Deterministic network channel for offline replay: turns a sent trace
+/// into the trace of arrivals a receiver would see over a link with the
+/// configured loss, burst loss, reordering, duplication, jitter and stalls.
+///
+/// The generator is a fixed mt19937_64 and every distribution is derived
+/// here from its raw output, because the standard library's distributions
+/// are not specified bit-for-bit and would differ between toolchains.
+class NetworkImpairment {
+public:
+    explicit NetworkImpairment(const ImpairmentConfig& config);
+
+    /// Arrivals for `sent`, sorted by arrival time (ties keep send order).
+    PacketTrace apply(const PacketTrace& sent);
+
+    const ImpairmentConfig& config() const { return config_; }
+    const ImpairmentStats& stats() const { return stats_; }
+
+private:
+    double uniform();
+    bool chance(double p) { return p > 0.0 && uniform() < p; }
+    double exponential(double mean);
+    std::uint64_t jitterUs();
+    /// Release time of a packet sent at `sendUs` if a stall holds it.
+    std::uint64_t stallRelease(std::uint64_t sendUs);
+
+    ImpairmentConfig config_;
+    std::mt19937_64 rng_;
+    ImpairmentStats stats_;
+    bool inBurst_ = false;
+    std::uint64_t stallStartUs_ = 0;
+    std::uint64_t stallEndUs_ = 0;
+    bool haveStall_ = false;
+};
+
+} // namespace aas
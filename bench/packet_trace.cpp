@@ -0,0 +1,198 @@
+#include "packet_trace.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "aas/audio_format.h"
+#include "aas/comfort_noise.h"
+#include "aas/datagram.h"
+#include "aas/lossless_codec.h"
+#include "aas/sample_format.h"
+
+namespace aas {
+
+namespace {
+
+constexpr char kMagic[8] = {'A', 'A', 'S', 'T', 'R', 'C', '0', '1'};
+constexpr double kPi = 3.14159265358979323846;
+/// DtxController's descriptor repeat and 200 ms refresh, in slots.
+constexpr std::uint64_t kSidRepeatSlots = 2;
+constexpr std::uint64_t kSidRefreshSlots = 80;
+
+struct FileCloser {
+    void operator()(std::FILE* f) const { std::fclose(f); }
+};
+using File = std::unique_ptr<std::FILE, FileCloser>;
+
+void putLe(std::uint8_t* out, std::uint64_t value, std::size_t bytes) {
+    for (std::size_t i = 0; i < bytes; ++i) {
+        out[i] = static_cast<std::uint8_t>(value >> (8 * i));
+    }
+}
+
+std::uint64_t getLe(const std::uint8_t* in, std::size_t bytes) {
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+/// Two tones per channel (a different pair on each) at -12 dBFS, plus a
+/// little noise so the lossless coder sees realistic residuals.
+void fillTestSignal(AudioFrame& frame, std::uint64_t firstSample, std::uint32_t& noise) {
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        const double t = static_cast<double>(firstSample + i) / kSampleRateHz;
+        for (std::size_t ch = 0; ch < frame.channels; ++ch) {
+            const double f = 220.0 * static_cast<double>(ch + 1);
+            noise = noise * 1664525u + 1013904223u;
+            const double dither = (static_cast<double>(noise >> 8) / 16777216.0 - 0.5) * 1e-3;
+            const double s = 0.15 * std::sin(2.0 * kPi * f * t) + 0.1 * std::sin(2.0 * kPi * 2.7 * f * t);
+            frame.samples[i * frame.channels + ch] = static_cast<float>(s + dither);
+        }
+    }
+}
+
+} // namespace
+
+bool writePacketTrace(const std::string& path, const PacketTrace& trace) {
+    File file(std::fopen(path.c_str(), "wb"));
+    if (!file || std::fwrite(kMagic, 1, sizeof(kMagic), file.get()) != sizeof(kMagic)) {
+        return false;
+    }
+    for (const TracePacket& packet : trace) {
+        std::uint8_t record[10];
+        putLe(record, packet.timeUs, 8);
+        putLe(record + 8, packet.bytes.size(), 2);
+        if (std::fwrite(record, 1, sizeof(record), file.get()) != sizeof(record) ||
+            std::fwrite(packet.bytes.data(), 1, packet.bytes.size(), file.get()) != packet.bytes.size()) {
+            return false;
+        }
+    }
+    return std::fflush(file.get()) == 0;
+}
+
+bool readPacketTrace(const std::string& path, PacketTrace& out, std::string* error) {
+    auto fail = [error](const char* message) {
+        if (error != nullptr) {
+            *error = message;
+        }
+        return false;
+    };
+    File file(std::fopen(path.c_str(), "rb"));
+    if (!file) {
+        return fail("cannot open trace");
+    }
+    char magic[sizeof(kMagic)];
+    if (std::fread(magic, 1, sizeof(magic), file.get()) != sizeof(magic) ||
+        std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        return fail("not a packet trace");
+    }
+    out.clear();
+    std::uint8_t record[10];
+    while (std::fread(record, 1, sizeof(record), file.get()) == sizeof(record)) {
+        TracePacket packet;
+        packet.timeUs = getLe(record, 8);
+        const auto size = static_cast<std::size_t>(getLe(record + 8, 2));
+        if (size > kMaxDatagramBytes) {
+            return fail("datagram larger than the MTU");
+        }
+        packet.bytes.resize(size);
+        if (std::fread(packet.bytes.data(), 1, size, file.get()) != size) {
+            return fail("truncated trace");
+        }
+        if (!out.empty() && packet.timeUs < out.back().timeUs) {
+            return fail("trace is not in time order");
+        }
+        out.push_back(std::move(packet));
+    }
+    return true;
+}
+
+PacketTrace synthesizeTrace(const SyntheticTraceConfig& config) {
+    PacketTrace trace;
+    const std::uint16_t channels =
+        static_cast<std::uint16_t>(std::clamp<std::size_t>(config.channels, 1, kMaxFrameChannels));
+    const auto slots = static_cast<std::uint64_t>(config.seconds * 1e6 / kFrameDurationUs);
+    const double slotUs = kFrameDurationUs * (1.0 + config.senderDriftPpm * 1e-6);
+    const auto silenceFrom = static_cast<std::uint64_t>(config.silenceFromSec * 1e6 / kFrameDurationUs);
+    const auto silenceSlots = static_cast<std::uint64_t>(config.silenceSec * 1e6 / kFrameDurationUs);
+    const std::uint64_t silenceEnd = silenceFrom + silenceSlots;
+    ComfortNoiseDescriptor background;
+    background.channels = static_cast<std::uint8_t>(channels);
+    background.levelDb = -60;
+
+    // The encoder stage's state is a few KiB of buffers; keep it off the stack.
+    auto ring = std::make_unique<DatagramRing>();
+    auto fec = std::make_unique<FecEncoder>();
+    auto frame = std::make_unique<AudioFrame>();
+    fec->configure(config.fec);
+    frame->channels = channels;
+    std::uint32_t noise = 1;
+    trace.reserve(slots + slots / 2);
+
+    for (std::uint64_t slot = 0; slot < slots; ++slot) {
+        fillTestSignal(*frame, slot * kFrameSamples, noise);
+        PacketHeader header{};
+        header.versionCodec = PacketHeader::packVersionCodec(config.codec);
+        header.seq = static_cast<std::uint16_t>(config.firstSeq + slot);
+        header.sampleClock = static_cast<std::uint32_t>(config.firstSampleClock + slot * kFrameSamples);
+        header.streamId = config.streamId;
+        header.frameUnits = 1;
+
+        if (slot >= silenceFrom && slot < silenceEnd) {
+            const std::uint64_t quiet = slot - silenceFrom;
+            if (quiet == 0) {
+                fec->endTalkspurt(*ring);
+            }
+            if (quiet == 0 || quiet == kSidRepeatSlots ||
+                (quiet > kSidRepeatSlots && (quiet - kSidRepeatSlots) % kSidRefreshSlots == 0)) {
+                Datagram* sid = ring->writeSlot();
+                if (sid == nullptr) {
+                    break;
+                }
+                header.flags = kFlagSilence;
+                std::uint8_t* payload = writePacketHeader(header, sid->bytes);
+                const std::size_t descriptor = writeComfortNoise(background, payload);
+                sid->size = static_cast<std::uint16_t>(kPacketHeaderBytes + descriptor);
+                ring->publish();
+            }
+        } else {
+            Datagram* dg = fec->beginMedia(*ring);
+            if (dg == nullptr) {
+                break;
+            }
+            std::uint8_t* primary = FecEncoder::primaryPayload(dg);
+            std::size_t size = 0;
+            if (config.codec == CodecId::kLossless) {
+                size = encodeLossless(*frame, 0, primary, FecEncoder::kMaxPrimaryBytes);
+                if (size == 0) {
+                    break;
+                }
+            } else {
+                size = kFrameSamples * channels * sizeof(std::int16_t);
+                if (size > FecEncoder::kMaxPrimaryBytes) {
+                    break;
+                }
+                floatToPcm16(frame->samples, primary, kFrameSamples * channels);
+            }
+            fec->commitMedia(*ring, dg, header, size);
+        }
+
+        // Sent once the frame's last sample is captured.
+        const auto sendUs = static_cast<std::uint64_t>(std::llround(static_cast<double>(slot + 1) * slotUs));
+        while (const Datagram* out = ring->readSlot()) {
+            TracePacket packet;
+            packet.timeUs = sendUs;
+            packet.bytes.assign(out->bytes, out->bytes + out->size);
+            trace.push_back(std::move(packet));
+            ring->release();
+        }
+    }
+    return trace;
+}
+
+} // namespace aas
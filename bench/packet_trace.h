@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "aas/packet_header.h"
+#include "fec_encoder.h"
+
+namespace aas {
+
+/// One datagram of a trace and the time it was sent, or, after
+/// NetworkImpairment, the time it arrives.
+struct TracePacket {
+    std::uint64_t timeUs = 0;
+    std::vector<std::uint8_t> bytes;
+};
+
+/// Datagrams in time order. Offline only: traces are built, impaired and
+/// replayed outside any real-time thread, so plain vectors are fine.
+using PacketTrace = std::vector<TracePacket>;
+
+/// Trace file: the 8-byte magic "AASTRC01", then per datagram a
+/// little-endian u64 time in microseconds, a u16 size and the bytes.
+/// Captures of a live session (datagram and arrival stamp, as handed to
+/// StreamPipeline::inbox()) replay through the same path as synthetic ones.
+bool writePacketTrace(const std::string& path, const PacketTrace& trace);
+bool readPacketTrace(const std::string& path, PacketTrace& out, std::string* error = nullptr);
+
+/// What synthesizeTrace() sends.
+struct SyntheticTraceConfig {
+    double seconds = 10.0;
+    std::uint16_t channels = 2;
+    /// kPcm16 or kLossless: the codecs the receiver decodes itself. A frame
+    /// must fit FecEncoder::kMaxPrimaryBytes (PCM up to three channels);
+    /// the trace ends at the first one that does not.
+    CodecId codec = CodecId::kPcm16;
+    /// Protection exactly as the phone applies it (the real FecEncoder).
+    FecSettings fec{};
+    /// Sender clock error against the receiver, parts per million; the
+    /// drift resampler has to absorb it.
+    double senderDriftPpm = 0.0;
+    /// A DTX gap of `silenceSec` starting `silenceFromSec` in: silence
+    /// descriptors as DtxController sends them (at the start, two slots
+    /// later, then every 200 ms) and nothing in the other slots.
+    double silenceFromSec = 0.0;
+    double silenceSec = 0.0;
+    std::uint8_t streamId = 1;
+    /// First sample clock; arbitrary so wrap handling is not special-cased.
+    std::uint32_t firstSampleClock = 0x10000000u;
+    std::uint16_t firstSeq = 0xff00u;
+};
+
+/// A sender's packet stream for a two-tone test signal: one media packet
+/// per 2.5 ms slot, stamped when its frame completes on the sender clock,
+/// with parity packets immediately behind the group they close.
+PacketTrace synthesizeTrace(const SyntheticTraceConfig& config);
+
+} // namespace aas
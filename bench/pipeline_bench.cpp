@@ -0,0 +1,295 @@
+#include "pipeline_bench.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+#include "aas/latency_trace.h"
+#include "aas/packet_header.h"
+#include "aas/spsc_ring.h"
+#include "fec_decoder.h"
+#include "frame_ring_source.h"
+#include "stream_decoder.h"
+#include "stream_pipeline.h"
+
+namespace aas {
+
+namespace {
+
+std::uint64_t nanosNow() {
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(
+        duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+/// The receiver side of one stream, connected as StreamPipeline connects
+/// it. Heap-allocated: FEC history and the frame rings are a few hundred
+/// KiB.
+struct BenchPipeline {
+    BenchPipeline(const PipelineBenchConfig& config)
+        : jitter(config.jitter), source(decoded, config.outputChannels, config.periodFrames) {
+        source.setJitterStats(&jitter.stats());
+        source.setTrace(&trace);
+        source.setTargetFillSamples(static_cast<double>(StreamPipeline::kDecodedLead * kFrameSamples));
+    }
+
+    FecDecoder fec;
+    JitterBuffer jitter;
+    StreamDecoder decoder;
+    FrameRing decoded;
+    FrameRingSource source;
+    LatencyTrace trace;
+    StreamPacket packet;
+};
+
+/// Send time of every media slot, keyed by sample clock.
+std::unordered_map<std::uint32_t, std::uint64_t> sendTimes(const PacketTrace& sent) {
+    std::unordered_map<std::uint32_t, std::uint64_t> times;
+    times.reserve(sent.size());
+    for (const TracePacket& packet : sent) {
+        PacketHeader header;
+        if (packet.bytes.size() < kPacketHeaderBytes ||
+            !readPacketHeader(packet.bytes.data(), packet.bytes.size(), header) ||
+            header.hasFlag(kFlagFecParity) || header.frameUnits == 0) {
+            continue;
+        }
+        for (std::uint32_t unit = 0; unit < header.frameUnits; ++unit) {
+            const std::uint32_t clock = header.sampleClock + unit * static_cast<std::uint32_t>(kFrameSamples);
+            times.emplace(clock, packet.timeUs);
+        }
+    }
+    return times;
+}
+
+double quantileMs(const std::vector<std::uint32_t>& sorted, double q) {
+    if (sorted.empty()) {
+        return 0.0;
+    }
+    return sorted[static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1))] / 1000.0;
+}
+
+} // namespace
+
+PipelineBenchResult runPipelineBench(const PacketTrace& sent, const PacketTrace& arrivals,
+                                     const PipelineBenchConfig& config) {
+    PipelineBenchResult result;
+    if (arrivals.empty()) {
+        return result;
+    }
+    const std::uint64_t wallStart = nanosNow();
+    const auto pipeline = std::make_unique<BenchPipeline>(config);
+    const std::unordered_map<std::uint32_t, std::uint64_t> sendUs = sendTimes(sent);
+    std::unordered_map<std::uint32_t, std::uint64_t> presentedUs;
+    presentedUs.reserve(sendUs.size());
+
+    const std::size_t periodFrames = std::max<std::size_t>(config.periodFrames, 1);
+    const std::size_t channels = std::clamp<std::size_t>(config.outputChannels, 1, kMaxFrameChannels);
+    std::vector<float> output(periodFrames * channels);
+    const double periodUs = static_cast<double>(periodFrames) * 1e6 / kSampleRateHz;
+    const std::uint64_t startUs = arrivals.front().timeUs;
+    const std::uint64_t endUs = arrivals.back().timeUs + config.tailUs;
+
+    std::uint64_t minTransitUs = std::numeric_limits<std::uint64_t>::max();
+    std::uint64_t lastArrivalUs = 0;
+    bool active = false;
+    auto& stageNs = result.stageNs;
+    auto stage = [&stageNs](BenchStage s) -> std::uint64_t& { return stageNs[static_cast<std::size_t>(s)]; };
+
+    // StreamPipeline::service(), with each stage timed on its own.
+    auto service = [&](std::uint64_t nowUs) {
+        BenchPipeline& p = *pipeline;
+        if (active && nowUs > lastArrivalUs && nowUs - lastArrivalUs > StreamPipeline::kIdleTimeoutUs) {
+            p.jitter.reset();
+            p.decoder.reset();
+            p.fec.reset();
+            p.source.reset();
+            active = false;
+            ++result.idleResets;
+        }
+        if (!active) {
+            return;
+        }
+        const std::size_t lead = StreamPipeline::decodedLead(p.source.demandSamples());
+        while (p.decoded.sizeApprox() < lead) {
+            AudioFrame* frame = p.decoded.writeSlot();
+            if (frame == nullptr) {
+                break;
+            }
+            std::uint64_t t0 = nanosNow();
+            const Playout playout = p.jitter.pop(nowUs);
+            std::uint64_t t1 = nanosNow();
+            stage(BenchStage::kPlayout) += t1 - t0;
+            if (playout.action == PlayoutAction::kWaiting) {
+                break;
+            }
+            p.decoder.decode(playout, *frame);
+            stage(BenchStage::kDecode) += nanosNow() - t1;
+            p.decoded.publish();
+            ++result.framesPlayed;
+        }
+    };
+
+    // Counters are taken when the last datagram has been handled; what the
+    // tail adds is the stream ending, not the link.
+    auto collectCounters = [&result, &pipeline]() {
+        const BenchPipeline& p = *pipeline;
+        const JitterBufferStats& jitter = p.jitter.stats();
+        const FecDecoderStats& fec = p.fec.stats();
+        result.received = jitter.received.load(std::memory_order_relaxed);
+        result.late = jitter.late.load(std::memory_order_relaxed);
+        result.duplicates = jitter.duplicates.load(std::memory_order_relaxed);
+        result.lost = jitter.lost.load(std::memory_order_relaxed);
+        result.expanded = jitter.expanded.load(std::memory_order_relaxed);
+        result.accelerated = jitter.accelerated.load(std::memory_order_relaxed);
+        result.comfortNoise = jitter.comfortNoise.load(std::memory_order_relaxed);
+        result.concealed = p.decoder.concealed();
+        result.recoveredByParity = fec.recoveredByParity.load(std::memory_order_relaxed);
+        result.recoveredByRedundancy = fec.recoveredByRedundancy.load(std::memory_order_relaxed);
+        result.recoveredTooLate = fec.recoveredTooLate.load(std::memory_order_relaxed);
+        result.underrunFrames = p.source.underrunFrames();
+    };
+
+    const std::uint64_t lastUs = arrivals.back().timeUs;
+    const std::uint64_t driftFromUs = lastUs - std::min(config.driftWindowUs, lastUs - startUs);
+    double driftSum = 0.0;
+    std::uint64_t driftSamples = 0;
+
+    std::size_t next = 0;
+    std::uint64_t renders = 0;
+    double nextTickUs = static_cast<double>(startUs);
+    for (;;) {
+        const double nextRenderUs = static_cast<double>(startUs) + static_cast<double>(renders) * periodUs;
+        const double nextArrivalUs = next < arrivals.size() ? static_cast<double>(arrivals[next].timeUs)
+                                                            : std::numeric_limits<double>::infinity();
+        const double nowD = std::min({nextArrivalUs, nextTickUs, nextRenderUs});
+        const auto nowUs = static_cast<std::uint64_t>(nowD);
+        if (nowUs > endUs) {
+            break;
+        }
+
+        if (nowD == nextArrivalUs) {
+            BenchPipeline& p = *pipeline;
+            while (next < arrivals.size() && arrivals[next].timeUs <= nowUs) {
+                const TracePacket& arrival = arrivals[next++];
+                // Copied out of the receive buffer, as into StreamPipeline's inbox.
+                p.packet.arrivalUs = arrival.timeUs;
+                p.packet.size = static_cast<std::uint16_t>(std::min(arrival.bytes.size(), kMaxDatagramBytes));
+                std::memcpy(p.packet.bytes, arrival.bytes.data(), p.packet.size);
+                ++result.datagrams;
+
+                PacketHeader header;
+                if (readPacketHeader(p.packet.bytes, p.packet.size, header)) {
+                    p.decoder.setCodec(header.codec());
+                    const auto it = sendUs.find(header.sampleClock);
+                    if (!header.hasFlag(kFlagFecParity) && it != sendUs.end() &&
+                        arrival.timeUs >= it->second) {
+                        minTransitUs = std::min(minTransitUs, arrival.timeUs - it->second);
+                    }
+                }
+                const std::uint64_t t0 = nanosNow();
+                const bool ok = p.fec.onDatagram(p.packet.bytes, p.packet.size, p.packet.arrivalUs, p.jitter);
+                stage(BenchStage::kFec) += nanosNow() - t0;
+                if (ok) {
+                    lastArrivalUs = arrival.timeUs;
+                    active = true;
+                }
+            }
+            service(nowUs);
+            if (next == arrivals.size()) {
+                collectCounters();
+            }
+            continue;
+        }
+        if (nowD == nextTickUs) {
+            service(nowUs);
+            nextTickUs += config.workerTickUs;
+        }
+        if (nowD == nextRenderUs) {
+            BenchPipeline& p = *pipeline;
+            const auto presentUs = static_cast<std::uint64_t>(nowD + periodUs);
+            const std::uint64_t t0 = nanosNow();
+            p.source.render(output.data(), periodFrames, channels, presentUs);
+            stage(BenchStage::kRender) += nanosNow() - t0;
+            ++renders;
+            if (nowUs >= driftFromUs && nowUs <= lastUs) {
+                driftSum += p.source.controller().driftPpm();
+                ++driftSamples;
+            }
+            // Last presentation wins: an expanded frame borrows the clock
+            // of the slot that then plays for real.
+            p.trace.drain([&presentedUs](const TraceEvent& event) {
+                if (event.stage == TraceStage::kPresented) {
+                    presentedUs[event.sampleClock] = event.timeUs;
+                }
+            });
+        }
+    }
+
+    std::vector<std::uint32_t> latencies;
+    latencies.reserve(presentedUs.size());
+    for (const auto& [clock, timeUs] : presentedUs) {
+        const auto it = sendUs.find(clock);
+        if (it != sendUs.end() && it->second >= startUs + config.warmupUs && timeUs >= it->second) {
+            const std::uint64_t us = timeUs - it->second;
+            latencies.push_back(static_cast<std::uint32_t>(std::min<std::uint64_t>(us, ~0u)));
+        }
+    }
+    std::sort(latencies.begin(), latencies.end());
+    result.latencySamples = latencies.size();
+    result.latencyP50Ms = quantileMs(latencies, 0.50);
+    result.latencyP95Ms = quantileMs(latencies, 0.95);
+    result.latencyP99Ms = quantileMs(latencies, 0.99);
+    result.latencyP999Ms = quantileMs(latencies, 0.999);
+    result.latencyMaxMs = latencies.empty() ? 0.0 : latencies.back() / 1000.0;
+    if (minTransitUs != std::numeric_limits<std::uint64_t>::max()) {
+        result.minTransitMs = static_cast<double>(minTransitUs) / 1000.0;
+    }
+
+    if (driftSamples != 0) {
+        result.driftPpm = driftSum / static_cast<double>(driftSamples);
+    }
+
+    result.audioSec = static_cast<double>(endUs - startUs) / 1e6;
+    result.wallSec = static_cast<double>(nanosNow() - wallStart) / 1e9;
+    return result;
+}
+
+std::string formatBenchTable(const std::vector<BenchRow>& rows) {
+    std::string out =
+        "| Scenario         | P50      | P99      | P99.9    | Max      | Added P99 | Lost  | FEC fixed | "
+        "Concealed | Late  | Underrun | Drift    |\n"
+        "| ---------------- | -------- | -------- | -------- | -------- | --------- | ----- | --------- | "
+        "--------- | ----- | -------- | -------- |\n";
+    char line[256];
+    for (const BenchRow& row : rows) {
+        const PipelineBenchResult& r = row.result;
+        std::snprintf(line, sizeof(line),
+                      "| %-16s | %5.2f ms | %5.2f ms | %5.2f ms | %5.2f ms | %6.2f ms | %5llu | %9llu | "
+                      "%7.3f %% | %5llu | %8llu | %4.0f ppm |\n",
+                      row.name.c_str(), r.latencyP50Ms, r.latencyP99Ms, r.latencyP999Ms, r.latencyMaxMs,
+                      r.latencyP99Ms - r.minTransitMs, static_cast<unsigned long long>(r.lost),
+                      static_cast<unsigned long long>(r.recoveredByParity + r.recoveredByRedundancy),
+                      r.concealedPercent(), static_cast<unsigned long long>(r.late),
+                      static_cast<unsigned long long>(r.underrunFrames), r.driftPpm);
+        out += line;
+    }
+    out += "\n| Scenario         | Frames   | FEC      | Playout  | Decode   | Render   | Speed   |\n"
+           "| ---------------- | -------- | -------- | -------- | -------- | -------- | ------- |\n";
+    for (const BenchRow& row : rows) {
+        const PipelineBenchResult& r = row.result;
+        std::snprintf(line, sizeof(line), "| %-16s | %8llu | %8.1f | %8.1f | %8.1f | %8.1f | %6.0fx |\n",
+                      row.name.c_str(), static_cast<unsigned long long>(r.framesPlayed),
+                      r.msPerMillionFrames(BenchStage::kFec), r.msPerMillionFrames(BenchStage::kPlayout),
+                      r.msPerMillionFrames(BenchStage::kDecode), r.msPerMillionFrames(BenchStage::kRender),
+                      r.wallSec > 0.0 ? r.audioSec / r.wallSec : 0.0);
+        out += line;
+    }
+    out += "\nStage columns are CPU milliseconds per million frames played.\n";
+    return out;
+}
+
+} // namespace aas
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "jitter_buffer.h"
+#include "packet_trace.h"
+
+namespace aas {
+
+/// Receiver stages timed separately by runPipelineBench().
+enum class BenchStage : std::uint8_t {
+    kFec,     ///< FecDecoder::onDatagram(): unwrap, split, repair, jitter insert
+    kPlayout, ///< JitterBuffer::pop()
+    kDecode,  ///< StreamDecoder::decode(), including PLC and comfort noise
+    kRender,  ///< FrameRingSource::render(): drift loop and resampler
+    kCount,
+};
+inline constexpr std::size_t kBenchStageCount = static_cast<std::size_t>(BenchStage::kCount);
+
+struct PipelineBenchConfig {
+    std::size_t outputChannels = 2;
+    /// Device period the render side pulls, in 48 kHz frames.
+    std::size_t periodFrames = 128;
+    /// Decode worker tick; DecodePool wakes at least every millisecond, and
+    /// on every delivery.
+    std::uint32_t workerTickUs = 1000;
+    JitterBufferConfig jitter{};
+    /// Frames sent during the first `warmupUs` are left out of the latency
+    /// figures (prefill and drift-loop lock).
+    std::uint64_t warmupUs = 1000000;
+    /// Virtual time kept running after the last arrival to drain playout.
+    std::uint64_t tailUs = 200000;
+    /// The drift figure is the loop's mean over the last `driftWindowUs`
+    /// before the final arrival, once it has had the rest to lock.
+    std::uint64_t driftWindowUs = 10000000;
+};
+
+struct PipelineBenchResult {
+    double audioSec = 0.0;
+    double wallSec = 0.0;
+    std::uint64_t datagrams = 0;
+    std::uint64_t framesPlayed = 0;
+
+    /// Send to first sample at the DAC, per frame (exact quantiles).
+    std::size_t latencySamples = 0;
+    double latencyP50Ms = 0.0;
+    double latencyP95Ms = 0.0;
+    double latencyP99Ms = 0.0;
+    double latencyP999Ms = 0.0;
+    double latencyMaxMs = 0.0;
+    /// Transit of the fastest packet. Latency above it is what jitter
+    /// buffering, decode and rendering add.
+    double minTransitMs = 0.0;
+
+    std::uint64_t received = 0;
+    std::uint64_t late = 0;
+    std::uint64_t duplicates = 0;
+    std::uint64_t lost = 0;
+    std::uint64_t expanded = 0;
+    std::uint64_t accelerated = 0;
+    std::uint64_t comfortNoise = 0;
+    std::uint64_t concealed = 0;
+    std::uint64_t recoveredByParity = 0;
+    std::uint64_t recoveredByRedundancy = 0;
+    std::uint64_t recoveredTooLate = 0;
+    std::uint64_t underrunFrames = 0;
+    std::uint64_t idleResets = 0;
+    /// Where the drift loop settled (see PipelineBenchConfig::driftWindowUs).
+    /// A sender running N ppm slow should read -N.
+    double driftPpm = 0.0;
+
+    /// Thread time spent in each stage, nanoseconds. Includes one
+    /// steady_clock read per call (tens of ns), which matters only against
+    /// PCM's near-free decode.
+    std::array<std::uint64_t, kBenchStageCount> stageNs{};
+
+    double concealedPercent() const {
+        return framesPlayed == 0 ? 0.0 : 100.0 * static_cast<double>(concealed) / framesPlayed;
+    }
+    /// Milliseconds of CPU per million frames played (equal to ns/frame).
+    double msPerMillionFrames(BenchStage stage) const {
+        const auto ns = static_cast<double>(stageNs[static_cast<std::size_t>(stage)]);
+        return framesPlayed == 0 ? 0.0 : ns / static_cast<double>(framesPlayed);
+    }
+};
+
+/// Replays `arrivals` through the receiver's real FEC decoder, jitter
+/// buffer, decoder and PLC, decoded-frame ring and drift resampler in
+/// virtual time, as fast as the CPU allows.
+///
+/// The stages are wired as StreamPipeline wires them and driven as the
+/// receiver drives them: the decode side runs after every delivery and on
+/// the worker tick, the render side every device period, and the period
+/// rendered at time t is taken to reach the DAC one period later. `sent`
+/// is the trace before impairment; its times give each frame's send time,
+/// keyed by sample clock, for the latency figures. Single-threaded.
+PipelineBenchResult runPipelineBench(const PacketTrace& sent, const PacketTrace& arrivals,
+                                     const PipelineBenchConfig& config = {});
+
+struct BenchRow {
+    std::string name;
+    PipelineBenchResult result;
+};
+
+/// Two Markdown tables: latency and loss per row, then CPU per stage.
+std::string formatBenchTable(const std::vector<BenchRow>& rows);
+
+} // namespace aas
@@ -0,0 +1,257 @@
+// Offline receiver benchmark: replays synthetic or recorded packet traces
+// through the receiver pipeline under a suite of network impairments and
+// prints latency, loss handling and per-stage CPU (README, Benchmarks).
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "network_impairment.h"
+#include "packet_trace.h"
+#include "pipeline_bench.h"
+
+namespace {
+
+using namespace aas;
+
+struct Scenario {
+    const char* name;
+    ImpairmentConfig impairment;
+    FecSettings fec;
+    double senderDriftPpm;
+    /// DTX gap from 2 s in, seconds; the stream needs to run past it.
+    double silenceSec = 0.0;
+};
+
+/// How far from the sender's drift the loop may settle before the run fails.
+constexpr double kDriftTolerancePpm = 100.0;
+
+ImpairmentConfig link(JitterDistribution jitter, std::uint32_t jitterUs) {
+    ImpairmentConfig config;
+    config.jitter = jitter;
+    config.jitterUs = jitterUs;
+    return config;
+}
+
+/// The fixed suite: a clean LAN, typical and busy Wi-Fi, then one
+/// impairment at a time on the typical link, each with the protection
+/// FecController would pick for it.
+std::vector<Scenario> suite() {
+    std::vector<Scenario> scenarios;
+    const ImpairmentConfig wifi = link(JitterDistribution::kPareto, 600);
+    scenarios.push_back({"clean", link(JitterDistribution::kExponential, 100), {}, 0.0});
+    scenarios.push_back({"wifi", wifi, {}, 0.0});
+    ImpairmentConfig busy = link(JitterDistribution::kPareto, 1500);
+    busy.paretoShape = 1.8;
+    scenarios.push_back({"wifi-busy", busy, {0, true, 0}, 0.0});
+
+    ImpairmentConfig random = wifi;
+    random.lossRate = 0.01;
+    scenarios.push_back({"loss-1%", random, {0, true, 1}, 0.0});
+    ImpairmentConfig burst = wifi;
+    burst.burstRate = 0.01;
+    burst.meanBurstPackets = 4.0;
+    scenarios.push_back({"burst-4", burst, {4, true, 4}, 0.0});
+    ImpairmentConfig reorder = wifi;
+    reorder.reorderRate = 0.02;
+    reorder.reorderUs = 4000;
+    scenarios.push_back({"reorder-2%", reorder, {}, 0.0});
+    ImpairmentConfig duplicate = wifi;
+    duplicate.duplicateRate = 0.05;
+    scenarios.push_back({"duplicate-5%", duplicate, {}, 0.0});
+    ImpairmentConfig stalls = wifi;
+    stalls.stallsPerSec = 0.5;
+    stalls.stallUs = 30000;
+    scenarios.push_back({"stall-30ms", stalls, {}, 0.0});
+    scenarios.push_back({"drift+300ppm", wifi, {}, 300.0});
+    scenarios.push_back({"drift-300ppm", wifi, {}, -300.0});
+    scenarios.push_back({"dtx-25s", link(JitterDistribution::kNone, 0), {}, 0.0, 25.0});
+    return scenarios;
+}
+
+bool parseJitter(const char* name, JitterDistribution& out) {
+    static const struct {
+        const char* name;
+        JitterDistribution value;
+    } kNames[] = {{"none", JitterDistribution::kNone},
+                  {"uniform", JitterDistribution::kUniform},
+                  {"halfnormal", JitterDistribution::kHalfNormal},
+                  {"exp", JitterDistribution::kExponential},
+                  {"pareto", JitterDistribution::kPareto}};
+    for (const auto& entry : kNames) {
+        if (std::strcmp(name, entry.name) == 0) {
+            out = entry.value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void usage() {
+    std::fprintf(stderr,
+                 "usage: replay_bench [options]\n"
+                 "  --seconds S      synthetic trace length (default 30)\n"
+                 "  --codec C        pcm | lossless (default pcm)\n"
+                 "  --channels N     synthetic channels (default 2)\n"
+                 "  --period N       device period in frames (default 128)\n"
+                 "  --seed N         impairment seed (default 1)\n"
+                 "  --scenario NAME  run one suite scenario\n"
+                 "  --trace FILE     replay a recorded trace instead of the synthetic one\n"
+                 "  --save FILE      write the sent trace\n"
+                 "custom impairment (replaces the suite):\n"
+                 "  --base-us N --jitter none|uniform|halfnormal|exp|pareto --jitter-us N\n"
+                 "  --pareto-shape X --loss P --burst-rate P --burst-len N --reorder P\n"
+                 "  --reorder-us N --dup P --stalls PER_SEC --stall-us N\n"
+                 "  --drift-ppm X --parity N --redundant\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    SyntheticTraceConfig synthetic;
+    synthetic.seconds = 30.0;
+    PipelineBenchConfig bench;
+    std::uint64_t seed = 1;
+    std::string only;
+    std::string tracePath;
+    std::string savePath;
+    bool custom = false;
+    Scenario customScenario{"custom", link(JitterDistribution::kPareto, 600), {}, 0.0};
+    ImpairmentConfig& imp = customScenario.impairment;
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--redundant") {
+            customScenario.fec.redundantFrame = true;
+            custom = true;
+            continue;
+        }
+        if (arg == "--help" || i + 1 >= argc) {
+            usage();
+            return arg == "--help" ? 0 : 2;
+        }
+        const char* value = argv[++i];
+        const double number = std::atof(value);
+        const auto whole = static_cast<std::uint32_t>(std::strtoul(value, nullptr, 10));
+        if (arg == "--seconds") {
+            synthetic.seconds = number;
+        } else if (arg == "--codec") {
+            synthetic.codec = std::strcmp(value, "lossless") == 0 ? CodecId::kLossless : CodecId::kPcm16;
+        } else if (arg == "--channels") {
+            synthetic.channels = static_cast<std::uint16_t>(whole);
+        } else if (arg == "--period") {
+            bench.periodFrames = whole;
+        } else if (arg == "--seed") {
+            seed = std::strtoull(value, nullptr, 10);
+        } else if (arg == "--scenario") {
+            only = value;
+        } else if (arg == "--trace") {
+            tracePath = value;
+        } else if (arg == "--save") {
+            savePath = value;
+        } else {
+            custom = true;
+            if (arg == "--base-us") {
+                imp.baseDelayUs = whole;
+            } else if (arg == "--jitter") {
+                if (!parseJitter(value, imp.jitter)) {
+                    usage();
+                    return 2;
+                }
+            } else if (arg == "--jitter-us") {
+                imp.jitterUs = whole;
+            } else if (arg == "--pareto-shape") {
+                imp.paretoShape = number;
+            } else if (arg == "--loss") {
+                imp.lossRate = number;
+            } else if (arg == "--burst-rate") {
+                imp.burstRate = number;
+            } else if (arg == "--burst-len") {
+                imp.meanBurstPackets = number;
+            } else if (arg == "--reorder") {
+                imp.reorderRate = number;
+            } else if (arg == "--reorder-us") {
+                imp.reorderUs = whole;
+            } else if (arg == "--dup") {
+                imp.duplicateRate = number;
+            } else if (arg == "--stalls") {
+                imp.stallsPerSec = number;
+            } else if (arg == "--stall-us") {
+                imp.stallUs = whole;
+            } else if (arg == "--drift-ppm") {
+                customScenario.senderDriftPpm = number;
+            } else if (arg == "--parity") {
+                customScenario.fec.parityGroupSize = static_cast<std::uint8_t>(whole);
+            } else {
+                usage();
+                return 2;
+            }
+        }
+    }
+
+    PacketTrace recorded;
+    if (!tracePath.empty()) {
+        std::string error;
+        if (!readPacketTrace(tracePath, recorded, &error)) {
+            std::fprintf(stderr, "%s: %s\n", tracePath.c_str(), error.c_str());
+            return 1;
+        }
+    }
+
+    std::vector<Scenario> scenarios = custom ? std::vector<Scenario>{customScenario} : suite();
+    std::vector<BenchRow> rows;
+    std::vector<double> expectedDriftPpm;
+    for (const Scenario& scenario : scenarios) {
+        if (!only.empty() && only != scenario.name) {
+            continue;
+        }
+        PacketTrace generated;
+        if (tracePath.empty()) {
+            SyntheticTraceConfig config = synthetic;
+            config.fec = scenario.fec;
+            config.senderDriftPpm = scenario.senderDriftPpm;
+            config.silenceFromSec = 2.0;
+            config.silenceSec = scenario.silenceSec;
+            generated = synthesizeTrace(config);
+            if (generated.empty()) {
+                std::fprintf(stderr, "no frames: %u channels do not fit a datagram\n", synthetic.channels);
+                return 1;
+            }
+        }
+        const PacketTrace& sent = tracePath.empty() ? generated : recorded;
+        if (!savePath.empty() && !writePacketTrace(savePath, sent)) {
+            std::fprintf(stderr, "%s: cannot write trace\n", savePath.c_str());
+            return 1;
+        }
+        ImpairmentConfig impairment = scenario.impairment;
+        impairment.seed = seed;
+        NetworkImpairment network(impairment);
+        const PacketTrace arrivals = network.apply(sent);
+        rows.push_back({scenario.name, runPipelineBench(sent, arrivals, bench)});
+        // A sender N ppm slow wants the device N ppm slow too. Only
+        // synthetic drift is known, and only the drift and DTX scenarios
+        // are there to test the loop.
+        const bool checked =
+            tracePath.empty() && (scenario.senderDriftPpm != 0.0 || scenario.silenceSec > 0.0);
+        expectedDriftPpm.push_back(checked ? -scenario.senderDriftPpm : std::nan(""));
+    }
+    if (rows.empty()) {
+        std::fprintf(stderr, "no scenario named %s\n", only.c_str());
+        return 2;
+    }
+    std::fputs(formatBenchTable(rows).c_str(), stdout);
+
+    int status = 0;
+    for (std::size_t i = 0; i < rows.size(); ++i) {
+        const double expected = expectedDriftPpm[i];
+        if (!std::isnan(expected) && std::fabs(rows[i].result.driftPpm - expected) > kDriftTolerancePpm) {
+            std::fprintf(stderr, "%s: drift loop settled at %.0f ppm, sender drift wants %.0f ppm\n",
+                         rows[i].name.c_str(), rows[i].result.driftPpm, expected);
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace aas {
+
+/// Micro-batching framing (kFlagAggregate, docs/protocol.md). The payload
+/// is
+///   [u8 count][count x u16 frame length][frame 0]...[frame count-1]
+/// where every frame is one separately encoded 2.5 ms frame. Frame i takes
+/// slot seq + i and starts at sample clock + 120 i; the header's frame
+/// units equal count. Each frame decodes on its own, so the receiver
+/// unpacks them into consecutive jitter-buffer slots and playout never
+/// sees the batch.
+inline constexpr std::uint8_t kMinAggregateFrames = 2;
+inline constexpr std::uint8_t kMaxAggregateFrames = 4;
+/// Longest packet in slots a receiver accepts: a 20 ms Opus frame.
+inline constexpr std::uint8_t kMaxPacketFrameUnits = 8;
+
+inline constexpr std::size_t aggregateTableBytes(std::uint8_t count) {
+    return 1 + sizeof(std::uint16_t) * count;
+}
+
+/// Frames of a received aggregate, pointing into the payload.
+struct AggregateView {
+    std::uint8_t count = 0;
+    std::array<const std::uint8_t*, kMaxAggregateFrames> frames{};
+    std::array<std::uint16_t, kMaxAggregateFrames> sizes{};
+};
+
+/// Writes the count and length table in front of frames already placed
+/// at `out + aggregateTableBytes(count)`.
+inline void writeAggregateTable(std::uint8_t* out, std::uint8_t count, const std::uint16_t* sizes) {
+    out[0] = count;
+    std::memcpy(out + 1, sizes, sizeof(std::uint16_t) * count);
+}
+
+/// Splits an aggregate payload. False if the count is out of range or the
+/// lengths do not add up to exactly `size`.
+inline bool parseAggregate(const std::uint8_t* payload, std::size_t size, AggregateView& out) {
+    if (size < 1) {
+        return false;
+    }
+    const std::uint8_t count = payload[0];
+    if (count < kMinAggregateFrames || count > kMaxAggregateFrames || size < aggregateTableBytes(count)) {
+        return false;
+    }
+    std::size_t offset = aggregateTableBytes(count);
+    out.count = count;
+    for (std::uint8_t i = 0; i < count; ++i) {
+        std::uint16_t length;
+        std::memcpy(&length, payload + 1 + sizeof(length) * i, sizeof(length));
+        if (length > size - offset) {
+            return false;
+        }
+        out.frames[i] = payload + offset;
+        out.sizes[i] = length;
+        offset += length;
+    }
+    return offset == size;
+}
+
+} // namespace aas
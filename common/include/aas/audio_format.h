@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace aas {
+
+/// Pipeline-wide audio constants. Every stage on both platforms works in
+/// 2.5 ms frames of 120 samples at 48 kHz (see docs/prd.md, Audio Encoding).
+inline constexpr std::uint32_t kSampleRateHz = 48000;
+inline constexpr std::size_t kFrameSamples = 120;
+inline constexpr std::uint32_t kFrameDurationUs = 2500;
+/// Stereo is the norm; live rigs run up to 8 channels, interleaved in WAVE
+/// order (aas/sample_format.h, ChannelMap).
+inline constexpr std::size_t kMaxFrameChannels = 8;
+
+static_assert(kFrameSamples * 1000000u / kSampleRateHz == kFrameDurationUs,
+              "frame duration must match frame size at the pipeline rate");
+
+/// Bits of AudioFrame::flags.
+enum AudioFrameFlags : std::uint16_t {
+    /// The latency marker starts at the first sample of this frame.
+    kAudioFrameMarker = 1u << 0,
+};
+
+/// One 2.5 ms block of interleaved float PCM as it travels between stages.
+/// Fixed size so ring slots can be preallocated and copied without branches.
+struct AudioFrame {
+    /// Sample-clock position of the first sample (wraps at 2^32).
+    std::uint32_t sampleClock = 0;
+    std::uint16_t channels = 1;
+    std::uint16_t flags = 0;
+    /// Local monotonic time (us) at which the first sample hit the input
+    /// converter, as estimated by the capture stage; 0 if unknown.
+    std::uint64_t captureUs = 0;
+    /// Local monotonic time (us) the frame was delivered to the pipeline by
+    /// the audio callback; 0 if unknown.
+    std::uint64_t callbackUs = 0;
+    float samples[kFrameSamples * kMaxFrameChannels] = {};
+};
+
+} // namespace aas
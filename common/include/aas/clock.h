@@ -0,0 +1,17 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace aas {
+
+/// Monotonic microseconds for stage timing and arrival stamps. steady_clock
+/// maps to CLOCK_MONOTONIC on Android and QueryPerformanceCounter on
+/// Windows, so this is cheap enough to call per packet.
+inline std::uint64_t monotonicMicros() {
+    using namespace std::chrono;
+    return static_cast<std::uint64_t>(
+        duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace aas
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/datagram.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// What the codec menu shows for each codec (docs/prd.md, Audio Encoding):
+/// the latency it adds on top of the 2.5 ms frame and the stereo bandwidth
+/// on the wire. Encode figures are the per-frame budgets the pipeline is
+/// held to, not measurements; the live table comes from LatencyReport.
+struct CodecInfo {
+    CodecId id;
+    const char* name;
+    /// Encode plus decode time per frame, ms.
+    double codecMs;
+    /// Lookahead beyond the frame itself, ms.
+    double lookaheadMs;
+    /// Typical stereo payload rate, kbit/s (headers excluded).
+    std::uint32_t stereoKbps;
+    bool lossless;
+};
+
+inline constexpr CodecInfo kCodecInfo[] = {
+    {CodecId::kPcm16, "PCM 16-bit", 0.05, 0.0, 1536, true},
+    // FLAC-style fixed prediction + Rice; bandwidth depends on the material
+    // (dense mixes ~60% of PCM, speech and quiet passages ~30%).
+    {CodecId::kLossless, "Lossless (LPC + Rice)", 0.2, 0.0, 768, true},
+    // CELT-only VoIP mode, README latency budget (3.0 ms encode, 1.5 ms
+    // decode); 2.5 ms lookahead.
+    {CodecId::kOpus, "Opus (CELT)", 4.5, 2.5, 128, false},
+    // The same encoder per stream; the rate is per stereo pair.
+    {CodecId::kOpusMultistream, "Opus multichannel (CELT)", 4.5, 2.5, 128, false},
+    // AAC-ELD at 480-sample frames: four pipeline frames are buffered.
+    {CodecId::kAac, "AAC-ELD", 2.0, 7.5, 128, false},
+};
+
+inline constexpr std::size_t kCodecCount = sizeof(kCodecInfo) / sizeof(kCodecInfo[0]);
+
+inline const CodecInfo* findCodecInfo(CodecId id) {
+    for (const CodecInfo& info : kCodecInfo) {
+        if (info.id == id) {
+            return &info;
+        }
+    }
+    return nullptr;
+}
+
+/// Most channels one 2.5 ms frame of `codec` can carry in a datagram. PCM
+/// is bounded by the 1400-byte payload (240 bytes per channel); lossless
+/// frames of up to eight channels go out whenever they compress, which is
+/// all but white noise, so its bound is the verbatim one too. Plain Opus is
+/// mono or stereo; more channels use kOpusMultistream.
+inline constexpr std::size_t maxWireChannels(CodecId codec) {
+    switch (codec) {
+    case CodecId::kPcm16:
+    case CodecId::kLossless:
+        return kMaxPayloadBytes / (kFrameSamples * sizeof(std::int16_t));
+    case CodecId::kOpus:
+    case CodecId::kAac:
+        return 2;
+    case CodecId::kOpusMultistream:
+        return kMaxFrameChannels;
+    }
+    return 0;
+}
+
+/// Delay the mic-mode RNNoise stage adds ahead of the encoder: 7.5 ms
+/// bridging 2.5 ms frames to its 10 ms frames plus 10 ms of overlap-add
+/// synthesis (NoiseSuppressor::kAddedDelaySamples). Android's built-in
+/// NoiseSuppressor runs inside the capture path and adds nothing here.
+inline constexpr double kRnnoiseAddedMs = 17.5;
+
+/// The latency estimate shown next to the codec: one frame of capture
+/// buffering plus lookahead plus codec time, plus RNNoise when it is on.
+inline constexpr double codecLatencyEstimateMs(const CodecInfo& info, bool rnnoise = false) {
+    return static_cast<double>(kFrameDurationUs) / 1000.0 + info.lookaheadMs + info.codecMs +
+           (rnnoise ? kRnnoiseAddedMs : 0.0);
+}
+
+} // namespace aas
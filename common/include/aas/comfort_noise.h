@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+/// Spectral envelope order of the comfort noise. Background noise is
+/// smooth enough that four poles capture its tilt and one broad resonance
+/// (fan hum, room tone), and the descriptor stays six bytes.
+inline constexpr std::size_t kComfortNoiseOrder = 4;
+inline constexpr std::size_t kComfortNoiseBytes = 2 + kComfortNoiseOrder;
+
+/// Payload of a kFlagSilence packet (docs/protocol.md, Discontinuous
+/// Transmission): what the background sounded like when the sender went
+/// quiet, so the receiver can keep playing something like it.
+struct ComfortNoiseDescriptor {
+    std::uint8_t channels = 1;
+    /// RMS level, dBFS; -127 is digital silence.
+    std::int8_t levelDb = -127;
+    /// Reflection coefficients of the all-pole envelope, Q7.
+    std::int8_t reflection[kComfortNoiseOrder] = {};
+};
+
+inline std::size_t writeComfortNoise(const ComfortNoiseDescriptor& cn, std::uint8_t* out) {
+    out[0] = cn.channels;
+    out[1] = static_cast<std::uint8_t>(cn.levelDb);
+    for (std::size_t i = 0; i < kComfortNoiseOrder; ++i) {
+        out[2 + i] = static_cast<std::uint8_t>(cn.reflection[i]);
+    }
+    return kComfortNoiseBytes;
+}
+
+inline bool readComfortNoise(const std::uint8_t* data, std::size_t size, ComfortNoiseDescriptor& out) {
+    if (size < kComfortNoiseBytes || data[0] == 0 || data[0] > kMaxFrameChannels) {
+        return false;
+    }
+    out.channels = data[0];
+    out.levelDb = static_cast<std::int8_t>(data[1]);
+    for (std::size_t i = 0; i < kComfortNoiseOrder; ++i) {
+        out.reflection[i] = static_cast<std::int8_t>(data[2 + i]);
+    }
+    return true;
+}
+
+/// Order-kComfortNoiseOrder LPC analysis of `n` samples by Levinson-Durbin.
+/// Writes the reflection coefficients and returns the normalised
+/// prediction error (residual over signal energy): near 1 for white noise,
+/// far below it for voiced speech or tones, which is the spectral flatness
+/// of the all-pole fit without an FFT. Returns 1 with zero coefficients for
+/// silence.
+inline float lpcReflection(const float* x, std::size_t n, float* reflection) {
+    double r[kComfortNoiseOrder + 1] = {};
+    for (std::size_t lag = 0; lag <= kComfortNoiseOrder; ++lag) {
+        for (std::size_t i = lag; i < n; ++i) {
+            r[lag] += static_cast<double>(x[i]) * x[i - lag];
+        }
+    }
+    std::fill(reflection, reflection + kComfortNoiseOrder, 0.0f);
+    if (r[0] <= 1e-12) {
+        return 1.0f;
+    }
+    // A touch of white-noise correction keeps the recursion
+    // well-conditioned on near-pure tones.
+    r[0] *= 1.0001;
+    double a[kComfortNoiseOrder + 1] = {1.0};
+    double error = r[0];
+    for (std::size_t m = 1; m <= kComfortNoiseOrder; ++m) {
+        double acc = r[m];
+        for (std::size_t i = 1; i < m; ++i) {
+            acc += a[i] * r[m - i];
+        }
+        const double k = -acc / error;
+        double next[kComfortNoiseOrder + 1];
+        for (std::size_t i = 1; i < m; ++i) {
+            next[i] = a[i] + k * a[m - i];
+        }
+        for (std::size_t i = 1; i < m; ++i) {
+            a[i] = next[i];
+        }
+        a[m] = k;
+        error *= 1.0 - k * k;
+        reflection[m - 1] = static_cast<float>(k);
+    }
+    return static_cast<float>(error / r[0]);
+}
+
+/// Receiver side: shaped noise from the last descriptor. The level glides
+/// over a few frames when a refreshed descriptor arrives, so updates do not
+/// click. One filter state per channel, no allocation.
+class ComfortNoiseGenerator {
+public:
+    /// Largest reflection magnitude used, keeping the synthesis filter
+    /// comfortably stable after Q7 rounding.
+    static constexpr float kMaxReflection = 0.97f;
+
+    void setDescriptor(const ComfortNoiseDescriptor& cn) {
+        channels_ = std::clamp<std::size_t>(cn.channels, 1, kMaxFrameChannels);
+        // Step-up recursion: reflection to direct-form coefficients, and
+        // the normalised prediction error the envelope implies.
+        float a[kComfortNoiseOrder + 1] = {1.0f};
+        float error = 1.0f;
+        for (std::size_t m = 1; m <= kComfortNoiseOrder; ++m) {
+            const float k = std::clamp(cn.reflection[m - 1] / 128.0f, -kMaxReflection, kMaxReflection);
+            float next[kComfortNoiseOrder + 1];
+            for (std::size_t i = 1; i < m; ++i) {
+                next[i] = a[i] + k * a[m - i];
+            }
+            for (std::size_t i = 1; i < m; ++i) {
+                a[i] = next[i];
+            }
+            a[m] = k;
+            error *= 1.0f - k * k;
+        }
+        for (std::size_t i = 0; i < kComfortNoiseOrder; ++i) {
+            a_[i] = a[i + 1];
+        }
+        // The filter multiplies white-noise power by 1 / error; uniform
+        // noise in [-1, 1] has power 1/3.
+        const float rms = cn.levelDb <= -127 ? 0.0f : std::pow(10.0f, cn.levelDb / 20.0f);
+        targetGain_ = rms * std::sqrt(3.0f * error);
+        if (!started_) {
+            gain_ = targetGain_;
+            started_ = true;
+        }
+    }
+
+    /// One frame of noise at the descriptor's channel count.
+    void generate(AudioFrame& out) {
+        out.channels = static_cast<std::uint16_t>(channels_);
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            gain_ += (targetGain_ - gain_) * kGlidePerSample;
+            for (std::size_t ch = 0; ch < channels_; ++ch) {
+                float* state = state_[ch];
+                float y = gain_ * uniform(seed_[ch]);
+                for (std::size_t k = 0; k < kComfortNoiseOrder; ++k) {
+                    y -= a_[k] * state[k];
+                }
+                for (std::size_t k = kComfortNoiseOrder - 1; k > 0; --k) {
+                    state[k] = state[k - 1];
+                }
+                state[0] = y;
+                out.samples[i * channels_ + ch] = y;
+            }
+        }
+    }
+
+    bool ready() const { return started_; }
+
+    void reset() {
+        started_ = false;
+        gain_ = 0.0f;
+        targetGain_ = 0.0f;
+        for (auto& state : state_) {
+            std::fill(state, state + kComfortNoiseOrder, 0.0f);
+        }
+    }
+
+private:
+    /// About 10 ms to settle on a new level.
+    static constexpr float kGlidePerSample = 1.0f / 480.0f;
+
+    static float uniform(std::uint32_t& s) {
+        s ^= s << 13;
+        s ^= s >> 17;
+        s ^= s << 5;
+        return static_cast<float>(static_cast<std::int32_t>(s)) * (1.0f / 2147483648.0f);
+    }
+
+    std::size_t channels_ = 1;
+    float a_[kComfortNoiseOrder] = {};
+    float gain_ = 0.0f;
+    float targetGain_ = 0.0f;
+    bool started_ = false;
+    float state_[kMaxFrameChannels][kComfortNoiseOrder] = {};
+    std::uint32_t seed_[kMaxFrameChannels] = {0x9e3779b9u, 0x7f4a7c15u, 0x94d049bbu, 0xbf58476du,
+                                              0x2545f491u, 0x6a09e667u, 0xbb67ae85u, 0x3c6ef372u};
+};
+
+} // namespace aas
@@ -0,0 +1,567 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/clock.h"
+#include "aas/datagram.h"
+#include "aas/packet_header.h"
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// Messages of the control channel (docs/protocol.md, Control Channel).
+enum class ControlType : std::uint8_t {
+    kVolume = 1,          ///< GainCommand, value = gain in Q12 (4096 = unity)
+    kPause = 2,           ///< GainCommand, value = 1 to pause, 0 to resume
+    kCodecRequest = 3,    ///< CodecRequest, receiver to sender
+    kReceiverReport = 4,  ///< ReceiverReport, receiver to sender
+    kPing = 5,            ///< ControlPing, answered by the channel itself
+    kPong = 6,
+};
+
+/// Commands are delivered exactly once and in order. Reports and pings are
+/// best effort: a lost report is superseded by the next one, and waiting
+/// for a retransmitted ping would measure the retransmission.
+constexpr bool controlReliable(ControlType type) {
+    return type == ControlType::kVolume || type == ControlType::kPause ||
+           type == ControlType::kCodecRequest;
+}
+
+inline constexpr std::size_t kMaxControlPayload = 32;
+inline constexpr std::uint16_t kUnityGainQ12 = 4096;
+
+/// GainCommand flags.
+enum GainCommandFlags : std::uint8_t {
+    /// Start at `atSampleClock` (the sender's capture clock) rather than at
+    /// the next frame boundary.
+    kGainAtSampleClock = 1u << 0,
+};
+
+#pragma pack(push, 1)
+struct GainCommand {
+    std::uint16_t value;
+    std::uint8_t flags;  ///< GainCommandFlags
+    std::uint8_t reserved;
+    std::uint32_t atSampleClock;
+    /// Linear ramp length; 0 means one frame.
+    std::uint16_t rampSamples;
+    std::uint16_t reserved2;
+};
+
+/// Zero in any field means "keep the current one".
+struct CodecRequest {
+    CodecId codec;
+    std::uint8_t frameUnits;
+    std::uint8_t channels;
+    std::uint8_t reserved;
+    std::uint32_t bitrateBps;
+};
+
+/// What the receiver made of the last interval, for the sender's
+/// FecController and BatchController.
+struct ReceiverReport {
+    std::uint16_t intervalMs;
+    /// Slots missing before FEC (lost for good plus recovered), per mille
+    /// of the slots due.
+    std::uint16_t lossPermille;
+    /// Slots lost after FEC, i.e. concealed.
+    std::uint16_t residualLossPermille;
+    /// Slots that arrived after their playout time.
+    std::uint16_t latePermille;
+    std::uint32_t delayP95Us;  ///< jitter-buffer delay above the fastest packet
+    std::uint32_t delayP99Us;
+    std::uint8_t targetDepthFrames;
+    std::uint8_t depthFrames;
+    std::uint16_t reserved;
+    std::uint32_t slots;  ///< slots due in the interval
+};
+
+struct ControlPing {
+    std::uint64_t t1;  ///< pinger's clock
+    std::uint64_t t2;  ///< responder's clock, pong only
+};
+
+/// Datagram layout after the media header (kFlagControl, frame units 0).
+struct ControlFrameHeader {
+    /// Chosen by each end at reset(); a new value tells the peer to sync
+    /// its receive state to `base` instead of waiting for old sequence
+    /// numbers.
+    std::uint32_t session;
+    /// Oldest reliable sequence number this end has not had acknowledged.
+    std::uint16_t base;
+    /// Next reliable sequence number expected from the peer (cumulative).
+    std::uint16_t ack;
+    std::uint8_t count;  ///< messages that follow
+    std::uint8_t reserved[3];
+};
+
+struct ControlMessageHeader {
+    ControlType type;
+    std::uint8_t length;
+    std::uint16_t seq;  ///< reliable messages only, zero otherwise
+};
+#pragma pack(pop)
+
+inline constexpr std::size_t kControlFrameHeaderBytes = sizeof(ControlFrameHeader);
+static_assert(kControlFrameHeaderBytes == 12, "control frame header must have no padding");
+
+struct ControlMessage {
+    ControlType type = ControlType::kPing;
+    std::uint8_t length = 0;
+    std::uint8_t payload[kMaxControlPayload] = {};
+
+    template <typename T>
+    static ControlMessage make(ControlType type, const T& body) {
+        static_assert(sizeof(T) <= kMaxControlPayload, "control payload too large");
+        ControlMessage message;
+        message.type = type;
+        message.length = static_cast<std::uint8_t>(sizeof(T));
+        std::memcpy(message.payload, &body, sizeof(T));
+        return message;
+    }
+
+    /// False if the payload is too short for T (a newer peer may append
+    /// fields, so longer is fine).
+    template <typename T>
+    bool read(T& out) const {
+        if (length < sizeof(T)) {
+            return false;
+        }
+        std::memcpy(&out, payload, sizeof(T));
+        return true;
+    }
+};
+
+/// Counters, readable from any thread.
+struct ControlChannelStats {
+    std::atomic<std::uint64_t> datagramsSent{0};
+    std::atomic<std::uint64_t> messagesSent{0};
+    std::atomic<std::uint64_t> retransmits{0};
+    std::atomic<std::uint64_t> delivered{0};
+    std::atomic<std::uint64_t> duplicates{0};
+    /// Best-effort messages dropped because a queue was full.
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> malformed{0};
+    std::atomic<std::uint64_t> peerRestarts{0};
+    /// Datagrams from a second session while the current peer was live.
+    std::atomic<std::uint64_t> ignored{0};
+    /// Smoothed control round trip (acks and pings).
+    std::atomic<std::uint32_t> srttUs{0};
+};
+
+/// Reliable, ordered control sub-channel multiplexed on the media flow:
+/// standalone datagrams with kFlagControl on the same socket pair, so it
+/// needs no extra connection, port or firewall rule, and a lost command
+/// never holds up audio behind it.
+///
+/// Reliable messages get a 16-bit sequence number and stay in a window of
+/// kWindow until the peer's cumulative ack covers them. They are resent
+/// after an RTO taken from the measured round trip as in RFC 6298, which
+/// on a LAN is the kMinRtoUs floor, so a lost command costs a couple of
+/// milliseconds rather than a TCP-style 200 ms. The RTO doubles each time
+/// it expires on the oldest unacknowledged message (RFC 6298 5.5), not for
+/// every message resent alongside it. The receiving end buffers
+/// anything that arrives ahead of a gap and delivers strictly in order.
+/// Every datagram carries the ack, and a reliable arrival makes the next
+/// poll() send one even if there is nothing else to say. Best-effort
+/// messages ride along in the same datagrams.
+///
+/// Three roles, one thread each:
+///   - application thread: post() and receive(), through SPSC rings;
+///   - I/O thread (the one that owns the socket): onDatagram(), poll(),
+///     and enqueue() for messages it generates itself (reports);
+///   - anyone: stats().
+/// The I/O thread must call poll() after every onDatagram() and at least
+/// every kMinRtoUs while anything is unacknowledged.
+class ControlChannel {
+public:
+    static constexpr std::size_t kWindow = 16;
+    static constexpr std::size_t kQueue = 32;
+    static constexpr std::uint64_t kInitialRtoUs = 10'000;
+    static constexpr std::uint64_t kMinRtoUs = 2'000;
+    static constexpr std::uint64_t kMaxRtoUs = 250'000;
+    static constexpr std::uint64_t kPingIntervalUs = 1'000'000;
+    /// Silence after which a held peer may be replaced (setHoldPeer()); a
+    /// live peer pings at least once a second.
+    static constexpr std::uint64_t kPeerQuietUs = 2 * kPingIntervalUs;
+
+    using Queue = SpscRing<ControlMessage, kQueue>;
+
+    explicit ControlChannel(std::uint32_t session = 0) { reset(session); }
+    ControlChannel(const ControlChannel&) = delete;
+    ControlChannel& operator=(const ControlChannel&) = delete;
+
+    // ---- application thread -------------------------------------------
+
+    /// Queues `message` for the I/O thread. False when the queue is full.
+    bool post(const ControlMessage& message) { return outbox_.tryPush(message); }
+
+    /// Takes the next delivered message.
+    bool receive(ControlMessage& out) { return inbox_.tryPop(out); }
+
+    // ---- I/O thread ----------------------------------------------------
+
+    /// Queues a message generated on the I/O thread. False when the window
+    /// (reliable) or the best-effort queue is full.
+    bool enqueue(const ControlMessage& message) {
+        if (controlReliable(message.type)) {
+            return addReliable(message);
+        }
+        return addBestEffort(message);
+    }
+
+    /// With `hold`, a datagram from a new session is ignored until the
+    /// current peer has been quiet for kPeerQuietUs, so a second sender
+    /// cannot take the channel over from a live one; a restarted peer is
+    /// picked up once its old session has gone quiet. Set before use.
+    void setHoldPeer(bool hold) { holdPeer_ = hold; }
+
+    /// Takes one datagram with kFlagControl. Returns false (and counts it)
+    /// if it is malformed or from a session held off by setHoldPeer().
+    bool onDatagram(const std::uint8_t* data, std::size_t size, std::uint64_t nowUs) {
+        PacketHeader header;
+        if (!readPacketHeader(data, size, header) || !header.hasFlag(kFlagControl) ||
+            size < kPacketHeaderBytes + kControlFrameHeaderBytes) {
+            stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        ControlFrameHeader frame;
+        std::memcpy(&frame, data + kPacketHeaderBytes, sizeof(frame));
+        if (holdPeer_ && havePeer_ && frame.session != peerSession_ && nowUs < lastPeerUs_ + kPeerQuietUs) {
+            stats_.ignored.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        lastPeerUs_ = nowUs;
+        if (!havePeer_ || frame.session != peerSession_) {
+            if (havePeer_) {
+                stats_.peerRestarts.fetch_add(1, std::memory_order_relaxed);
+            }
+            havePeer_ = true;
+            peerSession_ = frame.session;
+            recvNext_ = frame.base;
+            for (Incoming& slot : reorder_) {
+                slot.occupied = false;
+            }
+            nextPingUs_ = nowUs;
+        }
+        onAck(frame.ack, nowUs);
+
+        std::size_t offset = kPacketHeaderBytes + kControlFrameHeaderBytes;
+        for (std::uint8_t i = 0; i < frame.count; ++i) {
+            ControlMessageHeader m;
+            if (offset + sizeof(m) > size) {
+                stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            std::memcpy(&m, data + offset, sizeof(m));
+            offset += sizeof(m);
+            if (m.length > kMaxControlPayload || offset + m.length > size) {
+                stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            ControlMessage message;
+            message.type = m.type;
+            message.length = m.length;
+            std::memcpy(message.payload, data + offset, m.length);
+            offset += m.length;
+            if (controlReliable(m.type)) {
+                onReliable(m.seq, message);
+            } else {
+                onBestEffort(message, nowUs);
+            }
+        }
+        deliverInOrder();
+        return true;
+    }
+
+    /// Writes the next datagram that is due (new messages, retransmissions,
+    /// best-effort messages, or a bare ack) into `out` (kMaxDatagramBytes)
+    /// and returns its size, 0 when there is nothing to send. Call until it
+    /// returns 0.
+    std::size_t poll(std::uint64_t nowUs, std::uint8_t streamId, std::uint8_t* out) {
+        pullOutbox();
+        if (havePeer_ && nowUs >= nextPingUs_) {
+            ControlPing ping{nowUs, 0};
+            addBestEffort(ControlMessage::make(ControlType::kPing, ping));
+            nextPingUs_ = nowUs + kPingIntervalUs;
+        }
+
+        PacketHeader header{};
+        header.versionCodec = PacketHeader::packVersionCodec(CodecId::kPcm16);
+        header.flags = kFlagControl;
+        header.streamId = streamId;
+        header.frameUnits = 0;
+        std::uint8_t* const start = writePacketHeader(header, out);
+        std::size_t size = kPacketHeaderBytes + kControlFrameHeaderBytes;
+        std::uint8_t count = 0;
+        bool expired = false;
+
+        for (std::uint16_t seq = sendBase_; seq != nextSeq_; ++seq) {
+            Outgoing& o = window_[seq % kWindow];
+            if (o.sentUs != 0 && nowUs < o.sentUs + rtoUs_) {
+                continue;
+            }
+            if (!fits(size, o.message)) {
+                break;
+            }
+            size = writeMessage(out, size, o.message, seq);
+            ++count;
+            if (o.sentUs != 0) {
+                o.retransmitted = true;
+                expired |= seq == sendBase_;
+                stats_.retransmits.fetch_add(1, std::memory_order_relaxed);
+            }
+            o.sentUs = nowUs;
+        }
+        while (bestEffortCount_ > 0 && fits(size, bestEffort_[bestEffortHead_])) {
+            size = writeMessage(out, size, bestEffort_[bestEffortHead_], 0);
+            bestEffortHead_ = (bestEffortHead_ + 1) % kQueue;
+            --bestEffortCount_;
+            ++count;
+        }
+        if (count == 0 && !ackDue_) {
+            return 0;
+        }
+
+        ControlFrameHeader frame{};
+        frame.session = session_;
+        frame.base = sendBase_;
+        frame.ack = recvNext_;
+        frame.count = count;
+        std::memcpy(start, &frame, sizeof(frame));
+        ackDue_ = false;
+        if (expired) {
+            rtoUs_ = std::min(rtoUs_ * 2, kMaxRtoUs);
+        }
+        stats_.datagramsSent.fetch_add(1, std::memory_order_relaxed);
+        stats_.messagesSent.fetch_add(count, std::memory_order_relaxed);
+        return size;
+    }
+
+    /// Reliable messages sent and not yet acknowledged.
+    std::size_t unacked() const { return static_cast<std::uint16_t>(nextSeq_ - sendBase_); }
+
+    /// Starts a new session: forgets every message in flight and all
+    /// receive state. 0 derives the id from the clock.
+    void reset(std::uint32_t session) {
+        session_ = session != 0 ? session : freshSession();
+        sendBase_ = 0;
+        nextSeq_ = 0;
+        for (Outgoing& o : window_) {
+            o = Outgoing{};
+        }
+        bestEffortHead_ = 0;
+        bestEffortCount_ = 0;
+        havePeer_ = false;
+        peerSession_ = 0;
+        lastPeerUs_ = 0;
+        recvNext_ = 0;
+        for (Incoming& slot : reorder_) {
+            slot.occupied = false;
+        }
+        ackDue_ = false;
+        haveRtt_ = false;
+        srttUs_ = 0.0;
+        rttvarUs_ = 0.0;
+        rtoUs_ = kInitialRtoUs;
+        nextPingUs_ = 0;
+    }
+
+    std::uint32_t session() const { return session_; }
+    bool havePeer() const { return havePeer_; }
+    const ControlChannelStats& stats() const { return stats_; }
+
+private:
+    struct Outgoing {
+        ControlMessage message;
+        std::uint64_t sentUs = 0;  ///< 0 until first sent
+        bool retransmitted = false;
+    };
+
+    struct Incoming {
+        bool occupied = false;
+        std::uint16_t seq = 0;
+        ControlMessage message;
+    };
+
+    static int seqDelta(std::uint16_t a, std::uint16_t b) {
+        return static_cast<std::int16_t>(static_cast<std::uint16_t>(a - b));
+    }
+
+    static std::uint32_t freshSession() {
+        const std::uint64_t now = monotonicMicros();
+        const auto mixed = static_cast<std::uint32_t>(now ^ (now >> 32) ^ (now >> 17));
+        return mixed != 0 ? mixed : 1;
+    }
+
+    static bool fits(std::size_t size, const ControlMessage& message) {
+        return size + sizeof(ControlMessageHeader) + message.length <= kMaxDatagramBytes;
+    }
+
+    static std::size_t writeMessage(std::uint8_t* out, std::size_t size, const ControlMessage& message,
+                                    std::uint16_t seq) {
+        ControlMessageHeader m{message.type, message.length, seq};
+        std::memcpy(out + size, &m, sizeof(m));
+        std::memcpy(out + size + sizeof(m), message.payload, message.length);
+        return size + sizeof(m) + message.length;
+    }
+
+    bool addReliable(const ControlMessage& message) {
+        if (unacked() >= kWindow) {
+            return false;
+        }
+        Outgoing& o = window_[nextSeq_ % kWindow];
+        o.message = message;
+        o.sentUs = 0;
+        o.retransmitted = false;
+        ++nextSeq_;
+        return true;
+    }
+
+    bool addBestEffort(const ControlMessage& message) {
+        if (bestEffortCount_ == kQueue) {
+            stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        bestEffort_[(bestEffortHead_ + bestEffortCount_) % kQueue] = message;
+        ++bestEffortCount_;
+        return true;
+    }
+
+    /// Moves posted messages into the window while it has room; the rest
+    /// wait in the ring, in order.
+    void pullOutbox() {
+        while (const ControlMessage* message = outbox_.readSlot()) {
+            if (controlReliable(message->type)) {
+                if (!addReliable(*message)) {
+                    break;
+                }
+            } else {
+                addBestEffort(*message);
+            }
+            outbox_.release();
+        }
+    }
+
+    void onAck(std::uint16_t ack, std::uint64_t nowUs) {
+        const int covered = seqDelta(ack, sendBase_);
+        if (covered <= 0 || covered > static_cast<int>(unacked())) {
+            return;  // nothing new, or not from this session
+        }
+        for (std::uint16_t seq = sendBase_; seq != ack; ++seq) {
+            const Outgoing& o = window_[seq % kWindow];
+            // Karn: a retransmitted message's ack may be for either copy.
+            if (!o.retransmitted && o.sentUs != 0 && nowUs >= o.sentUs) {
+                addRtt(static_cast<double>(nowUs - o.sentUs));
+            }
+        }
+        sendBase_ = ack;
+    }
+
+    void addRtt(double rttUs) {
+        if (!haveRtt_) {
+            haveRtt_ = true;
+            srttUs_ = rttUs;
+            rttvarUs_ = rttUs / 2.0;
+        } else {
+            rttvarUs_ += (std::fabs(rttUs - srttUs_) - rttvarUs_) / 4.0;
+            srttUs_ += (rttUs - srttUs_) / 8.0;
+        }
+        const auto rto = static_cast<std::uint64_t>(srttUs_ + 4.0 * rttvarUs_);
+        rtoUs_ = std::clamp(rto, kMinRtoUs, kMaxRtoUs);
+        stats_.srttUs.store(static_cast<std::uint32_t>(srttUs_), std::memory_order_relaxed);
+    }
+
+    void onReliable(std::uint16_t seq, const ControlMessage& message) {
+        ackDue_ = true;
+        const int ahead = seqDelta(seq, recvNext_);
+        if (ahead < 0 || ahead >= static_cast<int>(kWindow)) {
+            // Already delivered (our ack was lost), or beyond the window
+            // the peer may have in flight.
+            stats_.duplicates.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Incoming& slot = reorder_[seq % kWindow];
+        if (slot.occupied) {
+            stats_.duplicates.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        slot.occupied = true;
+        slot.seq = seq;
+        slot.message = message;
+    }
+
+    void onBestEffort(const ControlMessage& message, std::uint64_t nowUs) {
+        if (message.type == ControlType::kPing) {
+            ControlPing ping;
+            if (message.read(ping)) {
+                ping.t2 = nowUs;
+                addBestEffort(ControlMessage::make(ControlType::kPong, ping));
+            }
+            return;
+        }
+        if (message.type == ControlType::kPong) {
+            ControlPing pong;
+            if (message.read(pong) && nowUs >= pong.t1) {
+                addRtt(static_cast<double>(nowUs - pong.t1));
+            }
+            return;
+        }
+        if (!inbox_.tryPush(message)) {
+            stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        stats_.delivered.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Hands buffered messages to the inbox from recvNext_ on. A full inbox
+    /// leaves them buffered and unacknowledged, so the peer keeps them too.
+    void deliverInOrder() {
+        for (;;) {
+            Incoming& slot = reorder_[recvNext_ % kWindow];
+            if (!slot.occupied || slot.seq != recvNext_ || !inbox_.tryPush(slot.message)) {
+                return;
+            }
+            slot.occupied = false;
+            ++recvNext_;
+            stats_.delivered.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // Application thread <-> I/O thread.
+    Queue outbox_;
+    Queue inbox_;
+
+    // Send side (I/O thread).
+    std::uint32_t session_ = 0;
+    std::uint16_t sendBase_ = 0;
+    std::uint16_t nextSeq_ = 0;
+    std::array<Outgoing, kWindow> window_{};
+    std::array<ControlMessage, kQueue> bestEffort_{};
+    std::size_t bestEffortHead_ = 0;
+    std::size_t bestEffortCount_ = 0;
+    bool haveRtt_ = false;
+    double srttUs_ = 0.0;
+    double rttvarUs_ = 0.0;
+    std::uint64_t rtoUs_ = kInitialRtoUs;
+    std::uint64_t nextPingUs_ = 0;
+
+    // Receive side (I/O thread).
+    bool havePeer_ = false;
+    bool holdPeer_ = false;
+    std::uint32_t peerSession_ = 0;
+    std::uint64_t lastPeerUs_ = 0;
+    std::uint16_t recvNext_ = 0;
+    std::array<Incoming, kWindow> reorder_{};
+    bool ackDue_ = false;
+
+    ControlChannelStats stats_;
+};
+
+} // namespace aas
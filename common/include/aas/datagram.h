@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// Largest UDP payload that fits a 1500-byte Ethernet/Wi-Fi MTU without
+/// IP fragmentation (1500 - 20 IPv4 - 8 UDP).
+inline constexpr std::size_t kMaxDatagramBytes = 1472;
+
+/// Largest encoded frame payload any stage handles. Opus tops out at 1275
+/// bytes per frame; raw stereo PCM at 120 samples is 480 bytes. The margin
+/// to kMaxDatagramBytes leaves room for the header and FEC framing.
+inline constexpr std::size_t kMaxPayloadBytes = 1400;
+
+/// One outgoing datagram, built in place by the encoder. Slots of a
+/// DatagramRing form the sender's preallocated packet arena: the encoder
+/// writes straight into writeSlot()->bytes and the send stage points its
+/// iovecs at the same memory.
+struct Datagram {
+    std::uint16_t size = 0;
+    alignas(8) std::uint8_t bytes[kMaxDatagramBytes];
+};
+
+/// 64 datagrams = 160 ms of 2.5 ms packets, far more than the send stage
+/// should ever fall behind.
+using DatagramRing = SpscRing<Datagram, 64>;
+
+} // namespace aas
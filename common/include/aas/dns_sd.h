@@ -0,0 +1,454 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// Receiver discovery over multicast DNS (RFC 6762) with DNS-SD service
+/// records (RFC 6763); docs/protocol.md, Discovery.
+inline constexpr std::uint16_t kMdnsPort = 5353;
+/// 224.0.0.251, host byte order.
+inline constexpr std::uint32_t kMdnsGroupV4 = 0xe00000fbu;
+inline constexpr char kAasServiceType[] = "_aas._udp.local";
+/// Bound for one query or advert; a full advert is about 250 bytes.
+inline constexpr std::size_t kDnsSdMessageBytes = 512;
+/// RFC 6762 section 6.7: answers to one-shot queries (sent from a port
+/// other than 5353) carry TTLs of at most ten seconds.
+inline constexpr std::uint32_t kMdnsLegacyTtlSec = 10;
+
+inline constexpr std::uint32_t codecBit(CodecId id) { return 1u << static_cast<unsigned>(id); }
+
+/// What a receiver says about itself: the SRV/A records give the media
+/// endpoint, the TXT record the rest.
+struct ReceiverAdvert {
+    /// Instance label shown in the phone's list ("Studio PC"), up to 63 bytes.
+    std::string instance;
+    /// Host label; the record names it "<host>.local".
+    std::string host;
+    /// IPv4 address, network byte order.
+    std::uint32_t ipv4 = 0;
+    /// Media port.
+    std::uint16_t port = 0;
+    /// "wasapi-exclusive", "wasapi-shared" or "asio".
+    std::string backend;
+    /// codecBit() per CodecId the receiver decodes.
+    std::uint32_t codecMask = 0;
+    std::uint8_t streams = 0;
+    std::uint8_t maxStreams = 0;
+    /// Busiest decode worker, percent of its period.
+    std::uint8_t loadPercent = 0;
+    /// Record lifetime; 0 in a goodbye, which withdraws the receiver.
+    std::uint32_t ttlSec = 120;
+};
+
+namespace dns_sd {
+
+enum : std::uint16_t {
+    kTypeA = 1,
+    kTypePtr = 12,
+    kTypeTxt = 16,
+    kTypeSrv = 33,
+    kTypeAny = 255,
+    kClassIn = 1,
+    /// Top bit of the class: cache-flush in answers (RFC 6762 section
+    /// 10.2), unicast-response-requested in questions.
+    kClassTopBit = 0x8000,
+    kFlagResponse = 0x8000,
+    kFlagAuthoritative = 0x0400,
+};
+
+inline constexpr std::size_t kHeaderBytes = 12;
+inline constexpr std::size_t kMaxNameBytes = 255;
+
+inline std::uint16_t read16(const std::uint8_t* p) { return static_cast<std::uint16_t>(p[0] << 8 | p[1]); }
+inline std::uint32_t read32(const std::uint8_t* p) {
+    return static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16 |
+           static_cast<std::uint32_t>(p[2]) << 8 | p[3];
+}
+
+inline bool equalsIgnoreCase(const std::string& a, const char* b) {
+    const std::size_t n = std::strlen(b);
+    if (a.size() != n) {
+        return false;
+    }
+    for (std::size_t i = 0; i < n; ++i) {
+        const char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] + 32) : a[i];
+        const char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] + 32) : b[i];
+        if (x != y) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Bounds-checked big-endian message writer. Every write past `capacity`
+/// is dropped and clears ok().
+class Writer {
+public:
+    Writer(std::uint8_t* out, std::size_t capacity) : out_(out), capacity_(capacity) {}
+
+    void u8(std::uint8_t v) {
+        if (size_ + 1 > capacity_) {
+            ok_ = false;
+            return;
+        }
+        out_[size_++] = v;
+    }
+    void u16(std::uint16_t v) {
+        u8(static_cast<std::uint8_t>(v >> 8));
+        u8(static_cast<std::uint8_t>(v));
+    }
+    void u32(std::uint32_t v) {
+        u16(static_cast<std::uint16_t>(v >> 16));
+        u16(static_cast<std::uint16_t>(v));
+    }
+    void bytes(const void* data, std::size_t n) {
+        if (size_ + n > capacity_) {
+            ok_ = false;
+            return;
+        }
+        std::memcpy(out_ + size_, data, n);
+        size_ += n;
+    }
+    /// One label, verbatim (an instance label may hold dots and spaces).
+    void label(const std::string& text) {
+        const std::size_t n = text.size() < 63 ? text.size() : 63;
+        if (n == 0) {
+            ok_ = false;
+            return;
+        }
+        u8(static_cast<std::uint8_t>(n));
+        bytes(text.data(), n);
+    }
+    /// A dotted name, label by label, then the root.
+    void dotted(const char* name) {
+        const char* start = name;
+        for (const char* p = name;; ++p) {
+            if (*p == '.' || *p == '\0') {
+                label(std::string(start, static_cast<std::size_t>(p - start)));
+                if (*p == '\0') {
+                    break;
+                }
+                start = p + 1;
+            }
+        }
+        u8(0);
+    }
+    /// Compression pointer to a name written earlier at `offset`.
+    void pointer(std::size_t offset) { u16(static_cast<std::uint16_t>(0xc000u | offset)); }
+
+    /// Owner name already written; starts the fixed part of a record and
+    /// returns where its rdata length goes.
+    std::size_t beginRecord(std::uint16_t type, bool unique, std::uint32_t ttl) {
+        u16(type);
+        u16(static_cast<std::uint16_t>(kClassIn | (unique ? kClassTopBit : 0)));
+        u32(ttl);
+        const std::size_t at = size_;
+        u16(0);
+        return at;
+    }
+    void endRecord(std::size_t lengthAt) {
+        if (!ok_) {
+            return;
+        }
+        const std::size_t length = size_ - lengthAt - 2;
+        out_[lengthAt] = static_cast<std::uint8_t>(length >> 8);
+        out_[lengthAt + 1] = static_cast<std::uint8_t>(length);
+    }
+
+    std::size_t size() const { return size_; }
+    bool ok() const { return ok_; }
+
+private:
+    std::uint8_t* out_;
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+    bool ok_ = true;
+};
+
+/// Reads the (possibly compressed) name at `offset` as dotted text and
+/// advances `offset` past it in the record. False on a malformed name or a
+/// pointer loop.
+inline bool readName(const std::uint8_t* data, std::size_t size, std::size_t& offset, std::string& out) {
+    out.clear();
+    std::size_t at = offset;
+    bool jumped = false;
+    for (int hops = 0; hops < 16;) {
+        if (at >= size) {
+            return false;
+        }
+        const std::uint8_t length = data[at];
+        if (length == 0) {
+            if (!jumped) {
+                offset = at + 1;
+            }
+            return true;
+        }
+        if ((length & 0xc0) == 0xc0) {
+            if (at + 1 >= size) {
+                return false;
+            }
+            if (!jumped) {
+                offset = at + 2;
+            }
+            at = static_cast<std::size_t>(length & 0x3f) << 8 | data[at + 1];
+            jumped = true;
+            ++hops;
+            continue;
+        }
+        if ((length & 0xc0) != 0 || at + 1 + length > size || out.size() + length + 1 > kMaxNameBytes) {
+            return false;
+        }
+        if (!out.empty()) {
+            out += '.';
+        }
+        out.append(reinterpret_cast<const char*>(data + at + 1), length);
+        at += 1 + length;
+    }
+    return false;
+}
+
+inline void writeHeader(Writer& w, std::uint16_t id, std::uint16_t flags, std::uint16_t questions,
+                        std::uint16_t answers, std::uint16_t additional) {
+    w.u16(id);
+    w.u16(flags);
+    w.u16(questions);
+    w.u16(answers);
+    w.u16(0);
+    w.u16(additional);
+}
+
+/// Applies one TXT string ("key=value") to `advert`.
+inline void applyTxt(const std::string& entry, ReceiverAdvert& advert) {
+    const std::size_t eq = entry.find('=');
+    if (eq == std::string::npos) {
+        return;
+    }
+    const std::string key = entry.substr(0, eq);
+    const std::string value = entry.substr(eq + 1);
+    if (key == "backend") {
+        advert.backend = value;
+    } else if (key == "codecs") {
+        advert.codecMask = 0;
+        for (const char* p = value.c_str(); *p != '\0';) {
+            char* end = nullptr;
+            const unsigned long id = std::strtoul(p, &end, 10);
+            if (end == p) {
+                break;
+            }
+            if (id < 32) {
+                advert.codecMask |= 1u << id;
+            }
+            p = *end == ',' ? end + 1 : end;
+        }
+    } else if (key == "streams") {
+        char* end = nullptr;
+        advert.streams = static_cast<std::uint8_t>(std::strtoul(value.c_str(), &end, 10));
+        if (*end == '/') {
+            advert.maxStreams = static_cast<std::uint8_t>(std::strtoul(end + 1, nullptr, 10));
+        }
+    } else if (key == "load") {
+        advert.loadPercent = static_cast<std::uint8_t>(std::strtoul(value.c_str(), nullptr, 10));
+    }
+}
+
+} // namespace dns_sd
+
+/// Writes a PTR question for kAasServiceType. Returns its size, or 0 if
+/// `capacity` is too small.
+inline std::size_t writeMdnsQuery(std::uint16_t id, std::uint8_t* out, std::size_t capacity) {
+    dns_sd::Writer w(out, capacity);
+    dns_sd::writeHeader(w, id, 0, 1, 0, 0);
+    w.dotted(kAasServiceType);
+    w.u16(dns_sd::kTypePtr);
+    w.u16(dns_sd::kClassIn);
+    return w.ok() ? w.size() : 0;
+}
+
+/// True if `data` is a query whose questions include kAasServiceType (PTR
+/// or ANY); `id` gets the query id, which one-shot answers echo.
+inline bool isMdnsQueryForReceivers(const std::uint8_t* data, std::size_t size, std::uint16_t& id) {
+    if (size < dns_sd::kHeaderBytes || (dns_sd::read16(data + 2) & dns_sd::kFlagResponse) != 0) {
+        return false;
+    }
+    id = dns_sd::read16(data);
+    const std::uint16_t questions = dns_sd::read16(data + 4);
+    std::size_t offset = dns_sd::kHeaderBytes;
+    std::string name;
+    for (std::uint16_t q = 0; q < questions; ++q) {
+        if (!dns_sd::readName(data, size, offset, name) || offset + 4 > size) {
+            return false;
+        }
+        const std::uint16_t type = dns_sd::read16(data + offset);
+        offset += 4;
+        if ((type == dns_sd::kTypePtr || type == dns_sd::kTypeAny) &&
+            dns_sd::equalsIgnoreCase(name, kAasServiceType)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Writes the full advert: the PTR answer plus SRV, TXT and A as
+/// additional records (RFC 6763 section 12), so one datagram gives the
+/// phone everything. `queryId` and `echoQuestion` are for one-shot
+/// answers, which repeat the question. Returns the size, or 0 if it does
+/// not fit.
+inline std::size_t writeReceiverAdvert(const ReceiverAdvert& advert, std::uint8_t* out, std::size_t capacity,
+                                       std::uint16_t queryId = 0, bool echoQuestion = false) {
+    using namespace dns_sd;
+    Writer w(out, capacity);
+    writeHeader(w, queryId, kFlagResponse | kFlagAuthoritative, echoQuestion ? 1 : 0, 1, 3);
+    std::size_t serviceAt = w.size();
+    w.dotted(kAasServiceType);
+    if (echoQuestion) {
+        w.u16(kTypePtr);
+        w.u16(kClassIn);
+        w.pointer(serviceAt);
+    }
+
+    // PTR: service type -> instance.
+    std::size_t at = w.beginRecord(kTypePtr, false, advert.ttlSec);
+    const std::size_t instanceAt = w.size();
+    w.label(advert.instance);
+    w.pointer(serviceAt);
+    w.endRecord(at);
+
+    // SRV: instance -> host.local:port.
+    w.pointer(instanceAt);
+    at = w.beginRecord(kTypeSrv, true, advert.ttlSec);
+    w.u16(0);
+    w.u16(0);
+    w.u16(advert.port);
+    const std::size_t hostAt = w.size();
+    w.label(advert.host);
+    w.dotted("local");
+    w.endRecord(at);
+
+    // TXT: the receiver's state.
+    w.pointer(instanceAt);
+    at = w.beginRecord(kTypeTxt, true, advert.ttlSec);
+    std::string codecs;
+    for (unsigned id = 0; id < 32; ++id) {
+        if ((advert.codecMask & (1u << id)) != 0) {
+            codecs += (codecs.empty() ? "" : ",") + std::to_string(id);
+        }
+    }
+    const std::string entries[] = {
+        "txtvers=1",
+        "backend=" + advert.backend,
+        "codecs=" + codecs,
+        "streams=" + std::to_string(advert.streams) + "/" + std::to_string(advert.maxStreams),
+        "load=" + std::to_string(advert.loadPercent),
+    };
+    for (const std::string& entry : entries) {
+        const std::size_t n = entry.size() < 255 ? entry.size() : 255;
+        w.u8(static_cast<std::uint8_t>(n));
+        w.bytes(entry.data(), n);
+    }
+    w.endRecord(at);
+
+    // A: host.local -> address.
+    w.pointer(hostAt);
+    at = w.beginRecord(kTypeA, true, advert.ttlSec);
+    w.bytes(&advert.ipv4, 4);
+    w.endRecord(at);
+    return w.ok() ? w.size() : 0;
+}
+
+/// Reads the first kAasServiceType instance out of a response, joining its
+/// PTR, SRV, TXT and A records from any section. False if the message is
+/// not a response, is malformed, or does not name a complete receiver
+/// (a goodbye needs only the PTR; it comes back with ttlSec 0).
+inline bool readReceiverAdvert(const std::uint8_t* data, std::size_t size, ReceiverAdvert& out) {
+    using namespace dns_sd;
+    if (size < kHeaderBytes || (read16(data + 2) & kFlagResponse) == 0) {
+        return false;
+    }
+    const std::size_t questions = read16(data + 4);
+    const std::size_t records = std::size_t{read16(data + 6)} + read16(data + 8) + read16(data + 10);
+    std::size_t offset = kHeaderBytes;
+    std::string name;
+    for (std::size_t q = 0; q < questions; ++q) {
+        if (!readName(data, size, offset, name) || offset + 4 > size) {
+            return false;
+        }
+        offset += 4;
+    }
+
+    // Two passes: the PTR names the instance, the rest are matched to it.
+    const std::size_t recordsAt = offset;
+    const std::string suffix = std::string(".") + kAasServiceType;
+    std::string instanceName;
+    std::string hostName;
+    ReceiverAdvert advert;
+    bool haveSrv = false;
+    bool haveAddress = false;
+    for (int pass = 0; pass < 3; ++pass) {
+        offset = recordsAt;
+        for (std::size_t r = 0; r < records; ++r) {
+            if (!readName(data, size, offset, name) || offset + 10 > size) {
+                return false;
+            }
+            const std::uint16_t type = read16(data + offset);
+            const std::uint32_t ttl = read32(data + offset + 4);
+            const std::size_t length = read16(data + offset + 8);
+            const std::size_t rdata = offset + 10;
+            if (rdata + length > size) {
+                return false;
+            }
+            offset = rdata + length;
+
+            if (pass == 0 && type == kTypePtr && instanceName.empty() &&
+                equalsIgnoreCase(name, kAasServiceType)) {
+                std::size_t at = rdata;
+                std::string target;
+                if (readName(data, size, at, target) && target.size() > suffix.size() &&
+                    equalsIgnoreCase(target.substr(target.size() - suffix.size()), suffix.c_str())) {
+                    instanceName = target;
+                    advert.instance = target.substr(0, target.size() - suffix.size());
+                    advert.ttlSec = ttl;
+                }
+            } else if (pass == 1 && !instanceName.empty() && equalsIgnoreCase(name, instanceName.c_str())) {
+                if (type == kTypeSrv && length >= 7) {
+                    std::size_t at = rdata + 6;
+                    if (readName(data, size, at, hostName)) {
+                        advert.port = read16(data + rdata + 4);
+                        const std::size_t dot = hostName.find('.');
+                        advert.host = hostName.substr(0, dot);
+                        haveSrv = true;
+                    }
+                } else if (type == kTypeTxt) {
+                    for (std::size_t at = rdata; at < rdata + length;) {
+                        const std::size_t n = data[at];
+                        if (at + 1 + n > rdata + length) {
+                            break;
+                        }
+                        applyTxt(std::string(reinterpret_cast<const char*>(data + at + 1), n), advert);
+                        at += 1 + n;
+                    }
+                }
+            } else if (pass == 2 && haveSrv && type == kTypeA && length == 4 &&
+                       equalsIgnoreCase(name, hostName.c_str())) {
+                std::memcpy(&advert.ipv4, data + rdata, 4);
+                haveAddress = true;
+            }
+        }
+        if (instanceName.empty()) {
+            return false;
+        }
+    }
+    if (advert.ttlSec != 0 && !(haveSrv && haveAddress)) {
+        return false;
+    }
+    out = advert;
+    return true;
+}
+
+} // namespace aas
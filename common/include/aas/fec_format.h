@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// Shared framing for the two loss-protection schemes (docs/protocol.md).
+///
+/// Redundant frame (kFlagRedundant): the payload is
+///   [u16 primary length][primary frame][copy of frame seq-1]
+/// so an isolated loss is repaired one packet later at the cost of payload
+/// bytes only, with no extra packet. This is the in-band scheme for the
+/// CELT-only Opus mode, where libopus' own LBRR is not available.
+///
+/// XOR parity (kFlagFecParity): a separate datagram whose header seq is the
+/// first media seq of the group, followed by FecParityHeader and the XOR of
+/// the group's primary payloads zero-padded to the longest. Any single loss
+/// in the group can be rebuilt. Members are consecutive packets, so with
+/// multi-slot packets their seqs step by the group's frame units; the
+/// parity header's shape byte says how, since a rebuilt packet has no
+/// header of its own.
+inline constexpr std::size_t kRedundancyPrefixBytes = 2;
+
+inline constexpr std::uint8_t kMinParityGroup = 2;
+inline constexpr std::uint8_t kMaxParityGroup = 16;
+
+#pragma pack(push, 1)
+struct FecParityHeader {
+    std::uint8_t groupSize;
+    /// Low nibble: frame units of every member (0 reads as 1). Bit 4:
+    /// members are aggregates (kFlagAggregate). Senders start a new group
+    /// whenever the packet shape changes.
+    std::uint8_t shape;
+    /// XOR of the group's primary payload lengths.
+    std::uint16_t lengthXor;
+    /// XOR of the group's sample clocks.
+    std::uint32_t sampleClockXor;
+};
+#pragma pack(pop)
+
+inline constexpr std::size_t kFecParityHeaderBytes = 8;
+static_assert(sizeof(FecParityHeader) == kFecParityHeaderBytes, "parity header must have no padding");
+
+inline constexpr std::uint8_t kParityShapeAggregate = 1u << 4;
+
+inline std::uint8_t parityShape(std::uint8_t frameUnits, bool aggregate) {
+    return static_cast<std::uint8_t>((frameUnits & 0x0f) | (aggregate ? kParityShapeAggregate : 0));
+}
+
+inline std::uint8_t parityFrameUnits(std::uint8_t shape) {
+    const std::uint8_t units = shape & 0x0f;
+    return units == 0 ? 1 : units;
+}
+
+/// XORs `size` bytes of `src` into `dst`. Plain byte loop on purpose: the
+/// compiler vectorises it on both NEON and SSE2, and payloads are short.
+inline void xorInto(std::uint8_t* dst, const std::uint8_t* src, std::size_t size) {
+    for (std::size_t i = 0; i < size; ++i) {
+        dst[i] ^= src[i];
+    }
+}
+
+} // namespace aas
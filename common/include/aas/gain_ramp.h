@@ -0,0 +1,129 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/control_channel.h"
+
+namespace aas {
+
+/// Volume and pause state published by the control thread for the audio
+/// thread (through a SeqLock); `serial` changes with every command.
+struct GainSetting {
+    std::uint32_t serial = 0;
+    float volume = 1.0f;
+    bool paused = false;
+    /// Start the ramp at `startSampleClock` instead of the next frame.
+    bool atSampleClock = false;
+    std::uint32_t startSampleClock = 0;
+    std::uint32_t rampSamples = kFrameSamples;
+
+    float target() const { return paused ? 0.0f : volume; }
+};
+
+/// Largest volume a command may ask for (+12 dB).
+inline constexpr float kMaxRemoteGain = 4.0f;
+
+/// Folds one kVolume or kPause command into `setting` and bumps its
+/// serial. Returns false for other messages or a short payload.
+inline bool applyGainCommand(const ControlMessage& message, GainSetting& setting) {
+    GainCommand command;
+    if ((message.type != ControlType::kVolume && message.type != ControlType::kPause) ||
+        !message.read(command)) {
+        return false;
+    }
+    if (message.type == ControlType::kVolume) {
+        setting.volume = std::min(static_cast<float>(command.value) / kUnityGainQ12, kMaxRemoteGain);
+    } else {
+        setting.paused = command.value != 0;
+    }
+    setting.atSampleClock = (command.flags & kGainAtSampleClock) != 0;
+    setting.startSampleClock = command.atSampleClock;
+    setting.rampSamples = command.rampSamples != 0 ? command.rampSamples : kFrameSamples;
+    ++setting.serial;
+    return true;
+}
+
+/// Sample-accurate gain stage for remote volume and pause.
+///
+/// A new setting takes effect at a frame boundary, or at the exact sample
+/// its sample clock names when that falls inside a later frame, and moves
+/// linearly from the gain in force to its target over rampSamples, so
+/// neither a pause nor a volume step clicks. A sample clock already in the
+/// past starts the ramp at once. At unity and not ramping, apply() returns
+/// without touching the samples. Audio thread only.
+class GainRamp {
+public:
+    void apply(AudioFrame& frame, const GainSetting& setting) {
+        if (setting.serial != serial_) {
+            serial_ = setting.serial;
+            pending_ = setting;
+            havePending_ = true;
+        }
+        std::size_t startAt = kFrameSamples;  // no new ramp in this frame
+        if (havePending_) {
+            const auto ahead = static_cast<std::int32_t>(pending_.startSampleClock - frame.sampleClock);
+            if (!pending_.atSampleClock || ahead <= 0) {
+                startAt = 0;
+            } else if (ahead < static_cast<std::int32_t>(kFrameSamples)) {
+                startAt = static_cast<std::size_t>(ahead);
+            }
+        }
+        if (startAt == kFrameSamples && remaining_ == 0) {
+            if (gain_ != 1.0f) {
+                scale(frame, gain_);
+            }
+            return;
+        }
+
+        const std::size_t channels = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            if (i == startAt) {
+                target_ = pending_.target();
+                remaining_ = std::max<std::uint32_t>(pending_.rampSamples, 1);
+                step_ = (target_ - gain_) / static_cast<float>(remaining_);
+                havePending_ = false;
+            }
+            if (remaining_ > 0) {
+                gain_ = --remaining_ == 0 ? target_ : gain_ + step_;
+            }
+            float* sample = frame.samples + i * channels;
+            for (std::size_t ch = 0; ch < channels; ++ch) {
+                sample[ch] *= gain_;
+            }
+        }
+    }
+
+    float gain() const { return gain_; }
+
+    /// Back to unity. The setting in force is taken up again, ramping, on
+    /// the next apply().
+    void reset() {
+        serial_ = 0;
+        gain_ = 1.0f;
+        target_ = 1.0f;
+        step_ = 0.0f;
+        remaining_ = 0;
+        havePending_ = false;
+    }
+
+private:
+    static void scale(AudioFrame& frame, float gain) {
+        const std::size_t channels = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+        for (std::size_t i = 0; i < kFrameSamples * channels; ++i) {
+            frame.samples[i] *= gain;
+        }
+    }
+
+    std::uint32_t serial_ = 0;
+    GainSetting pending_{};
+    bool havePending_ = false;
+    float gain_ = 1.0f;
+    float target_ = 1.0f;
+    float step_ = 0.0f;
+    std::uint32_t remaining_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace aas {
+
+/// Log-linear (HDR-style) histogram of microsecond values for the stage
+/// telemetry.
+///
+/// Values below kLinearBuckets get a bucket each; every power of two above
+/// that is split into kSubBuckets, so any recorded value is known to within
+/// 1/16 (6 %) up to kMaxValueUs (16.7 s). Larger values land in the last
+/// bucket. 336 buckets of 32 bits is 1.3 KiB per histogram.
+///
+/// record() is for exactly one writer thread (the stage that owns it) and
+/// is wait-free: a relaxed load and store per field, no read-modify-write.
+/// Any number of readers take snapshot() at any time. A snapshot is not an
+/// atomic cut across buckets, but every bucket only grows, so at worst it
+/// misses the last few samples.
+class LatencyHistogram {
+public:
+    static constexpr std::uint32_t kLinearBuckets = 32;
+    static constexpr std::uint32_t kSubBits = 4;
+    static constexpr std::uint32_t kSubBuckets = 1u << kSubBits;
+    static constexpr std::uint32_t kMaxExponent = 24;
+    static constexpr std::uint32_t kMaxValueUs = (1u << kMaxExponent) - 1;
+    static constexpr std::size_t kBuckets = kLinearBuckets + (kMaxExponent - 5) * kSubBuckets;
+
+    static_assert(kLinearBuckets == 1u << 5, "linear region must end at a power of two");
+
+    static std::size_t bucketOf(std::uint32_t us) {
+        if (us < kLinearBuckets) {
+            return us;
+        }
+        if (us > kMaxValueUs) {
+            return kBuckets - 1;
+        }
+        std::uint32_t exponent = 31;
+        while ((us >> exponent) == 0) {
+            --exponent;
+        }
+        const std::uint32_t sub = (us >> (exponent - kSubBits)) & (kSubBuckets - 1);
+        return kLinearBuckets + (exponent - 5) * kSubBuckets + sub;
+    }
+
+    /// Smallest value that lands in `bucket`.
+    static std::uint32_t bucketLowUs(std::size_t bucket) {
+        if (bucket < kLinearBuckets) {
+            return static_cast<std::uint32_t>(bucket);
+        }
+        const auto offset = static_cast<std::uint32_t>(bucket - kLinearBuckets);
+        const std::uint32_t exponent = offset / kSubBuckets + 5;
+        const std::uint32_t sub = offset % kSubBuckets;
+        return (1u << exponent) + (sub << (exponent - kSubBits));
+    }
+
+    /// Writer thread only.
+    void record(std::uint64_t us) {
+        const auto value = static_cast<std::uint32_t>(us > kMaxValueUs ? kMaxValueUs + 1ull : us);
+        std::atomic<std::uint32_t>& bucket = buckets_[bucketOf(value)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        count_.store(count_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        sumUs_.store(sumUs_.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        if (value > maxUs_.load(std::memory_order_relaxed)) {
+            maxUs_.store(value, std::memory_order_relaxed);
+        }
+        if (value < minUs_.load(std::memory_order_relaxed)) {
+            minUs_.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    /// Cumulative counts since construction.
+    struct Snapshot {
+        std::array<std::uint32_t, kBuckets> buckets{};
+        std::uint64_t count = 0;
+        std::uint64_t sumUs = 0;
+        std::uint32_t minUs = 0;
+        std::uint32_t maxUs = 0;
+
+        /// Samples recorded after `earlier` (an older snapshot of the same
+        /// histogram). min/max stay the lifetime values.
+        Snapshot since(const Snapshot& earlier) const {
+            Snapshot delta = *this;
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                delta.buckets[i] -= earlier.buckets[i];
+            }
+            delta.count -= earlier.count;
+            delta.sumUs -= earlier.sumUs;
+            return delta;
+        }
+
+        double meanUs() const { return count == 0 ? 0.0 : static_cast<double>(sumUs) / count; }
+
+        /// Value at quantile q (0-1): the lower edge of the bucket holding
+        /// it, capped at maxUs.
+        std::uint32_t quantileUs(double q) const {
+            std::uint64_t total = 0;
+            for (std::uint32_t n : buckets) {
+                total += n;
+            }
+            if (total == 0) {
+                return 0;
+            }
+            const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(total - 1));
+            std::uint64_t seen = 0;
+            for (std::size_t i = 0; i < kBuckets; ++i) {
+                seen += buckets[i];
+                if (seen > rank) {
+                    const std::uint32_t low = bucketLowUs(i);
+                    return low < maxUs ? low : maxUs;
+                }
+            }
+            return maxUs;
+        }
+    };
+
+    void snapshot(Snapshot& out) const {
+        for (std::size_t i = 0; i < kBuckets; ++i) {
+            out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+        }
+        out.count = count_.load(std::memory_order_relaxed);
+        out.sumUs = sumUs_.load(std::memory_order_relaxed);
+        out.maxUs = maxUs_.load(std::memory_order_relaxed);
+        const std::uint32_t min = minUs_.load(std::memory_order_relaxed);
+        out.minUs = out.count == 0 ? 0 : min;
+    }
+
+private:
+    std::array<std::atomic<std::uint32_t>, kBuckets> buckets_{};
+    std::atomic<std::uint64_t> count_{0};
+    std::atomic<std::uint64_t> sumUs_{0};
+    std::atomic<std::uint32_t> minUs_{UINT32_MAX};
+    std::atomic<std::uint32_t> maxUs_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace aas {
+
+/// Maximum-length sequence used as the latency marker. Order 9 gives 511
+/// samples (10.6 ms): long enough for a sharp correlation peak well above
+/// codec noise, short enough to fit between two 1 s injections with room
+/// for a large end-to-end delay.
+inline constexpr unsigned kMarkerOrder = 9;
+inline constexpr std::size_t kMarkerLength = (1u << kMarkerOrder) - 1;
+
+/// Marker as +-1.0 chips from a Fibonacci LFSR on x^9 + x^5 + 1.
+inline std::array<float, kMarkerLength> makeMarker() {
+    std::array<float, kMarkerLength> chips{};
+    std::uint32_t state = 0x1ff;
+    for (std::size_t i = 0; i < kMarkerLength; ++i) {
+        const std::uint32_t bit = ((state >> 8) ^ (state >> 4)) & 1u;
+        chips[i] = (state & 1u) ? 1.0f : -1.0f;
+        state = ((state << 1) | bit) & 0x1ff;
+    }
+    return chips;
+}
+
+} // namespace aas
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/datagram.h"
+#include "aas/packet_header.h"
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// Points in a frame's life recorded by the latency harness. The first
+/// three are sender-clock times carried in the TraceTrailer and recorded by
+/// the receiver's decode thread; the rest are receiver-clock times. The
+/// comment on each names the thread that records it.
+enum class TraceStage : std::uint8_t {
+    kCaptureHw,       ///< First sample at the input converter (decode thread)
+    kCaptureCallback, ///< Delivered by the capture callback (decode thread)
+    kEncodeDone,      ///< Encoded and queued for sending (decode thread)
+    kReceived,        ///< Datagram arrival stamp (decode thread, from the receive stage)
+    kDecodeStart,     ///< Popped from the jitter buffer (decode thread)
+    kDecodeDone,      ///< PCM ready (decode thread)
+    kPresented,       ///< Estimated time the first sample leaves the DAC (render thread)
+    kMarkerInjected,  ///< Marker start, sender capture time (decode thread, from the trailer)
+    kMarkerDetected,  ///< Marker found in the output (analysis thread)
+    kCount,
+};
+
+inline constexpr std::size_t kTraceStageCount = static_cast<std::size_t>(TraceStage::kCount);
+
+struct TraceEvent {
+    std::uint32_t sampleClock = 0;
+    TraceStage stage = TraceStage::kCaptureHw;
+    std::uint64_t timeUs = 0;
+};
+
+/// Lock-free collection point for stage timestamps.
+///
+/// One SPSC ring per stage, so every stage records from its own thread
+/// without contention and only a reporting thread reads. A full ring drops
+/// the event and counts it rather than blocking a real-time thread. Each
+/// stage must be recorded from exactly one thread (listed in TraceStage).
+class LatencyTrace {
+public:
+    static constexpr std::size_t kEventsPerStage = 1024;
+
+    bool record(TraceStage stage, std::uint32_t sampleClock, std::uint64_t timeUs) {
+        Ring& ring = rings_[static_cast<std::size_t>(stage)];
+        if (!ring.tryPush(TraceEvent{sampleClock, stage, timeUs})) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    /// Reader thread: hands every buffered event to `sink(const TraceEvent&)`.
+    template <typename Sink>
+    std::size_t drain(Sink&& sink) {
+        std::size_t count = 0;
+        for (Ring& ring : rings_) {
+            TraceEvent event;
+            while (ring.tryPop(event)) {
+                sink(event);
+                ++count;
+            }
+        }
+        return count;
+    }
+
+    std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    using Ring = SpscRing<TraceEvent, kEventsPerStage>;
+    std::array<Ring, kTraceStageCount> rings_;
+    std::atomic<std::uint64_t> dropped_{0};
+};
+
+#pragma pack(push, 1)
+/// Sender stage timestamps appended to a media datagram in test mode
+/// (kFlagTrace, docs/protocol.md).
+struct TraceTrailer {
+    std::uint64_t captureUs;
+    std::uint16_t callbackDeltaUs;
+    std::uint16_t encodeDeltaUs;
+};
+#pragma pack(pop)
+
+inline constexpr std::size_t kTraceTrailerBytes = 12;
+static_assert(sizeof(TraceTrailer) == kTraceTrailerBytes, "trailer must have no padding");
+
+/// Saturating microsecond delta for the trailer's 16-bit fields.
+inline std::uint16_t traceDelta(std::uint64_t later, std::uint64_t earlier) {
+    const std::uint64_t delta = later > earlier ? later - earlier : 0;
+    return static_cast<std::uint16_t>(delta > 0xffff ? 0xffff : delta);
+}
+
+/// Appends `trailer` to a finished datagram and sets kFlagTrace in its
+/// header. Returns false if the datagram has no room left.
+inline bool appendTraceTrailer(Datagram& dg, const TraceTrailer& trailer) {
+    if (dg.size < kPacketHeaderBytes || dg.size + kTraceTrailerBytes > kMaxDatagramBytes) {
+        return false;
+    }
+    std::memcpy(dg.bytes + dg.size, &trailer, kTraceTrailerBytes);
+    dg.size = static_cast<std::uint16_t>(dg.size + kTraceTrailerBytes);
+    dg.bytes[offsetof(PacketHeader, flags)] |= kFlagTrace;
+    return true;
+}
+
+/// Removes the trailer from a received datagram whose header has
+/// kFlagTrace, shrinking `size`. Returns false if it is too short.
+inline bool stripTraceTrailer(const std::uint8_t* data, std::size_t& size, TraceTrailer& out) {
+    if (size < kPacketHeaderBytes + kTraceTrailerBytes) {
+        return false;
+    }
+    size -= kTraceTrailerBytes;
+    std::memcpy(&out, data + size, kTraceTrailerBytes);
+    return true;
+}
+
+} // namespace aas
@@ -0,0 +1,521 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include "aas/audio_format.h"
+#include "aas/sample_format.h"
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AAS_LOSSLESS_NEON 1
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AAS_LOSSLESS_SSE2 1
+#endif
+
+namespace aas {
+
+/// Per-frame lossless coder for CodecId::kLossless (payload format in
+/// docs/protocol.md). Samples are the same 16-bit values the PCM codec
+/// would send; each channel picks the FLAC fixed polynomial predictor
+/// (order 0-4) with the smallest residual and Rice-codes it in four
+/// partitions. Every frame is self-contained (warm-up samples travel
+/// verbatim) so a lost packet costs only itself, and there is no lookahead:
+/// the encoder sees exactly the 120 samples it sends.
+///
+/// `dropBits` > 0 makes it near-lossless: that many LSBs are rounded off
+/// before prediction, trading ~6 dB of noise floor per bit for ~1 bit per
+/// sample of payload.
+namespace lossless {
+
+inline constexpr std::size_t kMaxOrder = 4;
+inline constexpr std::size_t kPartitions = 4;
+inline constexpr std::size_t kPartitionSamples = kFrameSamples / kPartitions;
+inline constexpr unsigned kMaxDropBits = 6;
+inline constexpr unsigned kEscapeParam = 15;
+inline constexpr unsigned kMaxRiceParam = 14;
+
+/// Bits of the first payload byte.
+enum HeaderBits : std::uint8_t {
+    kHeaderChannelsMask = 0x03,  ///< low bits of channels - 1
+    kHeaderSide = 1u << 2,       ///< second channel carries left - right
+    kHeaderDropShift = 3,        ///< bits 3-5: dropped LSBs
+    kHeaderDropMask = 0x07u << kHeaderDropShift,
+    kHeaderVerbatim = 1u << 6,   ///< int16 PCM follows, no prediction
+    kHeaderChannelsHigh = 1u << 7,  ///< bit 2 of channels - 1 (5-8 channels)
+};
+
+inline constexpr std::uint8_t headerChannels(std::size_t channels) {
+    const auto code = static_cast<std::uint8_t>(channels - 1);
+    const std::uint8_t high = (code & 0x04) != 0 ? kHeaderChannelsHigh : 0;
+    return static_cast<std::uint8_t>((code & kHeaderChannelsMask) | high);
+}
+
+inline constexpr std::size_t channelsFromHeader(std::uint8_t header) {
+    return (header & kHeaderChannelsMask) + ((header & kHeaderChannelsHigh) != 0 ? 4u : 0u) + 1u;
+}
+
+static_assert(kFrameSamples % kPartitions == 0, "partitions must tile the frame");
+
+class BitWriter {
+public:
+    BitWriter(std::uint8_t* out, std::size_t capacity) : out_(out), capacity_(capacity) {}
+
+    void put(std::uint32_t value, unsigned bits) {
+        acc_ |= static_cast<std::uint64_t>(value & ((bits == 32) ? ~0u : ((1u << bits) - 1))) << count_;
+        count_ += bits;
+        while (count_ >= 8) {
+            emit(static_cast<std::uint8_t>(acc_));
+            acc_ >>= 8;
+            count_ -= 8;
+        }
+    }
+
+    /// `q` zeros then a one.
+    void putUnary(std::uint32_t q) {
+        while (q >= 24) {
+            put(0, 24);
+            q -= 24;
+        }
+        put(1u << q, q + 1);
+    }
+
+    /// Flushes the last partial byte; returns the byte count, or 0 if the
+    /// output did not fit.
+    std::size_t finish() {
+        if (count_ > 0) {
+            emit(static_cast<std::uint8_t>(acc_));
+            acc_ = 0;
+            count_ = 0;
+        }
+        return overflow_ ? 0 : size_;
+    }
+
+private:
+    void emit(std::uint8_t byte) {
+        if (size_ < capacity_) {
+            out_[size_++] = byte;
+        } else {
+            overflow_ = true;
+        }
+    }
+
+    std::uint8_t* out_;
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+    std::uint64_t acc_ = 0;
+    unsigned count_ = 0;
+    bool overflow_ = false;
+};
+
+class BitReader {
+public:
+    BitReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size) {}
+
+    std::uint32_t get(unsigned bits) {
+        refill(bits);
+        const std::uint32_t value =
+            static_cast<std::uint32_t>(acc_) & ((bits == 32) ? ~0u : ((1u << bits) - 1));
+        acc_ >>= bits;
+        count_ -= bits;
+        return value;
+    }
+
+    /// Counts zeros up to the terminating one; gives up (and flags an
+    /// overrun) after `limit` so corrupt input cannot spin.
+    std::uint32_t getUnary(std::uint32_t limit) {
+        std::uint32_t q = 0;
+        while (get(1) == 0) {
+            if (++q > limit || overrun_) {
+                overrun_ = true;
+                return 0;
+            }
+        }
+        return q;
+    }
+
+    bool overrun() const { return overrun_; }
+
+private:
+    void refill(unsigned bits) {
+        while (count_ < bits) {
+            std::uint64_t byte = 0;
+            if (pos_ < size_) {
+                byte = data_[pos_++];
+            } else {
+                overrun_ = true;
+            }
+            acc_ |= byte << count_;
+            count_ += 8;
+        }
+    }
+
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t pos_ = 0;
+    std::uint64_t acc_ = 0;
+    unsigned count_ = 0;
+    bool overrun_ = false;
+};
+
+inline std::uint32_t zigzag(std::int32_t v) {
+    return (static_cast<std::uint32_t>(v) << 1) ^ static_cast<std::uint32_t>(v >> 31);
+}
+
+inline std::int32_t unzigzag(std::uint32_t u) {
+    return static_cast<std::int32_t>(u >> 1) ^ -static_cast<std::int32_t>(u & 1);
+}
+
+inline std::int32_t signExtend(std::uint32_t value, unsigned bits) {
+    const std::uint32_t sign = 1u << (bits - 1);
+    return static_cast<std::int32_t>((value ^ sign) - sign);
+}
+
+/// Fixed-predictor residuals of one channel: res[k][n] for orders 0-4 at
+/// every n >= k (each order is the first difference of the one below), and
+/// the sum of |res[k][n]| over n >= kMaxOrder so orders compare on the same
+/// span. Vectorised; the inner loop is one load pair, subtract and
+/// absolute-accumulate per four samples.
+inline void fixedResiduals(const std::int32_t* x, std::int32_t (*res)[kFrameSamples],
+                           std::uint32_t* cost) {
+    std::memcpy(res[0], x, sizeof(res[0]));
+    for (std::size_t k = 1; k <= kMaxOrder; ++k) {
+        const std::int32_t* prev = res[k - 1];
+        std::int32_t* cur = res[k];
+        std::size_t n = k;
+        for (; n < kMaxOrder; ++n) {
+            cur[n] = prev[n] - prev[n - 1];
+        }
+#if defined(AAS_LOSSLESS_NEON)
+        for (; n + 4 <= kFrameSamples; n += 4) {
+            vst1q_s32(cur + n, vsubq_s32(vld1q_s32(prev + n), vld1q_s32(prev + n - 1)));
+        }
+#elif defined(AAS_LOSSLESS_SSE2)
+        for (; n + 4 <= kFrameSamples; n += 4) {
+            const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + n));
+            const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(prev + n - 1));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(cur + n), _mm_sub_epi32(a, b));
+        }
+#endif
+        for (; n < kFrameSamples; ++n) {
+            cur[n] = prev[n] - prev[n - 1];
+        }
+    }
+
+    // |residual| <= 2^(17 + 4) for a 17-bit side channel, times 116
+    // samples, stays inside 32 bits.
+    for (std::size_t k = 0; k <= kMaxOrder; ++k) {
+        const std::int32_t* r = res[k];
+        std::size_t n = kMaxOrder;
+        std::uint32_t sum = 0;
+#if defined(AAS_LOSSLESS_NEON)
+        uint32x4_t acc = vdupq_n_u32(0);
+        for (; n + 4 <= kFrameSamples; n += 4) {
+            acc = vaddq_u32(acc, vreinterpretq_u32_s32(vabsq_s32(vld1q_s32(r + n))));
+        }
+        const uint32x2_t half = vadd_u32(vget_low_u32(acc), vget_high_u32(acc));
+        sum = vget_lane_u32(vpadd_u32(half, half), 0);
+#elif defined(AAS_LOSSLESS_SSE2)
+        __m128i acc = _mm_setzero_si128();
+        for (; n + 4 <= kFrameSamples; n += 4) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r + n));
+            const __m128i sign = _mm_srai_epi32(v, 31);
+            acc = _mm_add_epi32(acc, _mm_sub_epi32(_mm_xor_si128(v, sign), sign));
+        }
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0x4e));
+        acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, 0xb1));
+        sum = static_cast<std::uint32_t>(_mm_cvtsi128_si32(acc));
+#endif
+        for (; n < kFrameSamples; ++n) {
+            sum += static_cast<std::uint32_t>(std::abs(r[n]));
+        }
+        cost[k] = sum;
+    }
+}
+
+inline std::size_t bestOrder(const std::uint32_t* cost) {
+    std::size_t best = 0;
+    for (std::size_t k = 1; k <= kMaxOrder; ++k) {
+        if (cost[k] < cost[best]) {
+            best = k;
+        }
+    }
+    return best;
+}
+
+/// Writes one partition's Rice parameter and residuals, choosing the
+/// parameter from the mean and checking its neighbours exactly; falls back
+/// to fixed-width escape coding when even the best parameter loses.
+inline void writePartition(BitWriter& w, const std::int32_t* r, std::size_t count) {
+    std::uint32_t u[kPartitionSamples];
+    std::uint64_t sum = 0;
+    std::uint32_t all = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        u[i] = zigzag(r[i]);
+        sum += u[i];
+        all |= u[i];
+    }
+    auto riceBits = [&](unsigned k) {
+        std::uint64_t bits = static_cast<std::uint64_t>(count) * (k + 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            bits += u[i] >> k;
+        }
+        return bits;
+    };
+    unsigned guess = 0;
+    while (guess < kMaxRiceParam && (static_cast<std::uint64_t>(count) << (guess + 1)) <= sum) {
+        ++guess;
+    }
+    unsigned param = guess;
+    std::uint64_t bits = riceBits(guess);
+    for (unsigned k : {guess == 0 ? 0u : guess - 1, std::min(guess + 1, kMaxRiceParam)}) {
+        const std::uint64_t b = riceBits(k);
+        if (b < bits) {
+            bits = b;
+            param = k;
+        }
+    }
+
+    unsigned width = 0;
+    while (width < 32 && (all >> width) != 0) {
+        ++width;
+    }
+    const std::uint64_t escapeBits = 5 + static_cast<std::uint64_t>(count) * width;
+    if (escapeBits < bits) {
+        w.put(kEscapeParam, 4);
+        w.put(width, 5);
+        for (std::size_t i = 0; i < count; ++i) {
+            w.put(u[i], width);
+        }
+        return;
+    }
+    w.put(param, 4);
+    for (std::size_t i = 0; i < count; ++i) {
+        w.putUnary(u[i] >> param);
+        if (param > 0) {
+            w.put(u[i], param);
+        }
+    }
+}
+
+inline void writeChannel(BitWriter& w, const std::int32_t (*res)[kFrameSamples], std::size_t order,
+                         unsigned sampleBits) {
+    w.put(static_cast<std::uint32_t>(order), 3);
+    for (std::size_t n = 0; n < order; ++n) {
+        w.put(static_cast<std::uint32_t>(res[0][n]), sampleBits);
+    }
+    const std::int32_t* r = res[order];
+    for (std::size_t p = 0; p < kPartitions; ++p) {
+        // The first partition loses the warm-up samples.
+        const std::size_t begin = std::max(p * kPartitionSamples, order);
+        writePartition(w, r + begin, (p + 1) * kPartitionSamples - begin);
+    }
+}
+
+/// True when `v` is a two's complement value of `bits` bits.
+inline bool inSampleRange(std::int64_t v, unsigned bits) {
+    const std::int64_t limit = std::int64_t{1} << (bits - 1);
+    return v >= -limit && v < limit;
+}
+
+inline bool readChannel(BitReader& r, std::int32_t* x, unsigned sampleBits) {
+    const std::size_t order = r.get(3);
+    if (order > kMaxOrder) {
+        return false;
+    }
+    for (std::size_t n = 0; n < order; ++n) {
+        x[n] = signExtend(r.get(sampleBits), sampleBits);
+    }
+    // Residuals decode into x and are integrated in place afterwards.
+    for (std::size_t p = 0; p < kPartitions; ++p) {
+        const std::size_t begin = std::max(p * kPartitionSamples, order);
+        const std::size_t end = (p + 1) * kPartitionSamples;
+        const unsigned param = r.get(4);
+        if (param == kEscapeParam) {
+            // No residual of a valid frame needs more than this.
+            const unsigned width = r.get(5);
+            if (width > sampleBits + kMaxOrder + 1) {
+                return false;
+            }
+            for (std::size_t n = begin; n < end; ++n) {
+                x[n] = unzigzag(width == 0 ? 0 : r.get(width));
+            }
+        } else {
+            for (std::size_t n = begin; n < end; ++n) {
+                const std::uint32_t q = r.getUnary(1u << (sampleBits + kMaxOrder + 1 - param));
+                const std::uint32_t low = (param > 0) ? r.get(param) : 0;
+                x[n] = unzigzag((q << param) | low);
+            }
+        }
+        if (r.overrun()) {
+            return false;
+        }
+    }
+    // Integrated in 64 bits and bounded to sampleBits, so a malformed
+    // payload fails here instead of wrapping or decoding far beyond full
+    // scale; earlier samples already passed the bound.
+    for (std::size_t n = order; n < kFrameSamples; ++n) {
+        const std::int64_t e = x[n];
+        std::int64_t v = e;
+        switch (order) {
+        case 0: break;
+        case 1: v = e + x[n - 1]; break;
+        case 2: v = e + 2 * x[n - 1] - x[n - 2]; break;
+        case 3: v = e + 3 * x[n - 1] - 3 * x[n - 2] + x[n - 3]; break;
+        default: v = e + 4 * x[n - 1] - 6 * x[n - 2] + 4 * x[n - 3] - x[n - 4]; break;
+        }
+        if (!inSampleRange(v, sampleBits)) {
+            return false;
+        }
+        x[n] = static_cast<std::int32_t>(v);
+    }
+    return true;
+}
+
+} // namespace lossless
+
+/// Size of the verbatim fallback for `channels`, which bounds every
+/// encoded frame.
+inline constexpr std::size_t losslessMaxBytes(std::size_t channels) {
+    return 1 + kFrameSamples * channels * sizeof(std::int16_t);
+}
+
+/// Encodes `frame` into `out`. Returns the payload size, or 0 if it did not
+/// fit in `capacity`; with at least losslessMaxBytes(frame.channels) it
+/// always fits. Above five channels the verbatim form exceeds a datagram,
+/// so such frames only go out when they compress. Runs in well under 0.1 ms
+/// for a stereo frame on a mid-range ARM core, with no allocation.
+inline std::size_t encodeLossless(const AudioFrame& frame, unsigned dropBits, std::uint8_t* out,
+                                  std::size_t capacity) {
+    using namespace lossless;
+    const std::size_t channels = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+    dropBits = std::min(dropBits, kMaxDropBits);
+
+    // Quantise exactly as the PCM16 codec does, then round off dropped bits.
+    std::uint8_t quantised[kMaxFrameChannels * kFrameSamples * sizeof(std::int16_t)];
+    floatToPcm16(frame.samples, quantised, kFrameSamples * channels);
+    std::int32_t pcm[kMaxFrameChannels][kFrameSamples];
+    const std::int32_t half = dropBits > 0 ? (1 << (dropBits - 1)) : 0;
+    const std::int32_t maxCode = 32767 >> dropBits;
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            std::int16_t s;
+            std::memcpy(&s, quantised + 2 * (i * channels + ch), sizeof(s));
+            pcm[ch][i] = std::min((s + half) >> dropBits, maxCode);
+        }
+    }
+
+    // One slot per channel plus the FL - FR side channel at kSideSlot.
+    constexpr std::size_t kSideSlot = kMaxFrameChannels;
+    std::int32_t res[kMaxFrameChannels + 1][kMaxOrder + 1][kFrameSamples];
+    std::uint32_t cost[kMaxFrameChannels + 1][kMaxOrder + 1];
+    std::size_t order[kMaxFrameChannels + 1];
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        fixedResiduals(pcm[ch], res[ch], cost[ch]);
+        order[ch] = bestOrder(cost[ch]);
+    }
+    // Only the front pair is decorrelated; the other channels of a live
+    // rig (centre, LFE, surrounds, or separate microphones) rarely share
+    // enough with a neighbour to pay for the extra bit.
+    bool side = false;
+    if (channels >= 2) {
+        std::int32_t diff[kFrameSamples];
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            diff[i] = pcm[0][i] - pcm[1][i];
+        }
+        fixedResiduals(diff, res[kSideSlot], cost[kSideSlot]);
+        order[kSideSlot] = bestOrder(cost[kSideSlot]);
+        side = cost[kSideSlot][order[kSideSlot]] < cost[1][order[1]];
+    }
+
+    const unsigned sampleBits = 16 - dropBits;
+    BitWriter w(out, capacity);
+    w.put(static_cast<std::uint32_t>(headerChannels(channels)) |
+              (side ? static_cast<std::uint32_t>(kHeaderSide) : 0u) | (dropBits << kHeaderDropShift),
+          8);
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        if (ch == 1 && side) {
+            writeChannel(w, res[kSideSlot], order[kSideSlot], sampleBits + 1);
+        } else {
+            writeChannel(w, res[ch], order[ch], sampleBits);
+        }
+    }
+    const std::size_t size = w.finish();
+    if (size != 0 && size < losslessMaxBytes(channels)) {
+        return size;
+    }
+    if (capacity < losslessMaxBytes(channels)) {
+        return 0;
+    }
+
+    // Noise-like input: plain int16 is smaller than any prediction.
+    out[0] = static_cast<std::uint8_t>(headerChannels(channels) | kHeaderVerbatim |
+                                       (dropBits << kHeaderDropShift));
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            const auto v = static_cast<std::int16_t>(pcm[ch][i] * (1 << dropBits));
+            std::memcpy(out + 1 + 2 * (i * channels + ch), &v, sizeof(v));
+        }
+    }
+    return losslessMaxBytes(channels);
+}
+
+/// Decodes one kLossless payload into `out` (samples and channels only).
+/// Returns false on a malformed payload.
+inline bool decodeLossless(const std::uint8_t* data, std::size_t size, AudioFrame& out) {
+    using namespace lossless;
+    if (size < 1) {
+        return false;
+    }
+    const std::uint8_t header = data[0];
+    const std::size_t channels = channelsFromHeader(header);
+    const unsigned dropBits = (header & kHeaderDropMask) >> kHeaderDropShift;
+    if (channels > kMaxFrameChannels || dropBits > kMaxDropBits) {
+        return false;
+    }
+    out.channels = static_cast<std::uint16_t>(channels);
+    constexpr float kScale = 1.0f / 32768.0f;
+
+    if (header & kHeaderVerbatim) {
+        if (size != losslessMaxBytes(channels)) {
+            return false;
+        }
+        pcm16ToFloat(data + 1, out.samples, kFrameSamples * channels);
+        return true;
+    }
+
+    const unsigned sampleBits = 16 - dropBits;
+    const bool side = (header & kHeaderSide) != 0;
+    std::int32_t pcm[kMaxFrameChannels][kFrameSamples];
+    BitReader r(data + 1, size - 1);
+    if (side && channels < 2) {
+        return false;
+    }
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        if (!readChannel(r, pcm[ch], sampleBits + (ch == 1 && side ? 1 : 0))) {
+            return false;
+        }
+    }
+    if (side) {
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            pcm[1][i] = pcm[0][i] - pcm[1][i];
+            if (!inSampleRange(pcm[1][i], sampleBits)) {
+                return false;
+            }
+        }
+    }
+    const float scale = kScale * static_cast<float>(1 << dropBits);
+    for (std::size_t ch = 0; ch < channels; ++ch) {
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            out.samples[i * channels + ch] = static_cast<float>(pcm[ch][i]) * scale;
+        }
+    }
+    return true;
+}
+
+} // namespace aas
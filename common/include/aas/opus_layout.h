@@ -0,0 +1,84 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+/// Stream layout for CodecId::kOpusMultistream: the arguments to
+/// opus_multistream_encoder_create() / opus_multistream_decoder_create()
+/// for one channel count. Both ends derive it from the channel byte that
+/// starts each payload (docs/protocol.md), so nothing else is negotiated.
+struct OpusStreamLayout {
+    std::uint8_t channels = 0;
+    std::uint8_t streams = 0;
+    /// The first `coupled` streams are stereo.
+    std::uint8_t coupled = 0;
+    /// mapping[c]: coded channel for interleaved buffer channel c.
+    std::array<std::uint8_t, kMaxFrameChannels> mapping{};
+};
+
+namespace opus_layout {
+
+/// RFC 7845 channel mapping family 1, indexed by Vorbis channel order.
+struct Family1 {
+    std::uint8_t streams;
+    std::uint8_t coupled;
+    std::uint8_t mapping[kMaxFrameChannels];
+};
+
+inline constexpr Family1 kFamily1[kMaxFrameChannels] = {
+    {1, 0, {0}},
+    {1, 1, {0, 1}},
+    {2, 1, {0, 2, 1}},
+    {2, 2, {0, 1, 2, 3}},
+    {3, 2, {0, 4, 1, 2, 3}},
+    {4, 2, {0, 4, 1, 2, 3, 5}},
+    {4, 3, {0, 4, 1, 2, 3, 5, 6}},
+    {5, 3, {0, 6, 1, 2, 3, 4, 5, 7}},
+};
+
+/// Vorbis position of each WAVE-order channel (aas/sample_format.h,
+/// ChannelMap): the pipeline keeps WAVE order end to end, Opus couples
+/// channels in Vorbis order.
+inline constexpr std::uint8_t kWaveToVorbis[kMaxFrameChannels][kMaxFrameChannels] = {
+    {0},
+    {0, 1},
+    {0, 2, 1},                 // FL FR FC
+    {0, 1, 2, 3},              // FL FR BL BR
+    {0, 2, 1, 3, 4},           // FL FR FC BL BR
+    {0, 2, 1, 5, 3, 4},        // 5.1: FL FR FC LFE BL BR
+    {0, 2, 1, 6, 5, 3, 4},     // 6.1: FL FR FC LFE BC SL SR
+    {0, 2, 1, 7, 5, 6, 3, 4},  // 7.1: FL FR FC LFE BL BR SL SR
+};
+
+} // namespace opus_layout
+
+/// The family 1 layout for `channels` (1-8) with the mapping composed for
+/// WAVE-order interleaved buffers, so the encoder and decoder read and write
+/// AudioFrame::samples directly and the front pair, the rear pair and the
+/// side pair are each coded as one coupled stream. Returns a layout with
+/// channels == 0 for any other count.
+inline constexpr OpusStreamLayout opusStreamLayout(std::size_t channels) {
+    OpusStreamLayout layout{};
+    if (channels == 0 || channels > kMaxFrameChannels) {
+        return layout;
+    }
+    const opus_layout::Family1& family = opus_layout::kFamily1[channels - 1];
+    layout.channels = static_cast<std::uint8_t>(channels);
+    layout.streams = family.streams;
+    layout.coupled = family.coupled;
+    for (std::size_t c = 0; c < channels; ++c) {
+        layout.mapping[c] = family.mapping[opus_layout::kWaveToVorbis[channels - 1][c]];
+    }
+    return layout;
+}
+
+static_assert(opusStreamLayout(6).mapping[3] == 5, "5.1 LFE is the last coded channel");
+static_assert(opusStreamLayout(8).streams == 5 && opusStreamLayout(8).coupled == 3,
+              "7.1 is three pairs and two mono streams");
+
+} // namespace aas
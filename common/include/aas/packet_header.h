@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace aas {
+
+// The wire format is little-endian, which is the native order of every
+// target (ARM64/ARMv7 Android, x86-64 Windows). That lets both ends move
+// the header with a single memcpy instead of per-field byte swaps.
+#if defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__)
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "packet_header.h assumes a little-endian target");
+#elif !defined(_WIN32)
+#error "cannot determine byte order; packet_header.h assumes little-endian"
+#endif
+
+inline constexpr std::uint8_t kProtocolVersion = 1;
+
+enum class CodecId : std::uint8_t {
+    kPcm16 = 0,
+    kOpus = 1,
+    kAac = 2,
+    /// Per-frame fixed prediction + Rice coding (aas/lossless_codec.h).
+    kLossless = 3,
+    /// Opus multistream for 3-8 channels: a channel-count byte, then the
+    /// multistream packet (aas/opus_layout.h).
+    kOpusMultistream = 4,
+};
+
+/// Bits of PacketHeader::flags.
+enum PacketFlags : std::uint8_t {
+    /// Payload is parity over a group of media packets, not audio.
+    kFlagFecParity = 1u << 0,
+    /// Payload carries a redundant copy of an earlier frame (e.g. Opus LBRR).
+    kFlagRedundant = 1u << 1,
+    /// A TraceTrailer with sender stage timestamps ends the datagram.
+    kFlagTrace = 1u << 2,
+    /// The latency marker starts at the first sample of this frame.
+    kFlagMarker = 1u << 3,
+    /// A TimingMessage ends the datagram (after any trace trailer).
+    kFlagTiming = 1u << 4,
+    /// Payload is 2-4 separately encoded 2.5 ms frames (aas/aggregate.h).
+    kFlagAggregate = 1u << 5,
+    /// Payload is a comfort-noise descriptor, not audio: the sender is in
+    /// DTX and skips slots until speech resumes (aas/comfort_noise.h).
+    kFlagSilence = 1u << 6,
+    /// Payload is control-channel messages, not audio (frame units 0,
+    /// aas/control_channel.h).
+    kFlagControl = 1u << 7,
+};
+
+#pragma pack(push, 1)
+/// Media packet header, 10 bytes, see docs/protocol.md.
+///
+/// Fields are laid out so that every multi-byte field is naturally aligned
+/// relative to the start of the datagram, and there is no padding: the
+/// 16-bit sequence sits at offset 2 and the 32-bit sample clock at offset 4.
+/// There is no application checksum; the UDP checksum and 802.11 FCS
+/// already cover the datagram, so a second pass over the payload would only
+/// cost encode time.
+struct PacketHeader {
+    /// High nibble: protocol version. Low nibble: CodecId.
+    std::uint8_t versionCodec;
+    std::uint8_t flags;
+    /// First 2.5 ms frame slot the payload covers; a packet of n frame
+    /// units is followed by seq + n.
+    std::uint16_t seq;
+    /// Sample-clock position of the first sample in the payload (48 kHz).
+    std::uint32_t sampleClock;
+    std::uint8_t streamId;
+    /// Frame duration in 2.5 ms units (1 = 120 samples); 0 means the
+    /// datagram carries no audio (e.g. a standalone timing message).
+    std::uint8_t frameUnits;
+
+    constexpr std::uint8_t version() const { return static_cast<std::uint8_t>(versionCodec >> 4); }
+    constexpr CodecId codec() const { return static_cast<CodecId>(versionCodec & 0x0f); }
+    constexpr bool hasFlag(std::uint8_t flag) const { return (flags & flag) != 0; }
+
+    static constexpr std::uint8_t packVersionCodec(CodecId codec) {
+        return static_cast<std::uint8_t>((kProtocolVersion << 4) | (static_cast<std::uint8_t>(codec) & 0x0f));
+    }
+};
+#pragma pack(pop)
+
+inline constexpr std::size_t kPacketHeaderBytes = 10;
+
+static_assert(std::is_trivially_copyable_v<PacketHeader>, "header is moved with memcpy");
+static_assert(sizeof(PacketHeader) == kPacketHeaderBytes, "header must have no padding");
+static_assert(offsetof(PacketHeader, versionCodec) == 0, "wire layout");
+static_assert(offsetof(PacketHeader, flags) == 1, "wire layout");
+static_assert(offsetof(PacketHeader, seq) == 2, "wire layout");
+static_assert(offsetof(PacketHeader, sampleClock) == 4, "wire layout");
+static_assert(offsetof(PacketHeader, streamId) == 8, "wire layout");
+static_assert(offsetof(PacketHeader, frameUnits) == 9, "wire layout");
+
+/// Writes `header` at the start of `out`, which must hold kPacketHeaderBytes.
+/// Returns the payload pointer just past it.
+inline std::uint8_t* writePacketHeader(const PacketHeader& header, std::uint8_t* out) {
+    std::memcpy(out, &header, kPacketHeaderBytes);
+    return out + kPacketHeaderBytes;
+}
+
+/// Reads the header of a received datagram of `size` bytes. `data` must
+/// point at a buffer of at least kPacketHeaderBytes capacity (every datagram
+/// slot is), so the copy is unconditional and validation is one combined
+/// test of length and version.
+inline bool readPacketHeader(const std::uint8_t* data, std::size_t size, PacketHeader& out) {
+    std::memcpy(&out, data, kPacketHeaderBytes);
+    return (size >= kPacketHeaderBytes) & (out.version() == kProtocolVersion);
+}
+
+} // namespace aas
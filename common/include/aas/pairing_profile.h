@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// What one side remembers about the other after a session, so the next
+/// Start skips pairing and negotiation (docs/flowchart.md, Warm Start). The
+/// phone fills the endpoint and stream settings; the PC fills the backend
+/// and the clock and drift it measured. Each side keeps its own copy.
+struct PairingProfile {
+    /// The other end: the PC's name on the phone, the phone's device key
+    /// (CaptureProfileCache::deviceKey()) on the PC.
+    std::string peer;
+    /// PC endpoint, numeric address and media port.
+    std::string host;
+    std::uint16_t port = 0;
+    std::uint8_t streamId = 0;
+
+    CodecId codec = CodecId::kOpus;
+    /// Frame duration in 2.5 ms units.
+    std::uint8_t frameUnits = 1;
+    std::uint16_t channels = 2;
+
+    /// Sender clock rate against the receiver (ClockEstimate::skewPpm).
+    /// Crystals hold their offset in rate for months, so this seeds the
+    /// clock filter; the offset itself does not carry over, since both
+    /// monotonic clocks restart at boot.
+    double clockSkewPpm = 0.0;
+    /// Where the drift loop settled (DriftController::driftPpm()).
+    double driftPpm = 0.0;
+
+    /// "wasapi-exclusive", "wasapi-shared" or "asio".
+    std::string backend;
+    /// WASAPI endpoint id (UTF-8) or ASIO driver name; empty for the default.
+    std::string outputDevice;
+    std::uint32_t periodFrames = 0;
+
+    /// When the profile was written, seconds since the Unix epoch.
+    std::uint64_t savedUnixSec = 0;
+};
+
+/// One PairingProfile persisted as a key=value text file, written through a
+/// temporary file and a rename like CaptureProfileCache, so a crash
+/// mid-write leaves the previous profile.
+class PairingProfileStore {
+public:
+    /// Bump when the file layout or a field's meaning changes.
+    static constexpr int kVersion = 1;
+
+    explicit PairingProfileStore(std::string path) : path_(std::move(path)) {}
+
+    /// False if there is no profile, it is unreadable, or it is from
+    /// another version.
+    bool load(PairingProfile& out) const {
+        std::ifstream in(path_);
+        if (!in) {
+            return false;
+        }
+        PairingProfile profile;
+        int version = 0;
+        std::string line;
+        while (std::getline(in, line)) {
+            const std::size_t eq = line.find('=');
+            if (eq == std::string::npos) {
+                continue;
+            }
+            const std::string name = line.substr(0, eq);
+            const std::string value = line.substr(eq + 1);
+            const char* v = value.c_str();
+            if (name == "version") {
+                version = std::atoi(v);
+            } else if (name == "peer") {
+                profile.peer = value;
+            } else if (name == "host") {
+                profile.host = value;
+            } else if (name == "port") {
+                profile.port = static_cast<std::uint16_t>(std::atoi(v));
+            } else if (name == "stream_id") {
+                profile.streamId = static_cast<std::uint8_t>(std::atoi(v));
+            } else if (name == "codec") {
+                profile.codec = static_cast<CodecId>(std::atoi(v) & 0x0f);
+            } else if (name == "frame_units") {
+                profile.frameUnits = static_cast<std::uint8_t>(std::atoi(v));
+            } else if (name == "channels") {
+                profile.channels = static_cast<std::uint16_t>(std::atoi(v));
+            } else if (name == "clock_skew_ppm") {
+                profile.clockSkewPpm = std::strtod(v, nullptr);
+            } else if (name == "drift_ppm") {
+                profile.driftPpm = std::strtod(v, nullptr);
+            } else if (name == "backend") {
+                profile.backend = value;
+            } else if (name == "output_device") {
+                profile.outputDevice = value;
+            } else if (name == "period_frames") {
+                profile.periodFrames = static_cast<std::uint32_t>(std::strtoul(v, nullptr, 10));
+            } else if (name == "saved") {
+                profile.savedUnixSec = std::strtoull(v, nullptr, 10);
+            }
+        }
+        if (version != kVersion || profile.frameUnits == 0 || profile.channels == 0) {
+            return false;
+        }
+        out = profile;
+        return true;
+    }
+
+    bool store(const PairingProfile& profile) const {
+        const std::string tmp = path_ + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out) {
+                return false;
+            }
+            out << "version=" << kVersion << '\n'
+                << "peer=" << profile.peer << '\n'
+                << "host=" << profile.host << '\n'
+                << "port=" << profile.port << '\n'
+                << "stream_id=" << static_cast<int>(profile.streamId) << '\n'
+                << "codec=" << static_cast<int>(profile.codec) << '\n'
+                << "frame_units=" << static_cast<int>(profile.frameUnits) << '\n'
+                << "channels=" << profile.channels << '\n'
+                << "clock_skew_ppm=" << profile.clockSkewPpm << '\n'
+                << "drift_ppm=" << profile.driftPpm << '\n'
+                << "backend=" << profile.backend << '\n'
+                << "output_device=" << profile.outputDevice << '\n'
+                << "period_frames=" << profile.periodFrames << '\n'
+                << "saved=" << profile.savedUnixSec << '\n';
+            if (!out.flush()) {
+                return false;
+            }
+        }
+        // std::filesystem::rename replaces an existing file on Windows too.
+        std::error_code error;
+        std::filesystem::rename(tmp, path_, error);
+        return !error;
+    }
+
+    /// Forgets the profile: the next Start pairs from scratch.
+    void invalidate() const { std::remove(path_.c_str()); }
+
+private:
+    std::string path_;
+};
+
+} // namespace aas
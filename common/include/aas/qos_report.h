@@ -0,0 +1,128 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/packet_header.h"
+#include "aas/timing.h"
+
+namespace aas {
+
+/// DSCP code points the sender marks media with (RFC 4594 names).
+inline constexpr std::uint8_t kDscpDefault = 0;
+inline constexpr std::uint8_t kDscpCs5 = 40;         ///< the spec's marking (TOS 0xA0)
+inline constexpr std::uint8_t kDscpVoiceAdmit = 44;  ///< capacity-admitted telephony
+inline constexpr std::uint8_t kDscpEf = 46;          ///< expedited forwarding, telephony (TOS 0xB8)
+inline constexpr std::uint8_t kDscpCs6 = 48;         ///< network control
+
+/// The DSCP is the upper six bits of the IPv4 TOS / IPv6 traffic class
+/// byte; the low two are ECN.
+constexpr std::uint8_t tosForDscp(std::uint8_t dscp) { return static_cast<std::uint8_t>(dscp << 2); }
+constexpr std::uint8_t dscpOfTos(std::uint8_t tos) { return static_cast<std::uint8_t>(tos >> 2); }
+
+enum class WmmAccessCategory : std::uint8_t {
+    kBackground,
+    kBestEffort,
+    kVideo,
+    kVoice,
+};
+
+/// Access category a Wi-Fi station or AP queues `dscp` in.
+///
+/// RFC 8325 (Linux cfg80211 since 5.8, most current APs) puts EF and
+/// VOICE-ADMIT in UP 6 and CS6 in UP 7, i.e. AC_VO, but CS5 in UP 5, which
+/// is AC_VI. The older precedence mapping (UP = DSCP >> 3) still found on
+/// many APs gives AC_VO to CS6 and CS7 only.
+constexpr WmmAccessCategory wmmAccessCategory(std::uint8_t dscp, bool rfc8325 = true) {
+    std::uint8_t up = static_cast<std::uint8_t>(dscp >> 3);
+    if (rfc8325) {
+        switch (dscp) {
+        case kDscpEf:
+        case kDscpVoiceAdmit:
+            up = 6;
+            break;
+        case kDscpCs6:
+            up = 7;
+            break;
+        case 56:  // CS7 is reserved and not to be trusted from hosts
+            up = 0;
+            break;
+        case 16:  // CS2, OAM
+            up = 0;
+            break;
+        default:
+            break;
+        }
+    }
+    switch (up) {
+    case 1:
+    case 2:
+        return WmmAccessCategory::kBackground;
+    case 4:
+    case 5:
+        return WmmAccessCategory::kVideo;
+    case 6:
+    case 7:
+        return WmmAccessCategory::kVoice;
+    default:
+        return WmmAccessCategory::kBestEffort;
+    }
+}
+
+inline const char* wmmAccessCategoryName(WmmAccessCategory ac) {
+    static constexpr const char* kNames[] = {"AC_BK", "AC_BE", "AC_VI", "AC_VO"};
+    return kNames[static_cast<std::size_t>(ac)];
+}
+
+/// QoS report flags.
+enum QosReportFlags : std::uint8_t {
+    /// The receiver read the TOS byte of at least one datagram in the
+    /// interval (IP_RECVTOS works there); `tos` and `tosMatching` are valid.
+    kQosTosKnown = 1u << 0,
+};
+
+/// What the receiver saw of the media flow over one interval
+/// (docs/protocol.md, QoS Reports). Sent by the PC once a second to the
+/// address media arrives from, as a standalone timing datagram.
+#pragma pack(push, 1)
+struct QosReport {
+    TimingKind kind;            ///< always kQosReport
+    std::uint8_t tos;           ///< most common TOS byte in the interval
+    std::uint16_t intervalMs;
+    std::uint32_t datagrams;    ///< media datagrams received in the interval
+    std::uint32_t tosMatching;  ///< how many of them carried `tos`
+    /// One-way transit above the fastest media datagram of the last two
+    /// seconds, over the interval.
+    std::uint32_t delayP50Us;
+    std::uint32_t delayP99Us;
+    std::uint32_t delayMaxUs;
+    std::uint8_t flags;  ///< QosReportFlags
+    std::uint8_t reserved[3];
+};
+#pragma pack(pop)
+
+static_assert(sizeof(QosReport) == kTimingMessageBytes, "a QoS report fills the timing message slot");
+
+/// Writes a datagram holding only `report`. Returns its size.
+inline std::size_t writeQosReportDatagram(const QosReport& report, std::uint8_t streamId, std::uint8_t* out) {
+    PacketHeader header{};
+    header.versionCodec = PacketHeader::packVersionCodec(CodecId::kPcm16);
+    header.flags = kFlagTiming;
+    header.streamId = streamId;
+    header.frameUnits = 0;
+    std::uint8_t* p = writePacketHeader(header, out);
+    std::memcpy(p, &report, sizeof(QosReport));
+    return kPacketHeaderBytes + sizeof(QosReport);
+}
+
+/// Reads the report from a standalone timing datagram of kind kQosReport.
+inline bool readQosReport(const std::uint8_t* data, std::size_t size, QosReport& out) {
+    if (size < kPacketHeaderBytes + sizeof(QosReport)) {
+        return false;
+    }
+    std::memcpy(&out, data + size - sizeof(QosReport), sizeof(QosReport));
+    return out.kind == TimingKind::kQosReport;
+}
+
+} // namespace aas
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// Session-lifetime memory for everything the real-time threads touch:
+/// frame rings, packet inboxes, FEC and resampler buffers.
+///
+/// reserve() maps one block at session start, locks it into RAM (mlock /
+/// VirtualLock) and touches every page, so the hot path can neither page
+/// fault nor reach the heap. Allocation is a bump pointer; nothing is freed
+/// until release(), which runs the destructors of objects made with
+/// create() in reverse order and unmaps the block.
+///
+/// Locking is best effort: Android caps RLIMIT_MEMLOCK for apps (often
+/// 64 KiB), and Windows needs the working set raised first. An unlocked
+/// arena is still pre-faulted and allocation-free, and locked() says which
+/// one the session got. Requests beyond the reservation fall back to the
+/// heap and are counted in overflowBytes(), so a sizing mistake shows up in
+/// the stats instead of as a failed session.
+///
+/// Setup is single-threaded (the control thread); the RT threads only use
+/// the memory.
+class RtArena {
+public:
+    static constexpr std::size_t kMaxObjects = 64;
+
+    RtArena() = default;
+    ~RtArena() { release(); }
+    RtArena(const RtArena&) = delete;
+    RtArena& operator=(const RtArena&) = delete;
+
+    /// Maps, locks and pre-faults `bytes` (rounded up to whole pages).
+    bool reserve(std::size_t bytes) {
+        release();
+        const std::size_t page = pageSize();
+        const std::size_t size = (bytes + page - 1) / page * page;
+#if defined(_WIN32)
+        void* base = ::VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+        if (base == nullptr) {
+            return false;
+        }
+        SIZE_T minimum = 0;
+        SIZE_T maximum = 0;
+        const HANDLE process = ::GetCurrentProcess();
+        if (::GetProcessWorkingSetSize(process, &minimum, &maximum)) {
+            ::SetProcessWorkingSetSize(process, minimum + size, maximum + size);
+        }
+        locked_ = ::VirtualLock(base, size) != 0;
+#else
+        void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            return false;
+        }
+        locked_ = ::mlock(base, size) == 0;
+#endif
+        base_ = static_cast<std::uint8_t*>(base);
+        capacity_ = size;
+        used_ = 0;
+        for (std::size_t offset = 0; offset < size; offset += page) {
+            // Writes, not reads: a read of a fresh anonymous page maps the
+            // shared zero page and the first write would still fault.
+            static_cast<volatile std::uint8_t*>(base_)[offset] = 0;
+        }
+        return true;
+    }
+
+    /// Destroys created objects (newest first) and returns the block.
+    void release() {
+        while (objectCount_ > 0) {
+            Object& object = objects_[--objectCount_];
+            object.destroy(object.pointer);
+            if (!contains(object.pointer)) {
+                ::operator delete(object.pointer, std::align_val_t{object.align});
+            }
+        }
+        if (base_ != nullptr) {
+#if defined(_WIN32)
+            if (locked_) {
+                ::VirtualUnlock(base_, capacity_);
+            }
+            ::VirtualFree(base_, 0, MEM_RELEASE);
+#else
+            ::munmap(base_, capacity_);
+#endif
+        }
+        base_ = nullptr;
+        capacity_ = 0;
+        used_ = 0;
+        locked_ = false;
+        overflowBytes_.store(0, std::memory_order_relaxed);
+    }
+
+    /// Bump-allocates from the block; nullptr (and an overflow count) when
+    /// it is exhausted.
+    void* allocate(std::size_t bytes, std::size_t align = kCacheLineSize) {
+        const std::size_t start = (used_ + align - 1) / align * align;
+        if (base_ == nullptr || start + bytes > capacity_) {
+            overflowBytes_.fetch_add(bytes, std::memory_order_relaxed);
+            return nullptr;
+        }
+        used_ = start + bytes;
+        return base_ + start;
+    }
+
+    /// Constructs a T in the arena (or on the heap once it is full); its
+    /// destructor runs in release(). Returns nullptr only when kMaxObjects
+    /// objects already exist.
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        if (objectCount_ == kMaxObjects) {
+            return nullptr;
+        }
+        constexpr std::size_t align = alignof(T) > kCacheLineSize ? alignof(T) : kCacheLineSize;
+        void* memory = allocate(sizeof(T), align);
+        if (memory == nullptr) {
+            memory = ::operator new(sizeof(T), std::align_val_t{align});
+        }
+        T* object = ::new (memory) T(std::forward<Args>(args)...);
+        objects_[objectCount_++] = Object{object, [](void* p) { static_cast<T*>(p)->~T(); }, align};
+        return object;
+    }
+
+    bool contains(const void* p) const {
+        const auto* byte = static_cast<const std::uint8_t*>(p);
+        return base_ != nullptr && byte >= base_ && byte < base_ + capacity_;
+    }
+
+    bool locked() const { return locked_; }
+    std::size_t capacity() const { return capacity_; }
+    std::size_t used() const { return used_; }
+    std::size_t overflowBytes() const { return overflowBytes_.load(std::memory_order_relaxed); }
+
+    /// Arena that default-constructed ArenaAllocators on this thread draw
+    /// from; set for the duration of a session's construction.
+    static RtArena*& current() {
+        thread_local RtArena* arena = nullptr;
+        return arena;
+    }
+
+    /// Makes `arena` current for the enclosing scope.
+    class Scope {
+    public:
+        explicit Scope(RtArena& arena) : previous_(current()) { current() = &arena; }
+        ~Scope() { current() = previous_; }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        RtArena* previous_;
+    };
+
+private:
+    struct Object {
+        void* pointer;
+        void (*destroy)(void*);
+        std::size_t align;
+    };
+
+    static std::size_t pageSize() {
+#if defined(_WIN32)
+        SYSTEM_INFO info;
+        ::GetSystemInfo(&info);
+        return info.dwPageSize;
+#else
+        return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+    }
+
+    std::uint8_t* base_ = nullptr;
+    std::size_t capacity_ = 0;
+    std::size_t used_ = 0;
+    bool locked_ = false;
+    std::atomic<std::size_t> overflowBytes_{0};
+    std::array<Object, kMaxObjects> objects_{};
+    std::size_t objectCount_ = 0;
+};
+
+/// Standard allocator over the arena that was current when it was made
+/// (the heap when none was). Containers sized once at construction keep
+/// their storage in locked memory; deallocating arena memory is a no-op.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    ArenaAllocator() noexcept : arena_(RtArena::current()) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+    T* allocate(std::size_t n) {
+        if (arena_ != nullptr) {
+            if (void* p = arena_->allocate(n * sizeof(T), alignof(T) > 16 ? alignof(T) : 16)) {
+                return static_cast<T*>(p);
+            }
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, std::size_t) noexcept {
+        if (arena_ == nullptr || !arena_->contains(p)) {
+            ::operator delete(p);
+        }
+    }
+
+    RtArena* arena() const noexcept { return arena_; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ == other.arena();
+    }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ != other.arena();
+    }
+
+private:
+    RtArena* arena_;
+};
+
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace aas
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#include "aas/thread_stats.h"
+
+#if defined(AAS_RT_CHECK) && defined(__linux__)
+#include <sys/resource.h>
+#endif
+
+namespace aas {
+
+/// Debug-build RT-safety checker (compile with AAS_RT_CHECK).
+///
+/// RtScope tags its thread as real-time. While tagged, any heap allocation
+/// or free through operator new/delete (and, on the Windows debug CRT,
+/// malloc) is a violation; rt_check_hooks.h installs those hooks and must
+/// be included by exactly one translation unit per binary. Within an active
+/// cycle (RtScope::begin() to end()) a voluntary context switch means the
+/// thread blocked in a syscall or on a lock, and a page fault means it
+/// touched memory outside the locked arena; both are read from
+/// getrusage(RUSAGE_THREAD) on Linux and Android. Windows has no per-thread
+/// equivalent, so there only allocations are trapped.
+///
+/// Violations are counted per kind; with setAbortOnViolation(true) (CI
+/// stress runs) the first one aborts so the core dump shows the offending
+/// stack. Without AAS_RT_CHECK every call compiles to nothing.
+class RtCheck {
+public:
+    enum Violation : std::size_t { kAllocation, kFree, kBlocking, kPageFault, kViolationCount };
+
+    static void setAbortOnViolation(bool abort) { state().abort.store(abort, std::memory_order_relaxed); }
+
+    static std::uint64_t count(Violation v) { return state().counts[v].load(std::memory_order_relaxed); }
+    /// Role of the thread behind the most recent violation.
+    static ThreadRole lastOffender() { return state().lastRole.load(std::memory_order_relaxed); }
+
+#if defined(AAS_RT_CHECK)
+    static void enterRealtime(ThreadRole role) {
+        local().role = role;
+        local().tagged = true;
+    }
+    static void leaveRealtime() { local().tagged = false; }
+    static bool realtime() { return local().tagged && !local().suspended; }
+
+    static void report(Violation v) {
+        // The reporting path itself must not recurse into the hooks.
+        Local& self = local();
+        if (self.suspended) {
+            return;
+        }
+        self.suspended = true;
+        state().counts[v].fetch_add(1, std::memory_order_relaxed);
+        state().lastRole.store(self.role, std::memory_order_relaxed);
+        if (state().abort.load(std::memory_order_relaxed)) {
+            std::abort();
+        }
+        self.suspended = false;
+    }
+
+    static void beginCycle() {
+#if defined(__linux__)
+        rusage usage;
+        if (local().tagged && getrusage(RUSAGE_THREAD, &usage) == 0) {
+            local().switches = usage.ru_nvcsw;
+            local().faults = usage.ru_minflt + usage.ru_majflt;
+        }
+#endif
+    }
+
+    static void endCycle() {
+#if defined(__linux__)
+        rusage usage;
+        if (local().tagged && getrusage(RUSAGE_THREAD, &usage) == 0) {
+            if (usage.ru_nvcsw != local().switches) {
+                report(kBlocking);
+            }
+            if (usage.ru_minflt + usage.ru_majflt != local().faults) {
+                report(kPageFault);
+            }
+        }
+#endif
+    }
+#else
+    static void enterRealtime(ThreadRole) {}
+    static void leaveRealtime() {}
+    static bool realtime() { return false; }
+    static void report(Violation) {}
+    static void beginCycle() {}
+    static void endCycle() {}
+#endif
+
+private:
+    struct State {
+        std::array<std::atomic<std::uint64_t>, kViolationCount> counts{};
+        std::atomic<ThreadRole> lastRole{ThreadRole::kCount};
+        std::atomic<bool> abort{false};
+    };
+    struct Local {
+        ThreadRole role = ThreadRole::kCount;
+        bool tagged = false;
+        bool suspended = false;
+        long switches = 0;
+        long faults = 0;
+    };
+
+    static State& state() {
+        static State s;
+        return s;
+    }
+    static Local& local() {
+        thread_local Local l;
+        return l;
+    }
+};
+
+} // namespace aas
@@ -0,0 +1,126 @@
+#pragma once
+
+// Allocation hooks for the RT-safety checker (aas/rt_check.h). Include from
+// exactly one translation unit per binary; without AAS_RT_CHECK this file
+// is empty.
+
+#if defined(AAS_RT_CHECK)
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32) && defined(_DEBUG)
+#include <crtdbg.h>
+#define AAS_RT_CHECK_CRT 1
+#endif
+
+#include "aas/rt_check.h"
+
+namespace aas::rt_check_detail {
+
+/// With the debug CRT hook installed, malloc reports and operator new must
+/// not report a second time.
+#if defined(AAS_RT_CHECK_CRT)
+inline constexpr bool kReportInNew = false;
+#else
+inline constexpr bool kReportInNew = true;
+#endif
+
+inline void* allocate(std::size_t size) {
+    if (kReportInNew && RtCheck::realtime()) {
+        RtCheck::report(RtCheck::kAllocation);
+    }
+    if (void* p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+inline void* allocateAligned(std::size_t size, std::align_val_t align) {
+    if (kReportInNew && RtCheck::realtime()) {
+        RtCheck::report(RtCheck::kAllocation);
+    }
+    const auto alignment = static_cast<std::size_t>(align);
+#if defined(_WIN32)
+    void* p = _aligned_malloc(size == 0 ? 1 : size, alignment);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size == 0 ? 1 : size) != 0) {
+        p = nullptr;
+    }
+#endif
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+inline void release(void* p) {
+    if (kReportInNew && p != nullptr && RtCheck::realtime()) {
+        RtCheck::report(RtCheck::kFree);
+    }
+    std::free(p);
+}
+
+inline void releaseAligned(void* p) {
+    if (kReportInNew && p != nullptr && RtCheck::realtime()) {
+        RtCheck::report(RtCheck::kFree);
+    }
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+#if defined(AAS_RT_CHECK_CRT)
+/// Debug CRT hook: also sees plain malloc/free from C code.
+inline int crtAllocHook(int type, void*, std::size_t, int, long, const unsigned char*, int) {
+    if (RtCheck::realtime()) {
+        RtCheck::report(type == _HOOK_FREE ? RtCheck::kFree : RtCheck::kAllocation);
+    }
+    return TRUE;
+}
+
+inline const bool kCrtHookInstalled = (_CrtSetAllocHook(crtAllocHook), true);
+#endif
+
+} // namespace aas::rt_check_detail
+
+void* operator new(std::size_t size) { return aas::rt_check_detail::allocate(size); }
+void* operator new[](std::size_t size) { return aas::rt_check_detail::allocate(size); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return aas::rt_check_detail::allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return aas::rt_check_detail::allocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new(std::size_t size, std::align_val_t align) {
+    return aas::rt_check_detail::allocateAligned(size, align);
+}
+void* operator new[](std::size_t size, std::align_val_t align) {
+    return aas::rt_check_detail::allocateAligned(size, align);
+}
+
+void operator delete(void* p) noexcept { aas::rt_check_detail::release(p); }
+void operator delete[](void* p) noexcept { aas::rt_check_detail::release(p); }
+void operator delete(void* p, std::size_t) noexcept { aas::rt_check_detail::release(p); }
+void operator delete[](void* p, std::size_t) noexcept { aas::rt_check_detail::release(p); }
+void operator delete(void* p, std::align_val_t) noexcept { aas::rt_check_detail::releaseAligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { aas::rt_check_detail::releaseAligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+    aas::rt_check_detail::releaseAligned(p);
+}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {
+    aas::rt_check_detail::releaseAligned(p);
+}
+
+#endif // AAS_RT_CHECK
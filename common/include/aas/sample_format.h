@@ -0,0 +1,267 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#include "aas/audio_format.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define AAS_FORMAT_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AAS_FORMAT_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AAS_FORMAT_NEON 1
+#endif
+
+namespace aas {
+
+/// Sample-format and channel-layout kernels shared by both ends: int16 wire
+/// PCM to and from float frames, interleaved to planar and back, and
+/// channel routing.
+///
+/// Loops that walk channels inside a frame are templates on the channel
+/// count, so each count compiles to straight-line code with no per-sample
+/// branch; withChannelCount() picks the instantiation once per call from
+/// the runtime count. Stereo, the common case, also has hand-written
+/// NEON/SSE2 shuffles. The flat conversions do not care about channels
+/// and have NEON, SSE2 and AVX2 paths.
+
+/// Calls `f(std::integral_constant<std::size_t, N>{})` with N = `channels`.
+/// Returns false (and calls nothing) outside 1-kMaxFrameChannels.
+template <class F>
+inline bool withChannelCount(std::size_t channels, F&& f) {
+    static_assert(kMaxFrameChannels == 8, "one case per supported channel count");
+    switch (channels) {
+    case 1: f(std::integral_constant<std::size_t, 1>{}); return true;
+    case 2: f(std::integral_constant<std::size_t, 2>{}); return true;
+    case 3: f(std::integral_constant<std::size_t, 3>{}); return true;
+    case 4: f(std::integral_constant<std::size_t, 4>{}); return true;
+    case 5: f(std::integral_constant<std::size_t, 5>{}); return true;
+    case 6: f(std::integral_constant<std::size_t, 6>{}); return true;
+    case 7: f(std::integral_constant<std::size_t, 7>{}); return true;
+    case 8: f(std::integral_constant<std::size_t, 8>{}); return true;
+    default: return false;
+    }
+}
+
+/// `count` little-endian int16 samples (any alignment, e.g. a packet
+/// payload) to float in [-1, 1).
+inline void pcm16ToFloat(const std::uint8_t* in, float* out, std::size_t count) {
+    constexpr float kScale = 1.0f / 32768.0f;
+    std::size_t i = 0;
+#if defined(AAS_FORMAT_AVX2)
+    const __m256 scale8 = _mm256_set1_ps(kScale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)), scale8));
+    }
+#elif defined(AAS_FORMAT_SSE2)
+    const __m128 scale4 = _mm_set1_ps(kScale);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + 2 * i));
+        // Sign-extend by placing each sample in the top half and shifting.
+        const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+        const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+        _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale4));
+        _mm_storeu_ps(out + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale4));
+    }
+#elif defined(AAS_FORMAT_NEON)
+    for (; i + 8 <= count; i += 8) {
+        const int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(in + 2 * i));
+        vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), kScale));
+        vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), kScale));
+    }
+#endif
+    for (; i < count; ++i) {
+        std::int16_t v;
+        std::memcpy(&v, in + 2 * i, sizeof(v));
+        out[i] = static_cast<float>(v) * kScale;
+    }
+}
+
+/// `count` floats to little-endian int16, rounded to nearest and saturated:
+/// the exact inverse of pcm16ToFloat() for every value it produces.
+inline void floatToPcm16(const float* in, std::uint8_t* out, std::size_t count) {
+    std::size_t i = 0;
+#if defined(AAS_FORMAT_AVX2)
+    const __m256 scale8 = _mm256_set1_ps(32768.0f);
+    for (; i + 16 <= count; i += 16) {
+        const __m256i a = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i), scale8));
+        const __m256i b = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_loadu_ps(in + i + 8), scale8));
+        // packs works per 128-bit lane; put the quadwords back in order.
+        const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 2 * i), packed);
+    }
+#elif defined(AAS_FORMAT_SSE2)
+    const __m128 scale4 = _mm_set1_ps(32768.0f);
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i), scale4));
+        const __m128i b = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(in + i + 4), scale4));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 2 * i), _mm_packs_epi32(a, b));
+    }
+#elif defined(AAS_FORMAT_NEON) && defined(__aarch64__)
+    // vcvtnq (round to nearest) is AArch64 only; ARMv7 takes the scalar loop.
+    for (; i + 8 <= count; i += 8) {
+        const int32x4_t a = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i), 32768.0f));
+        const int32x4_t b = vcvtnq_s32_f32(vmulq_n_f32(vld1q_f32(in + i + 4), 32768.0f));
+        vst1q_u8(out + 2 * i, vreinterpretq_u8_s16(vcombine_s16(vqmovn_s32(a), vqmovn_s32(b))));
+    }
+#endif
+    for (; i < count; ++i) {
+        float v = in[i] * 32768.0f;
+        v = v < -32768.0f ? -32768.0f : (v > 32767.0f ? 32767.0f : v);
+        // lrint rounds half to even in the default mode, as the vector
+        // conversions do.
+        const auto s = static_cast<std::int16_t>(std::lrint(v));
+        std::memcpy(out + 2 * i, &s, sizeof(s));
+    }
+}
+
+/// Interleaved `in` (Channels floats per frame) to one row per channel.
+template <std::size_t Channels>
+inline void deinterleave(const float* in, float* const* out, std::size_t frames) {
+    for (std::size_t i = 0; i < frames; ++i) {
+        for (std::size_t ch = 0; ch < Channels; ++ch) {
+            out[ch][i] = in[i * Channels + ch];
+        }
+    }
+}
+
+template <>
+inline void deinterleave<2>(const float* in, float* const* out, std::size_t frames) {
+    float* left = out[0];
+    float* right = out[1];
+    std::size_t i = 0;
+#if defined(AAS_FORMAT_SSE2)
+    for (const std::size_t end = frames & ~std::size_t{3}; i < end; i += 4) {
+        const __m128 a = _mm_loadu_ps(in + 2 * i);
+        const __m128 b = _mm_loadu_ps(in + 2 * i + 4);
+        _mm_storeu_ps(left + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0)));
+        _mm_storeu_ps(right + i, _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1)));
+    }
+#elif defined(AAS_FORMAT_NEON)
+    for (const std::size_t end = frames & ~std::size_t{3}; i < end; i += 4) {
+        const float32x4x2_t v = vld2q_f32(in + 2 * i);
+        vst1q_f32(left + i, v.val[0]);
+        vst1q_f32(right + i, v.val[1]);
+    }
+#endif
+    for (; i < frames; ++i) {
+        left[i] = in[2 * i];
+        right[i] = in[2 * i + 1];
+    }
+}
+
+/// One row per channel back to interleaved `out`.
+template <std::size_t Channels>
+inline void interleave(const float* const* in, float* out, std::size_t frames) {
+    for (std::size_t i = 0; i < frames; ++i) {
+        for (std::size_t ch = 0; ch < Channels; ++ch) {
+            out[i * Channels + ch] = in[ch][i];
+        }
+    }
+}
+
+template <>
+inline void interleave<2>(const float* const* in, float* out, std::size_t frames) {
+    const float* left = in[0];
+    const float* right = in[1];
+    std::size_t i = 0;
+#if defined(AAS_FORMAT_SSE2)
+    for (const std::size_t end = frames & ~std::size_t{3}; i < end; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        _mm_storeu_ps(out + 2 * i, _mm_unpacklo_ps(l, r));
+        _mm_storeu_ps(out + 2 * i + 4, _mm_unpackhi_ps(l, r));
+    }
+#elif defined(AAS_FORMAT_NEON)
+    for (const std::size_t end = frames & ~std::size_t{3}; i < end; i += 4) {
+        float32x4x2_t v;
+        v.val[0] = vld1q_f32(left + i);
+        v.val[1] = vld1q_f32(right + i);
+        vst2q_f32(out + 2 * i, v);
+    }
+#endif
+    for (; i < frames; ++i) {
+        out[2 * i] = left[i];
+        out[2 * i + 1] = right[i];
+    }
+}
+
+/// Which stream channel each output channel plays. Every frame in the
+/// pipeline is interleaved in WAVE / SMPTE order (7.1 is FL FR FC LFE BL BR
+/// SL SR; the layout for each count is listed in aas/opus_layout.h), which
+/// is also the order WASAPI channel masks use, so the default map is the
+/// identity.
+struct ChannelMap {
+    static constexpr std::int8_t kSilent = -1;
+
+    /// source[c]: stream channel for output c, or kSilent.
+    std::array<std::int8_t, kMaxFrameChannels> source{};
+
+    /// Stream channels to the first outputs, the rest silent; a mono
+    /// stream feeds every output.
+    static ChannelMap forChannels(std::size_t streamChannels, std::size_t outputChannels) {
+        ChannelMap map;
+        for (std::size_t c = 0; c < kMaxFrameChannels; ++c) {
+            const bool routed = c < outputChannels && (streamChannels == 1 || c < streamChannels);
+            map.source[c] = routed ? static_cast<std::int8_t>(streamChannels == 1 ? 0 : c) : kSilent;
+        }
+        return map;
+    }
+
+    bool isIdentity(std::size_t channels) const {
+        for (std::size_t c = 0; c < channels; ++c) {
+            if (source[c] != static_cast<std::int8_t>(c)) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+/// Routes `frames` interleaved frames of `inChannels` into OutChannels per
+/// `map`. Silent outputs read stream channel 0 at gain 0, so the inner loop
+/// is the same multiply for every output and carries no branch. `map` must
+/// only name channels below `inChannels`.
+template <std::size_t OutChannels>
+inline void remapChannels(const float* in, std::size_t inChannels, float* out, std::size_t frames,
+                          const ChannelMap& map) {
+    std::size_t index[OutChannels];
+    float gain[OutChannels];
+    for (std::size_t c = 0; c < OutChannels; ++c) {
+        const bool silent = map.source[c] < 0;
+        index[c] = silent ? 0 : static_cast<std::size_t>(map.source[c]);
+        gain[c] = silent ? 0.0f : 1.0f;
+    }
+    for (std::size_t i = 0; i < frames; ++i) {
+        const float* frame = in + i * inChannels;
+        for (std::size_t c = 0; c < OutChannels; ++c) {
+            out[i * OutChannels + c] = frame[index[c]] * gain[c];
+        }
+    }
+}
+
+/// Runtime-count form: a straight copy when the layout already matches,
+/// otherwise the OutChannels instantiation. False if `outChannels` is not
+/// 1-kMaxFrameChannels.
+inline bool remapChannels(const float* in, std::size_t inChannels, float* out, std::size_t outChannels,
+                          std::size_t frames, const ChannelMap& map) {
+    if (inChannels == outChannels && map.isIdentity(outChannels)) {
+        std::memcpy(out, in, frames * outChannels * sizeof(float));
+        return true;
+    }
+    return withChannelCount(outChannels, [&](auto n) {
+        remapChannels<decltype(n)::value>(in, inChannels, out, frames, map);
+    });
+}
+
+} // namespace aas
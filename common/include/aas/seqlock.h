@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace aas {
+
+/// Single-writer, many-reader snapshot of a small trivially copyable value.
+///
+/// The writer never waits; readers retry while a write is in flight. The
+/// payload is stored as relaxed atomic words so concurrent access is well
+/// defined rather than a benign-looking data race. Use it for estimates and
+/// settings that several threads sample (clock offset, stream stats), not
+/// for anything written at audio rate by more than one thread.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T>, "SeqLock copies the value bytewise");
+
+public:
+    SeqLock() { store(T{}); }
+
+    /// Writer thread only.
+    void store(const T& value) {
+        std::uint64_t words[kWords] = {};
+        std::memcpy(words, &value, sizeof(T));
+        const std::uint32_t seq = sequence_.load(std::memory_order_relaxed);
+        sequence_.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        for (std::size_t i = 0; i < kWords; ++i) {
+            words_[i].store(words[i], std::memory_order_relaxed);
+        }
+        sequence_.store(seq + 2, std::memory_order_release);
+    }
+
+    /// Any thread. Never returns a torn value.
+    T load() const {
+        std::uint64_t words[kWords];
+        std::uint32_t before = 0;
+        std::uint32_t after = 0;
+        do {
+            before = sequence_.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < kWords; ++i) {
+                words[i] = words_[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = sequence_.load(std::memory_order_relaxed);
+        } while ((before & 1u) != 0 || before != after);
+        T value;
+        std::memcpy(&value, words, sizeof(T));
+        return value;
+    }
+
+private:
+    static constexpr std::size_t kWords = (sizeof(T) + 7) / 8;
+
+    std::atomic<std::uint32_t> sequence_{0};
+    std::array<std::atomic<std::uint64_t>, kWords> words_{};
+};
+
+} // namespace aas
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+
+#include "aas/audio_format.h"
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+/// Layout of the shared-memory audio output (docs/protocol.md, Shared-Memory
+/// Output): a header, then slotCount fixed-size slots, one decoded 2.5 ms
+/// frame each. Everything is little-endian at fixed offsets, so a plugin
+/// built with another compiler can map it with this header alone.
+inline constexpr std::uint32_t kSharedAudioMagic = 0x4D534141;  // "AASM"
+inline constexpr std::uint16_t kSharedAudioVersion = 1;
+inline constexpr std::uint32_t kSharedAudioNoStream = 0xFFFFFFFFu;
+
+struct SharedAudioHeader {
+    std::uint32_t magic;
+    std::uint16_t version;
+    std::uint16_t headerBytes;
+    std::uint32_t slotCount;  ///< power of two
+    std::uint32_t slotBytes;  ///< stride between slots
+    std::uint32_t sampleRateHz;
+    std::uint16_t framesPerSlot;
+    std::uint16_t maxChannels;
+    /// Changes whenever the writer (re)opens the mapping or a new sender
+    /// takes it over; readers then resync to the write position.
+    std::atomic<std::uint32_t> generation;
+    /// Stream id of the sender in the slots, kSharedAudioNoStream before
+    /// the first frame.
+    std::atomic<std::uint32_t> streamId;
+    /// Slots published since the generation started; slot i lives at
+    /// i % slotCount.
+    std::atomic<std::uint64_t> writeIndex;
+    /// Writer's monotonic time (QueryPerformanceCounter, us) of its last
+    /// publish. It stops moving while no sender is streaming.
+    std::atomic<std::uint64_t> lastWriteUs;
+    std::uint8_t reserved[kCacheLineSize - 48];
+};
+
+struct SharedAudioSlot {
+    /// Odd while the writer is filling the slot.
+    std::atomic<std::uint32_t> sequence;
+    std::uint32_t sampleClock;  ///< sender's sample clock of the first sample
+    std::uint16_t channels;
+    std::uint16_t flags;  ///< AudioFrameFlags
+    std::uint32_t reserved;
+    std::uint64_t index;      ///< absolute slot index, to tell a lapped slot
+    std::uint64_t publishUs;  ///< writer's monotonic time at publish
+    std::uint8_t reserved2[kCacheLineSize - 32];
+    float samples[kFrameSamples * kMaxFrameChannels];  ///< interleaved, `channels` wide
+};
+
+static_assert(sizeof(SharedAudioHeader) == kCacheLineSize, "header is one cache line");
+static_assert(sizeof(SharedAudioSlot) % kCacheLineSize == 0, "slots stay cache-line aligned");
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free &&
+                  std::atomic<std::uint32_t>::is_always_lock_free,
+              "atomics shared between processes must be lock-free");
+
+inline constexpr std::size_t sharedAudioBytes(std::size_t slotCount) {
+    return sizeof(SharedAudioHeader) + slotCount * sizeof(SharedAudioSlot);
+}
+
+/// Writer side, on memory the receiver mapped (SharedAudioOutput). Never
+/// waits for readers: a slot a reader has not taken yet is overwritten
+/// once the ring comes round. One thread only, the decode worker of the
+/// pipeline the mapping belongs to.
+///
+/// Each slot is a seqlock: the sequence goes odd, the frame is copied in
+/// with one memcpy, the sequence goes even, then writeIndex moves on.
+/// Samples are copied plainly rather than as atomic words as in SeqLock:
+/// the other side is another process, quite possibly another compiler, so
+/// the layout promises bytes and the sequence check catches a torn copy.
+class SharedAudioWriter {
+public:
+    /// Lays the header and slots out in `memory` (sharedAudioBytes(slotCount)
+    /// bytes). A header already there from an earlier writer gives the next
+    /// generation, so readers holding the mapping open resync.
+    bool init(void* memory, std::size_t bytes, std::size_t slotCount) {
+        if (memory == nullptr || slotCount < 2 || (slotCount & (slotCount - 1)) != 0 ||
+            bytes < sharedAudioBytes(slotCount)) {
+            return false;
+        }
+        auto* existing = static_cast<SharedAudioHeader*>(memory);
+        std::uint32_t generation = 1;
+        if (existing->magic == kSharedAudioMagic) {
+            generation = existing->generation.load(std::memory_order_relaxed) + 1;
+        }
+
+        // Magic last, so a reader never takes a half-built header for valid.
+        header_ = new (memory) SharedAudioHeader{};
+        header_->version = kSharedAudioVersion;
+        header_->headerBytes = static_cast<std::uint16_t>(sizeof(SharedAudioHeader));
+        header_->slotCount = static_cast<std::uint32_t>(slotCount);
+        header_->slotBytes = static_cast<std::uint32_t>(sizeof(SharedAudioSlot));
+        header_->sampleRateHz = kSampleRateHz;
+        header_->framesPerSlot = static_cast<std::uint16_t>(kFrameSamples);
+        header_->maxChannels = static_cast<std::uint16_t>(kMaxFrameChannels);
+        header_->generation.store(generation, std::memory_order_relaxed);
+        header_->streamId.store(kSharedAudioNoStream, std::memory_order_relaxed);
+        slots_ = reinterpret_cast<SharedAudioSlot*>(static_cast<std::uint8_t*>(memory) +
+                                                   sizeof(SharedAudioHeader));
+        for (std::size_t i = 0; i < slotCount; ++i) {
+            SharedAudioSlot* slot = new (&slots_[i]) SharedAudioSlot{};
+            slot->index = ~std::uint64_t{0};
+        }
+        mask_ = slotCount - 1;
+        next_ = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = kSharedAudioMagic;
+        return true;
+    }
+
+    bool ready() const { return header_ != nullptr; }
+
+    /// Publishes one decoded frame of `streamId`. A different stream than
+    /// the last starts a new generation.
+    void publish(const AudioFrame& frame, std::uint8_t streamId, std::uint64_t nowUs) {
+        if (header_->streamId.load(std::memory_order_relaxed) != streamId) {
+            header_->streamId.store(streamId, std::memory_order_relaxed);
+            header_->generation.fetch_add(1, std::memory_order_release);
+        }
+        SharedAudioSlot& slot = slots_[next_ & mask_];
+        const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        const std::size_t channels = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+        slot.sampleClock = frame.sampleClock;
+        slot.channels = static_cast<std::uint16_t>(channels);
+        slot.flags = frame.flags;
+        slot.index = next_;
+        slot.publishUs = nowUs;
+        std::memcpy(slot.samples, frame.samples, kFrameSamples * channels * sizeof(float));
+
+        slot.sequence.store(sequence + 2, std::memory_order_release);
+        header_->writeIndex.store(++next_, std::memory_order_release);
+        header_->lastWriteUs.store(nowUs, std::memory_order_relaxed);
+    }
+
+private:
+    SharedAudioHeader* header_ = nullptr;
+    SharedAudioSlot* slots_ = nullptr;
+    std::size_t mask_ = 0;
+    std::uint64_t next_ = 0;
+};
+
+/// What SharedAudioReader::read() found.
+enum class SharedAudioRead : std::uint8_t {
+    kFrame,    ///< a frame was copied out
+    kEmpty,    ///< nothing new since the last frame
+    kResync,   ///< the writer restarted or changed sender; reading goes on from its position
+    kOverrun,  ///< the reader fell more than the ring behind and skipped ahead
+};
+
+/// Where a frame read from the ring came from.
+struct SharedAudioFrameInfo {
+    std::uint32_t sampleClock = 0;
+    std::uint16_t channels = 0;
+    std::uint16_t flags = 0;
+    std::uint64_t publishUs = 0;
+    std::uint64_t index = 0;
+};
+
+/// Reader side, in the consuming process, on a read-only view of the
+/// mapping (SharedAudioClient on Windows). Any number of readers may run,
+/// each with its own cursor; none of them is seen by the writer. Wait-free
+/// apart from retrying a slot the writer is filling at that moment, so it
+/// is safe on an audio callback. One thread per reader.
+class SharedAudioReader {
+public:
+    /// Checks the header in `memory` (`bytes` mapped). False if it is not
+    /// an output of this version or the mapping is shorter than it says.
+    bool attach(const void* memory, std::size_t bytes) {
+        header_ = nullptr;
+        const auto* header = static_cast<const SharedAudioHeader*>(memory);
+        if (memory == nullptr || bytes < sizeof(SharedAudioHeader) || header->magic != kSharedAudioMagic ||
+            header->version != kSharedAudioVersion || header->headerBytes != sizeof(SharedAudioHeader) ||
+            header->slotBytes != sizeof(SharedAudioSlot) || header->slotCount < 2 ||
+            (header->slotCount & (header->slotCount - 1)) != 0 ||
+            bytes < sharedAudioBytes(header->slotCount)) {
+            return false;
+        }
+        header_ = header;
+        slots_ = reinterpret_cast<const SharedAudioSlot*>(static_cast<const std::uint8_t*>(memory) +
+                                                         sizeof(SharedAudioHeader));
+        slotCount_ = header->slotCount;
+        haveCursor_ = false;
+        return true;
+    }
+
+    bool attached() const { return header_ != nullptr; }
+
+    /// Frames kept between the writer and the reader after a (re)sync; 0
+    /// starts with the next frame published.
+    void setLead(std::size_t frames) { lead_ = frames; }
+
+    /// Frames published and not read yet.
+    std::size_t available() const {
+        if (header_ == nullptr || !haveCursor_) {
+            return 0;
+        }
+        const std::uint64_t written = header_->writeIndex.load(std::memory_order_acquire);
+        return written > cursor_ ? static_cast<std::size_t>(written - cursor_) : 0;
+    }
+
+    /// Copies the next frame's samples into `out` (room for
+    /// kFrameSamples * kMaxFrameChannels floats, or for the stream's
+    /// channels when the caller knows them) with one memcpy. kResync and
+    /// kOverrun also mean a frame was copied when `info.channels` != 0.
+    SharedAudioRead read(float* out, SharedAudioFrameInfo& info) {
+        info = {};
+        if (header_ == nullptr) {
+            return SharedAudioRead::kEmpty;
+        }
+        SharedAudioRead result = SharedAudioRead::kFrame;
+        const std::uint32_t generation = header_->generation.load(std::memory_order_acquire);
+        std::uint64_t written = header_->writeIndex.load(std::memory_order_acquire);
+        if (!haveCursor_ || generation != generation_ || written < cursor_) {
+            generation_ = generation;
+            cursor_ = resyncCursor(written);
+            haveCursor_ = true;
+            result = SharedAudioRead::kResync;
+        } else if (written - cursor_ > slotCount_ - 1) {
+            cursor_ = resyncCursor(written);
+            result = SharedAudioRead::kOverrun;
+        }
+
+        for (int attempt = 0; attempt < 4 && cursor_ < written; ++attempt) {
+            const SharedAudioSlot& slot = slots_[cursor_ & (slotCount_ - 1)];
+            const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1u) == 0) {
+                const std::uint64_t index = slot.index;
+                const std::uint16_t channels =
+                    std::min<std::uint16_t>(slot.channels, static_cast<std::uint16_t>(kMaxFrameChannels));
+                info.sampleClock = slot.sampleClock;
+                info.flags = slot.flags;
+                info.publishUs = slot.publishUs;
+                info.index = index;
+                std::memcpy(out, slot.samples, kFrameSamples * channels * sizeof(float));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) == before && index == cursor_) {
+                    info.channels = channels;
+                    ++cursor_;
+                    return result;
+                }
+                if (index > cursor_ && index != ~std::uint64_t{0}) {
+                    // Lapped while copying: skip to where the writer is now.
+                    written = header_->writeIndex.load(std::memory_order_acquire);
+                    cursor_ = resyncCursor(written);
+                    result = SharedAudioRead::kOverrun;
+                }
+            }
+        }
+        info = {};
+        return result == SharedAudioRead::kFrame ? SharedAudioRead::kEmpty : result;
+    }
+
+    /// Stream id the writer is publishing, kSharedAudioNoStream if none yet.
+    std::uint32_t streamId() const {
+        return header_ == nullptr ? kSharedAudioNoStream : header_->streamId.load(std::memory_order_relaxed);
+    }
+    std::uint64_t lastWriteUs() const {
+        return header_ == nullptr ? 0 : header_->lastWriteUs.load(std::memory_order_relaxed);
+    }
+
+private:
+    /// `lead_` frames behind the writer, at most half the ring.
+    std::uint64_t resyncCursor(std::uint64_t written) const {
+        return written - std::min<std::uint64_t>({lead_, slotCount_ / 2, written});
+    }
+
+    const SharedAudioHeader* header_ = nullptr;
+    const SharedAudioSlot* slots_ = nullptr;
+    std::uint64_t slotCount_ = 0;
+    std::size_t lead_ = 0;
+    bool haveCursor_ = false;
+    std::uint32_t generation_ = 0;
+    std::uint64_t cursor_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+/// Fixed line size rather than std::hardware_destructive_interference_size,
+/// which the NDK and MSVC toolchains disagree on (or warn about).
+inline constexpr std::size_t kCacheLineSize = 64;
+
+/// Lock-free single-producer / single-consumer ring joining two pipeline
+/// stages (capture -> encode -> send on Android, receive -> decode -> playback
+/// on the PC).
+///
+/// All storage lives inside the object, so constructing it at session start
+/// is the only allocation. Head and tail sit on their own cache lines, and
+/// each side keeps a private copy of the other side's index so the common
+/// case touches no shared line beyond its own. Capacity must be a power of
+/// two; indices run free and are masked on access, so all Capacity slots are
+/// usable.
+///
+/// Exactly one thread may call the producer methods and exactly one thread
+/// the consumer methods. Both sides are wait-free and safe to call from an
+/// audio callback.
+template <typename T, std::size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "SpscRing slots are copied with plain assignment on the RT path");
+
+public:
+    SpscRing() = default;
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    static constexpr std::size_t capacity() { return Capacity; }
+
+    // ---- producer side -------------------------------------------------
+
+    /// Returns the next free slot for in-place writing, or nullptr when the
+    /// ring is full. The slot becomes visible only after publish().
+    T* writeSlot() {
+        const std::size_t head = head_.value.load(std::memory_order_relaxed);
+        if (head - cachedTail_ == Capacity) {
+            cachedTail_ = tail_.value.load(std::memory_order_acquire);
+            if (head - cachedTail_ == Capacity) {
+                return nullptr;
+            }
+        }
+        return &slots_[head & kMask];
+    }
+
+    /// Makes the slot returned by the last writeSlot() visible to the consumer.
+    void publish() {
+        head_.value.store(head_.value.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+    }
+
+    bool tryPush(const T& item) {
+        T* slot = writeSlot();
+        if (slot == nullptr) {
+            return false;
+        }
+        *slot = item;
+        publish();
+        return true;
+    }
+
+    // ---- consumer side -------------------------------------------------
+
+    /// Returns the oldest published slot for in-place reading, or nullptr
+    /// when the ring is empty. The slot stays owned by the consumer until
+    /// release().
+    const T* readSlot() {
+        const std::size_t tail = tail_.value.load(std::memory_order_relaxed);
+        if (tail == cachedHead_) {
+            cachedHead_ = head_.value.load(std::memory_order_acquire);
+            if (tail == cachedHead_) {
+                return nullptr;
+            }
+        }
+        return &slots_[tail & kMask];
+    }
+
+    /// Hands the slot returned by the last readSlot() back to the producer.
+    void release() {
+        tail_.value.store(tail_.value.load(std::memory_order_relaxed) + 1,
+                          std::memory_order_release);
+    }
+
+    /// Number of published slots the consumer may read right now. Together
+    /// with peek() and release(n) this lets a consumer hand a whole batch to
+    /// one syscall without copying it out of the ring.
+    std::size_t readAvailable() {
+        cachedHead_ = head_.value.load(std::memory_order_acquire);
+        return cachedHead_ - tail_.value.load(std::memory_order_relaxed);
+    }
+
+    /// The i-th readable slot, oldest first. Requires i < readAvailable().
+    const T& peek(std::size_t i) const {
+        return slots_[(tail_.value.load(std::memory_order_relaxed) + i) & kMask];
+    }
+
+    /// Mutable peek: the consumer owns readable slots until it releases
+    /// them, so it may patch one in place (e.g. append a trailer just
+    /// before sending).
+    T& peek(std::size_t i) {
+        return slots_[(tail_.value.load(std::memory_order_relaxed) + i) & kMask];
+    }
+
+    /// Hands the `count` oldest readable slots back to the producer.
+    void release(std::size_t count) {
+        tail_.value.store(tail_.value.load(std::memory_order_relaxed) + count,
+                          std::memory_order_release);
+    }
+
+    bool tryPop(T& out) {
+        const T* slot = readSlot();
+        if (slot == nullptr) {
+            return false;
+        }
+        out = *slot;
+        release();
+        return true;
+    }
+
+    // ---- either side ---------------------------------------------------
+
+    /// Number of published, unreleased slots. Exact when called from either
+    /// endpoint thread about its own side; approximate from anywhere else.
+    std::size_t sizeApprox() const {
+        const std::size_t head = head_.value.load(std::memory_order_acquire);
+        const std::size_t tail = tail_.value.load(std::memory_order_acquire);
+        return head - tail;
+    }
+
+    bool emptyApprox() const { return sizeApprox() == 0; }
+
+private:
+    static constexpr std::size_t kMask = Capacity - 1;
+
+    struct alignas(kCacheLineSize) PaddedIndex {
+        std::atomic<std::size_t> value{0};
+    };
+
+    // Producer-owned: head, and its snapshot of the consumer index on a
+    // separate line so the consumer's acquire loads never see it bounce.
+    PaddedIndex head_;
+    alignas(kCacheLineSize) std::size_t cachedTail_ = 0;
+
+    // Consumer-owned: tail, and its snapshot of the producer index.
+    PaddedIndex tail_;
+    alignas(kCacheLineSize) std::size_t cachedHead_ = 0;
+
+    alignas(kCacheLineSize) std::array<T, Capacity> slots_{};
+
+    static_assert(std::atomic<std::size_t>::is_always_lock_free,
+                  "SpscRing requires lock-free size_t atomics");
+};
+
+/// 16 slots = 40 ms of audio: deep enough to absorb a scheduling hiccup on
+/// either side, small enough that a stalled consumer is noticed quickly.
+inline constexpr std::size_t kFrameRingSlots = 16;
+
+/// Frame ring used between every pair of audio stages on both platforms.
+using FrameRing = SpscRing<AudioFrame, kFrameRingSlots>;
+
+} // namespace aas
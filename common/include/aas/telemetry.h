@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/histogram.h"
+#include "aas/thread_stats.h"
+
+namespace aas {
+
+/// Per-stage timing the UIs and the stats channel show. Each is recorded by
+/// the one thread that owns the stage.
+enum class TelemetryStage : std::uint8_t {
+    kCaptureWait,   ///< Android: capture callback to the frame being picked up
+    kEncode,        ///< Android: encode time per frame
+    kNetwork,       ///< PC: one-way transit above the path's fastest packet
+    kJitterDepth,   ///< PC: jitter buffer depth at each playout, in us of audio
+    kDecode,        ///< PC: decode time per frame
+    kRenderMargin,  ///< PC: audio queued ahead of the device after each period
+    kCount,
+};
+
+inline const char* telemetryStageName(TelemetryStage stage) {
+    static constexpr const char* kNames[] = {"capture_wait", "encode", "network",
+                                             "jitter_depth", "decode", "render_margin"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<std::size_t>(TelemetryStage::kCount),
+                  "one name per stage");
+    return kNames[static_cast<std::size_t>(stage)];
+}
+
+/// Packet outcomes, read from the stages' existing counters when a report
+/// is built.
+enum class TelemetryCounter : std::uint8_t {
+    kReceived,
+    kLate,
+    kLost,
+    kRecoveredByFec,
+    kConcealed,
+    kCount,
+};
+
+using TelemetryCounters = std::array<std::uint64_t, static_cast<std::size_t>(TelemetryCounter::kCount)>;
+
+inline std::uint64_t& counterAt(TelemetryCounters& counters, TelemetryCounter which) {
+    return counters[static_cast<std::size_t>(which)];
+}
+
+inline const char* telemetryCounterName(TelemetryCounter counter) {
+    static constexpr const char* kNames[] = {"received", "late", "lost", "recovered_fec", "concealed"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<std::size_t>(TelemetryCounter::kCount),
+                  "one name per counter");
+    return kNames[static_cast<std::size_t>(counter)];
+}
+
+/// One histogram per stage for one stream. Stages a side does not run stay
+/// empty.
+class StageTelemetry {
+public:
+    static constexpr std::size_t kStages = static_cast<std::size_t>(TelemetryStage::kCount);
+
+    void record(TelemetryStage stage, std::uint64_t us) { histogram(stage).record(us); }
+
+    LatencyHistogram& histogram(TelemetryStage stage) { return stages_[static_cast<std::size_t>(stage)]; }
+    const LatencyHistogram& histogram(TelemetryStage stage) const {
+        return stages_[static_cast<std::size_t>(stage)];
+    }
+
+private:
+    std::array<LatencyHistogram, kStages> stages_;
+};
+
+#pragma pack(push, 1)
+/// Quantile summary of one stage over a report interval.
+struct StageSummary {
+    std::uint32_t count;
+    std::uint32_t p50Us;
+    std::uint32_t p99Us;
+    std::uint32_t p999Us;
+    std::uint32_t maxUs;  ///< lifetime maximum
+};
+
+/// One stats-channel datagram: one stream's summary over the last
+/// interval. Little-endian, like the media header (docs/protocol.md,
+/// Telemetry Channel).
+struct TelemetryReport {
+    std::uint32_t magic;
+    std::uint8_t version;
+    std::uint8_t side;  ///< 0 sender (phone), 1 receiver (PC)
+    std::uint8_t streamId;
+    std::uint8_t reserved;
+    std::uint64_t sessionId;
+    std::uint64_t timestampUs;  ///< reporter's monotonic clock
+    std::uint32_t intervalUs;
+    std::uint32_t deadlineMisses;  ///< all of the reporter's RT threads, this interval
+    std::array<StageSummary, StageTelemetry::kStages> stages;
+    TelemetryCounters counters;  ///< cumulative
+};
+#pragma pack(pop)
+
+inline constexpr std::uint32_t kTelemetryMagic = 0x54534141;  // "AAST"
+inline constexpr std::uint8_t kTelemetryVersion = 1;
+inline constexpr std::size_t kTelemetryReportBytes =
+    32 + sizeof(StageSummary) * StageTelemetry::kStages + sizeof(TelemetryCounters);
+static_assert(sizeof(TelemetryReport) == kTelemetryReportBytes, "report must have no padding");
+
+inline StageSummary summarise(const LatencyHistogram::Snapshot& interval) {
+    StageSummary s{};
+    s.count = static_cast<std::uint32_t>(interval.count);
+    s.p50Us = interval.quantileUs(0.50);
+    s.p99Us = interval.quantileUs(0.99);
+    s.p999Us = interval.quantileUs(0.999);
+    s.maxUs = interval.maxUs;
+    return s;
+}
+
+/// Sum of every registered thread's deadline misses so far.
+inline std::uint64_t totalDeadlineMisses() {
+    const ThreadRegistry& registry = ThreadRegistry::instance();
+    std::uint64_t misses = 0;
+    for (std::size_t i = 0; i < registry.size(); ++i) {
+        misses += registry.at(i).misses.load(std::memory_order_relaxed);
+    }
+    return misses;
+}
+
+/// Turns one stream's StageTelemetry into interval reports. Lives on the UI
+/// or reporting thread, never an RT one: it holds the previous snapshots
+/// (about 10 KiB) to diff against, which is the only thing readers need
+/// beyond the histograms' own atomics.
+class TelemetrySampler {
+public:
+    TelemetrySampler(const StageTelemetry& telemetry, std::uint8_t side, std::uint8_t streamId,
+                     std::uint64_t sessionId)
+        : telemetry_(telemetry) {
+        report_.magic = kTelemetryMagic;
+        report_.version = kTelemetryVersion;
+        report_.side = side;
+        report_.streamId = streamId;
+        report_.sessionId = sessionId;
+    }
+
+    /// Builds the report for the interval since the previous call;
+    /// `counters` are the stages' cumulative counts, in TelemetryCounter
+    /// order.
+    const TelemetryReport& sample(std::uint64_t nowUs, const TelemetryCounters& counters) {
+        for (std::size_t i = 0; i < StageTelemetry::kStages; ++i) {
+            telemetry_.histogram(static_cast<TelemetryStage>(i)).snapshot(current_);
+            report_.stages[i] = summarise(current_.since(previous_[i]));
+            previous_[i] = current_;
+        }
+        const std::uint64_t misses = totalDeadlineMisses();
+        report_.deadlineMisses = static_cast<std::uint32_t>(misses - lastMisses_);
+        lastMisses_ = misses;
+        report_.intervalUs = static_cast<std::uint32_t>(lastUs_ == 0 ? 0 : nowUs - lastUs_);
+        lastUs_ = nowUs;
+        report_.timestampUs = nowUs;
+        report_.counters = counters;
+        return report_;
+    }
+
+    const TelemetryReport& last() const { return report_; }
+
+private:
+    const StageTelemetry& telemetry_;
+    std::array<LatencyHistogram::Snapshot, StageTelemetry::kStages> previous_{};
+    LatencyHistogram::Snapshot current_;
+    TelemetryReport report_{};
+    std::uint64_t lastMisses_ = 0;
+    std::uint64_t lastUs_ = 0;
+};
+
+/// The report as stats-channel datagram bytes.
+inline const std::uint8_t* telemetryBytes(const TelemetryReport& report) {
+    return reinterpret_cast<const std::uint8_t*>(&report);
+}
+
+/// Checks and copies a received stats-channel datagram (the collector side).
+inline bool readTelemetryReport(const std::uint8_t* data, std::size_t size, TelemetryReport& out) {
+    if (size != kTelemetryReportBytes) {
+        return false;
+    }
+    std::memcpy(&out, data, kTelemetryReportBytes);
+    return out.magic == kTelemetryMagic && out.version == kTelemetryVersion;
+}
+
+} // namespace aas
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace aas {
+
+/// Every pipeline thread, on either platform. The RtThread implementations
+/// map each role to a scheduling policy; the stats reader uses it to label
+/// rows.
+enum class ThreadRole : std::uint8_t {
+    kCapture,        ///< Android: Oboe data callback (AAudio's thread)
+    kEncode,
+    kFec,
+    kSend,
+    kNoiseSuppress,  ///< Android: mic-mode RNNoise worker
+    kReceive,        ///< PC: RIO completion loop and dispatch
+    kDecode,         ///< PC: decode pool worker
+    kResample,
+    kRender,         ///< PC: WASAPI render thread or ASIO driver callback
+    kCount,
+};
+
+inline const char* threadRoleName(ThreadRole role) {
+    static constexpr const char* kNames[] = {"capture", "encode", "fec",      "send",   "denoise",
+                                             "receive", "decode", "resample", "render"};
+    static_assert(sizeof(kNames) / sizeof(kNames[0]) == static_cast<std::size_t>(ThreadRole::kCount),
+                  "one name per role");
+    return kNames[static_cast<std::size_t>(role)];
+}
+
+/// How far a thread actually got with its requested scheduling, so a
+/// misconfigured thread shows up in the stats instead of as underruns.
+enum class RtGrant : std::uint8_t {
+    kNone,             ///< Ordinary time-sharing priority
+    kNice,             ///< Raised priority only (Android nice, Windows TIME_CRITICAL)
+    kPerformanceHint,  ///< Android: nice plus an APerformanceHint session
+    kFifo,             ///< Android: SCHED_FIFO
+    kMmcss,            ///< Windows: MMCSS "Pro Audio" task
+    kExternal,         ///< Owned by the audio driver/framework, left as is
+};
+
+/// Per-thread cycle accounting. The owning thread reports every cycle's
+/// active time (wake to going back to sleep); a cycle longer than the
+/// budget is a deadline miss. Relaxed atomics: readers want counts, not a
+/// consistent snapshot.
+struct ThreadStats {
+    std::atomic<ThreadRole> role{ThreadRole::kCount};
+    std::atomic<RtGrant> grant{RtGrant::kNone};
+    std::atomic<int> core{-1};               ///< pinned core, -1 if not pinned
+    std::atomic<std::uint32_t> budgetUs{0};  ///< 0 = no deadline, only counted
+    std::atomic<std::uint64_t> cycles{0};
+    std::atomic<std::uint64_t> misses{0};
+    std::atomic<std::uint32_t> worstUs{0};
+
+    void record(std::uint64_t activeUs) {
+        cycles.fetch_add(1, std::memory_order_relaxed);
+        const auto us = static_cast<std::uint32_t>(activeUs > UINT32_MAX ? UINT32_MAX : activeUs);
+        const std::uint32_t budget = budgetUs.load(std::memory_order_relaxed);
+        if (budget != 0 && us > budget) {
+            misses.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (us > worstUs.load(std::memory_order_relaxed)) {
+            worstUs.store(us, std::memory_order_relaxed);
+        }
+    }
+};
+
+/// Fixed table of every pipeline thread's stats. Threads claim an entry
+/// once at start; entries are never released (a restarted stage claims a
+/// new one), so readers can iterate without locks.
+class ThreadRegistry {
+public:
+    static constexpr std::size_t kMaxThreads = 32;
+
+    static ThreadRegistry& instance() {
+        static ThreadRegistry registry;
+        return registry;
+    }
+
+    /// Returns a fresh entry, or a shared overflow entry when the table is
+    /// full (so callers never need a null check on the RT path).
+    ThreadStats& claim(ThreadRole role, std::uint32_t budgetUs) {
+        const std::size_t index = count_.fetch_add(1, std::memory_order_acq_rel);
+        ThreadStats& stats = index < kMaxThreads ? entries_[index] : overflow_;
+        stats.role.store(role, std::memory_order_relaxed);
+        stats.budgetUs.store(budgetUs, std::memory_order_relaxed);
+        return stats;
+    }
+
+    std::size_t size() const {
+        const std::size_t n = count_.load(std::memory_order_acquire);
+        return n < kMaxThreads ? n : kMaxThreads;
+    }
+    const ThreadStats& at(std::size_t i) const { return entries_[i]; }
+
+private:
+    ThreadRegistry() = default;
+
+    std::array<ThreadStats, kMaxThreads> entries_;
+    ThreadStats overflow_;
+    std::atomic<std::size_t> count_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "aas/datagram.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+/// Clock-exchange message (docs/protocol.md, Clock Synchronisation).
+///
+/// The receiver (PC) is the client: it sends a request carrying t1, the
+/// sender (phone) stamps t2 on arrival and t3 just before transmitting the
+/// response, and the PC stamps t4 on arrival. Responses travel as a trailer
+/// on the next outgoing media datagram, or alone if no media is flowing.
+///
+/// Path probes run the other way (docs/protocol.md, Path Probing): the phone
+/// sends a standalone probe on each transport path with t1 on its clock and
+/// the path id in `reserved`, and the PC echoes it straight back to the
+/// source address with t2/t3 on its own clock.
+///
+/// QoS reports (aas/qos_report.h) share the slot and the kind byte but not
+/// the rest of the layout.
+enum class TimingKind : std::uint8_t {
+    kRequest = 1,
+    kResponse = 2,
+    kProbe = 3,
+    kProbeEcho = 4,
+    kQosReport = 5,
+};
+
+#pragma pack(push, 1)
+struct TimingMessage {
+    TimingKind kind;
+    std::uint8_t reserved;  ///< path id for probes, zero otherwise
+    std::uint16_t pingId;
+    std::uint64_t t1;  ///< receiver clock, request sent
+    std::uint64_t t2;  ///< sender clock, request received
+    std::uint64_t t3;  ///< sender clock, response sent
+};
+#pragma pack(pop)
+
+inline constexpr std::size_t kTimingMessageBytes = 28;
+static_assert(sizeof(TimingMessage) == kTimingMessageBytes, "timing message must have no padding");
+
+/// Writes a datagram holding only `message` (frame units 0 = no audio).
+/// Returns its size.
+inline std::size_t writeTimingDatagram(const TimingMessage& message, std::uint8_t streamId,
+                                       std::uint8_t* out) {
+    PacketHeader header{};
+    header.versionCodec = PacketHeader::packVersionCodec(CodecId::kPcm16);
+    header.flags = kFlagTiming;
+    header.streamId = streamId;
+    header.frameUnits = 0;
+    std::uint8_t* p = writePacketHeader(header, out);
+    std::memcpy(p, &message, kTimingMessageBytes);
+    return kPacketHeaderBytes + kTimingMessageBytes;
+}
+
+/// Appends `message` as the last trailer of a finished datagram and sets
+/// kFlagTiming. The send stage calls this just before transmitting, so t3
+/// is as close to the wire as user space gets.
+inline bool appendTimingTrailer(std::uint8_t* data, std::size_t& size, const TimingMessage& message) {
+    if (size < kPacketHeaderBytes || size + kTimingMessageBytes > kMaxDatagramBytes) {
+        return false;
+    }
+    std::memcpy(data + size, &message, kTimingMessageBytes);
+    size += kTimingMessageBytes;
+    data[offsetof(PacketHeader, flags)] |= kFlagTiming;
+    return true;
+}
+
+/// Removes the timing trailer from a datagram with kFlagTiming, shrinking
+/// `size` and clearing the flag so later stages see a plain datagram.
+inline bool stripTimingTrailer(std::uint8_t* data, std::size_t& size, TimingMessage& out) {
+    if (size < kPacketHeaderBytes + kTimingMessageBytes) {
+        return false;
+    }
+    size -= kTimingMessageBytes;
+    std::memcpy(&out, data + size, kTimingMessageBytes);
+    data[offsetof(PacketHeader, flags)] &= static_cast<std::uint8_t>(~kFlagTiming);
+    return true;
+}
+
+} // namespace aas
@@ -0,0 +1,167 @@
+#include "shared_audio_client.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace aas {
+
+SharedAudioClient::~SharedAudioClient() { close(); }
+
+bool SharedAudioClient::open(const std::wstring& name) {
+    close();
+    mapping_ = ::OpenFileMappingW(FILE_MAP_READ, FALSE, name.c_str());
+    if (mapping_ == nullptr) {
+        lastError_ = ::GetLastError();
+        return false;
+    }
+    view_ = ::MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+    if (view_ == nullptr) {
+        lastError_ = ::GetLastError();
+        close();
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION region{};
+    if (::VirtualQuery(view_, &region, sizeof(region)) == 0 || !reader_.attach(view_, region.RegionSize)) {
+        lastError_ = ERROR_INVALID_DATA;
+        close();
+        return false;
+    }
+    reader_.setLead(lead_);
+    position_ = kFrameSamples;
+    length_ = kFrameSamples;
+    haveLevel_ = false;
+    info_ = {};
+    stats_ = {};
+    lastError_ = 0;
+    return true;
+}
+
+void SharedAudioClient::close() {
+    reader_ = SharedAudioReader();
+    if (view_ != nullptr) {
+        ::UnmapViewOfFile(view_);
+        view_ = nullptr;
+    }
+    if (mapping_ != nullptr) {
+        ::CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+}
+
+void SharedAudioClient::setLead(std::size_t frames) {
+    lead_ = frames;
+    reader_.setLead(frames);
+}
+
+bool SharedAudioClient::nextFrame() {
+    SharedAudioFrameInfo info;
+    const SharedAudioRead result = reader_.read(frame_, info);
+    if (result == SharedAudioRead::kResync) {
+        ++stats_.resyncs;
+        haveLevel_ = false;
+    } else if (result == SharedAudioRead::kOverrun) {
+        ++stats_.overruns;
+        haveLevel_ = false;
+    }
+    if (info.channels == 0) {
+        return false;
+    }
+    info_ = info;
+    position_ = 0;
+    length_ = kFrameSamples;
+    ++stats_.frames;
+
+    // Drift between the phone's clock and the host's is taken up a sample
+    // at a time, so the fill stays within a frame of the target.
+    const double target = targetLevel();
+    if (haveLevel_ && level_ > target + kFrameSamples) {
+        slip(false);
+        ++stats_.dropped;
+    } else if (haveLevel_ && level_ < target - kFrameSamples) {
+        slip(true);
+        ++stats_.inserted;
+    }
+    return true;
+}
+
+void SharedAudioClient::slip(bool insert) {
+    // Reads the frame at a position that moves smoothly by one sample over
+    // kSlipSamples, linearly interpolated, then carries on shifted.
+    const std::size_t channels = info_.channels;
+    float* x = frame_;
+    if (insert) {
+        for (std::size_t i = kFrameSamples; i > kSlipSamples; --i) {
+            std::copy_n(x + (i - 1) * channels, channels, x + i * channels);
+        }
+        for (std::size_t i = kSlipSamples; i > 0; --i) {
+            const float frac = 1.0f - static_cast<float>(i) / kSlipSamples;
+            for (std::size_t ch = 0; ch < channels; ++ch) {
+                const float a = x[(i - 1) * channels + ch];
+                x[i * channels + ch] = a + frac * (x[i * channels + ch] - a);
+            }
+        }
+        length_ = kFrameSamples + 1;
+    } else {
+        for (std::size_t i = 0; i + 1 < kFrameSamples; ++i) {
+            const float frac = i < kSlipSamples ? static_cast<float>(i + 1) / (kSlipSamples + 1) : 1.0f;
+            for (std::size_t ch = 0; ch < channels; ++ch) {
+                const float a = x[i * channels + ch];
+                x[i * channels + ch] = a + frac * (x[(i + 1) * channels + ch] - a);
+            }
+        }
+        length_ = kFrameSamples - 1;
+    }
+}
+
+std::size_t SharedAudioClient::pull(float* out, std::size_t frames, std::size_t channels) {
+    // What will be left once this period is filled, averaged so that only
+    // drift, not the phase between the writer's frames and the host's
+    // periods, moves it.
+    double level = static_cast<double>(reader_.available() * kFrameSamples) +
+                   static_cast<double>(length_ - std::min(position_, length_)) - static_cast<double>(frames);
+    if (level > targetLevel() + static_cast<double>(kSkipAheadFrames * kFrameSamples)) {
+        // Far ahead (the host stalled): skipping is quicker than slipping.
+        level -= static_cast<double>(length_ - std::min(position_, length_));
+        position_ = length_;
+        SharedAudioFrameInfo info;
+        while (level > targetLevel() && reader_.available() != 0) {
+            reader_.read(frame_, info);
+            level -= kFrameSamples;
+            ++stats_.skipped;
+        }
+        haveLevel_ = false;
+    }
+    if (!haveLevel_) {
+        level_ = level;
+        haveLevel_ = reader_.available() != 0;
+    } else {
+        level_ += static_cast<double>(frames) / (kLevelWindowFrames + frames) * (level - level_);
+    }
+
+    std::size_t done = 0;
+    while (done < frames) {
+        if (position_ >= length_ && !nextFrame()) {
+            const std::size_t missing = frames - done;
+            std::memset(out + done * channels, 0, missing * channels * sizeof(float));
+            stats_.underruns += (missing + kFrameSamples - 1) / kFrameSamples;
+            break;
+        }
+        const std::size_t n = std::min(frames - done, length_ - position_);
+        const std::size_t have = std::min<std::size_t>(info_.channels, channels);
+        const float* in = frame_ + position_ * info_.channels;
+        float* dst = out + done * channels;
+        if (have == channels && info_.channels == channels) {
+            std::memcpy(dst, in, n * channels * sizeof(float));
+        } else {
+            for (std::size_t i = 0; i < n; ++i) {
+                std::copy_n(in + i * info_.channels, have, dst + i * channels);
+                std::fill_n(dst + i * channels + have, channels - have, 0.0f);
+            }
+        }
+        position_ += n;
+        done += n;
+    }
+    return done;
+}
+
+} // namespace aas
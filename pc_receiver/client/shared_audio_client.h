@@ -0,0 +1,107 @@
+#pragma once
+
+#include <windows.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "aas/shared_audio.h"
+
+namespace aas {
+
+/// Consumer side of the receiver's shared-memory output (docs/protocol.md,
+/// Shared-Memory Output), for DAW plugins, OBS sources and anything else on
+/// the same PC. Depends on Win32 and aas/shared_audio.h only, so it drops
+/// into a plugin build as these two files.
+///
+/// Two ways to read:
+///   - reader().read() copies whole 2.5 ms frames, one memcpy each, with
+///     their sample clocks, for hosts that resample or align themselves;
+///   - pull() fills a host buffer of any length and channel count, keeping
+///     about lead() + 1 frames in hand. The drift between the phone's
+///     clock and the host's is absorbed a sample at a time: when the fill,
+///     averaged over kLevelWindowFrames, strays more than a frame from
+///     that, the next frame is read one sample shorter or longer, the
+///     position sliding over kSlipSamples so nothing clicks. At ±300 ppm
+///     that is one sample every 28 frames. Only a backlog beyond
+///     kSkipAheadFrames (a stalled host) is skipped as whole frames, and an
+///     empty ring plays silence.
+///
+/// One thread per client, normally the host's audio callback; open() and
+/// close() are not real-time safe.
+class SharedAudioClient {
+public:
+    struct Stats {
+        std::uint64_t frames = 0;     ///< frames taken from the ring
+        std::uint64_t underruns = 0;  ///< frames' worth of silence pull() padded with
+        std::uint64_t dropped = 0;    ///< samples dropped to stay near lead()
+        std::uint64_t inserted = 0;   ///< samples inserted to stay near lead()
+        std::uint64_t skipped = 0;    ///< frames skipped beyond kSkipAheadFrames
+        std::uint64_t resyncs = 0;    ///< writer restarts and sender changes
+        std::uint64_t overruns = 0;   ///< times the client was lapped
+    };
+
+    /// Samples over which a dropped or inserted sample is slid in.
+    static constexpr std::size_t kSlipSamples = 32;
+    /// Averaging window of the fill, in samples (0.5 s).
+    static constexpr double kLevelWindowFrames = 24000.0;
+    /// Frames beyond the target past which the backlog is skipped outright.
+    static constexpr std::size_t kSkipAheadFrames = 8;
+
+    SharedAudioClient() = default;
+    ~SharedAudioClient();
+    SharedAudioClient(const SharedAudioClient&) = delete;
+    SharedAudioClient& operator=(const SharedAudioClient&) = delete;
+
+    /// Maps `name` read-only (the receiver's MultiStreamConfig name plus
+    /// "." and the pipeline slot). False, with the Win32 error, when there
+    /// is no such output or it is not of this version.
+    bool open(const std::wstring& name);
+    void close();
+    bool isOpen() const { return view_ != nullptr; }
+
+    /// Frames kept between the receiver and pull(); 1 (2.5 ms) by default.
+    void setLead(std::size_t frames);
+    std::size_t lead() const { return lead_; }
+
+    /// Fills `frames` interleaved float frames of `channels` at 48 kHz.
+    /// Channels the stream lacks are silent; extra stream channels are
+    /// left out. Returns the frames that carried stream audio.
+    std::size_t pull(float* out, std::size_t frames, std::size_t channels);
+
+    SharedAudioReader& reader() { return reader_; }
+    /// Sample clock of the frame pull() is in, for A/V alignment.
+    std::uint32_t sampleClock() const { return info_.sampleClock; }
+    const Stats& stats() const { return stats_; }
+    DWORD lastError() const { return lastError_; }
+
+private:
+    bool nextFrame();
+    /// Rewrites frame_ one sample longer (`insert`) or shorter.
+    void slip(bool insert);
+    /// Fill, in samples, that pull() steers to: lead() plus one frame,
+    /// which keeps the phase between the writer's frames and the host's
+    /// periods from running it dry.
+    double targetLevel() const { return static_cast<double>((lead_ + 1) * kFrameSamples); }
+
+    HANDLE mapping_ = nullptr;
+    const void* view_ = nullptr;
+    SharedAudioReader reader_;
+    std::size_t lead_ = 1;
+    DWORD lastError_ = 0;
+    Stats stats_;
+
+    // The frame pull() is working through, with room for an inserted
+    // sample.
+    SharedAudioFrameInfo info_{};
+    std::size_t position_ = kFrameSamples;
+    std::size_t length_ = kFrameSamples;
+    float frame_[(kFrameSamples + 1) * kMaxFrameChannels] = {};
+
+    // Fill left after each pull(), in samples, averaged.
+    double level_ = 0.0;
+    bool haveLevel_ = false;
+};
+
+} // namespace aas
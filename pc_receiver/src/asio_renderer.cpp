@@ -0,0 +1,355 @@
+#include "asio_renderer.h"
+
+#include <asiodrivers.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "aas/audio_format.h"
+#include "aas/clock.h"
+
+// Defined by the SDK's asiodrivers.cpp.
+extern AsioDrivers* asioDrivers;
+bool loadAsioDriver(char* name);
+
+namespace aas {
+
+namespace {
+
+constexpr std::size_t kMaxDrivers = 32;
+constexpr std::size_t kDriverNameBytes = 32;
+
+bool toDeviceFormat(ASIOSampleType type, DeviceSampleFormat& out) {
+    switch (type) {
+    case ASIOSTFloat32LSB:
+        out = DeviceSampleFormat::kFloat32;
+        return true;
+    case ASIOSTInt32LSB:
+        out = DeviceSampleFormat::kInt32;
+        return true;
+    case ASIOSTInt24LSB:
+        out = DeviceSampleFormat::kInt24;
+        return true;
+    case ASIOSTInt16LSB:
+        out = DeviceSampleFormat::kInt16;
+        return true;
+    default:
+        // Big-endian and right-justified (Int32LSB16/18/20/24) types are
+        // rare on Windows drivers and not worth a conversion path each.
+        return false;
+    }
+}
+
+/// Smallest size >= `requested` the driver accepts.
+long chooseBufferSize(long requested, long minSize, long maxSize, long preferred, long granularity) {
+    if (granularity == 0 || minSize == maxSize) {
+        return preferred;
+    }
+    const long clamped = std::clamp(requested, minSize, maxSize);
+    if (granularity == -1) {
+        // Powers of two only.
+        long size = minSize;
+        while (size < clamped && size * 2 <= maxSize) {
+            size *= 2;
+        }
+        return size;
+    }
+    const long steps = (clamped - minSize + granularity - 1) / granularity;
+    return std::min(maxSize, minSize + steps * granularity);
+}
+
+} // namespace
+
+AsioRenderer* AsioRenderer::active_ = nullptr;
+
+AsioRenderer::~AsioRenderer() { close(); }
+
+std::vector<std::string> AsioRenderer::drivers() {
+    char storage[kMaxDrivers][kDriverNameBytes] = {};
+    char* names[kMaxDrivers];
+    for (std::size_t i = 0; i < kMaxDrivers; ++i) {
+        names[i] = storage[i];
+    }
+    AsioDrivers list;
+    const long count = list.getDriverNames(names, static_cast<long>(kMaxDrivers));
+    std::vector<std::string> result;
+    for (long i = 0; i < count; ++i) {
+        result.emplace_back(names[i]);
+    }
+    return result;
+}
+
+bool AsioRenderer::open(const AsioConfig& config, RenderSource& source) {
+    close();
+    if (active_ != nullptr) {
+        lastError_ = ASE_NotPresent;
+        return false;
+    }
+    config_ = config;
+    source_ = &source;
+
+    std::vector<char> name(config.driverName.begin(), config.driverName.end());
+    name.push_back('\0');
+    if (!loadAsioDriver(name.data())) {
+        lastError_ = ASE_NotPresent;
+        return false;
+    }
+    ASIODriverInfo info{};
+    info.asioVersion = 2;
+    info.sysRef = ::GetDesktopWindow();
+    lastError_ = ASIOInit(&info);
+    if (lastError_ != ASE_OK) {
+        asioDrivers->removeCurrentDriver();
+        return false;
+    }
+    active_ = this;
+    open_ = true;
+
+    lastError_ = ASIOCanSampleRate(kSampleRateHz);
+    if (lastError_ == ASE_OK) {
+        lastError_ = ASIOSetSampleRate(kSampleRateHz);
+    }
+    if (lastError_ != ASE_OK) {
+        close();
+        return false;
+    }
+
+    long inputs = 0;
+    long outputs = 0;
+    lastError_ = ASIOGetChannels(&inputs, &outputs);
+    if (lastError_ != ASE_OK || outputs <= config.firstChannel) {
+        if (lastError_ == ASE_OK) {
+            lastError_ = ASE_InvalidParameter;
+        }
+        close();
+        return false;
+    }
+    channels_ = static_cast<std::uint16_t>(
+        std::min<long>({config.channels, static_cast<long>(kMaxChannels), outputs - config.firstChannel}));
+
+    long minSize = 0;
+    long maxSize = 0;
+    long preferred = 0;
+    long granularity = 0;
+    lastError_ = ASIOGetBufferSize(&minSize, &maxSize, &preferred, &granularity);
+    if (lastError_ != ASE_OK) {
+        close();
+        return false;
+    }
+    bufferFrames_ = static_cast<std::uint32_t>(
+        chooseBufferSize(static_cast<long>(config.bufferFrames), minSize, maxSize, preferred, granularity));
+
+    if (!createBuffers()) {
+        close();
+        return false;
+    }
+
+    long inputLatency = 0;
+    long outputLatency = 0;
+    if (ASIOGetLatencies(&inputLatency, &outputLatency) == ASE_OK) {
+        outputLatencyUs_ = static_cast<std::uint64_t>(outputLatency) * 1000000u / kSampleRateHz;
+    } else {
+        outputLatencyUs_ = 2ull * bufferFrames_ * 1000000u / kSampleRateHz;
+    }
+    // ASIOOutputReady() tells the driver the half is filled so it can
+    // skip one buffer of output latency; probing it is the documented way
+    // to find out whether the driver supports it.
+    outputReady_ = (ASIOOutputReady() == ASE_OK);
+
+    periodEvent_ = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    scopeReleased_ = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    return true;
+}
+
+bool AsioRenderer::createBuffers() {
+    for (std::size_t ch = 0; ch < channels_; ++ch) {
+        bufferInfos_[ch] = ASIOBufferInfo{};
+        bufferInfos_[ch].isInput = ASIOFalse;
+        bufferInfos_[ch].channelNum = static_cast<long>(config_.firstChannel + ch);
+    }
+    callbacks_.bufferSwitch = &AsioRenderer::onBufferSwitch;
+    callbacks_.sampleRateDidChange = &AsioRenderer::onSampleRateChanged;
+    callbacks_.asioMessage = &AsioRenderer::onMessage;
+    callbacks_.bufferSwitchTimeInfo = &AsioRenderer::onBufferSwitchTimeInfo;
+    lastError_ = ASIOCreateBuffers(bufferInfos_.data(), channels_, static_cast<long>(bufferFrames_),
+                                   &callbacks_);
+    if (lastError_ != ASE_OK) {
+        return false;
+    }
+
+    for (std::size_t ch = 0; ch < channels_; ++ch) {
+        ASIOChannelInfo channel{};
+        channel.channel = bufferInfos_[ch].channelNum;
+        channel.isInput = ASIOFalse;
+        lastError_ = ASIOGetChannelInfo(&channel);
+        DeviceSampleFormat format;
+        if (lastError_ != ASE_OK || !toDeviceFormat(channel.type, format) || (ch > 0 && format != format_)) {
+            if (lastError_ == ASE_OK) {
+                lastError_ = ASE_InvalidMode;
+            }
+            ASIODisposeBuffers();
+            return false;
+        }
+        format_ = format;
+        for (std::size_t half = 0; half < 2; ++half) {
+            halves_[half][ch] = bufferInfos_[ch].buffers[half];
+        }
+    }
+    return true;
+}
+
+bool AsioRenderer::start() {
+    if (!open_ || running_) {
+        return false;
+    }
+    // Both halves start silent; the driver may play one before the first
+    // switch.
+    const std::size_t bytes = bufferFrames_ * bytesPerSample(format_);
+    for (std::size_t half = 0; half < 2; ++half) {
+        for (std::size_t ch = 0; ch < channels_; ++ch) {
+            std::memset(halves_[half][ch], 0, bytes);
+        }
+    }
+    lastIndex_ = -1;
+    // The driver thread's RtScope was released by its last switch in
+    // stop(); the first switch after this one raises whichever thread the
+    // driver now calls back on.
+    releaseScope_.store(false, std::memory_order_release);
+    resetRequested_.store(false, std::memory_order_release);
+    lastError_ = ASIOStart();
+    running_ = (lastError_ == ASE_OK);
+    return running_;
+}
+
+void AsioRenderer::stop() {
+    if (running_) {
+        // The RtScope must end on the thread it raised, so the next switch
+        // releases it before the driver is stopped. A driver that has
+        // stopped calling back leaves it to the switch after start().
+        ::ResetEvent(scopeReleased_);
+        releaseScope_.store(true, std::memory_order_release);
+        if (scopeHeld_.load(std::memory_order_acquire)) {
+            ::WaitForSingleObject(scopeReleased_, kScopeReleaseTimeoutMs);
+        }
+        ASIOStop();
+        running_ = false;
+    }
+}
+
+void AsioRenderer::close() {
+    stop();
+    if (open_) {
+        ASIODisposeBuffers();
+        ASIOExit();
+        asioDrivers->removeCurrentDriver();
+        open_ = false;
+        if (active_ == this) {
+            active_ = nullptr;
+        }
+    }
+    if (periodEvent_ != nullptr) {
+        ::CloseHandle(periodEvent_);
+        periodEvent_ = nullptr;
+    }
+    if (scopeReleased_ != nullptr) {
+        ::CloseHandle(scopeReleased_);
+        scopeReleased_ = nullptr;
+    }
+}
+
+void AsioRenderer::switchBuffers(long index) {
+    const bool releasing = releaseScope_.load(std::memory_order_acquire);
+    const DWORD thread = ::GetCurrentThreadId();
+    if (driverThread_ && driverThreadId_ != thread) {
+        // The scope outlived a stop() the driver never called back for, and
+        // the restarted driver calls on a new thread; the old one is gone.
+        driverThread_.reset();
+        scopeHeld_.store(false, std::memory_order_release);
+    }
+    if (!driverThread_ && !releasing) {
+        // The callback runs on the driver's thread; raise it once. Most
+        // drivers already do this, and a second registration is harmless.
+        RtThreadConfig config;
+        config.role = ThreadRole::kRender;
+        config.budgetUs = static_cast<std::uint32_t>(bufferFrames_ * 1000000ull / kSampleRateHz / 2);
+        config.critical = true;
+        driverThread_.emplace(config);
+        driverThreadId_ = thread;
+        scopeHeld_.store(true, std::memory_order_release);
+    }
+    const std::uint64_t startUs = driverThread_ ? driverThread_->begin() : monotonicMicros();
+    if (index == lastIndex_) {
+        missedSwitches_.fetch_add(1, std::memory_order_relaxed);
+    }
+    lastIndex_ = index;
+
+    PlanarOutput out;
+    out.channels = halves_[static_cast<std::size_t>(index & 1)].data();
+    out.channelCount = channels_;
+    out.format = format_;
+    source_->renderPlanar(out, bufferFrames_, startUs + outputLatencyUs_);
+    if (outputReady_) {
+        ASIOOutputReady();
+    }
+    periods_.fetch_add(1, std::memory_order_relaxed);
+    ::SetEvent(periodEvent_);
+    if (driverThread_) {
+        driverThread_->end(startUs);
+        if (releasing) {
+            // stop() is waiting: end the scope here, on its own thread.
+            driverThread_.reset();
+            scopeHeld_.store(false, std::memory_order_release);
+            ::SetEvent(scopeReleased_);
+        }
+    }
+}
+
+void AsioRenderer::onBufferSwitch(long index, ASIOBool) {
+    if (active_ != nullptr) {
+        active_->switchBuffers(index);
+    }
+}
+
+ASIOTime* AsioRenderer::onBufferSwitchTimeInfo(ASIOTime* time, long index, ASIOBool) {
+    // The driver's system time has timeGetTime() resolution; presentation is
+    // stamped from the monotonic clock in switchBuffers() instead.
+    if (active_ != nullptr) {
+        active_->switchBuffers(index);
+    }
+    return time;
+}
+
+void AsioRenderer::onSampleRateChanged(ASIOSampleRate rate) {
+    if (active_ != nullptr && rate != kSampleRateHz) {
+        active_->resetRequested_.store(true, std::memory_order_release);
+    }
+}
+
+long AsioRenderer::onMessage(long selector, long value, void*, double*) {
+    switch (selector) {
+    case kAsioSelectorSupported:
+        return (value == kAsioResetRequest || value == kAsioEngineVersion || value == kAsioResyncRequest ||
+                value == kAsioLatenciesChanged || value == kAsioSupportsTimeInfo)
+                   ? 1
+                   : 0;
+    case kAsioEngineVersion:
+        return 2;
+    case kAsioResetRequest:
+        // Must not reset from inside the callback; the owner polls this.
+        if (active_ != nullptr) {
+            active_->resetRequested_.store(true, std::memory_order_release);
+        }
+        return 1;
+    case kAsioResyncRequest:
+    case kAsioLatenciesChanged:
+        // Latencies are re-read on the next open(); the drift controller
+        // absorbs a resync.
+        return 1;
+    case kAsioSupportsTimeInfo:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+} // namespace aas
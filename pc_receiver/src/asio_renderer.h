@@ -0,0 +1,130 @@
+#pragma once
+
+#include <windows.h>
+
+// Steinberg ASIO SDK (not redistributable; point the build at a local copy).
+#include <asiosys.h>
+#include <asio.h>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "render_source.h"
+#include "rt_thread.h"
+
+namespace aas {
+
+struct AsioConfig {
+    /// Driver name as listed by AsioRenderer::drivers().
+    std::string driverName;
+    /// Requested half-buffer size; rounded to the driver's granularity.
+    std::uint32_t bufferFrames = 64;
+    std::uint16_t channels = 2;
+    /// First driver output channel to use.
+    std::uint16_t firstChannel = 0;
+};
+
+/// Native ASIO render backend for pro interfaces at 32-64 sample buffers.
+///
+/// The driver's bufferSwitchTimeInfo callback calls the RenderSource's
+/// renderPlanar() straight into the half-buffer being handed over, in the
+/// driver's int32 / int24 / int16 / float format, then calls
+/// ASIOOutputReady() where supported so the driver need not wait for the
+/// next switch. There is no ring or thread between the source and the
+/// driver: at these sizes every hop is a buffer of headroom.
+///
+/// After each switch periodEvent() is signalled, so the decode thread can
+/// wait on it and decode the next frame right behind the driver instead of
+/// on its own timer; frames then reach the decoded-frame ring just ahead of
+/// the switch that consumes them.
+///
+/// The ASIO API has a single driver per process and callbacks without a
+/// user pointer, so only one AsioRenderer may be open at a time.
+class AsioRenderer {
+public:
+    AsioRenderer() = default;
+    ~AsioRenderer();
+    AsioRenderer(const AsioRenderer&) = delete;
+    AsioRenderer& operator=(const AsioRenderer&) = delete;
+
+    /// Installed ASIO drivers.
+    static std::vector<std::string> drivers();
+
+    /// Loads and initialises the driver at 48 kHz and creates the buffers.
+    /// Returns false and records the ASIO error on failure.
+    bool open(const AsioConfig& config, RenderSource& source);
+    bool start();
+    void stop();
+    void close();
+
+    bool isOpen() const { return open_; }
+    std::uint32_t bufferFrames() const { return bufferFrames_; }
+    std::uint16_t channels() const { return channels_; }
+    DeviceSampleFormat format() const { return format_; }
+    /// Driver-reported output latency, in us.
+    std::uint64_t outputLatencyUs() const { return outputLatencyUs_; }
+    ASIOError lastError() const { return lastError_; }
+
+    /// Auto-reset event signalled after every buffer switch.
+    HANDLE periodEvent() const { return periodEvent_; }
+
+    std::uint64_t periods() const { return periods_.load(std::memory_order_relaxed); }
+    /// Switches where the same half was handed over twice in a row: the
+    /// callback missed a period.
+    std::uint64_t missedSwitches() const { return missedSwitches_.load(std::memory_order_relaxed); }
+    /// The driver asked to be reset (buffer size or rate changed in its
+    /// control panel); the owner must close() and open() again.
+    bool resetRequested() const { return resetRequested_.load(std::memory_order_acquire); }
+
+private:
+    static constexpr std::size_t kMaxChannels = RenderSource::kMaxPlanarChannels;
+    /// How long stop() waits for a switch to release the driver thread's
+    /// RtScope; many periods at any buffer size.
+    static constexpr DWORD kScopeReleaseTimeoutMs = 100;
+
+    static void onBufferSwitch(long index, ASIOBool processNow);
+    static ASIOTime* onBufferSwitchTimeInfo(ASIOTime* time, long index, ASIOBool processNow);
+    static void onSampleRateChanged(ASIOSampleRate rate);
+    static long onMessage(long selector, long value, void* message, double* opt);
+
+    void switchBuffers(long index);
+    bool createBuffers();
+
+    RenderSource* source_ = nullptr;
+    AsioConfig config_;
+    bool open_ = false;
+    bool running_ = false;
+    bool outputReady_ = false;
+    // Created and destroyed on the driver callback thread only: it outlives
+    // start() and is released by the first switch after stop() asks.
+    std::optional<RtScope> driverThread_;
+    DWORD driverThreadId_ = 0;
+    std::uint32_t bufferFrames_ = 0;
+    std::uint16_t channels_ = 0;
+    DeviceSampleFormat format_ = DeviceSampleFormat::kInt32;
+    std::uint64_t outputLatencyUs_ = 0;
+    ASIOError lastError_ = ASE_OK;
+    long lastIndex_ = -1;
+    HANDLE periodEvent_ = nullptr;
+    HANDLE scopeReleased_ = nullptr;  // set by the switch that released driverThread_
+
+    ASIOCallbacks callbacks_{};
+    std::array<ASIOBufferInfo, kMaxChannels> bufferInfos_{};
+    // Per half: the channel pointers handed to renderPlanar().
+    std::array<std::array<void*, kMaxChannels>, 2> halves_{};
+
+    std::atomic<std::uint64_t> periods_{0};
+    std::atomic<std::uint64_t> missedSwitches_{0};
+    std::atomic<bool> resetRequested_{false};
+    std::atomic<bool> releaseScope_{false};  // stop() -> next switch
+    std::atomic<bool> scopeHeld_{false};
+
+    static AsioRenderer* active_;
+};
+
+} // namespace aas
@@ -0,0 +1,189 @@
+#include "clock_sync.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace aas {
+
+namespace {
+
+/// Timestamping floor: syscall and scheduling noise on either end.
+constexpr double kBaseNoiseUs = 30.0;
+/// Random walk of the offset beyond what skew explains, us^2 per second.
+constexpr double kOffsetWanderUs2PerSec = 4.0;
+/// Random walk of the skew, ppm^2 per second (crystal temperature drift).
+constexpr double kSkewWanderPpm2PerSec = 1e-4;
+/// Initial skew uncertainty: crystals are specified to +-100 ppm.
+constexpr double kInitialSkewSigmaPpm = 100.0;
+/// Doubt on a remembered skew: temperature moves a crystal a few ppm.
+constexpr double kHintSkewSigmaPpm = 5.0;
+/// Innovation gate in standard deviations.
+constexpr double kGateSigmas = 5.0;
+
+} // namespace
+
+ClockSync::ClockSync() { reset(); }
+
+void ClockSync::reset() {
+    nextPingId_ = 0;
+    nextRequestUs_ = 0;
+    requestsSent_ = 0;
+    responses_ = 0;
+    sentUs_.fill(0);
+    sentId_.fill(0);
+    rttCount_ = 0;
+    rttNext_ = 0;
+    seeded_ = false;
+    best_ = Sample{0.0, 1e18, 0};
+    rejects_ = 0;
+    x0_ = x1_ = 0.0;
+    p00_ = p01_ = p11_ = 0.0;
+    stateUs_ = 0;
+    published_.store(ClockEstimate{});
+}
+
+std::size_t ClockSync::pollRequest(std::uint64_t nowUs, std::uint8_t streamId, std::uint8_t* out) {
+    if (nowUs < nextRequestUs_) {
+        return 0;
+    }
+    const bool handshake = requestsSent_ < kHandshakeExchanges;
+    nextRequestUs_ = nowUs + (handshake ? kHandshakeSpacingUs : kTrackingIntervalUs);
+
+    TimingMessage message{};
+    message.kind = TimingKind::kRequest;
+    message.pingId = nextPingId_++;
+    message.t1 = nowUs;
+    const std::size_t slot = message.pingId % sentUs_.size();
+    sentUs_[slot] = nowUs;
+    sentId_[slot] = message.pingId;
+    ++requestsSent_;
+    return writeTimingDatagram(message, streamId, out);
+}
+
+void ClockSync::onResponse(const TimingMessage& message, std::uint64_t t4Us) {
+    if (message.kind != TimingKind::kResponse) {
+        return;
+    }
+    const std::size_t slot = message.pingId % sentUs_.size();
+    if (sentId_[slot] != message.pingId || sentUs_[slot] != message.t1 || t4Us < message.t1) {
+        return;  // stale or forged echo
+    }
+    sentUs_[slot] = 0;
+
+    // t1/t4 on the receiver clock, t2/t3 on the sender clock.
+    const double t1 = static_cast<double>(message.t1);
+    const double t2 = static_cast<double>(message.t2);
+    const double t3 = static_cast<double>(message.t3);
+    const double t4 = static_cast<double>(t4Us);
+    Sample sample;
+    sample.offsetUs = ((t1 - t2) + (t4 - t3)) / 2.0;
+    sample.rttUs = std::max(0.0, (t4 - t1) - (t3 - t2));
+    sample.atUs = t4Us;
+
+    rtts_[rttNext_] = sample.rttUs;
+    rttNext_ = (rttNext_ + 1) % kRttWindow;
+    rttCount_ = std::min(rttCount_ + 1, kRttWindow);
+    ++responses_;
+
+    if (!seeded_) {
+        if (sample.rttUs < best_.rttUs) {
+            best_ = sample;
+        }
+        if (responses_ >= kHandshakeExchanges) {
+            seed(best_);
+        }
+        return;
+    }
+    update(sample);
+}
+
+double ClockSync::minRtt() const {
+    double best = 1e18;
+    for (std::size_t i = 0; i < rttCount_; ++i) {
+        best = std::min(best, rtts_[i]);
+    }
+    return best;
+}
+
+void ClockSync::seed(const Sample& sample) {
+    x0_ = sample.offsetUs;
+    x1_ = haveSkewHint_ ? skewHintPpm_ : 0.0;
+    const double sigma = kBaseNoiseUs + sample.rttUs / 2.0;
+    p00_ = sigma * sigma;
+    p01_ = 0.0;
+    const double skewSigma = haveSkewHint_ ? kHintSkewSigmaPpm : kInitialSkewSigmaPpm;
+    p11_ = skewSigma * skewSigma;
+    stateUs_ = sample.atUs;
+    seeded_ = true;
+    rejects_ = 0;
+    publish(true);
+}
+
+void ClockSync::update(const Sample& sample) {
+    // Predict to the sample time. Skew is in us per second, so dt is in s.
+    const double dt = (static_cast<double>(sample.atUs) - static_cast<double>(stateUs_)) / 1e6;
+    if (dt > 0.0) {
+        x0_ += x1_ * dt;
+        const double q0 = kOffsetWanderUs2PerSec * dt + kSkewWanderPpm2PerSec * dt * dt * dt / 3.0;
+        const double q01 = kSkewWanderPpm2PerSec * dt * dt / 2.0;
+        const double q1 = kSkewWanderPpm2PerSec * dt;
+        const double n00 = p00_ + 2.0 * dt * p01_ + dt * dt * p11_ + q0;
+        const double n01 = p01_ + dt * p11_ + q01;
+        const double n11 = p11_ + q1;
+        p00_ = n00;
+        p01_ = n01;
+        p11_ = n11;
+        stateUs_ = sample.atUs;
+    }
+
+    // Path asymmetry can be at most half the RTT excess over the floor.
+    const double excess = std::max(0.0, sample.rttUs - minRtt());
+    const double sigma = kBaseNoiseUs + excess / 2.0;
+    const double r = sigma * sigma;
+
+    const double innovation = sample.offsetUs - x0_;
+    const double s = p00_ + r;
+    if (innovation * innovation > kGateSigmas * kGateSigmas * s) {
+        // A run of rejects means the clock really stepped (sender restart,
+        // suspend): start over from the next handshake.
+        if (++rejects_ >= kMaxConsecutiveRejects) {
+            reset();
+        }
+        return;
+    }
+    rejects_ = 0;
+
+    const double k0 = p00_ / s;
+    const double k1 = p01_ / s;
+    x0_ += k0 * innovation;
+    x1_ += k1 * innovation;
+    const double n00 = (1.0 - k0) * p00_;
+    const double n01 = (1.0 - k0) * p01_;
+    const double n11 = p11_ - k1 * p01_;
+    p00_ = n00;
+    p01_ = n01;
+    p11_ = n11;
+    publish(true);
+}
+
+void ClockSync::publish(bool locked) {
+    ClockEstimate estimate;
+    estimate.offsetUs = x0_;
+    estimate.skewPpm = x1_;
+    estimate.refUs = stateUs_;
+    estimate.uncertaintyUs = std::sqrt(std::max(0.0, p00_));
+    estimate.minRttUs = rttCount_ > 0 ? minRtt() : 0.0;
+    estimate.locked = locked;
+    published_.store(estimate);
+}
+
+std::uint64_t ClockSync::senderToReceiverUs(std::uint64_t senderUs) const {
+    const ClockEstimate e = estimate();
+    // Offset is a function of receiver time; one fixed-point step is exact
+    // to well under a nanosecond at any realistic skew.
+    const double approx = static_cast<double>(senderUs) + e.offsetUs;
+    const double offset = e.offsetUs + e.skewPpm * (approx - static_cast<double>(e.refUs)) / 1e6;
+    return static_cast<std::uint64_t>(static_cast<double>(senderUs) + offset);
+}
+
+} // namespace aas
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/seqlock.h"
+#include "aas/timing.h"
+
+namespace aas {
+
+/// Snapshot of the sender-to-receiver clock mapping.
+struct ClockEstimate {
+    /// receiver time - sender time, at receiver time refUs.
+    double offsetUs = 0.0;
+    /// Rate of change of the offset, in microseconds per second (= ppm).
+    double skewPpm = 0.0;
+    std::uint64_t refUs = 0;
+    /// One standard deviation of offsetUs.
+    double uncertaintyUs = 0.0;
+    /// Minimum round trip seen recently; a floor on the achievable error.
+    double minRttUs = 0.0;
+    bool locked = false;
+};
+
+/// In-band clock synchronisation against one sender, run by the PC's
+/// receive thread.
+///
+/// A burst of kHandshakeExchanges NTP-style exchanges at session start seeds
+/// the estimate from the lowest-RTT sample; after that one exchange every
+/// kTrackingIntervalUs keeps it current, with the phone's reply riding on a
+/// media datagram. Each sample feeds a two-state Kalman filter (offset and
+/// skew). A sample's noise is taken from how far its round trip exceeds the
+/// recent minimum, since that excess bounds how asymmetric the path could
+/// have been; clean exchanges therefore pull hard, queued ones barely move
+/// the estimate, and wild outliers are gated out.
+///
+/// pollRequest() and onResponse() belong to the receive thread.
+/// estimate() and senderToReceiverUs() may be called from any thread; the
+/// drift resampler and the latency report both read from here.
+class ClockSync {
+public:
+    static constexpr std::size_t kHandshakeExchanges = 8;
+    static constexpr std::uint64_t kHandshakeSpacingUs = 5000;
+    static constexpr std::uint64_t kTrackingIntervalUs = 250000;
+
+    ClockSync();
+
+    /// Writes a request datagram into `out` (kMaxDatagramBytes) when one is
+    /// due and returns its size, 0 otherwise.
+    std::size_t pollRequest(std::uint64_t nowUs, std::uint8_t streamId, std::uint8_t* out);
+
+    /// Feeds a response received at receiver time `t4Us`.
+    void onResponse(const TimingMessage& message, std::uint64_t t4Us);
+
+    ClockEstimate estimate() const { return published_.load(); }
+
+    /// Maps a sender monotonic timestamp to the receiver clock.
+    std::uint64_t senderToReceiverUs(std::uint64_t senderUs) const;
+
+    void reset();
+
+    /// Skew remembered from an earlier session with the same phone
+    /// (PairingProfile::clockSkewPpm). The handshake then starts the filter
+    /// at this skew with a few ppm of doubt instead of zero with 100, so
+    /// the offset stays put from the first seconds on. Survives reset().
+    void setSkewHint(double skewPpm) {
+        skewHintPpm_ = skewPpm;
+        haveSkewHint_ = true;
+    }
+
+private:
+    static constexpr std::size_t kRttWindow = 64;
+    static constexpr int kMaxConsecutiveRejects = 8;
+
+    struct Sample {
+        double offsetUs;
+        double rttUs;
+        std::uint64_t atUs;
+    };
+
+    void seed(const Sample& sample);
+    void update(const Sample& sample);
+    double minRtt() const;
+    void publish(bool locked);
+
+    std::uint16_t nextPingId_ = 0;
+    std::uint64_t nextRequestUs_ = 0;
+    std::size_t requestsSent_ = 0;
+    std::size_t responses_ = 0;
+
+    // Outstanding request send times by ping id, to reject stale echoes.
+    std::array<std::uint64_t, 16> sentUs_{};
+    std::array<std::uint16_t, 16> sentId_{};
+
+    std::array<double, kRttWindow> rtts_{};
+    std::size_t rttCount_ = 0;
+    std::size_t rttNext_ = 0;
+
+    bool seeded_ = false;
+    bool haveSkewHint_ = false;
+    double skewHintPpm_ = 0.0;
+    Sample best_{};
+    int rejects_ = 0;
+
+    // Kalman state: offset (us), skew (us/s), covariance.
+    double x0_ = 0.0;
+    double x1_ = 0.0;
+    double p00_ = 0.0;
+    double p01_ = 0.0;
+    double p11_ = 0.0;
+    std::uint64_t stateUs_ = 0;
+
+    SeqLock<ClockEstimate> published_;
+};
+
+} // namespace aas
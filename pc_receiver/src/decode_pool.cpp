@@ -0,0 +1,98 @@
+#include "decode_pool.h"
+
+#include <timeapi.h>
+
+#include <algorithm>
+
+#include "aas/clock.h"
+
+namespace aas {
+
+namespace {
+
+constexpr DWORD kServiceIntervalMs = 1;
+/// Cores held back for interrupts and the receive thread when choosing
+/// defaults.
+constexpr unsigned kReservedCores = 2;
+
+} // namespace
+
+DecodePool::~DecodePool() { stop(); }
+
+bool DecodePool::start(const std::vector<StreamPipeline*>& pipelines, const DecodePoolConfig& config) {
+    stop();
+    if (pipelines.empty()) {
+        return false;
+    }
+
+    const unsigned hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> cores = config.cores;
+    if (cores.empty()) {
+        for (unsigned c = std::min(kReservedCores, hardware - 1); c < hardware; ++c) {
+            cores.push_back(c);
+        }
+    }
+    std::size_t count = config.workers;
+    if (count == 0) {
+        count = std::min(pipelines.size(), cores.size());
+    }
+    count = std::max<std::size_t>(1, std::min(count, pipelines.size()));
+
+    for (std::size_t i = 0; i < count; ++i) {
+        auto worker = std::make_unique<Worker>();
+        worker->event = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        worker->core = cores[i % cores.size()];
+        workers_.push_back(std::move(worker));
+    }
+    for (std::size_t i = 0; i < pipelines.size(); ++i) {
+        workers_[i % count]->streams.push_back(pipelines[i]);
+    }
+
+    // 1 ms service ticks need the 1 ms system timer.
+    timerRaised_ = (::timeBeginPeriod(1) == TIMERR_NOERROR);
+    running_.store(true, std::memory_order_release);
+    for (auto& worker : workers_) {
+        RtThreadConfig rt;
+        rt.role = ThreadRole::kDecode;
+        rt.budgetUs = kServiceIntervalMs * 1000;
+        rt.core = static_cast<int>(worker->core);
+        Worker* w = worker.get();
+        worker->thread.start(rt, [this, w](RtScope& scope) { run(*w, scope); });
+    }
+    return true;
+}
+
+void DecodePool::stop() {
+    running_.store(false, std::memory_order_release);
+    for (auto& worker : workers_) {
+        if (worker->thread.joinable()) {
+            ::SetEvent(worker->event);
+            worker->thread.join();
+        }
+        ::CloseHandle(worker->event);
+    }
+    workers_.clear();
+    if (timerRaised_) {
+        ::timeEndPeriod(1);
+        timerRaised_ = false;
+    }
+}
+
+void DecodePool::wake(std::size_t index) {
+    if (!workers_.empty()) {
+        ::SetEvent(workers_[index % workers_.size()]->event);
+    }
+}
+
+void DecodePool::run(Worker& worker, RtScope& rt) {
+    while (running_.load(std::memory_order_acquire)) {
+        ::WaitForSingleObject(worker.event, kServiceIntervalMs);
+        const std::uint64_t nowUs = rt.begin();
+        for (StreamPipeline* stream : worker.streams) {
+            stream->service(nowUs);
+        }
+        rt.end(nowUs);
+    }
+}
+
+} // namespace aas
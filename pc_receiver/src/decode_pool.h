@@ -0,0 +1,63 @@
+#pragma once
+
+#include <windows.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "rt_thread.h"
+#include "stream_pipeline.h"
+
+namespace aas {
+
+struct DecodePoolConfig {
+    /// Worker threads; 0 = one per stream, capped at the cores available
+    /// after the receive and render threads.
+    std::size_t workers = 0;
+    /// Logical cores to pin workers to, in order; empty = cores 2.. (core 0
+    /// takes most interrupts, core 1 is left to the receive thread).
+    std::vector<unsigned> cores;
+};
+
+/// Fixed pool of decode workers, each pinned to one core, with streams
+/// statically partitioned across them (stream i goes to worker i % N).
+///
+/// A stream is only ever serviced by its own worker, so pipelines need no
+/// locks and stay warm in that core's cache; CPU grows with the number of
+/// active streams rather than with thread count. Workers wake when the
+/// dispatcher has delivered packets for one of their streams and at least
+/// every millisecond to keep the decoded rings topped up. A pass over the
+/// worker's streams that takes longer than that tick is a deadline miss.
+class DecodePool {
+public:
+    DecodePool() = default;
+    ~DecodePool();
+    DecodePool(const DecodePool&) = delete;
+    DecodePool& operator=(const DecodePool&) = delete;
+
+    bool start(const std::vector<StreamPipeline*>& pipelines, const DecodePoolConfig& config);
+    void stop();
+
+    /// Dispatch thread: packets arrived for pipeline `index`.
+    void wake(std::size_t index);
+
+    std::size_t workerCount() const { return workers_.size(); }
+
+private:
+    struct Worker {
+        RtThread thread;
+        HANDLE event = nullptr;
+        unsigned core = 0;
+        std::vector<StreamPipeline*> streams;
+    };
+
+    void run(Worker& worker, RtScope& rt);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> running_{false};
+    bool timerRaised_ = false;
+};
+
+} // namespace aas
@@ -0,0 +1,283 @@
+#include "drift_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "aas/sample_format.h"
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define AAS_RESAMPLER_SSE 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define AAS_RESAMPLER_NEON 1
+#endif
+
+namespace aas {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+constexpr double kCutoff = 0.46;     // fraction of the sample rate (22.08 kHz)
+constexpr double kKaiserBeta = 7.0;  // ~70 dB stopband
+
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 32; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/// Interpolated filter for fraction `frac` of the way from row `a` to row
+/// `b`, dotted against each channel's history starting at `base`. A
+/// template on the channel count so the per-tap channel loop unrolls and
+/// the accumulators stay in registers.
+template <std::size_t Channels>
+inline void dotTaps(const float* a, const float* b, float frac, const float* const* rows, std::size_t base,
+                    float* out) {
+#if defined(AAS_RESAMPLER_SSE)
+    const __m128 f = _mm_set1_ps(frac);
+    __m128 acc[Channels];
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        acc[ch] = _mm_setzero_ps();
+    }
+    for (std::size_t k = 0; k < DriftResampler::kTaps; k += 4) {
+        const __m128 ca = _mm_load_ps(a + k);
+        const __m128 cb = _mm_load_ps(b + k);
+        const __m128 c = _mm_add_ps(ca, _mm_mul_ps(f, _mm_sub_ps(cb, ca)));
+        for (std::size_t ch = 0; ch < Channels; ++ch) {
+            acc[ch] = _mm_add_ps(acc[ch], _mm_mul_ps(c, _mm_loadu_ps(rows[ch] + base + k)));
+        }
+    }
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        __m128 v = acc[ch];
+        v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+        v = _mm_add_ss(v, _mm_shuffle_ps(v, v, 0x55));
+        out[ch] = _mm_cvtss_f32(v);
+    }
+#elif defined(AAS_RESAMPLER_NEON)
+    const float32x4_t f = vdupq_n_f32(frac);
+    float32x4_t acc[Channels];
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        acc[ch] = vdupq_n_f32(0.0f);
+    }
+    for (std::size_t k = 0; k < DriftResampler::kTaps; k += 4) {
+        const float32x4_t ca = vld1q_f32(a + k);
+        const float32x4_t c = vmlaq_f32(ca, f, vsubq_f32(vld1q_f32(b + k), ca));
+        for (std::size_t ch = 0; ch < Channels; ++ch) {
+            acc[ch] = vmlaq_f32(acc[ch], c, vld1q_f32(rows[ch] + base + k));
+        }
+    }
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        const float32x2_t half = vadd_f32(vget_low_f32(acc[ch]), vget_high_f32(acc[ch]));
+        out[ch] = vget_lane_f32(vpadd_f32(half, half), 0);
+    }
+#else
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        float sum = 0.0f;
+        for (std::size_t k = 0; k < DriftResampler::kTaps; ++k) {
+            sum += (a[k] + frac * (b[k] - a[k])) * rows[ch][base + k];
+        }
+        out[ch] = sum;
+    }
+#endif
+}
+
+} // namespace
+
+// ---- DriftController -----------------------------------------------------
+
+double DriftController::update(double fillErrorSamples, double dtSec) {
+    if (!primed_) {
+        smoothed_ = fillErrorSamples;
+        primed_ = true;
+    } else {
+        const double alpha = dtSec / (gains_.smoothingSec + dtSec);
+        smoothed_ += alpha * (fillErrorSamples - smoothed_);
+    }
+
+    const double limit = kMaxCorrectionPpm * 1e-6;
+    const double proportional = gains_.kp * smoothed_;
+    integral_ += gains_.ki * smoothed_ * dtSec;
+    // Anti-windup: the integral alone may never ask for more than the clamp.
+    integral_ = std::clamp(integral_, -limit, limit);
+
+    ratio_ = 1.0 + std::clamp(proportional + integral_, -limit, limit);
+    return ratio_;
+}
+
+double DriftController::hold() {
+    primed_ = false;
+    smoothed_ = 0.0;
+    ratio_ = 1.0 + integral_;
+    return ratio_;
+}
+
+void DriftController::reset() {
+    primed_ = false;
+    smoothed_ = 0.0;
+    integral_ = 0.0;
+    ratio_ = 1.0;
+}
+
+void DriftController::seed(double driftPpm) {
+    const double limit = kMaxCorrectionPpm * 1e-6;
+    integral_ = std::clamp(driftPpm * 1e-6, -limit, limit);
+    ratio_ = 1.0 + integral_;
+}
+
+// ---- DriftResampler ------------------------------------------------------
+
+DriftResampler::DriftResampler(std::size_t channels, std::size_t maxBufferedFrames)
+    : channels_(std::clamp<std::size_t>(channels, 1, kMaxFrameChannels)),
+      capacity_(kTaps + maxBufferedFrames * kFrameSamples),
+      history_(channels_ * capacity_, 0.0f),
+      // One spare row for interpolation past the last phase, plus slack so
+      // the table can start on a 16-byte boundary.
+      table_((kPhases + 1) * kTaps + 4, 0.0f) {
+    float* rows = table_.data();
+    while (reinterpret_cast<std::uintptr_t>(rows) % 16 != 0) {
+        ++rows;
+    }
+    phases_ = rows;
+
+    const double half = static_cast<double>(kTaps) / 2.0;
+    const double norm = besselI0(kKaiserBeta);
+    for (std::size_t p = 0; p <= kPhases; ++p) {
+        const double frac = static_cast<double>(p) / kPhases;
+        float* row = rows + p * kTaps;
+        double sum = 0.0;
+        for (std::size_t k = 0; k < kTaps; ++k) {
+            // Distance from tap k to the output position, in input samples.
+            const double d = static_cast<double>(k) - static_cast<double>(kLead) - frac;
+            const double x = 2.0 * kCutoff * d;
+            const double sinc = (x == 0.0) ? 1.0 : std::sin(kPi * x) / (kPi * x);
+            const double r = d / half;
+            const double window = (std::fabs(r) >= 1.0)
+                                      ? 0.0
+                                      : besselI0(kKaiserBeta * std::sqrt(1.0 - r * r)) / norm;
+            const double c = 2.0 * kCutoff * sinc * window;
+            row[k] = static_cast<float>(c);
+            sum += c;
+        }
+        // Unity DC gain at every phase, so a slowly moving ratio cannot
+        // modulate the level.
+        for (std::size_t k = 0; k < kTaps; ++k) {
+            row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+    reset();
+}
+
+std::size_t DriftResampler::storageBytes(std::size_t channels, std::size_t maxBufferedFrames) {
+    const std::size_t rows = std::clamp<std::size_t>(channels, 1, kMaxFrameChannels);
+    const std::size_t history = rows * (kTaps + maxBufferedFrames * kFrameSamples);
+    const std::size_t table = (kPhases + 1) * kTaps + 4;
+    // Plus alignment padding for each of the two vectors.
+    return (history + table) * sizeof(float) + 2 * kCacheLineSize;
+}
+
+void DriftResampler::reset() {
+    std::fill(history_.begin(), history_.end(), 0.0f);
+    // kLead zeros in front of the first real sample, so the first output is
+    // centred on it and the filter never reads before the buffer.
+    writePos_ = kLead;
+    position_ = static_cast<std::uint64_t>(kLead) << kFracBits;
+}
+
+void DriftResampler::setRatio(double ratio) {
+    ratio_ = ratio;
+    step_ = static_cast<std::uint64_t>(std::llround(ratio * static_cast<double>(1ull << kFracBits)));
+}
+
+double DriftResampler::bufferedSamples() const {
+    const double pos = static_cast<double>(position_) / static_cast<double>(1ull << kFracBits);
+    return static_cast<double>(writePos_) - pos;
+}
+
+void DriftResampler::compact() {
+    const std::size_t readIndex = static_cast<std::size_t>(position_ >> kFracBits);
+    if (readIndex <= kLead) {
+        return;
+    }
+    const std::size_t drop = readIndex - kLead;
+    const std::size_t keep = writePos_ - drop;
+    for (std::size_t ch = 0; ch < channels_; ++ch) {
+        float* row = history_.data() + ch * capacity_;
+        std::memmove(row, row + drop, keep * sizeof(float));
+    }
+    writePos_ = keep;
+    position_ -= static_cast<std::uint64_t>(drop) << kFracBits;
+}
+
+bool DriftResampler::push(const AudioFrame& frame) {
+    if (writePos_ + kFrameSamples > capacity_) {
+        compact();
+        if (writePos_ + kFrameSamples > capacity_) {
+            return false;
+        }
+    }
+    const std::size_t inChannels = frame.channels;
+    if (inChannels == channels_) {
+        float* rows[kMaxFrameChannels];
+        for (std::size_t ch = 0; ch < channels_; ++ch) {
+            rows[ch] = history_.data() + ch * capacity_ + writePos_;
+        }
+        withChannelCount(channels_, [&](auto n) {
+            deinterleave<decltype(n)::value>(frame.samples, rows, kFrameSamples);
+        });
+        writePos_ += kFrameSamples;
+        return true;
+    }
+    for (std::size_t ch = 0; ch < channels_; ++ch) {
+        float* row = history_.data() + ch * capacity_ + writePos_;
+        // A mono frame feeds every output channel.
+        const std::size_t src = (ch < inChannels) ? ch : 0;
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            row[i] = frame.samples[i * inChannels + src];
+        }
+    }
+    writePos_ += kFrameSamples;
+    return true;
+}
+
+std::size_t DriftResampler::pull(float* out, std::size_t frames) {
+    std::size_t produced = 0;
+    withChannelCount(channels_, [&](auto n) { produced = pullChannels<decltype(n)::value>(out, frames); });
+    return produced;
+}
+
+template <std::size_t Channels>
+std::size_t DriftResampler::pullChannels(float* out, std::size_t frames) {
+    const float* rows[Channels];
+    for (std::size_t ch = 0; ch < Channels; ++ch) {
+        rows[ch] = history_.data() + ch * capacity_;
+    }
+    const float* table = phases_;
+
+    constexpr std::uint32_t kInterpBits = kFracBits - kPhaseBits;
+    constexpr float kInterpScale = 1.0f / static_cast<float>(1u << kInterpBits);
+
+    std::size_t produced = 0;
+    while (produced < frames) {
+        const std::size_t index = static_cast<std::size_t>(position_ >> kFracBits);
+        // The filter reaches kTaps/2 samples past the read index.
+        if (index + kTaps / 2 >= writePos_) {
+            break;
+        }
+        const auto frac = static_cast<std::uint32_t>(position_);
+        const std::uint32_t phase = frac >> kInterpBits;
+        const float blend = static_cast<float>(frac & ((1u << kInterpBits) - 1)) * kInterpScale;
+        dotTaps<Channels>(table + phase * kTaps, table + (phase + 1) * kTaps, blend, rows, index - kLead,
+                          out + produced * Channels);
+        position_ += step_;
+        ++produced;
+    }
+    return produced;
+}
+
+} // namespace aas
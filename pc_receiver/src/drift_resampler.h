@@ -0,0 +1,129 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/rt_arena.h"
+
+namespace aas {
+
+/// PI controller that turns the receiver's buffer position error into a
+/// resampling ratio.
+///
+/// The error (FrameRingSource's playout slip, in samples) is quantised to
+/// whole frames and jumps around with network jitter, so it is low-passed
+/// before use. The proportional term settles
+/// the level; the integral term converges on the actual clock ratio so that
+/// at steady state the correction holds without a standing error. The ratio
+/// is clamped to +-kMaxCorrectionPpm, and because it moves smoothly over
+/// seconds there is no audible pitch wobble.
+class DriftController {
+public:
+    static constexpr double kMaxCorrectionPpm = 1000.0;
+
+    struct Gains {
+        double kp = 6.0e-6;     ///< ratio per sample of error
+        double ki = 6.0e-7;     ///< ratio per sample-second of error
+        double smoothingSec = 0.5;
+    };
+
+    DriftController() = default;
+    explicit DriftController(const Gains& gains) : gains_(gains) {}
+
+    /// Feeds one fill measurement taken `dtSec` after the previous one and
+    /// returns the input/output ratio to apply (above 1 consumes faster).
+    double update(double fillErrorSamples, double dtSec);
+
+    /// For stretches where no error can be measured: drops the
+    /// proportional term and the smoothed error, keeping the ratio at the
+    /// integrator's estimate. The next update() starts smoothing afresh.
+    double hold();
+
+    double ratio() const { return ratio_; }
+    /// Current estimate of the sender/device clock mismatch.
+    double driftPpm() const { return (ratio_ - 1.0) * 1e6; }
+    void reset();
+
+    /// Preloads the integrator with an externally measured drift so the loop
+    /// starts near lock instead of integrating up from zero. ClockSync's
+    /// skew gives this directly: a sender clock running slow by N ppm
+    /// against the PC (skewPpm = +N) wants driftPpm = -N, assuming the
+    /// output device and the PC's monotonic clock share a crystal.
+    void seed(double driftPpm);
+
+private:
+    Gains gains_;
+    bool primed_ = false;
+    double smoothed_ = 0.0;
+    double integral_ = 0.0;
+    double ratio_ = 1.0;
+};
+
+/// Asynchronous sample-rate converter between the decoder's 48 kHz stream
+/// (phone clock) and the output device (PC clock).
+///
+/// A 24-tap Kaiser-windowed sinc is tabulated at 256 phases; the filter for
+/// an arbitrary fractional position is interpolated linearly between the two
+/// nearest phases, so the ratio can change every sample without a
+/// discontinuity. Group delay is half the filter, 12 samples (0.25 ms).
+/// History is stored planar so the tap loop is a straight SIMD dot product
+/// (SSE on x86, NEON on ARM, scalar otherwise), and the loop is compiled
+/// once per channel count (1-8) so the channels unroll.
+///
+/// All buffers are sized in the constructor (from the current RtArena when
+/// there is one); push() and pull() never allocate. One thread (the render thread) owns an instance.
+class DriftResampler {
+public:
+    static constexpr std::size_t kTaps = 24;
+    static constexpr std::size_t kPhases = 256;
+    static constexpr std::size_t kGroupDelaySamples = kTaps / 2;
+
+    explicit DriftResampler(std::size_t channels, std::size_t maxBufferedFrames = 8);
+
+    /// Bytes the constructor allocates, for sizing the session RtArena.
+    static std::size_t storageBytes(std::size_t channels, std::size_t maxBufferedFrames);
+
+    void setRatio(double ratio);
+
+    double ratio() const { return ratio_; }
+
+    /// Appends one decoded frame. Returns false if the history is full.
+    bool push(const AudioFrame& frame);
+
+    /// Produces up to `frames` interleaved output frames into `out` and
+    /// returns how many it could make from the buffered input.
+    std::size_t pull(float* out, std::size_t frames);
+
+    /// Input samples buffered ahead of the current read position, including
+    /// the fractional part. This is the resampler's contribution to the
+    /// fill level the DriftController regulates.
+    double bufferedSamples() const;
+
+    std::size_t channels() const { return channels_; }
+    void reset();
+
+private:
+    static constexpr std::uint32_t kFracBits = 32;
+    static constexpr std::uint32_t kPhaseBits = 8;
+    static_assert((1u << kPhaseBits) == kPhases, "phase table size must match phase bits");
+    static constexpr std::size_t kLead = kTaps / 2 - 1;
+
+    void compact();
+    /// pull() for a fixed channel count; pull() picks the instance once
+    /// per call.
+    template <std::size_t Channels>
+    std::size_t pullChannels(float* out, std::size_t frames);
+
+    std::size_t channels_;
+    std::size_t capacity_;
+    ArenaVector<float> history_;      // channels_ planar rows of capacity_
+    ArenaVector<float> table_;        // backing store for phases_
+    const float* phases_ = nullptr;   // (kPhases + 1) rows of kTaps, 16-byte aligned
+    std::size_t writePos_ = 0;
+    std::uint64_t position_ = 0;      // read position, 32.32 fixed point
+    std::uint64_t step_ = 1ull << kFracBits;
+    double ratio_ = 1.0;
+};
+
+} // namespace aas
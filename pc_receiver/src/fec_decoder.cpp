@@ -0,0 +1,276 @@
+#include "fec_decoder.h"
+
+#include <cstring>
+
+#include "aas/aggregate.h"
+
+namespace aas {
+
+namespace {
+
+inline int seqDelta(std::uint16_t a, std::uint16_t b) {
+    return static_cast<std::int16_t>(static_cast<std::uint16_t>(a - b));
+}
+
+} // namespace
+
+bool FecDecoder::onDatagram(const std::uint8_t* data, std::size_t size, std::uint64_t arrivalUs,
+                            JitterBuffer& jitter) {
+    PacketHeader header;
+    if (!readPacketHeader(data, size, header)) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (header.frameUnits == 0) {
+        // Control traffic (standalone timing messages); normally consumed
+        // by the receive stage before it gets here.
+        return false;
+    }
+    if (header.hasFlag(kFlagTrace)) {
+        TraceTrailer trailer;
+        if (!stripTraceTrailer(data, size, trailer)) {
+            stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        if (trace_ != nullptr) {
+            const std::uint64_t callbackUs = trailer.captureUs + trailer.callbackDeltaUs;
+            trace_->record(TraceStage::kCaptureHw, header.sampleClock, trailer.captureUs);
+            trace_->record(TraceStage::kCaptureCallback, header.sampleClock, callbackUs);
+            trace_->record(TraceStage::kEncodeDone, header.sampleClock,
+                           callbackUs + trailer.encodeDeltaUs);
+            trace_->record(TraceStage::kReceived, header.sampleClock, arrivalUs);
+            if (header.hasFlag(kFlagMarker)) {
+                trace_->record(TraceStage::kMarkerInjected, header.sampleClock, trailer.captureUs);
+            }
+        }
+    }
+    const std::uint8_t* payload = data + kPacketHeaderBytes;
+    const std::size_t payloadSize = size - kPacketHeaderBytes;
+
+    if (header.hasFlag(kFlagSilence)) {
+        // DTX descriptors travel outside parity groups and redundancy.
+        jitter.insertSilence(header.seq, header.sampleClock, arrivalUs, payload, payloadSize);
+    } else if (header.hasFlag(kFlagFecParity)) {
+        onParity(header, payload, payloadSize, jitter);
+    } else {
+        onMedia(header, payload, payloadSize, arrivalUs, jitter);
+    }
+    return true;
+}
+
+void FecDecoder::onMedia(const PacketHeader& header, const std::uint8_t* payload, std::size_t size,
+                         std::uint64_t arrivalUs, JitterBuffer& jitter) {
+    const std::uint8_t* primary = payload;
+    std::size_t primarySize = size;
+    const std::uint8_t* redundant = nullptr;
+    std::size_t redundantSize = 0;
+
+    if (header.hasFlag(kFlagRedundant)) {
+        std::uint16_t length = 0;
+        if (size < kRedundancyPrefixBytes) {
+            stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        std::memcpy(&length, payload, sizeof(length));
+        if (length > size - kRedundancyPrefixBytes) {
+            stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        primary = payload + kRedundancyPrefixBytes;
+        primarySize = length;
+        redundant = primary + primarySize;
+        redundantSize = size - kRedundancyPrefixBytes - primarySize;
+    }
+
+    if (primarySize > kMaxPayloadBytes || redundantSize > kMaxPayloadBytes) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const bool aggregate = header.hasFlag(kFlagAggregate);
+    if (!deliver(header.seq, header.sampleClock, header.frameUnits, aggregate, primary, primarySize,
+                 arrivalUs, false, jitter)) {
+        return;
+    }
+    remember(header.seq, header.sampleClock, primary, primarySize);
+
+    if (redundantSize > 0) {
+        // The copy is of the previous packet, which had the same shape.
+        const auto previousSeq = static_cast<std::uint16_t>(header.seq - header.frameUnits);
+        if (awaitingAny(previousSeq, header.frameUnits, jitter)) {
+            const std::uint32_t previousClock =
+                header.sampleClock - static_cast<std::uint32_t>(kFrameSamples * header.frameUnits);
+            if (deliver(previousSeq, previousClock, header.frameUnits, aggregate, redundant, redundantSize,
+                        0, true, jitter)) {
+                remember(previousSeq, previousClock, redundant, redundantSize);
+                stats_.recoveredByRedundancy.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    for (PendingParity& pending : pending_) {
+        if (!pending.valid) {
+            continue;
+        }
+        const int units = parityFrameUnits(pending.header.shape);
+        const int offset = seqDelta(header.seq, pending.baseSeq);
+        if (offset >= 0 && offset < pending.header.groupSize * units && offset % units == 0 &&
+            tryRecover(pending, jitter)) {
+            pending.valid = false;
+        }
+    }
+}
+
+bool FecDecoder::deliver(std::uint16_t seq, std::uint32_t sampleClock, std::uint8_t units, bool aggregate,
+                         const std::uint8_t* payload, std::size_t size, std::uint64_t arrivalUs,
+                         bool recovered, JitterBuffer& jitter) {
+    AggregateView frames;
+    if (units > kMaxPacketFrameUnits ||
+        (aggregate && (!parseAggregate(payload, size, frames) || frames.count != units))) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    bool stored = false;
+    for (std::uint8_t i = 0; i < units; ++i) {
+        const auto slotSeq = static_cast<std::uint16_t>(seq + i);
+        const std::uint32_t slotClock = sampleClock + static_cast<std::uint32_t>(kFrameSamples * i);
+        // An aggregate's frames each fill one slot; a longer codec frame
+        // is stored whole in every slot it covers.
+        const std::uint8_t* data = aggregate ? frames.frames[i] : payload;
+        const std::size_t bytes = aggregate ? frames.sizes[i] : size;
+        const std::uint8_t slotUnits = aggregate ? 1 : units;
+        const std::uint8_t part = aggregate ? 0 : i;
+        const InsertResult result =
+            recovered ? jitter.insertRecovered(slotSeq, slotClock, data, bytes, slotUnits, part)
+                      : jitter.insert(slotSeq, slotClock, arrivalUs, data, bytes, slotUnits, part);
+        stored |= result == InsertResult::kStored || result == InsertResult::kReset;
+    }
+    return recovered ? stored : true;
+}
+
+bool FecDecoder::awaitingAny(std::uint16_t seq, std::uint8_t units, const JitterBuffer& jitter) const {
+    for (std::uint8_t i = 0; i < units; ++i) {
+        if (jitter.awaiting(static_cast<std::uint16_t>(seq + i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FecDecoder::onParity(const PacketHeader& header, const std::uint8_t* payload, std::size_t size,
+                          JitterBuffer& jitter) {
+    if (size < kFecParityHeaderBytes) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    FecParityHeader parity;
+    std::memcpy(&parity, payload, kFecParityHeaderBytes);
+    const std::size_t bytes = size - kFecParityHeaderBytes;
+    if (parity.groupSize < kMinParityGroup || parity.groupSize > kMaxParityGroup ||
+        bytes > kMaxPayloadBytes) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    stats_.parityReceived.fetch_add(1, std::memory_order_relaxed);
+
+    // Oldest pending group is evicted; by the time four newer parity
+    // packets have arrived its frames are long past playout.
+    PendingParity& pending = pending_[nextPending_];
+    nextPending_ = (nextPending_ + 1) % kPendingGroups;
+    pending.valid = true;
+    pending.baseSeq = header.seq;
+    pending.header = parity;
+    pending.size = static_cast<std::uint16_t>(bytes);
+    std::memcpy(pending.bytes, payload + kFecParityHeaderBytes, bytes);
+
+    if (tryRecover(pending, jitter)) {
+        pending.valid = false;
+    }
+}
+
+bool FecDecoder::tryRecover(PendingParity& pending, JitterBuffer& jitter) {
+    const std::uint8_t units = parityFrameUnits(pending.header.shape);
+    const bool aggregate = (pending.header.shape & kParityShapeAggregate) != 0;
+    int missing = 0;
+    std::uint16_t missingSeq = 0;
+    for (std::uint8_t i = 0; i < pending.header.groupSize; ++i) {
+        const auto seq = static_cast<std::uint16_t>(pending.baseSeq + i * units);
+        if (lookup(seq) == nullptr) {
+            ++missing;
+            missingSeq = seq;
+        }
+    }
+    if (missing == 0) {
+        return true;
+    }
+    if (missing > 1) {
+        // Keep waiting for stragglers unless every missing frame is
+        // already behind playout.
+        for (std::uint8_t i = 0; i < pending.header.groupSize; ++i) {
+            const auto seq = static_cast<std::uint16_t>(pending.baseSeq + i * units);
+            if (lookup(seq) == nullptr && awaitingAny(seq, units, jitter)) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if (!awaitingAny(missingSeq, units, jitter)) {
+        stats_.recoveredTooLate.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::uint8_t rebuilt[kMaxPayloadBytes];
+    std::memcpy(rebuilt, pending.bytes, pending.size);
+    std::uint16_t length = pending.header.lengthXor;
+    std::uint32_t sampleClock = pending.header.sampleClockXor;
+    for (std::uint8_t i = 0; i < pending.header.groupSize; ++i) {
+        const HistoryEntry* entry = lookup(static_cast<std::uint16_t>(pending.baseSeq + i * units));
+        if (entry == nullptr) {
+            continue;
+        }
+        if (entry->size > pending.size) {
+            stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        xorInto(rebuilt, entry->bytes, entry->size);
+        length ^= entry->size;
+        sampleClock ^= entry->sampleClock;
+    }
+    if (length > pending.size) {
+        stats_.malformed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    if (deliver(missingSeq, sampleClock, units, aggregate, rebuilt, length, 0, true, jitter)) {
+        remember(missingSeq, sampleClock, rebuilt, length);
+        stats_.recoveredByParity.fetch_add(1, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void FecDecoder::remember(std::uint16_t seq, std::uint32_t sampleClock, const std::uint8_t* payload,
+                          std::size_t size) {
+    HistoryEntry& entry = history_[seq % kHistory];
+    entry.valid = true;
+    entry.seq = seq;
+    entry.size = static_cast<std::uint16_t>(size);
+    entry.sampleClock = sampleClock;
+    std::memcpy(entry.bytes, payload, size);
+}
+
+const FecDecoder::HistoryEntry* FecDecoder::lookup(std::uint16_t seq) const {
+    const HistoryEntry& entry = history_[seq % kHistory];
+    return (entry.valid && entry.seq == seq) ? &entry : nullptr;
+}
+
+void FecDecoder::reset() {
+    for (HistoryEntry& entry : history_) {
+        entry.valid = false;
+    }
+    for (PendingParity& pending : pending_) {
+        pending.valid = false;
+    }
+    nextPending_ = 0;
+}
+
+} // namespace aas
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/fec_format.h"
+#include "aas/latency_trace.h"
+#include "aas/packet_header.h"
+#include "jitter_buffer.h"
+
+namespace aas {
+
+struct FecDecoderStats {
+    std::atomic<std::uint64_t> parityReceived{0};
+    std::atomic<std::uint64_t> recoveredByParity{0};
+    std::atomic<std::uint64_t> recoveredByRedundancy{0};
+    /// Repairs that became possible only after playout had passed the frame.
+    std::atomic<std::uint64_t> recoveredTooLate{0};
+    std::atomic<std::uint64_t> malformed{0};
+};
+
+/// Receiver half of the FEC stage: sits between the receive ring and the
+/// jitter buffer on the decode thread.
+///
+/// Media packets are unwrapped (the primary frame goes to the jitter buffer
+/// and the redundant copy of the previous packet fills its slots if they are
+/// still missing) and remembered in a short history. Packets covering
+/// several 2.5 ms slots, micro-batched aggregates or longer codec frames,
+/// are split here so the jitter buffer and playout only ever see slots.
+/// Parity packets wait in a few pending slots until their group is down to
+/// exactly one missing packet, which is then rebuilt from the history. Repairs go through
+/// JitterBuffer::insertRecovered() and only while the frame is still ahead
+/// of playout, so nothing recovered ever arrives after its deadline.
+class FecDecoder {
+public:
+    /// Parses one received datagram and routes it into `jitter`. Returns
+    /// false for datagrams that are not valid media or parity packets.
+    bool onDatagram(const std::uint8_t* data, std::size_t size, std::uint64_t arrivalUs,
+                    JitterBuffer& jitter);
+
+    /// Latency test mode: sender timestamps from trace trailers, arrival
+    /// times and marker starts are recorded here. Null disables.
+    void setTrace(LatencyTrace* trace) { trace_ = trace; }
+
+    const FecDecoderStats& stats() const { return stats_; }
+
+    /// Forgets history and pending parity, e.g. when the sender restarts.
+    /// Counters are kept.
+    void reset();
+
+private:
+    static constexpr std::size_t kHistory = 64;
+    static constexpr std::size_t kPendingGroups = 4;
+
+    struct HistoryEntry {
+        bool valid = false;
+        std::uint16_t seq = 0;
+        std::uint16_t size = 0;
+        std::uint32_t sampleClock = 0;
+        std::uint8_t bytes[kMaxPayloadBytes];
+    };
+
+    struct PendingParity {
+        bool valid = false;
+        std::uint16_t baseSeq = 0;
+        FecParityHeader header{};
+        std::uint16_t size = 0;
+        std::uint8_t bytes[kMaxPayloadBytes];
+    };
+
+    void onMedia(const PacketHeader& header, const std::uint8_t* payload, std::size_t size,
+                 std::uint64_t arrivalUs, JitterBuffer& jitter);
+    void onParity(const PacketHeader& header, const std::uint8_t* payload, std::size_t size,
+                  JitterBuffer& jitter);
+    /// Routes one media payload (live, or rebuilt when `recovered`) into
+    /// the slots it covers: an aggregate's frames one per slot, a longer
+    /// codec frame once per slot. Live packets return false only when
+    /// malformed; recovered ones return whether anything was stored.
+    bool deliver(std::uint16_t seq, std::uint32_t sampleClock, std::uint8_t units, bool aggregate,
+                 const std::uint8_t* payload, std::size_t size, std::uint64_t arrivalUs, bool recovered,
+                 JitterBuffer& jitter);
+    /// True while any slot of the packet starting at `seq` is awaited.
+    bool awaitingAny(std::uint16_t seq, std::uint8_t units, const JitterBuffer& jitter) const;
+    /// Returns true when the pending group is finished with (recovered,
+    /// complete or too late) and its slot can be freed.
+    bool tryRecover(PendingParity& pending, JitterBuffer& jitter);
+    void remember(std::uint16_t seq, std::uint32_t sampleClock, const std::uint8_t* payload,
+                  std::size_t size);
+    const HistoryEntry* lookup(std::uint16_t seq) const;
+
+    std::array<HistoryEntry, kHistory> history_{};
+    std::array<PendingParity, kPendingGroups> pending_{};
+    std::size_t nextPending_ = 0;
+    LatencyTrace* trace_ = nullptr;
+    FecDecoderStats stats_;
+};
+
+} // namespace aas
@@ -0,0 +1,148 @@
+#include "frame_ring_source.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace aas {
+
+namespace {
+
+/// Room for the whole ring plus one period so a full ring never blocks the
+/// top-up.
+std::size_t resamplerFrames(std::size_t maxPeriodFrames) {
+    return kFrameRingSlots + maxPeriodFrames / kFrameSamples + 2;
+}
+
+} // namespace
+
+FrameRingSource::FrameRingSource(FrameRing& decoded, std::size_t channels, std::size_t maxPeriodFrames)
+    : decoded_(decoded),
+      resampler_(channels, resamplerFrames(maxPeriodFrames)),
+      scratch_(maxPeriodFrames * resampler_.channels(), 0.0f) {}
+
+std::size_t FrameRingSource::storageBytes(std::size_t channels, std::size_t maxPeriodFrames) {
+    const std::size_t rows = std::clamp<std::size_t>(channels, 1, kMaxFrameChannels);
+    return DriftResampler::storageBytes(channels, resamplerFrames(maxPeriodFrames)) +
+           maxPeriodFrames * rows * sizeof(float) + kCacheLineSize;
+}
+
+void FrameRingSource::render(float* out, std::size_t frames, std::size_t channels,
+                             std::uint64_t presentUs) {
+    frames = std::min(frames, scratch_.size() / resampler_.channels());
+    if (seedPending_) {
+        controller_.seed(driftSeedPpm_.load(std::memory_order_relaxed));
+        resampler_.setRatio(controller_.ratio());
+        seedPending_ = false;
+    }
+
+    // Top up to what this period consumes plus the filter's look-ahead;
+    // anything beyond stays in the ring for the next period.
+    const double needed = static_cast<double>(frames) * resampler_.ratio() + DriftResampler::kTaps;
+    while (resampler_.bufferedSamples() < needed) {
+        const AudioFrame* frame = decoded_.readSlot();
+        if (frame == nullptr) {
+            break;
+        }
+        const double aheadSamples = resampler_.bufferedSamples() + DriftResampler::kGroupDelaySamples;
+        if (!resampler_.push(*frame)) {
+            break;
+        }
+        if (trace_ != nullptr) {
+            const double aheadUs = aheadSamples / resampler_.ratio() * 1e6 / kSampleRateHz;
+            trace_->record(TraceStage::kPresented, frame->sampleClock,
+                           presentUs + static_cast<std::uint64_t>(std::max(0.0, aheadUs)));
+        }
+        decoded_.release();
+    }
+
+    const std::size_t srcChannels = resampler_.channels();
+    const std::size_t produced = resampler_.pull(scratch_.data(), frames);
+    if (produced < frames) {
+        std::memset(scratch_.data() + produced * srcChannels, 0,
+                    (frames - produced) * srcChannels * sizeof(float));
+        underrunFrames_ += frames - produced;
+    }
+    const double demand = needed - resampler_.bufferedSamples();
+    demandSamples_.store(demand > 0.0 ? static_cast<std::size_t>(std::ceil(demand)) : 0,
+                         std::memory_order_relaxed);
+
+    // Device channels beyond the stream's are silent unless a map routes
+    // them; a mono stream was already spread to every resampler channel on
+    // push().
+    const ChannelMap map = haveChannelMap_ ? channelMap_ : ChannelMap::forChannels(srcChannels, channels);
+    if (!remapChannels(scratch_.data(), srcChannels, out, channels, frames, map)) {
+        for (std::size_t i = 0; i < frames; ++i) {
+            for (std::size_t ch = 0; ch < channels; ++ch) {
+                out[i * channels + ch] = (ch < srcChannels) ? scratch_[i * srcChannels + ch] : 0.0f;
+            }
+        }
+    }
+
+    double fill = resampler_.bufferedSamples() + static_cast<double>(decoded_.sizeApprox() * kFrameSamples);
+    if (telemetry_ != nullptr) {
+        telemetry_->record(TelemetryStage::kRenderMargin,
+                           static_cast<std::uint64_t>(fill / resampler_.ratio() * 1e6 / kSampleRateHz));
+    }
+    const double dtSec = static_cast<double>(frames) / kSampleRateHz;
+    if (jitterStats_ == nullptr) {
+        resampler_.setRatio(controller_.update(fill - targetFill_, dtSec));
+        return;
+    }
+
+    // Audio from the newest arrival to the DAC, with the jitter buffer's own
+    // stretches and compressions and this side's underruns counted back out:
+    // what is left moves only with the two clocks. The depth alone would not
+    // do, since expand and accelerate already hold it near the target and
+    // where in that deadband it sits depends on the jitter, not the drift.
+    const JitterBufferStats& jitter = *jitterStats_;
+    const double depth = jitter.currentDepthFrames.load(std::memory_order_relaxed);
+    const double stretched = static_cast<double>(jitter.expanded.load(std::memory_order_relaxed)) -
+                             static_cast<double>(jitter.accelerated.load(std::memory_order_relaxed));
+    const double slip = fill + (depth - stretched) * kFrameSamples - static_cast<double>(underrunFrames_);
+    const std::uint64_t restarts = jitter.restarts.load(std::memory_order_relaxed);
+    if (restarts != jitterRestarts_) {
+        // A restart threw the buffered audio away; that is a step, not
+        // drift, so the slip is measured afresh and the integrator kept.
+        jitterRestarts_ = restarts;
+        haveSlipRef_ = false;
+    }
+    if (jitter.inDtx.load(std::memory_order_relaxed)) {
+        // Nothing arrives in a DTX gap, so the slip runs down however the
+        // clocks are doing. Play on at the drift estimate and measure
+        // afresh from the first speech.
+        resampler_.setRatio(controller_.hold());
+        haveSlipRef_ = false;
+        return;
+    }
+    if (!haveSlipRef_) {
+        // Anchored on the first period that played in full; the loop holds
+        // the position it had there.
+        if (produced < frames) {
+            return;
+        }
+        slipRefSamples_ = slip;
+        meanSlipSamples_ = 0.0;
+        haveSlipRef_ = true;
+    }
+    // A stall empties the output long before its backlog lands; clamping
+    // each sample to a frame keeps that dip from kicking the integrator,
+    // while drift moves the slip by only tens of samples a second.
+    const double error = std::clamp(slip - slipRefSamples_, -static_cast<double>(kFrameSamples),
+                                    static_cast<double>(kFrameSamples));
+    meanSlipSamples_ += dtSec / (kSlipWindowSec + dtSec) * (error - meanSlipSamples_);
+    resampler_.setRatio(controller_.update(meanSlipSamples_, dtSec));
+}
+
+void FrameRingSource::reset() {
+    while (decoded_.readSlot() != nullptr) {
+        decoded_.release();
+    }
+    resampler_.reset();
+    controller_.reset();
+    resampler_.setRatio(1.0);
+    seedPending_ = true;
+    haveSlipRef_ = false;
+}
+
+} // namespace aas
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/latency_trace.h"
+#include "aas/telemetry.h"
+#include "aas/rt_arena.h"
+#include "aas/sample_format.h"
+#include "aas/spsc_ring.h"
+#include "drift_resampler.h"
+#include "jitter_buffer.h"
+#include "render_source.h"
+
+namespace aas {
+
+/// RenderSource that plays the decoded-frame ring through the drift
+/// resampler.
+///
+/// Each render() moves just enough frames from the ring into the resampler
+/// to cover the period and pulls it. What stays queued stays in the ring, so
+/// the decode side can treat the ring's fill as demand.
+///
+/// The DriftController slaves the output device's clock to the phone's
+/// instead of letting drift pile up in the jitter buffer. With the jitter
+/// buffer's stats attached it is driven by the playout slip alone: the
+/// audio held from the newest arrival to the DAC (jitter buffer depth, ring
+/// and resampler), less the frames the buffer itself stretched or compressed
+/// and the samples this side rendered as silence, averaged over
+/// kSlipWindowSec and held where it stood when playback started, the buffer
+/// last restarted or the last DTX gap ended; through a gap the ratio stays
+/// at the integrator's estimate. Without them the ring and resampler fill is
+/// regulated to setTargetFillSamples(). An empty ring renders silence for
+/// the missing tail; playout keeps its cadence.
+///
+/// With a LatencyTrace attached it records TraceStage::kPresented for each
+/// frame as it enters the resampler, from the period's presentation time
+/// plus the output still ahead of that frame.
+class FrameRingSource final : public RenderSource {
+public:
+    /// Time constant of the playout slip's mean. Jitter moves the depth by
+    /// several frames from one packet to the next; drift moves it by one
+    /// frame every few seconds.
+    static constexpr double kSlipWindowSec = 2.0;
+
+    /// `maxPeriodFrames` bounds the device period render() is called with.
+    FrameRingSource(FrameRing& decoded, std::size_t channels, std::size_t maxPeriodFrames);
+
+    /// Bytes the constructor allocates, for sizing the session RtArena.
+    static std::size_t storageBytes(std::size_t channels, std::size_t maxPeriodFrames);
+
+    void setTrace(LatencyTrace* trace) { trace_ = trace; }
+    /// Records kRenderMargin (audio still queued after each period) here.
+    void setTelemetry(StageTelemetry* telemetry) { telemetry_ = telemetry; }
+    /// Fill level the controller regulates to, in samples (ring +
+    /// resampler), while no jitter buffer stats are attached.
+    void setTargetFillSamples(double samples) { targetFill_ = samples; }
+    /// Jitter buffer whose playout slip drives the controller. Its stats
+    /// are atomics, so the decode thread may own the buffer itself.
+    void setJitterStats(const JitterBufferStats* stats) { jitterStats_ = stats; }
+    DriftController& controller() { return controller_; }
+    /// Drift the loop starts from on the first render() and after every
+    /// reset(), e.g. where it settled last session
+    /// (PairingProfile::driftPpm). Any thread.
+    void setDriftSeedPpm(double driftPpm) { driftSeedPpm_.store(driftPpm, std::memory_order_relaxed); }
+    /// Routes stream channels to device channels. Without one the stream's
+    /// channels go to the first device channels in WAVE order. Every source
+    /// must be below the stream's channel count. Set before rendering
+    /// starts; devices with more than kMaxFrameChannels ignore it.
+    void setChannelMap(const ChannelMap& map) {
+        channelMap_ = map;
+        haveChannelMap_ = true;
+    }
+
+    /// Drops everything queued and restarts the drift loop. Render thread.
+    void reset();
+
+    void render(float* out, std::size_t frames, std::size_t channels, std::uint64_t presentUs) override;
+
+    std::uint64_t underrunFrames() const { return underrunFrames_; }
+    /// Samples the next period, if as long as the last, will take from the
+    /// ring beyond what the resampler already holds; the decode side keeps
+    /// that much decoded. Any thread.
+    std::size_t demandSamples() const { return demandSamples_.load(std::memory_order_relaxed); }
+
+private:
+    FrameRing& decoded_;
+    DriftResampler resampler_;
+    DriftController controller_;
+    ArenaVector<float> scratch_;
+    LatencyTrace* trace_ = nullptr;
+    StageTelemetry* telemetry_ = nullptr;
+    const JitterBufferStats* jitterStats_ = nullptr;
+    double targetFill_ = 2.0 * kFrameSamples;
+    std::atomic<double> driftSeedPpm_{0.0};
+    bool seedPending_ = true;
+    ChannelMap channelMap_{};
+    bool haveChannelMap_ = false;
+    std::uint64_t underrunFrames_ = 0;
+    std::atomic<std::size_t> demandSamples_{0};
+    bool haveSlipRef_ = false;
+    std::uint64_t jitterRestarts_ = 0;
+    double slipRefSamples_ = 0.0;
+    double meanSlipSamples_ = 0.0;
+};
+
+} // namespace aas
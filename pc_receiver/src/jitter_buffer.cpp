@@ -0,0 +1,353 @@
+#include "jitter_buffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace aas {
+
+namespace {
+
+constexpr std::int64_t kNoTransit = std::numeric_limits<std::int64_t>::max();
+
+/// Signed distance a - b on the 16-bit sequence circle.
+inline int seqDelta(std::uint16_t a, std::uint16_t b) {
+    return static_cast<std::int16_t>(static_cast<std::uint16_t>(a - b));
+}
+
+inline std::size_t framesForDelay(std::uint32_t delayUs) {
+    // The frame being played counts towards the depth, and playout phase
+    // against arrivals averages half a frame, so the delay itself is all
+    // that needs covering.
+    return (delayUs + kFrameDurationUs - 1) / kFrameDurationUs;
+}
+
+/// How far the covered delay must fall below the next frame down before
+/// the target may shrink, so a quantile sitting on a frame boundary does
+/// not flip the target back and forth.
+constexpr std::uint32_t kShrinkMarginUs = kFrameDurationUs / 2;
+
+} // namespace
+
+JitterBuffer::JitterBuffer(const JitterBufferConfig& config) : config_(config) {
+    targetFrames_ = std::clamp(config_.initialDepthFrames, config_.minDepthFrames,
+                               config_.maxDepthFrames);
+    reset();
+}
+
+void JitterBuffer::reset() {
+    for (Slot& slot : slots_) {
+        slot.occupied = false;
+    }
+    started_ = false;
+    prefilled_ = false;
+    inDtx_ = false;
+    haveClock_ = false;
+    windowMinUs_.fill(kNoTransit);
+    windowBucketEndUs_ = 0;
+    windowBucket_ = 0;
+    excessSinceUs_ = 0;
+    consecutiveExpands_ = 0;
+    framesSinceExpand_ = 0;
+    growthFrames_ = 0;
+    publishStats();
+}
+
+void JitterBuffer::start(std::uint16_t seq) {
+    started_ = true;
+    prefilled_ = false;
+    nextSeq_ = seq;
+    highestSeq_ = seq;
+}
+
+bool JitterBuffer::has(std::uint16_t seq) const {
+    const Slot& slot = slots_[seq & kMask];
+    return slot.occupied && slot.packet.seq == seq;
+}
+
+const BufferedPacket* JitterBuffer::peek(std::uint16_t seq) const {
+    return has(seq) ? &slots_[seq & kMask].packet : nullptr;
+}
+
+std::size_t JitterBuffer::depthFrames() const {
+    if (!started_) {
+        return 0;
+    }
+    const int depth = seqDelta(highestSeq_, nextSeq_) + 1;
+    return depth > 0 ? static_cast<std::size_t>(depth) : 0;
+}
+
+InsertResult JitterBuffer::insert(std::uint16_t seq, std::uint32_t sampleClock,
+                                  std::uint64_t arrivalUs, const std::uint8_t* payload,
+                                  std::size_t size, std::uint8_t units, std::uint8_t part) {
+    if (size > kMaxPayloadBytes) {
+        return InsertResult::kTooLarge;
+    }
+
+    InsertResult result = InsertResult::kStored;
+    if (!started_) {
+        start(seq);
+    } else {
+        const int ahead = seqDelta(seq, nextSeq_);
+        if (ahead >= static_cast<int>(kSlots) || ahead <= -static_cast<int>(kSlots)) {
+            // Sender restarted or we were stalled far longer than the
+            // window; nothing buffered is still meaningful.
+            reset();
+            start(seq);
+            stats_.restarts.fetch_add(1, std::memory_order_relaxed);
+            result = InsertResult::kReset;
+        } else if (ahead < 0) {
+            const std::uint32_t delayUs = recordDelay(sampleClock, arrivalUs);
+            lateHoldFrames_ = std::min(framesForDelay(delayUs), config_.maxDepthFrames);
+            lateHoldUntilUs_ = arrivalUs + config_.shrinkHoldUs;
+            updateTarget(arrivalUs);
+            stats_.late.fetch_add(1, std::memory_order_relaxed);
+            publishStats();
+            return InsertResult::kLate;
+        } else if (has(seq)) {
+            stats_.duplicates.fetch_add(1, std::memory_order_relaxed);
+            return InsertResult::kDuplicate;
+        }
+    }
+
+    store(seq, sampleClock, payload, size, units, part);
+    recordDelay(sampleClock, arrivalUs);
+    updateTarget(arrivalUs);
+    stats_.received.fetch_add(1, std::memory_order_relaxed);
+    publishStats();
+    return result;
+}
+
+InsertResult JitterBuffer::insertSilence(std::uint16_t seq, std::uint32_t sampleClock,
+                                         std::uint64_t arrivalUs, const std::uint8_t* payload,
+                                         std::size_t size) {
+    const InsertResult result = insert(seq, sampleClock, arrivalUs, payload, size);
+    if (result == InsertResult::kStored || result == InsertResult::kReset) {
+        slots_[seq & kMask].packet.silence = true;
+    }
+    return result;
+}
+
+InsertResult JitterBuffer::insertRecovered(std::uint16_t seq, std::uint32_t sampleClock,
+                                           const std::uint8_t* payload, std::size_t size,
+                                           std::uint8_t units, std::uint8_t part) {
+    if (size > kMaxPayloadBytes) {
+        return InsertResult::kTooLarge;
+    }
+    if (!awaiting(seq)) {
+        return has(seq) ? InsertResult::kDuplicate : InsertResult::kLate;
+    }
+    store(seq, sampleClock, payload, size, units, part);
+    publishStats();
+    return InsertResult::kStored;
+}
+
+bool JitterBuffer::awaiting(std::uint16_t seq) const {
+    if (!started_) {
+        return false;
+    }
+    const int ahead = seqDelta(seq, nextSeq_);
+    return ahead >= 0 && ahead < static_cast<int>(kSlots) && !has(seq);
+}
+
+void JitterBuffer::store(std::uint16_t seq, std::uint32_t sampleClock, const std::uint8_t* payload,
+                         std::size_t size, std::uint8_t units, std::uint8_t part) {
+    Slot& slot = slots_[seq & kMask];
+    slot.occupied = true;
+    slot.packet.seq = seq;
+    slot.packet.sampleClock = sampleClock;
+    slot.packet.units = units;
+    slot.packet.part = part;
+    slot.packet.silence = false;
+    slot.packet.size = static_cast<std::uint16_t>(size);
+    std::memcpy(slot.packet.payload, payload, size);
+    if (seqDelta(seq, highestSeq_) > 0) {
+        highestSeq_ = seq;
+    }
+}
+
+Playout JitterBuffer::pop(std::uint64_t nowUs) {
+    Playout out;
+    if (!started_) {
+        return out;
+    }
+    updateTarget(nowUs);
+
+    const std::size_t depth = depthFrames();
+    if (!prefilled_) {
+        if (depth < targetFrames_) {
+            return out;
+        }
+        prefilled_ = true;
+    }
+    if (depth >= targetFrames_) {
+        growthFrames_ = 0;
+    }
+
+    out.seq = nextSeq_;
+    ++framesSinceExpand_;
+    if (!has(nextSeq_) && inDtx_) {
+        // A slot the sender skipped, whether later ones are here or not.
+        out.action = PlayoutAction::kComfortNoise;
+        ++nextSeq_;
+        consecutiveExpands_ = 0;
+        excessSinceUs_ = 0;
+        stats_.comfortNoise.fetch_add(1, std::memory_order_relaxed);
+    } else if (has(nextSeq_) && growthFrames_ > 0 && depth < targetFrames_ &&
+               framesSinceExpand_ >= kExpandSpacingFrames && !inDtx_) {
+        // The target just grew: stretch by one frame now rather than waiting
+        // for an underrun to do it. Spacing the stretches keeps each one a
+        // short, isolated concealment. Only growth does this; a depth that
+        // dips under an unchanged target is jitter and comes back by itself.
+        out.action = PlayoutAction::kExpand;
+        framesSinceExpand_ = 0;
+        --growthFrames_;
+        stats_.expanded.fetch_add(1, std::memory_order_relaxed);
+    } else if (has(nextSeq_)) {
+        consecutiveExpands_ = 0;
+        Slot& first = slots_[nextSeq_ & kMask];
+        first.occupied = false;
+        out.primary = &first.packet;
+        out.action = PlayoutAction::kNormal;
+        inDtx_ = first.packet.silence;
+
+        if (depth > targetFrames_ + 1) {
+            if (excessSinceUs_ == 0) {
+                excessSinceUs_ = nowUs;
+            } else if (nowUs - excessSinceUs_ >= config_.accelerateHoldUs &&
+                       has(static_cast<std::uint16_t>(nextSeq_ + 1))) {
+                Slot& second = slots_[(nextSeq_ + 1) & kMask];
+                second.occupied = false;
+                out.secondary = &second.packet;
+                out.action = PlayoutAction::kAccelerate;
+                inDtx_ = second.packet.silence;
+                excessSinceUs_ = 0;
+                ++nextSeq_;
+                stats_.accelerated.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            excessSinceUs_ = 0;
+        }
+        ++nextSeq_;
+    } else if (seqDelta(highestSeq_, nextSeq_) > 0) {
+        // Later packets are here, so this one is lost rather than slow.
+        out.action = PlayoutAction::kConceal;
+        ++nextSeq_;
+        consecutiveExpands_ = 0;
+        stats_.lost.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        // Nothing buffered: stretch by one frame and keep waiting for
+        // nextSeq_. A long dry spell rebuffers to the target instead of
+        // trickling one frame at a time.
+        out.action = PlayoutAction::kExpand;
+        framesSinceExpand_ = 0;
+        if (++consecutiveExpands_ > config_.maxDepthFrames) {
+            prefilled_ = false;
+        }
+        stats_.expanded.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    publishStats();
+    return out;
+}
+
+std::uint32_t JitterBuffer::recordDelay(std::uint32_t sampleClock, std::uint64_t arrivalUs) {
+    if (!haveClock_) {
+        haveClock_ = true;
+        unwrappedSamples_ = 0;
+        windowBucketEndUs_ = arrivalUs + kMinWindowBucketUs;
+    } else {
+        // Signed step so reordered packets move backwards correctly.
+        unwrappedSamples_ += static_cast<std::int32_t>(sampleClock - lastSampleClock_);
+    }
+    lastSampleClock_ = sampleClock;
+
+    const std::int64_t sendUs = unwrappedSamples_ * 1000000 / kSampleRateHz;
+    const std::int64_t transitUs = static_cast<std::int64_t>(arrivalUs) - sendUs;
+
+    // Minimum transit over the last kMinWindowBuckets * 100 ms, so a slow
+    // change in clock offset does not pin the baseline forever.
+    while (arrivalUs >= windowBucketEndUs_) {
+        windowBucket_ = (windowBucket_ + 1) % kMinWindowBuckets;
+        windowMinUs_[windowBucket_] = kNoTransit;
+        windowBucketEndUs_ += kMinWindowBucketUs;
+    }
+    windowMinUs_[windowBucket_] = std::min(windowMinUs_[windowBucket_], transitUs);
+    const std::int64_t baseUs = *std::min_element(windowMinUs_.begin(), windowMinUs_.end());
+
+    const std::int64_t delay = transitUs - baseUs;
+    const std::uint32_t delayUs =
+        static_cast<std::uint32_t>(std::min<std::int64_t>(delay, std::numeric_limits<std::uint32_t>::max()));
+
+    const double forget = config_.forgetFactor;
+    for (double& bin : histogram_) {
+        bin *= forget;
+    }
+    const std::size_t bin = std::min<std::size_t>(delayUs / kBinUs, kBins - 1);
+    histogram_[bin] += 1.0 - forget;
+    if (delayHistogram_ != nullptr) {
+        delayHistogram_->record(delayUs);
+    }
+    return delayUs;
+}
+
+std::uint32_t JitterBuffer::quantileUs(double q) const {
+    // Bin centres: the upper edge would add a quarter-bin bias on average.
+    double total = 0.0;
+    for (double bin : histogram_) {
+        total += bin;
+    }
+    if (total <= 0.0) {
+        return 0;
+    }
+    const double threshold = q * total;
+    double acc = 0.0;
+    for (std::size_t i = 0; i < kBins; ++i) {
+        acc += histogram_[i];
+        if (acc >= threshold) {
+            return static_cast<std::uint32_t>(i * kBinUs + kBinUs / 2);
+        }
+    }
+    return static_cast<std::uint32_t>(kBins * kBinUs);
+}
+
+void JitterBuffer::updateTarget(std::uint64_t nowUs) {
+    const std::uint32_t delayUs = quantileUs(config_.targetQuantile);
+    std::size_t wanted = framesForDelay(delayUs);
+    if (wanted < targetFrames_ && delayUs + kShrinkMarginUs > (targetFrames_ - 1) * kFrameDurationUs) {
+        wanted = targetFrames_;
+    }
+    if (nowUs < lateHoldUntilUs_) {
+        wanted = std::max(wanted, lateHoldFrames_);
+    }
+    wanted = std::clamp(wanted, config_.minDepthFrames, config_.maxDepthFrames);
+
+    if (wanted > targetFrames_) {
+        growthFrames_ += wanted - targetFrames_;
+        targetFrames_ = wanted;
+        shrinkEligibleSinceUs_ = 0;
+    } else if (wanted < targetFrames_) {
+        if (shrinkEligibleSinceUs_ == 0) {
+            shrinkEligibleSinceUs_ = nowUs;
+        } else if (nowUs - shrinkEligibleSinceUs_ >= config_.shrinkHoldUs) {
+            // One frame per hold period; the compression that follows
+            // drains the extra depth gradually.
+            --targetFrames_;
+            shrinkEligibleSinceUs_ = nowUs;
+        }
+    } else {
+        shrinkEligibleSinceUs_ = 0;
+    }
+}
+
+void JitterBuffer::publishStats() {
+    stats_.targetDepthFrames.store(static_cast<std::uint32_t>(targetFrames_),
+                                   std::memory_order_relaxed);
+    stats_.currentDepthFrames.store(static_cast<std::uint32_t>(depthFrames()),
+                                    std::memory_order_relaxed);
+    stats_.p95DelayUs.store(quantileUs(0.95), std::memory_order_relaxed);
+    stats_.p99DelayUs.store(quantileUs(0.99), std::memory_order_relaxed);
+    stats_.inDtx.store(inDtx_, std::memory_order_relaxed);
+}
+
+} // namespace aas
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/datagram.h"
+#include "aas/histogram.h"
+
+namespace aas {
+
+struct JitterBufferConfig {
+    /// Depth limits in 2.5 ms frames. The upper bound keeps the buffer
+    /// inside the overall <10 ms budget even under bad interference.
+    std::size_t minDepthFrames = 1;
+    std::size_t maxDepthFrames = 6;
+    /// Depth used before any delay has been measured.
+    std::size_t initialDepthFrames = 2;
+    /// Delay quantile the target depth must cover (0.95 = P95).
+    double targetQuantile = 0.95;
+    /// Per-packet decay of the delay histogram; 0.997 gives a memory of
+    /// roughly one second at 400 packets/s.
+    double forgetFactor = 0.997;
+    /// How long the target must sit below the current depth before the
+    /// buffer starts compressing. Growth is immediate, shrinking is not.
+    std::uint32_t shrinkHoldUs = 1000000;
+    /// How long the depth must exceed the target by more than one frame
+    /// before a compression step, so a single burst is not mistaken for
+    /// excess latency.
+    std::uint32_t accelerateHoldUs = 50000;
+};
+
+/// Counters exported to the monitoring UI. Written by the owning thread
+/// with relaxed stores so any other thread may sample them at any time.
+struct JitterBufferStats {
+    std::atomic<std::uint32_t> targetDepthFrames{0};
+    std::atomic<std::uint32_t> currentDepthFrames{0};
+    std::atomic<std::uint32_t> p95DelayUs{0};
+    std::atomic<std::uint32_t> p99DelayUs{0};
+    std::atomic<std::uint64_t> received{0};
+    std::atomic<std::uint64_t> late{0};
+    std::atomic<std::uint64_t> duplicates{0};
+    std::atomic<std::uint64_t> lost{0};
+    /// Sequence jumps that dropped everything buffered (InsertResult::kReset).
+    std::atomic<std::uint64_t> restarts{0};
+    std::atomic<std::uint64_t> expanded{0};
+    std::atomic<std::uint64_t> accelerated{0};
+    /// Slots the sender skipped in DTX, played as comfort noise.
+    std::atomic<std::uint64_t> comfortNoise{0};
+    /// Playout is in a DTX gap. The depth then runs down to nothing however
+    /// the clocks are doing, so whatever steers by it should hold.
+    std::atomic<bool> inDtx{false};
+};
+
+/// One 2.5 ms slot. A codec frame longer than a slot (frame units > 1) is
+/// stored once per slot it covers, with `part` saying which 2.5 ms of it
+/// this slot plays; `sampleClock` is always the slot's own.
+/// Opus cannot pick a part out of the payload, so OpusFrameDecoder decodes
+/// the whole frame at the first of its slots and holds the rest for the
+/// following ones.
+struct BufferedPacket {
+    std::uint16_t seq = 0;
+    std::uint16_t size = 0;
+    std::uint32_t sampleClock = 0;
+    std::uint8_t units = 1;
+    std::uint8_t part = 0;
+    /// A kFlagSilence comfort-noise descriptor rather than codec data.
+    bool silence = false;
+    std::uint8_t payload[kMaxPayloadBytes];
+};
+
+enum class InsertResult {
+    kStored,
+    kDuplicate,
+    kLate,       ///< Arrived after its playout slot; counted and dropped.
+    kTooLarge,
+    kReset,      ///< Sequence jump beyond the window; buffer restarted.
+};
+
+enum class PlayoutAction {
+    kWaiting,      ///< Still prefilling to the target depth; play silence.
+    kNormal,       ///< Decode `primary`.
+    kAccelerate,   ///< Decode `primary` and `secondary`, compress into one frame.
+    kConceal,      ///< `seq` is lost but later packets exist; conceal and move on.
+    kExpand,       ///< Below target or dry; conceal without advancing (adds a frame).
+    kComfortNoise, ///< The sender is in DTX and skipped `seq`; play comfort noise and move on.
+};
+
+struct Playout {
+    PlayoutAction action = PlayoutAction::kWaiting;
+    std::uint16_t seq = 0;
+    const BufferedPacket* primary = nullptr;
+    const BufferedPacket* secondary = nullptr;
+};
+
+/// Receiver jitter buffer with a target depth that follows the measured
+/// delay distribution instead of a fixed 3-5 packets.
+///
+/// Each arrival's transit time (arrival clock minus sender sample clock) is
+/// taken relative to the fastest transit seen over the last two seconds and
+/// added to a histogram that decays with every packet. The target depth is
+/// the frame count covering the configured quantile of that histogram. A
+/// packet that shows up after its playout slot raises the target at once and
+/// holds it, and playout stretches by a frame every few frames until the
+/// depth catches up; when the target stays below the current depth for
+/// `shrinkHoldUs`, playout asks the decoder to compress two frames into one
+/// so latency drains without a gap.
+///
+/// The buffer is owned by the decode thread: insert() and pop() must be
+/// called from that thread (the receive thread hands packets over through
+/// an SpscRing). The stats block may be read from anywhere.
+class JitterBuffer {
+public:
+    static constexpr std::size_t kSlots = 64;
+
+    explicit JitterBuffer(const JitterBufferConfig& config = {});
+
+    /// Stores one slot. `units` and `part` describe a longer codec frame
+    /// split over consecutive slots (see BufferedPacket); the caller inserts
+    /// each part with its own seq and sample clock.
+    InsertResult insert(std::uint16_t seq, std::uint32_t sampleClock, std::uint64_t arrivalUs,
+                        const std::uint8_t* payload, std::size_t size, std::uint8_t units = 1,
+                        std::uint8_t part = 0);
+
+    /// Stores a frame rebuilt by FEC or taken from a redundant copy. Unlike
+    /// insert() it does not feed the delay statistics: a recovered frame's
+    /// arrival time says nothing about network delay.
+    InsertResult insertRecovered(std::uint16_t seq, std::uint32_t sampleClock,
+                                 const std::uint8_t* payload, std::size_t size, std::uint8_t units = 1,
+                                 std::uint8_t part = 0);
+
+    /// Stores a kFlagSilence packet. Like insert() it feeds the delay
+    /// statistics, which SID refreshes keep current through silence. Once
+    /// it has played, slots with nothing buffered are DTX gaps: pop()
+    /// returns kComfortNoise and keeps advancing instead of concealing,
+    /// expanding or counting losses, so the playout position tracks the
+    /// sender's slot clock and speech resumes at the same depth.
+    InsertResult insertSilence(std::uint16_t seq, std::uint32_t sampleClock, std::uint64_t arrivalUs,
+                               const std::uint8_t* payload, std::size_t size);
+
+    /// True when `seq` is still ahead of playout and not yet buffered, i.e.
+    /// recovering it now would still be in time.
+    bool awaiting(std::uint16_t seq) const;
+
+    /// Called once per 2.5 ms output frame. Returned pointers stay valid
+    /// until the next pop() or insert().
+    Playout pop(std::uint64_t nowUs);
+
+    /// Buffered packet for `seq`, if present. Used by FEC to look ahead.
+    const BufferedPacket* peek(std::uint16_t seq) const;
+
+    std::size_t targetDepthFrames() const { return targetFrames_; }
+    std::size_t depthFrames() const;
+    const JitterBufferStats& stats() const { return stats_; }
+    /// Receives every transit delay the buffer measures (the telemetry
+    /// network stage). Owning thread only.
+    void setDelayHistogram(LatencyHistogram* histogram) { delayHistogram_ = histogram; }
+
+    void reset();
+
+private:
+    static constexpr std::size_t kMask = kSlots - 1;
+    static constexpr std::uint32_t kBinUs = 250;
+    static constexpr std::size_t kBins = 64;
+    static constexpr std::uint32_t kMinWindowBucketUs = 100000;
+    static constexpr std::size_t kMinWindowBuckets = 20;
+    static constexpr std::size_t kExpandSpacingFrames = 4;
+
+    struct Slot {
+        bool occupied = false;
+        BufferedPacket packet;
+    };
+
+    std::uint32_t recordDelay(std::uint32_t sampleClock, std::uint64_t arrivalUs);
+    void start(std::uint16_t seq);
+    void store(std::uint16_t seq, std::uint32_t sampleClock, const std::uint8_t* payload,
+               std::size_t size, std::uint8_t units, std::uint8_t part);
+    bool has(std::uint16_t seq) const;
+    std::uint32_t quantileUs(double q) const;
+    void updateTarget(std::uint64_t nowUs);
+    void publishStats();
+
+    JitterBufferConfig config_;
+    std::array<Slot, kSlots> slots_{};
+
+    bool started_ = false;
+    bool prefilled_ = false;
+    /// The last slot played was a silence descriptor or a DTX gap.
+    bool inDtx_ = false;
+    std::uint16_t nextSeq_ = 0;
+    std::uint16_t highestSeq_ = 0;
+
+    // Transit-time tracking. Sample clocks are unwrapped into a 64-bit
+    // microsecond timeline anchored at the first packet.
+    bool haveClock_ = false;
+    std::uint32_t lastSampleClock_ = 0;
+    std::int64_t unwrappedSamples_ = 0;
+    std::array<std::int64_t, kMinWindowBuckets> windowMinUs_{};
+    std::uint64_t windowBucketEndUs_ = 0;
+    std::size_t windowBucket_ = 0;
+
+    std::array<double, kBins> histogram_{};
+
+    std::size_t targetFrames_ = 0;
+    std::size_t lateHoldFrames_ = 0;
+    std::uint64_t lateHoldUntilUs_ = 0;
+    std::uint64_t shrinkEligibleSinceUs_ = 0;
+    std::uint64_t excessSinceUs_ = 0;
+    std::size_t consecutiveExpands_ = 0;
+    std::size_t framesSinceExpand_ = 0;
+    /// Frames of target growth playout has yet to stretch for.
+    std::size_t growthFrames_ = 0;
+
+    JitterBufferStats stats_;
+    LatencyHistogram* delayHistogram_ = nullptr;
+};
+
+} // namespace aas
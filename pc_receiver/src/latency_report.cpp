@@ -0,0 +1,171 @@
+#include "latency_report.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "clock_sync.h"
+
+namespace aas {
+
+namespace {
+
+constexpr std::uint32_t bit(TraceStage stage) { return 1u << static_cast<unsigned>(stage); }
+
+constexpr std::uint32_t kFrameStages = bit(TraceStage::kCaptureHw) |
+                                       bit(TraceStage::kCaptureCallback) |
+                                       bit(TraceStage::kEncodeDone) |
+                                       bit(TraceStage::kDecodeStart) |
+                                       bit(TraceStage::kDecodeDone) | bit(TraceStage::kPresented);
+
+constexpr std::uint32_t kSenderStages = bit(TraceStage::kCaptureHw) |
+                                        bit(TraceStage::kCaptureCallback) |
+                                        bit(TraceStage::kEncodeDone) |
+                                        bit(TraceStage::kMarkerInjected);
+
+/// Frames that never complete (lost, concealed, merged by the jitter
+/// buffer) are dropped after this long.
+constexpr std::uint64_t kFrameTimeoutUs = 2000000;
+
+/// A detection further than this from the last injection is not ours.
+constexpr std::uint64_t kMarkerMatchWindowUs = 500000;
+
+struct RowInfo {
+    const char* name;
+    double targetMs;
+};
+
+// Targets from the README latency budget.
+constexpr RowInfo kRows[LatencyReport::kRowCount] = {
+    {"Capture", 1.2}, {"Encode", 3.0},  {"Network", 3.0}, {"Decode", 1.5},
+    {"Playback", 2.0}, {"Total", 10.7}, {"Marker", 10.7},
+};
+
+inline double deltaMs(std::uint64_t later, std::uint64_t earlier) {
+    return (static_cast<double>(later) - static_cast<double>(earlier)) / 1000.0;
+}
+
+} // namespace
+
+void LatencyReport::collect(LatencyTrace& trace) {
+    trace.drain([this](const TraceEvent& event) { add(event); });
+    prune(latestUs_);
+}
+
+void LatencyReport::add(const TraceEvent& event) {
+    const std::uint32_t mask = bit(event.stage);
+    std::uint64_t timeUs = event.timeUs;
+    if (mask & kSenderStages) {
+        if (clock_ != nullptr && clock_->estimate().locked) {
+            timeUs = clock_->senderToReceiverUs(timeUs);
+        } else {
+            timeUs = static_cast<std::uint64_t>(static_cast<std::int64_t>(timeUs) + offsetUs_);
+        }
+    }
+    latestUs_ = std::max(latestUs_, timeUs);
+
+    if (event.stage == TraceStage::kMarkerInjected) {
+        markerInjections_.push_back(timeUs);
+        return;
+    }
+    if (event.stage == TraceStage::kMarkerDetected) {
+        // Match to the latest injection before the detection.
+        while (markerInjections_.size() > 1 && markerInjections_[1] <= timeUs) {
+            markerInjections_.pop_front();
+        }
+        if (!markerInjections_.empty() && markerInjections_.front() <= timeUs &&
+            timeUs - markerInjections_.front() < kMarkerMatchWindowUs) {
+            addSample(kMarker, deltaMs(timeUs, markerInjections_.front()));
+            markerInjections_.pop_front();
+        }
+        return;
+    }
+    if (event.stage == TraceStage::kReceived) {
+        return;  // arrival is inside Network; recorded for raw dumps only
+    }
+
+    FrameTimes& times = frames_[event.sampleClock];
+    if (times.seen == 0) {
+        times.firstSeenUs = timeUs;
+    }
+    times.us[static_cast<std::size_t>(event.stage)] = timeUs;
+    times.seen |= mask;
+    if ((times.seen & kFrameStages) == kFrameStages) {
+        finish(times);
+        frames_.erase(event.sampleClock);
+    }
+}
+
+void LatencyReport::finish(const FrameTimes& times) {
+    auto at = [&](TraceStage stage) { return times.us[static_cast<std::size_t>(stage)]; };
+    addSample(kCapture, deltaMs(at(TraceStage::kCaptureCallback), at(TraceStage::kCaptureHw)));
+    addSample(kEncode, deltaMs(at(TraceStage::kEncodeDone), at(TraceStage::kCaptureCallback)));
+    addSample(kNetwork, deltaMs(at(TraceStage::kDecodeStart), at(TraceStage::kEncodeDone)));
+    addSample(kDecode, deltaMs(at(TraceStage::kDecodeDone), at(TraceStage::kDecodeStart)));
+    addSample(kPlayback, deltaMs(at(TraceStage::kPresented), at(TraceStage::kDecodeDone)));
+    addSample(kTotal, deltaMs(at(TraceStage::kPresented), at(TraceStage::kCaptureHw)));
+}
+
+void LatencyReport::addSample(Row r, double ms) {
+    std::deque<double>& row = samples_[r];
+    row.push_back(ms);
+    if (row.size() > kMaxSamples) {
+        row.pop_front();
+    }
+}
+
+void LatencyReport::prune(std::uint64_t nowUs) {
+    for (auto it = frames_.begin(); it != frames_.end();) {
+        if (nowUs > it->second.firstSeenUs + kFrameTimeoutUs) {
+            it = frames_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    while (!markerInjections_.empty() && nowUs > markerInjections_.front() + kFrameTimeoutUs) {
+        markerInjections_.pop_front();
+    }
+}
+
+LatencyReport::RowStats LatencyReport::row(Row r) const {
+    RowStats stats;
+    const std::deque<double>& row = samples_[r];
+    stats.count = row.size();
+    if (row.empty()) {
+        return stats;
+    }
+    std::vector<double> sorted(row.begin(), row.end());
+    std::sort(sorted.begin(), sorted.end());
+    auto quantile = [&](double q) {
+        const auto idx = static_cast<std::size_t>(q * static_cast<double>(sorted.size() - 1) + 0.5);
+        return sorted[idx];
+    };
+    stats.p50Ms = quantile(0.50);
+    stats.p99Ms = quantile(0.99);
+    stats.maxMs = sorted.back();
+    return stats;
+}
+
+std::string LatencyReport::formatTable() const {
+    std::string out = "| Stage     | Target   | P50      | P99      | Max      | Frames |\n"
+                      "| --------- | -------- | -------- | -------- | -------- | ------ |\n";
+    char line[128];
+    for (std::size_t r = 0; r < kRowCount; ++r) {
+        const RowStats stats = row(static_cast<Row>(r));
+        std::snprintf(line, sizeof(line), "| %-9s | %5.1f ms | %5.2f ms | %5.2f ms | %5.2f ms | %6zu |\n",
+                      kRows[r].name, kRows[r].targetMs, stats.p50Ms, stats.p99Ms, stats.maxMs,
+                      stats.count);
+        out += line;
+    }
+    return out;
+}
+
+void LatencyReport::clear() {
+    frames_.clear();
+    markerInjections_.clear();
+    for (auto& row : samples_) {
+        row.clear();
+    }
+    latestUs_ = 0;
+}
+
+} // namespace aas
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "aas/latency_trace.h"
+
+namespace aas {
+
+class ClockSync;
+
+/// Turns LatencyTrace events into the per-stage table of the README's
+/// "Revised Latency Budget", with P50/P99/max per row.
+///
+/// Events are joined per frame by sample clock. Sender times are moved to
+/// the receiver clock with the offset set by setClockOffsetUs() (receiver
+/// time = sender time + offset), or by a ClockSync when one is attached. Stage boundaries:
+///
+///   Capture  = capture callback - capture at converter        (sender)
+///   Encode   = encode done - capture callback                 (sender)
+///              (includes mic-mode RNNoise, whose frames keep their
+///              original capture timestamps)
+///   Network  = decode start - encode done   (send queue, air, jitter buffer)
+///   Decode   = decode done - decode start                     (receiver)
+///   Playback = presented - decode done   (resampler, device buffer, DAC)
+///   Total    = presented - capture at converter
+///
+/// A separate "Marker" row times the MLS marker from injection to detection
+/// in the output, which checks the stage timestamps against the signal path.
+///
+/// Runs on a non-real-time reporting thread; it allocates freely.
+class LatencyReport {
+public:
+    enum Row : std::size_t { kCapture, kEncode, kNetwork, kDecode, kPlayback, kTotal, kMarker, kRowCount };
+
+    struct RowStats {
+        std::size_t count = 0;
+        double p50Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    /// Samples kept per row; older ones are discarded first.
+    static constexpr std::size_t kMaxSamples = 200000;
+
+    void setClockOffsetUs(std::int64_t senderToReceiverUs) { offsetUs_ = senderToReceiverUs; }
+
+    /// Maps sender times through a live ClockSync instead of the fixed
+    /// offset, so skew over a long run does not smear the rows. Falls back
+    /// to the fixed offset until the estimate is locked.
+    void setClockSync(const ClockSync* clock) { clock_ = clock; }
+
+    /// Drains `trace` and folds complete frames into the statistics.
+    void collect(LatencyTrace& trace);
+
+    RowStats row(Row r) const;
+    /// Markdown table: Stage | Target | P50 | P99 | Max | Frames.
+    std::string formatTable() const;
+    void clear();
+
+private:
+    struct FrameTimes {
+        std::array<std::uint64_t, kTraceStageCount> us{};
+        std::uint32_t seen = 0;
+        std::uint64_t firstSeenUs = 0;
+    };
+
+    void add(const TraceEvent& event);
+    void finish(const FrameTimes& times);
+    void addSample(Row r, double ms);
+    void prune(std::uint64_t nowUs);
+
+    std::int64_t offsetUs_ = 0;
+    const ClockSync* clock_ = nullptr;
+    std::unordered_map<std::uint32_t, FrameTimes> frames_;
+    std::deque<std::uint64_t> markerInjections_;   // receiver-clock times
+    std::array<std::deque<double>, kRowCount> samples_;
+    std::uint64_t latestUs_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,78 @@
+#include "marker_detector.h"
+
+#include <cmath>
+
+namespace aas {
+
+namespace {
+
+constexpr double kSamplePeriodUs = 1e6 / kSampleRateHz;
+
+} // namespace
+
+MarkerDetector::MarkerDetector(LatencyTrace* trace) : chips_(makeMarker()), trace_(trace) {}
+
+void MarkerDetector::finishPeak(std::uint64_t onsetUs) {
+    if (trace_ != nullptr) {
+        trace_->record(TraceStage::kMarkerDetected, 0, onsetUs);
+    }
+    inPeak_ = false;
+    peakScore_ = 0.0f;
+    sinceDetection_ = 0;
+}
+
+std::size_t MarkerDetector::process(const float* samples, std::size_t frames, std::size_t channels,
+                                    std::uint64_t firstPresentUs) {
+    std::size_t found = 0;
+    const float scale = 1.0f / static_cast<float>(channels);
+    for (std::size_t i = 0; i < frames; ++i) {
+        float mono = 0.0f;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            mono += samples[i * channels + ch];
+        }
+        mono *= scale;
+
+        const float leaving = window_[writeIndex_];
+        window_[writeIndex_] = mono;
+        window_[writeIndex_ + kMarkerLength] = mono;
+        writeIndex_ = (writeIndex_ + 1) % kMarkerLength;
+        energy_ += static_cast<double>(mono) * mono - static_cast<double>(leaving) * leaving;
+        if (filled_ < kMarkerLength) {
+            ++filled_;
+        }
+        if (sinceDetection_ < kRefractorySamples) {
+            ++sinceDetection_;
+        }
+        if (filled_ < kMarkerLength || sinceDetection_ < kRefractorySamples) {
+            continue;
+        }
+
+        // Oldest sample in the window is at writeIndex_.
+        const float* line = window_.data() + writeIndex_;
+        double dot = 0.0;
+        for (std::size_t k = 0; k < kMarkerLength; ++k) {
+            dot += static_cast<double>(line[k]) * chips_[k];
+        }
+        const double denom = std::sqrt(std::fmax(energy_, 1e-12) * kMarkerLength);
+        const auto score = static_cast<float>(dot / denom);
+
+        // The window's oldest sample is the candidate onset.
+        const double sampleUs = static_cast<double>(i) - static_cast<double>(kMarkerLength - 1);
+        const auto onsetUs = static_cast<std::uint64_t>(
+            static_cast<double>(firstPresentUs) + sampleUs * kSamplePeriodUs);
+
+        if (score >= kThreshold) {
+            if (!inPeak_ || score > peakScore_) {
+                inPeak_ = true;
+                peakScore_ = score;
+                peakOnsetUs_ = onsetUs;
+            }
+        } else if (inPeak_) {
+            finishPeak(peakOnsetUs_);
+            ++found;
+        }
+    }
+    return found;
+}
+
+} // namespace aas
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/latency_marker.h"
+#include "aas/latency_trace.h"
+
+namespace aas {
+
+/// Latency test mode on the receiver: finds the sender's MLS marker in the
+/// output stream by normalised cross-correlation and records the estimated
+/// presentation time of its first sample as TraceStage::kMarkerDetected.
+///
+/// The correlation costs kMarkerLength multiply-adds per sample, so this
+/// runs on an analysis thread fed with copies of the rendered output, never
+/// on the render callback itself.
+class MarkerDetector {
+public:
+    /// Correlation (0-1) a peak must exceed; codec noise on an MLS stays
+    /// far below this, a clean marker lands above 0.9.
+    static constexpr float kThreshold = 0.6f;
+    /// Minimum spacing between detections.
+    static constexpr std::size_t kRefractorySamples = 24000;
+
+    explicit MarkerDetector(LatencyTrace* trace);
+
+    /// Feeds interleaved output. `firstPresentUs` is the receiver-clock time
+    /// the first of these samples is presented. Returns markers found.
+    std::size_t process(const float* samples, std::size_t frames, std::size_t channels,
+                        std::uint64_t firstPresentUs);
+
+private:
+    void finishPeak(std::uint64_t onsetUs);
+
+    std::array<float, kMarkerLength> chips_;
+    std::array<float, 2 * kMarkerLength> window_{};  // mirrored line, no wrap in the dot product
+    std::size_t writeIndex_ = 0;
+    std::size_t filled_ = 0;
+    double energy_ = 0.0;
+    std::size_t sinceDetection_ = kRefractorySamples;
+
+    // Peak tracking: the best score over consecutive above-threshold samples.
+    bool inPeak_ = false;
+    float peakScore_ = 0.0f;
+    std::uint64_t peakOnsetUs_ = 0;
+
+    LatencyTrace* trace_;
+};
+
+} // namespace aas
@@ -0,0 +1,171 @@
+#include "mdns_advertiser.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace aas {
+
+namespace {
+
+constexpr int kStartupAnnouncements = 3;
+constexpr std::uint64_t kStartupSpacingUs = 1'000'000;
+
+} // namespace
+
+MdnsAdvertiser::~MdnsAdvertiser() { close(); }
+
+bool MdnsAdvertiser::open(const MdnsAdvertiserConfig& config) {
+    close();
+    config_ = config;
+    if (config_.instance.empty()) {
+        config_.instance = config_.host;
+    }
+    socket_ = ::socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_ == INVALID_SOCKET) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+
+    const BOOL reuse = TRUE;
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(kMdnsPort);
+    local.sin_addr.s_addr = INADDR_ANY;
+    ip_mreq membership{};
+    membership.imr_multiaddr.s_addr = htonl(kMdnsGroupV4);
+    membership.imr_interface = config_.address;
+    const DWORD ttl = 255;
+    u_long nonBlocking = 1;
+    if (::setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>(&reuse),
+                     sizeof(reuse)) != 0 ||
+        ::bind(socket_, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0 ||
+        ::setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP, reinterpret_cast<const char*>(&membership),
+                     sizeof(membership)) != 0 ||
+        ::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, reinterpret_cast<const char*>(&config_.address),
+                     sizeof(config_.address)) != 0 ||
+        ::setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_TTL, reinterpret_cast<const char*>(&ttl),
+                     sizeof(ttl)) != 0 ||
+        ::ioctlsocket(socket_, FIONBIO, &nonBlocking) != 0) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    group_ = {};
+    group_.sin_family = AF_INET;
+    group_.sin_port = htons(kMdnsPort);
+    group_.sin_addr.s_addr = htonl(kMdnsGroupV4);
+    nextAnnounceUs_ = 0;
+    lastAnnounceUs_ = 0;
+    startupAnnouncements_ = kStartupAnnouncements;
+    lastError_ = 0;
+    return true;
+}
+
+void MdnsAdvertiser::close() {
+    if (socket_ != INVALID_SOCKET) {
+        // Goodbye: phones drop the entry now rather than at TTL expiry.
+        send(advert(0), nullptr, 0);
+        ::closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+}
+
+void MdnsAdvertiser::setLoad(std::uint8_t streams, std::uint8_t loadPercent) {
+    streams_.store(streams, std::memory_order_relaxed);
+    load_.store(std::min<std::uint8_t>(loadPercent, 100), std::memory_order_relaxed);
+}
+
+ReceiverAdvert MdnsAdvertiser::advert(std::uint32_t ttlSec) const {
+    ReceiverAdvert advert;
+    advert.instance = config_.instance;
+    advert.host = config_.host;
+    advert.ipv4 = config_.address.s_addr;
+    advert.port = config_.port;
+    advert.backend = config_.backend;
+    advert.codecMask = config_.codecMask;
+    advert.streams = streams_.load(std::memory_order_relaxed);
+    advert.maxStreams = config_.maxStreams;
+    advert.loadPercent = load_.load(std::memory_order_relaxed);
+    advert.ttlSec = ttlSec;
+    return advert;
+}
+
+bool MdnsAdvertiser::send(const ReceiverAdvert& advert, const sockaddr_in* to, std::uint16_t queryId) {
+    std::uint8_t message[kDnsSdMessageBytes];
+    const std::size_t size = writeReceiverAdvert(advert, message, sizeof(message), queryId, to != nullptr);
+    if (size == 0) {
+        return false;
+    }
+    const sockaddr_in& dest = to != nullptr ? *to : group_;
+    if (::sendto(socket_, reinterpret_cast<const char*>(message), static_cast<int>(size), 0,
+                 reinterpret_cast<const sockaddr*>(&dest), sizeof(dest)) == SOCKET_ERROR) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+    return true;
+}
+
+void MdnsAdvertiser::announce(std::uint64_t nowUs) {
+    const ReceiverAdvert current = advert(config_.ttlSec);
+    if (send(current, nullptr, 0)) {
+        announced_.fetch_add(1, std::memory_order_relaxed);
+    }
+    announcedStreams_ = current.streams;
+    announcedLoad_ = current.loadPercent;
+    lastAnnounceUs_ = nowUs;
+    if (startupAnnouncements_ > 0) {
+        --startupAnnouncements_;
+        nextAnnounceUs_ = nowUs + kStartupSpacingUs;
+    } else {
+        nextAnnounceUs_ = nowUs + std::uint64_t{config_.ttlSec} * 1'000'000 / 2;
+    }
+}
+
+void MdnsAdvertiser::service(std::uint64_t nowUs) {
+    if (socket_ == INVALID_SOCKET) {
+        return;
+    }
+    std::uint8_t message[kDnsSdMessageBytes];
+    for (;;) {
+        sockaddr_in from{};
+        int fromLength = sizeof(from);
+        const int size = ::recvfrom(socket_, reinterpret_cast<char*>(message), sizeof(message), 0,
+                                    reinterpret_cast<sockaddr*>(&from), &fromLength);
+        if (size == SOCKET_ERROR) {
+            const int error = ::WSAGetLastError();
+            // WSAEMSGSIZE: a larger mDNS message for someone else, dropped.
+            if (error == WSAEMSGSIZE) {
+                continue;
+            }
+            if (error != WSAEWOULDBLOCK) {
+                lastError_ = error;
+            }
+            break;
+        }
+        std::uint16_t queryId = 0;
+        if (!isMdnsQueryForReceivers(message, static_cast<std::size_t>(size), queryId)) {
+            continue;
+        }
+        bool sent = false;
+        if (from.sin_port != htons(kMdnsPort)) {
+            sent = send(advert(std::min(config_.ttlSec, kMdnsLegacyTtlSec)), &from, queryId);
+        } else {
+            // A full mDNS querier: answer the group, which also refreshes
+            // every other cache on the link.
+            sent = send(advert(config_.ttlSec), nullptr, 0);
+        }
+        if (sent) {
+            answered_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    const std::uint8_t streams = streams_.load(std::memory_order_relaxed);
+    const std::uint8_t load = load_.load(std::memory_order_relaxed);
+    const bool changed = streams != announcedStreams_ || std::abs(load - announcedLoad_) >= kLoadStepPercent;
+    if (nowUs >= nextAnnounceUs_ || (changed && nowUs >= lastAnnounceUs_ + kLoadAnnounceUs)) {
+        announce(nowUs);
+    }
+}
+
+} // namespace aas
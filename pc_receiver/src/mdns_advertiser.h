@@ -0,0 +1,99 @@
+#pragma once
+
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "aas/dns_sd.h"
+
+namespace aas {
+
+struct MdnsAdvertiserConfig {
+    /// Instance label the phone lists; defaults to the host label.
+    std::string instance;
+    /// Host label, without ".local".
+    std::string host;
+    /// Interface to advertise on; its address goes in the A record.
+    IN_ADDR address{};
+    /// Media port (MultiStreamConfig::port).
+    std::uint16_t port = 0;
+    /// "wasapi-exclusive", "wasapi-shared" or "asio".
+    std::string backend;
+    std::uint32_t codecMask = 0;
+    std::uint8_t maxStreams = 8;
+    std::uint32_t ttlSec = 120;
+};
+
+/// Advertises this receiver as a kAasServiceType instance
+/// (docs/protocol.md, Discovery): answers PTR queries and announces the
+/// record set unprompted, so phones on the LAN list it without a typed
+/// address.
+///
+/// One non-blocking UDP socket on port 5353, shared with the Windows DNS
+/// client's own mDNS responder through SO_REUSEADDR and joined to
+/// 224.0.0.251 on the configured interface. Queries sent from port 5353
+/// get a multicast answer; one-shot queries from any other port (what
+/// ReceiverDirectory sends) get a unicast answer straight back with the
+/// question echoed and TTLs capped at kMdnsLegacyTtlSec (RFC 6762 section
+/// 6.7). After open() the record set is announced three times a second
+/// apart, then every ttlSec / 2, and again within kLoadAnnounceUs when the
+/// stream count or load changes enough to reorder a phone's list. close()
+/// sends a goodbye.
+///
+/// service() runs on a control thread, never the receive or render
+/// threads; setLoad() may be called from any thread.
+class MdnsAdvertiser {
+public:
+    /// Smallest load change worth a fresh announcement, percent.
+    static constexpr std::uint8_t kLoadStepPercent = 10;
+    /// Minimum spacing of load-driven announcements.
+    static constexpr std::uint64_t kLoadAnnounceUs = 1'000'000;
+
+    MdnsAdvertiser() = default;
+    ~MdnsAdvertiser();
+    MdnsAdvertiser(const MdnsAdvertiser&) = delete;
+    MdnsAdvertiser& operator=(const MdnsAdvertiser&) = delete;
+
+    /// Returns false and records a WSA error code on failure.
+    bool open(const MdnsAdvertiserConfig& config);
+    void close();
+    bool isOpen() const { return socket_ != INVALID_SOCKET; }
+
+    /// Current streams and busiest decode worker (DecodePool stats).
+    void setLoad(std::uint8_t streams, std::uint8_t loadPercent);
+
+    /// Answers pending queries and sends due announcements. Call every
+    /// 100 ms or so; never blocks.
+    void service(std::uint64_t nowUs);
+
+    std::uint64_t answered() const { return answered_.load(std::memory_order_relaxed); }
+    std::uint64_t announced() const { return announced_.load(std::memory_order_relaxed); }
+    int lastError() const { return lastError_; }
+
+private:
+    ReceiverAdvert advert(std::uint32_t ttlSec) const;
+    /// Multicast when `to` is null.
+    bool send(const ReceiverAdvert& advert, const sockaddr_in* to, std::uint16_t queryId);
+    void announce(std::uint64_t nowUs);
+
+    SOCKET socket_ = INVALID_SOCKET;
+    MdnsAdvertiserConfig config_;
+    sockaddr_in group_{};
+
+    std::atomic<std::uint8_t> streams_{0};
+    std::atomic<std::uint8_t> load_{0};
+    std::uint8_t announcedStreams_ = 0;
+    std::uint8_t announcedLoad_ = 0;
+    std::uint64_t nextAnnounceUs_ = 0;
+    std::uint64_t lastAnnounceUs_ = 0;
+    int startupAnnouncements_ = 0;
+
+    std::atomic<std::uint64_t> answered_{0};
+    std::atomic<std::uint64_t> announced_{0};
+    int lastError_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,153 @@
+#include "multi_stream_receiver.h"
+
+#include <cstring>
+#include <vector>
+
+#include "aas/clock.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+namespace {
+
+constexpr DWORD kPollTimeoutMs = 5;
+/// One completion batch must be dispatched well inside a frame, or the
+/// decode workers see packets late.
+constexpr std::uint32_t kDispatchBudgetUs = 500;
+
+} // namespace
+
+MultiStreamReceiver::MultiStreamReceiver(const MultiStreamConfig& config) : config_(config) {
+    const std::size_t mixerBytes = sizeof(StreamMixer) + kCacheLineSize +
+                                   StreamMixer::storageBytes(config.maxPeriodFrames, config.outputChannels);
+    arena_.reserve(mixerBytes +
+                   kStreams * StreamPipeline::arenaBytes(config.outputChannels, config.maxPeriodFrames));
+    RtArena::Scope scope(arena_);
+    mixer_ = arena_.create<StreamMixer>(config.maxPeriodFrames, config.outputChannels);
+    for (std::size_t i = 0; i < kStreams; ++i) {
+        pipelines_[i] = arena_.create<StreamPipeline>(config.outputChannels, config.maxPeriodFrames,
+                                                      config.jitter);
+        mixer_->attach(i, pipelines_[i]);
+        idOf_[i] = -1;
+    }
+    for (auto& slot : slotOf_) {
+        slot.store(-1, std::memory_order_relaxed);
+    }
+}
+
+MultiStreamReceiver::~MultiStreamReceiver() { stop(); }
+
+bool MultiStreamReceiver::start() {
+    stop();
+    if (!rio_.open(config_.port)) {
+        return false;
+    }
+    if (!config_.sharedOutputName.empty()) {
+        for (std::size_t i = 0; i < kStreams; ++i) {
+            const std::wstring name = config_.sharedOutputName + L"." + std::to_wstring(i);
+            const bool open = shared_[i].open(name, config_.sharedOutputSlots);
+            pipelines_[i]->setSharedOutput(open ? &shared_[i].writer() : nullptr);
+        }
+    }
+    const std::vector<StreamPipeline*> pipelines(pipelines_.begin(), pipelines_.end());
+    if (!pool_.start(pipelines, config_.pool)) {
+        rio_.close();
+        return false;
+    }
+    running_.store(true, std::memory_order_release);
+    RtThreadConfig rt;
+    rt.role = ThreadRole::kReceive;
+    rt.budgetUs = kDispatchBudgetUs;
+    rt.core = config_.receiveCore;
+    receiveThread_.start(rt, [this](RtScope& scope) { receiveLoop(scope); });
+    return true;
+}
+
+void MultiStreamReceiver::stop() {
+    running_.store(false, std::memory_order_release);
+    if (receiveThread_.joinable()) {
+        receiveThread_.join();
+    }
+    pool_.stop();
+    rio_.close();
+    for (std::size_t i = 0; i < kStreams; ++i) {
+        pipelines_[i]->setSharedOutput(nullptr);
+        shared_[i].close();
+    }
+}
+
+void MultiStreamReceiver::receiveLoop(RtScope& rt) {
+    while (running_.load(std::memory_order_acquire)) {
+        rio_.poll(kPollTimeoutMs);
+        const std::uint64_t wokeUs = rt.begin();
+        std::uint32_t touched = 0;
+        while (const RxDatagram* rx = rio_.ready().readSlot()) {
+            const int slot = dispatch(*rx);
+            if (slot >= 0) {
+                touched |= 1u << slot;
+            }
+            rio_.returned().tryPush(rx->slot);
+            rio_.ready().release();
+        }
+        for (std::size_t i = 0; i < kStreams; ++i) {
+            if (touched & (1u << i)) {
+                pool_.wake(i);
+            }
+        }
+        const int current = slotOf(rio_.lastStreamId());
+        remote_.service(wokeUs, current >= 0 ? pipelines_[static_cast<std::size_t>(current)] : nullptr);
+        rt.end(wokeUs);
+    }
+}
+
+int MultiStreamReceiver::dispatch(const RxDatagram& rx) {
+    const std::uint8_t* bytes = rio_.data(rx.slot);
+    PacketHeader header;
+    if (!readPacketHeader(bytes, rx.size, header)) {
+        return -1;
+    }
+    const int slot = claimSlot(header.streamId, rx.arrivalUs);
+    if (slot < 0) {
+        unassigned_.fetch_add(1, std::memory_order_relaxed);
+        return -1;
+    }
+    lastSeenUs_[static_cast<std::size_t>(slot)] = rx.arrivalUs;
+
+    StreamPipeline::Inbox& inbox = pipelines_[static_cast<std::size_t>(slot)]->inbox();
+    StreamPacket* packet = inbox.writeSlot();
+    if (packet == nullptr) {
+        inboxOverflows_.fetch_add(1, std::memory_order_relaxed);
+        return slot;
+    }
+    packet->arrivalUs = rx.arrivalUs;
+    packet->size = rx.size;
+    std::memcpy(packet->bytes, bytes, rx.size);
+    inbox.publish();
+    return slot;
+}
+
+int MultiStreamReceiver::claimSlot(std::uint8_t streamId, std::uint64_t nowUs) {
+    const int existing = slotOf_[streamId].load(std::memory_order_relaxed);
+    if (existing >= 0) {
+        return existing;
+    }
+    for (std::size_t i = 0; i < kStreams; ++i) {
+        const bool free = idOf_[i] < 0;
+        // A slot is reclaimed only once its worker has also given up on it,
+        // so the old sender's state is gone before the new one arrives.
+        const bool stale = !free && nowUs - lastSeenUs_[i] > StreamPipeline::kIdleTimeoutUs &&
+                           !pipelines_[i]->active();
+        if (free || stale) {
+            if (stale) {
+                slotOf_[static_cast<std::size_t>(idOf_[i])].store(-1, std::memory_order_relaxed);
+            }
+            idOf_[i] = streamId;
+            pipelines_[i]->setStreamId(streamId);
+            slotOf_[streamId].store(static_cast<int>(i), std::memory_order_relaxed);
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+} // namespace aas
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "aas/rt_arena.h"
+#include "decode_pool.h"
+#include "jitter_buffer.h"
+#include "remote_control.h"
+#include "rio_receiver.h"
+#include "rt_thread.h"
+#include "shared_audio_output.h"
+#include "stream_mixer.h"
+#include "stream_pipeline.h"
+
+namespace aas {
+
+struct MultiStreamConfig {
+    std::uint16_t port = 0;
+    std::size_t outputChannels = 2;
+    /// Largest device period the renderer will ask for.
+    std::size_t maxPeriodFrames = 512;
+    JitterBufferConfig jitter;
+    DecodePoolConfig pool;
+    /// Core for the receive thread (decode workers default to 2..).
+    int receiveCore = 1;
+    /// When set, each pipeline also publishes its decoded frames to the
+    /// file mapping `sharedOutputName` + "." + slot, e.g. `Local\aas.0`
+    /// (docs/protocol.md, Shared-Memory Output). Empty turns it off.
+    std::wstring sharedOutputName;
+    std::size_t sharedOutputSlots = SharedAudioOutput::kDefaultSlots;
+};
+
+/// One receiver process serving up to StreamMixer::kMaxStreams senders on
+/// one UDP port.
+///
+/// The receive thread polls the RioReceiver and demultiplexes by the
+/// header's stream id: the first datagram from a new id claims a free
+/// pipeline (or one idle for longer than StreamPipeline::kIdleTimeoutUs),
+/// each datagram is copied into that pipeline's inbox, and the RIO buffer
+/// goes straight back to the receiver. The copy keeps RIO's single-consumer
+/// return ring intact however many workers there are, and costs a few
+/// kilobytes per second per stream. Decode-pool workers run the pipelines
+/// and mixer() is handed to the WASAPI or ASIO renderer as its source.
+///
+/// Clock sync stays single-sender: the attached ClockSync, if any, follows
+/// whichever phone sent last. So does remote(): the receive thread services
+/// its control channel every loop against the pipeline of the last sender.
+///
+/// With a shared output name configured, start() maps one shared-memory
+/// output per pipeline slot and the decode workers publish every decoded
+/// frame there too. A mapping that cannot be created leaves that slot
+/// without one; sharedOutputOpen() says which are up.
+///
+/// The pipelines and the mixer, with every buffer they own, are built in
+/// one locked RtArena sized from their storageBytes()/arenaBytes() helpers,
+/// so the receive, decode and render threads never touch heap pages.
+/// arenaLocked() and arenaOverflowBytes() report whether that held.
+class MultiStreamReceiver {
+public:
+    explicit MultiStreamReceiver(const MultiStreamConfig& config);
+    ~MultiStreamReceiver();
+    MultiStreamReceiver(const MultiStreamReceiver&) = delete;
+    MultiStreamReceiver& operator=(const MultiStreamReceiver&) = delete;
+
+    bool start();
+    void stop();
+
+    StreamMixer& mixer() { return *mixer_; }
+    RioReceiver& receiver() { return rio_; }
+    RemoteControl& remote() { return remote_; }
+    StreamPipeline& pipeline(std::size_t slot) { return *pipelines_[slot]; }
+    /// Pipeline slot serving `streamId`, or -1.
+    int slotOf(std::uint8_t streamId) const { return slotOf_[streamId].load(std::memory_order_relaxed); }
+    bool sharedOutputOpen(std::size_t slot) const { return shared_[slot].isOpen(); }
+
+    bool arenaLocked() const { return arena_.locked(); }
+    /// Non-zero when the arena was undersized and something went to the heap.
+    std::size_t arenaOverflowBytes() const { return arena_.overflowBytes(); }
+
+    /// Datagrams dropped because every slot was busy.
+    std::uint64_t unassigned() const { return unassigned_.load(std::memory_order_relaxed); }
+    /// Datagrams dropped because a stream's inbox was full.
+    std::uint64_t inboxOverflows() const { return inboxOverflows_.load(std::memory_order_relaxed); }
+
+private:
+    static constexpr std::size_t kStreams = StreamMixer::kMaxStreams;
+
+    void receiveLoop(RtScope& rt);
+    /// Copies one datagram to its stream's inbox; returns the slot, or -1.
+    int dispatch(const RxDatagram& rx);
+    int claimSlot(std::uint8_t streamId, std::uint64_t nowUs);
+
+    // Declared first so the objects in it outlive the threads using them.
+    RtArena arena_;
+    MultiStreamConfig config_;
+    RioReceiver rio_;
+    RemoteControl remote_{rio_};
+    std::array<StreamPipeline*, kStreams> pipelines_{};
+    std::array<SharedAudioOutput, kStreams> shared_;
+    StreamMixer* mixer_ = nullptr;
+    DecodePool pool_;
+    RtThread receiveThread_;
+    std::atomic<bool> running_{false};
+
+    // Receive thread owns the assignment; others only read it.
+    std::array<std::atomic<int>, 256> slotOf_;
+    std::array<std::uint64_t, kStreams> lastSeenUs_{};
+    std::array<int, kStreams> idOf_{};
+
+    std::atomic<std::uint64_t> unassigned_{0};
+    std::atomic<std::uint64_t> inboxOverflows_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,123 @@
+#include "opus_frame_decoder.h"
+
+#include <opus.h>
+#include <opus_multistream.h>
+
+#include <algorithm>
+
+#include "aas/opus_layout.h"
+
+namespace aas {
+
+namespace {
+
+std::size_t largestDecoderSize() {
+    std::size_t bytes = 0;
+    for (std::size_t channels = 1; channels <= kMaxFrameChannels; ++channels) {
+        const OpusStreamLayout layout = opusStreamLayout(channels);
+        const opus_int32 size = opus_multistream_decoder_get_size(layout.streams, layout.coupled);
+        bytes = std::max(bytes, static_cast<std::size_t>(std::max<opus_int32>(size, 0)));
+    }
+    return bytes;
+}
+
+} // namespace
+
+OpusFrameDecoder::OpusFrameDecoder() : state_(largestDecoderSize()) {
+    decoder_ = reinterpret_cast<OpusMSDecoder*>(state_.data());
+}
+
+OpusFrameDecoder::~OpusFrameDecoder() = default;
+
+std::size_t OpusFrameDecoder::storageBytes() {
+    // Plus alignment padding for the vector.
+    return largestDecoderSize() + kCacheLineSize;
+}
+
+bool OpusFrameDecoder::configure(CodecId codec, std::size_t channels) {
+    if (channels_ == channels && codec_ == codec) {
+        return true;
+    }
+    const OpusStreamLayout layout = opusStreamLayout(channels);
+    channels_ = 0;
+    held_ = false;
+    if (layout.channels == 0 ||
+        opus_multistream_decoder_init(decoder_, static_cast<opus_int32>(kSampleRateHz), layout.channels,
+                                      layout.streams, layout.coupled, layout.mapping.data()) != OPUS_OK) {
+        return false;
+    }
+    codec_ = codec;
+    channels_ = channels;
+    return true;
+}
+
+bool OpusFrameDecoder::decode(CodecId codec, const BufferedPacket& packet, AudioFrame& out) {
+    if (packet.units == 0 || packet.units > kMaxPacketFrameUnits || packet.part >= packet.units) {
+        return false;
+    }
+    const auto firstSeq = static_cast<std::uint16_t>(packet.seq - packet.part);
+    const std::uint32_t firstClock =
+        packet.sampleClock - static_cast<std::uint32_t>(packet.part * kFrameSamples);
+    if (!held_ || heldSeq_ != firstSeq || heldSampleClock_ != firstClock || heldUnits_ != packet.units) {
+        // Codec 4 payloads start with the channel count; plain Opus carries
+        // it in the TOC byte.
+        const unsigned char* data = packet.payload;
+        std::size_t size = packet.size;
+        int channels = 0;
+        if (codec == CodecId::kOpusMultistream) {
+            if (size < 2) {
+                return false;
+            }
+            channels = data[0];
+            ++data;
+            --size;
+        } else {
+            channels = size == 0 ? OPUS_INVALID_PACKET : opus_packet_get_nb_channels(data);
+        }
+        if (channels <= 0 || !configure(codec, static_cast<std::size_t>(channels))) {
+            return false;
+        }
+        const int samples = static_cast<int>(packet.units * kFrameSamples);
+        if (opus_multistream_decode_float(decoder_, data, static_cast<opus_int32>(size), pcm_, samples, 0) !=
+            samples) {
+            held_ = false;
+            return false;
+        }
+        held_ = true;
+        heldSeq_ = firstSeq;
+        heldSampleClock_ = firstClock;
+        heldUnits_ = packet.units;
+    }
+    const float* part = pcm_ + packet.part * kFrameSamples * channels_;
+    std::copy_n(part, kFrameSamples * channels_, out.samples);
+    out.sampleClock = packet.sampleClock;
+    out.channels = static_cast<std::uint16_t>(channels_);
+    out.flags = 0;
+    out.captureUs = 0;
+    out.callbackUs = 0;
+    return true;
+}
+
+bool OpusFrameDecoder::conceal(AudioFrame& out) {
+    if (channels_ == 0) {
+        return false;
+    }
+    const int samples = static_cast<int>(kFrameSamples);
+    if (opus_multistream_decode_float(decoder_, nullptr, 0, out.samples, samples, 0) != samples) {
+        return false;
+    }
+    out.channels = static_cast<std::uint16_t>(channels_);
+    out.flags = 0;
+    out.captureUs = 0;
+    out.callbackUs = 0;
+    return true;
+}
+
+void OpusFrameDecoder::reset() {
+    if (channels_ != 0) {
+        opus_multistream_decoder_ctl(decoder_, OPUS_RESET_STATE);
+    }
+    held_ = false;
+}
+
+} // namespace aas
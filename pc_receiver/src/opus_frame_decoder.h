@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/aggregate.h"
+#include "aas/audio_format.h"
+#include "aas/packet_header.h"
+#include "aas/rt_arena.h"
+#include "jitter_buffer.h"
+
+struct OpusMSDecoder;
+
+namespace aas {
+
+/// Per-stream libopus decoder for CodecId::kOpus and kOpusMultistream.
+///
+/// Both codecs go through one multistream decoder: a plain mono or stereo
+/// Opus packet is a one-stream multistream packet, and the family 1 layouts
+/// for one and two channels (aas/opus_layout.h) are exactly that. The
+/// decoder is re-initialised in place when the channel count or codec
+/// changes, so the state is sized once, for eight channels, in the
+/// constructor (from the current RtArena when there is one) and decode()
+/// never allocates.
+///
+/// A 5-20 ms frame is stored in every slot it covers, but Opus cannot pick
+/// one 2.5 ms part out of a packet, so the first of its slots to be played
+/// decodes all of it and the following slots are served from the held PCM.
+/// A slot of a frame that is not held (its first part was lost) decodes the
+/// frame itself. Decode thread only.
+class OpusFrameDecoder {
+public:
+    OpusFrameDecoder();
+    ~OpusFrameDecoder();
+    OpusFrameDecoder(const OpusFrameDecoder&) = delete;
+    OpusFrameDecoder& operator=(const OpusFrameDecoder&) = delete;
+
+    /// Bytes the constructor allocates, for sizing the session RtArena.
+    static std::size_t storageBytes();
+
+    /// Writes the 2.5 ms slot `packet` plays. False for a malformed packet
+    /// or one that does not decode to its frame units.
+    bool decode(CodecId codec, const BufferedPacket& packet, AudioFrame& out);
+    /// Fills `out` from the decoder's own concealment, continuing the last
+    /// decoded frame. False before anything was decoded.
+    bool conceal(AudioFrame& out);
+    void reset();
+
+private:
+    bool configure(CodecId codec, std::size_t channels);
+
+    ArenaVector<unsigned char> state_;
+    OpusMSDecoder* decoder_ = nullptr;
+    CodecId codec_ = CodecId::kOpus;
+    std::size_t channels_ = 0;  // 0 until configured
+
+    // The last frame decoded, by its first slot.
+    bool held_ = false;
+    std::uint16_t heldSeq_ = 0;
+    std::uint32_t heldSampleClock_ = 0;
+    std::uint8_t heldUnits_ = 0;
+    float pcm_[kMaxPacketFrameUnits * kFrameSamples * kMaxFrameChannels] = {};
+};
+
+} // namespace aas
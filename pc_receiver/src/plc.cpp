@@ -0,0 +1,154 @@
+#include "plc.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace aas {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct MergeTable {
+    std::array<float, PacketLossConcealer::kMergeSamples> fadeIn{};
+
+    MergeTable() {
+        for (std::size_t i = 0; i < fadeIn.size(); ++i) {
+            const double phase = (static_cast<double>(i) + 0.5) / fadeIn.size();
+            fadeIn[i] = static_cast<float>(0.5 - 0.5 * std::cos(kPi * phase));
+        }
+    }
+};
+
+// Built once during static initialisation, never on the audio thread.
+const MergeTable kMerge;
+
+} // namespace
+
+void PacketLossConcealer::onGoodFrame(AudioFrame& frame) {
+    if (concealing_ && frame.channels == channels_) {
+        for (std::size_t i = 0; i < kMergeSamples; ++i) {
+            const float in = kMerge.fadeIn[i];
+            for (std::size_t ch = 0; ch < channels_; ++ch) {
+                float& s = frame.samples[i * channels_ + ch];
+                s = in * s + (1.0f - in) * extrapolate(ch, concealed_ + i);
+            }
+        }
+    }
+    concealing_ = false;
+    push(frame);
+}
+
+void PacketLossConcealer::conceal(AudioFrame& out) {
+    out.channels = static_cast<std::uint16_t>(channels_);
+    out.sampleClock = nextSampleClock_;
+    out.flags = 0;
+    out.captureUs = 0;
+    out.callbackUs = 0;
+
+    if (filled_ < kMaxLag + kTemplateSamples) {
+        // Not enough signal to imitate yet.
+        std::fill(std::begin(out.samples), std::end(out.samples), 0.0f);
+        nextSampleClock_ += static_cast<std::uint32_t>(kFrameSamples);
+        return;
+    }
+    if (!concealing_) {
+        lag_ = findLag();
+        concealed_ = 0;
+        concealing_ = true;
+    }
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        for (std::size_t ch = 0; ch < channels_; ++ch) {
+            out.samples[i * channels_ + ch] = extrapolate(ch, concealed_ + i);
+        }
+    }
+    concealed_ += kFrameSamples;
+    nextSampleClock_ += static_cast<std::uint32_t>(kFrameSamples);
+}
+
+float PacketLossConcealer::extrapolate(std::size_t ch, std::size_t n) const {
+    if (n >= kSilentAfterSamples) {
+        return 0.0f;
+    }
+    const float gain = (n < kFullLevelSamples)
+                           ? 1.0f
+                           : 1.0f - static_cast<float>(n - kFullLevelSamples) /
+                                        static_cast<float>(kSilentAfterSamples - kFullLevelSamples);
+    const float* h = history_[ch].data();
+    return gain * h[kHistorySamples - lag_ + (n % lag_)];
+}
+
+std::size_t PacketLossConcealer::findLag() const {
+    // Template: the most recent samples, mixed down to mono.
+    float mono[kHistorySamples];
+    for (std::size_t i = 0; i < kHistorySamples; ++i) {
+        float sum = 0.0f;
+        for (std::size_t ch = 0; ch < channels_; ++ch) {
+            sum += history_[ch][i];
+        }
+        mono[i] = sum;
+    }
+    const float* t = mono + kHistorySamples - kTemplateSamples;
+    float templateEnergy = 0.0f;
+    for (std::size_t i = 0; i < kTemplateSamples; ++i) {
+        templateEnergy += t[i] * t[i];
+    }
+    if (templateEnergy < 1e-9f) {
+        return kMaxLag;
+    }
+
+    // Candidate energy is slid one sample per lag instead of recomputed.
+    const float* c = t - kMinLag;
+    float candidateEnergy = 0.0f;
+    for (std::size_t i = 0; i < kTemplateSamples; ++i) {
+        candidateEnergy += c[i] * c[i];
+    }
+    float best = kMinCorrelation;
+    std::size_t bestLag = kMaxLag;
+    for (std::size_t lag = kMinLag; lag <= kMaxLag; ++lag) {
+        c = t - lag;
+        if (lag > kMinLag) {
+            candidateEnergy += c[0] * c[0] - c[kTemplateSamples] * c[kTemplateSamples];
+        }
+        float dot = 0.0f;
+        for (std::size_t i = 0; i < kTemplateSamples; ++i) {
+            dot += t[i] * c[i];
+        }
+        if (dot <= 0.0f || candidateEnergy <= 1e-9f) {
+            continue;
+        }
+        const float corr = dot / std::sqrt(templateEnergy * candidateEnergy);
+        if (corr > best) {
+            best = corr;
+            bestLag = lag;
+        }
+    }
+    return bestLag;
+}
+
+void PacketLossConcealer::push(const AudioFrame& frame) {
+    channels_ = std::clamp<std::size_t>(frame.channels, 1, kMaxFrameChannels);
+    for (std::size_t ch = 0; ch < channels_; ++ch) {
+        float* h = history_[ch].data();
+        std::memmove(h, h + kFrameSamples, (kHistorySamples - kFrameSamples) * sizeof(float));
+        float* dst = h + kHistorySamples - kFrameSamples;
+        for (std::size_t i = 0; i < kFrameSamples; ++i) {
+            dst[i] = frame.samples[i * channels_ + ch];
+        }
+    }
+    filled_ = std::min(kHistorySamples, filled_ + kFrameSamples);
+    nextSampleClock_ = frame.sampleClock + static_cast<std::uint32_t>(kFrameSamples);
+}
+
+void PacketLossConcealer::reset() {
+    for (auto& h : history_) {
+        h.fill(0.0f);
+    }
+    filled_ = 0;
+    concealing_ = false;
+    concealed_ = 0;
+    lag_ = kMaxLag;
+}
+
+} // namespace aas
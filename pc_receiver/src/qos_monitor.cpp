@@ -0,0 +1,123 @@
+#include "qos_monitor.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+namespace {
+
+constexpr std::int64_t kNoTransit = std::numeric_limits<std::int64_t>::max();
+
+} // namespace
+
+QosMonitor::QosMonitor() { reset(); }
+
+void QosMonitor::reset() {
+    haveStream_ = false;
+    unwrappedSamples_ = 0;
+    windowMinUs_.fill(kNoTransit);
+    windowBucket_ = 0;
+    clearInterval(0);
+}
+
+void QosMonitor::clearInterval(std::uint64_t nowUs) {
+    intervalStartUs_ = nowUs;
+    datagrams_ = 0;
+    withTos_ = 0;
+    maxDelayUs_ = 0;
+    tosCounts_.fill(0);
+    delayBuckets_.fill(0);
+}
+
+std::uint32_t QosMonitor::transitAboveMinUs(std::uint32_t sampleClock, std::uint64_t arrivalUs) {
+    // Signed step so reordered datagrams move backwards correctly.
+    unwrappedSamples_ += static_cast<std::int32_t>(sampleClock - lastSampleClock_);
+    lastSampleClock_ = sampleClock;
+    const std::int64_t transitUs =
+        static_cast<std::int64_t>(arrivalUs) - unwrappedSamples_ * 1000000 / kSampleRateHz;
+
+    while (arrivalUs >= windowBucketEndUs_) {
+        windowBucket_ = (windowBucket_ + 1) % kMinWindowBuckets;
+        windowMinUs_[windowBucket_] = kNoTransit;
+        windowBucketEndUs_ += kMinWindowBucketUs;
+    }
+    windowMinUs_[windowBucket_] = std::min(windowMinUs_[windowBucket_], transitUs);
+    const std::int64_t baseUs = *std::min_element(windowMinUs_.begin(), windowMinUs_.end());
+    return static_cast<std::uint32_t>(
+        std::min<std::int64_t>(transitUs - baseUs, std::numeric_limits<std::uint32_t>::max()));
+}
+
+bool QosMonitor::onDatagram(std::uint8_t streamId, std::uint32_t sampleClock, std::uint64_t arrivalUs,
+                            bool haveTos, std::uint8_t tos) {
+    if (haveStream_ && streamId != streamId_) {
+        if (arrivalUs < lastArrivalUs_ + kReportIntervalUs) {
+            return false;
+        }
+        // The old stream went quiet. The new one's sample clock says
+        // nothing about the old one's, and neither does its marking.
+        reset();
+    }
+    if (!haveStream_) {
+        haveStream_ = true;
+        streamId_ = streamId;
+        lastSampleClock_ = sampleClock;
+        windowBucketEndUs_ = arrivalUs + kMinWindowBucketUs;
+        clearInterval(arrivalUs);
+    }
+    lastArrivalUs_ = arrivalUs;
+
+    const std::uint32_t delayUs = transitAboveMinUs(sampleClock, arrivalUs);
+    ++datagrams_;
+    maxDelayUs_ = std::max(maxDelayUs_, delayUs);
+    ++delayBuckets_[LatencyHistogram::bucketOf(delayUs)];
+    if (haveTos) {
+        ++withTos_;
+        ++tosCounts_[tos];
+    }
+    return true;
+}
+
+std::uint32_t QosMonitor::quantileUs(double q) const {
+    if (datagrams_ == 0) {
+        return 0;
+    }
+    const auto rank = static_cast<std::uint64_t>(q * static_cast<double>(datagrams_ - 1));
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < delayBuckets_.size(); ++i) {
+        seen += delayBuckets_[i];
+        if (seen > rank) {
+            return std::min(LatencyHistogram::bucketLowUs(i), maxDelayUs_);
+        }
+    }
+    return maxDelayUs_;
+}
+
+std::size_t QosMonitor::pollReport(std::uint64_t nowUs, std::uint8_t* out) {
+    if (!haveStream_ || nowUs < intervalStartUs_ + kReportIntervalUs) {
+        return 0;
+    }
+    QosReport report{};
+    report.kind = TimingKind::kQosReport;
+    const std::uint64_t intervalMs = (nowUs - intervalStartUs_) / 1000;
+    report.intervalMs = static_cast<std::uint16_t>(std::min<std::uint64_t>(intervalMs, 0xFFFF));
+    report.datagrams = datagrams_;
+    if (withTos_ > 0) {
+        const auto dominant = std::max_element(tosCounts_.begin(), tosCounts_.end());
+        report.tos = static_cast<std::uint8_t>(dominant - tosCounts_.begin());
+        report.tosMatching = *dominant;
+        report.flags |= kQosTosKnown;
+    }
+    report.delayP50Us = quantileUs(0.50);
+    report.delayP99Us = quantileUs(0.99);
+    report.delayMaxUs = maxDelayUs_;
+    published_.store(report);
+
+    const std::uint8_t streamId = streamId_;
+    clearInterval(nowUs);
+    return writeQosReportDatagram(report, streamId, out);
+}
+
+} // namespace aas
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/histogram.h"
+#include "aas/qos_report.h"
+#include "aas/seqlock.h"
+
+namespace aas {
+
+/// Receiver half of the QoS check (docs/protocol.md, QoS Reports), run by
+/// the PC's receive thread for one sender at a time. It keeps to the stream
+/// it has until that goes quiet for a report interval, so two phones
+/// streaming at once do not reset it on every datagram.
+///
+/// Every media datagram contributes the TOS byte it arrived with (read from
+/// IP_RECVTOS control data) and its one-way transit: arrival time minus
+/// the sender's sample clock, above the fastest datagram of the last two
+/// seconds, so neither the clock offset nor a slow drift matters. Once per
+/// kReportIntervalUs pollReport() sums the interval into a QosReport for
+/// the phone, which compares the DSCP with what it sent.
+///
+/// onDatagram() and pollReport() belong to the receive thread; lastReport()
+/// may be read from any thread.
+class QosMonitor {
+public:
+    static constexpr std::uint64_t kReportIntervalUs = 1000000;
+
+    QosMonitor();
+
+    /// One media datagram from `streamId`. `haveTos` is false when the
+    /// datagram came without an IP_TOS control message. Returns false if
+    /// the monitor is following another stream.
+    bool onDatagram(std::uint8_t streamId, std::uint32_t sampleClock, std::uint64_t arrivalUs,
+                    bool haveTos, std::uint8_t tos);
+
+    /// Writes a report datagram into `out` (kMaxDatagramBytes) when one is
+    /// due and returns its size, 0 otherwise.
+    std::size_t pollReport(std::uint64_t nowUs, std::uint8_t* out);
+
+    /// The last report sent, for the UI.
+    QosReport lastReport() const { return published_.load(); }
+
+    void reset();
+
+private:
+    static constexpr std::uint32_t kMinWindowBucketUs = 100000;
+    static constexpr std::size_t kMinWindowBuckets = 20;
+
+    std::uint32_t transitAboveMinUs(std::uint32_t sampleClock, std::uint64_t arrivalUs);
+    std::uint32_t quantileUs(double q) const;
+    void clearInterval(std::uint64_t nowUs);
+
+    bool haveStream_ = false;
+    std::uint8_t streamId_ = 0;
+    std::uint64_t lastArrivalUs_ = 0;
+
+    // Sample clocks unwrapped into a 64-bit timeline, as in JitterBuffer.
+    std::uint32_t lastSampleClock_ = 0;
+    std::int64_t unwrappedSamples_ = 0;
+    std::array<std::int64_t, kMinWindowBuckets> windowMinUs_{};
+    std::uint64_t windowBucketEndUs_ = 0;
+    std::size_t windowBucket_ = 0;
+
+    // The current interval. Buckets are LatencyHistogram's, without the
+    // atomics: only this thread ever sees them.
+    std::uint64_t intervalStartUs_ = 0;
+    std::uint32_t datagrams_ = 0;
+    std::uint32_t withTos_ = 0;
+    std::uint32_t maxDelayUs_ = 0;
+    std::array<std::uint32_t, 256> tosCounts_{};
+    std::array<std::uint32_t, LatencyHistogram::kBuckets> delayBuckets_{};
+
+    SeqLock<QosReport> published_;
+};
+
+} // namespace aas
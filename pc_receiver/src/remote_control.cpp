@@ -0,0 +1,135 @@
+#include "remote_control.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "rio_receiver.h"
+#include "stream_pipeline.h"
+
+namespace aas {
+
+namespace {
+
+std::uint16_t permille(std::uint64_t count, std::uint64_t total) {
+    return total == 0 ? 0 : static_cast<std::uint16_t>(std::min<std::uint64_t>(count * 1000 / total, 1000));
+}
+
+} // namespace
+
+RemoteControl::RemoteControl(RioReceiver& rio) : rio_(rio) {
+    channel_.setHoldPeer(true);
+    rio_.setControlChannel(&channel_);
+}
+
+RemoteControl::~RemoteControl() { rio_.setControlChannel(nullptr); }
+
+bool RemoteControl::postGain(ControlType type, std::uint16_t value, std::uint16_t rampSamples) {
+    GainCommand command{};
+    command.value = value;
+    command.rampSamples = rampSamples;
+    if (!channel_.post(ControlMessage::make(type, command))) {
+        return false;
+    }
+    rio_.wake();
+    return true;
+}
+
+bool RemoteControl::setSenderVolume(float gain, std::uint16_t rampSamples) {
+    const float q12 = std::round(std::clamp(gain, 0.0f, kMaxRemoteGain) * kUnityGainQ12);
+    return postGain(ControlType::kVolume, static_cast<std::uint16_t>(q12), rampSamples);
+}
+
+bool RemoteControl::pauseSender(bool paused, std::uint16_t rampSamples) {
+    return postGain(ControlType::kPause, paused ? 1 : 0, rampSamples);
+}
+
+bool RemoteControl::requestCodec(const CodecRequest& request) {
+    if (!channel_.post(ControlMessage::make(ControlType::kCodecRequest, request))) {
+        return false;
+    }
+    rio_.wake();
+    return true;
+}
+
+void RemoteControl::service(std::uint64_t nowUs, StreamPipeline* pipeline) {
+    bool gainChanged = false;
+    ControlMessage message;
+    while (channel_.receive(message)) {
+        // Codec requests and reports only travel towards the phone.
+        gainChanged |= applyGainCommand(message, gain_);
+    }
+    if (pipeline == nullptr) {
+        return;
+    }
+    if (gainChanged || pipeline != gainTarget_) {
+        pipeline->setGain(gain_);
+        gainTarget_ = pipeline;
+    }
+
+    if (!channel_.havePeer()) {
+        return;
+    }
+    if (pipeline != reported_) {
+        // New sender: start its deltas from here.
+        reported_ = pipeline;
+        const JitterBufferStats& jitter = pipeline->jitterStats();
+        const FecDecoderStats& fec = pipeline->fecStats();
+        lastReceived_ = jitter.received.load(std::memory_order_relaxed);
+        lastLate_ = jitter.late.load(std::memory_order_relaxed);
+        lastLost_ = jitter.lost.load(std::memory_order_relaxed);
+        lastRecovered_ = fec.recoveredByParity.load(std::memory_order_relaxed) +
+                         fec.recoveredByRedundancy.load(std::memory_order_relaxed);
+        lastReportUs_ = nowUs;
+        reportDueUs_ = nowUs + kReportIntervalUs;
+        return;
+    }
+    if (nowUs >= reportDueUs_) {
+        sendReport(nowUs, *pipeline);
+    }
+}
+
+void RemoteControl::sendReport(std::uint64_t nowUs, StreamPipeline& pipeline) {
+    const JitterBufferStats& jitter = pipeline.jitterStats();
+    const FecDecoderStats& fec = pipeline.fecStats();
+    const std::uint64_t received = jitter.received.load(std::memory_order_relaxed);
+    const std::uint64_t late = jitter.late.load(std::memory_order_relaxed);
+    const std::uint64_t lost = jitter.lost.load(std::memory_order_relaxed);
+    const std::uint64_t recovered = fec.recoveredByParity.load(std::memory_order_relaxed) +
+                                    fec.recoveredByRedundancy.load(std::memory_order_relaxed);
+
+    // Counters only grow while the pipeline keeps its stream; a reset in
+    // between shows up as a step back and the interval is skipped.
+    if (received >= lastReceived_ && late >= lastLate_ && lost >= lastLost_ && recovered >= lastRecovered_) {
+        // Recovered slots are not counted as received, and a late arrival
+        // was already played as lost.
+        const std::uint64_t lostDelta = lost - lastLost_;
+        const std::uint64_t recoveredDelta = recovered - lastRecovered_;
+        const std::uint64_t due = (received - lastReceived_) + recoveredDelta + lostDelta;
+
+        ReceiverReport report{};
+        report.intervalMs =
+            static_cast<std::uint16_t>(std::min<std::uint64_t>((nowUs - lastReportUs_) / 1000, 0xFFFF));
+        report.lossPermille = permille(lostDelta + recoveredDelta, due);
+        report.residualLossPermille = permille(lostDelta, due);
+        report.latePermille = permille(late - lastLate_, due);
+        report.delayP95Us = jitter.p95DelayUs.load(std::memory_order_relaxed);
+        report.delayP99Us = jitter.p99DelayUs.load(std::memory_order_relaxed);
+        report.targetDepthFrames = static_cast<std::uint8_t>(
+            std::min<std::uint32_t>(jitter.targetDepthFrames.load(std::memory_order_relaxed), 0xFF));
+        report.depthFrames = static_cast<std::uint8_t>(
+            std::min<std::uint32_t>(jitter.currentDepthFrames.load(std::memory_order_relaxed), 0xFF));
+        report.slots = static_cast<std::uint32_t>(std::min<std::uint64_t>(due, 0xFFFFFFFFu));
+        if (due > 0) {
+            channel_.enqueue(ControlMessage::make(ControlType::kReceiverReport, report));
+        }
+    }
+
+    lastReceived_ = received;
+    lastLate_ = late;
+    lastLost_ = lost;
+    lastRecovered_ = recovered;
+    lastReportUs_ = nowUs;
+    reportDueUs_ = nowUs + kReportIntervalUs;
+}
+
+} // namespace aas
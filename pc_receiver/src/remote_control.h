@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/control_channel.h"
+#include "aas/gain_ramp.h"
+
+namespace aas {
+
+class RioReceiver;
+class StreamPipeline;
+
+/// PC end of the control channel (docs/protocol.md, Control Channel).
+///
+/// Owns the ControlChannel the RioReceiver multiplexes on the media socket.
+/// The UI thread sends commands to the phone (capture volume, pause, codec
+/// and bitrate) and wakes the receive thread so they leave at once. The
+/// receive thread calls service() every loop: volume and pause commands
+/// from the phone go to the pipeline it streams into, where they take
+/// effect sample-accurately after decode, and every kReportIntervalUs the
+/// pipeline's loss, lateness and jitter-buffer delay go back to the phone
+/// as a ReceiverReport for its FEC and batching controllers.
+///
+/// Like clock sync, reports follow the most recent sender, but the channel
+/// itself stays with the phone it is talking to: control from a second
+/// phone is ignored until the first has been quiet for
+/// ControlChannel::kPeerQuietUs, as QosMonitor does with a second stream.
+class RemoteControl {
+public:
+    static constexpr std::uint64_t kReportIntervalUs = 250000;
+
+    /// Attaches the channel to `rio`, which must outlive this object.
+    explicit RemoteControl(RioReceiver& rio);
+    ~RemoteControl();
+    RemoteControl(const RemoteControl&) = delete;
+    RemoteControl& operator=(const RemoteControl&) = delete;
+
+    /// UI thread. Each returns false when the command queue is full.
+    /// `rampSamples` 0 ramps over one frame.
+    bool setSenderVolume(float gain, std::uint16_t rampSamples = 0);
+    bool pauseSender(bool paused, std::uint16_t rampSamples = 0);
+    bool requestCodec(const CodecRequest& request);
+
+    /// Receive thread. `pipeline` is the one serving the current sender,
+    /// null while there is none.
+    void service(std::uint64_t nowUs, StreamPipeline* pipeline);
+
+    const ControlChannelStats& stats() const { return channel_.stats(); }
+
+private:
+    bool postGain(ControlType type, std::uint16_t value, std::uint16_t rampSamples);
+    void sendReport(std::uint64_t nowUs, StreamPipeline& pipeline);
+
+    RioReceiver& rio_;
+    ControlChannel channel_;
+
+    // Receive thread.
+    GainSetting gain_{};
+    StreamPipeline* gainTarget_ = nullptr;
+    StreamPipeline* reported_ = nullptr;
+    std::uint64_t reportDueUs_ = 0;
+    std::uint64_t lastReportUs_ = 0;
+    std::uint64_t lastReceived_ = 0;
+    std::uint64_t lastLate_ = 0;
+    std::uint64_t lastLost_ = 0;
+    std::uint64_t lastRecovered_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "sample_convert.h"
+
+namespace aas {
+
+/// Driver-owned, non-interleaved output for one period (ASIO half-buffers).
+struct PlanarOutput {
+    /// One buffer per output channel, each `frames` samples of `format`.
+    void* const* channels = nullptr;
+    std::size_t channelCount = 0;
+    DeviceSampleFormat format = DeviceSampleFormat::kFloat32;
+};
+
+/// What an output backend pulls from once per device period.
+///
+/// Called on the backend's real-time render thread, so implementations must
+/// not block, lock or allocate.
+class RenderSource {
+public:
+    /// Frames per block in the default renderPlanar(): small enough that the
+    /// float block stays in L1 between render() and the conversion.
+    static constexpr std::size_t kPlanarBlockFrames = 32;
+    static constexpr std::size_t kMaxPlanarChannels = 8;
+
+    virtual ~RenderSource() = default;
+
+    /// Fills `frames` interleaved float frames of `channels` channels at
+    /// 48 kHz. `presentUs` is the receiver-clock time the first frame is
+    /// expected to leave the DAC. Anything the source cannot supply must be
+    /// written as silence.
+    virtual void render(float* out, std::size_t frames, std::size_t channels,
+                        std::uint64_t presentUs) = 0;
+
+    /// Fills driver buffers directly in their native format. The default
+    /// renders kPlanarBlockFrames at a time into a stack block and converts
+    /// each channel straight into its buffer, so no period-sized float
+    /// buffer sits between the source and the driver.
+    virtual void renderPlanar(const PlanarOutput& out, std::size_t frames, std::uint64_t presentUs) {
+        const std::size_t channels = std::min(out.channelCount, kMaxPlanarChannels);
+        const std::size_t sampleBytes = bytesPerSample(out.format);
+        float block[kPlanarBlockFrames * kMaxPlanarChannels];
+        for (std::size_t done = 0; done < frames; done += kPlanarBlockFrames) {
+            const std::size_t n = std::min(kPlanarBlockFrames, frames - done);
+            render(block, n, channels, presentUs + done * 1000000u / kSampleRateHz);
+            for (std::size_t ch = 0; ch < channels; ++ch) {
+                convertChannel(block + ch, channels, out.format,
+                               static_cast<std::uint8_t*>(out.channels[ch]) + done * sampleBytes, n);
+            }
+        }
+    }
+};
+
+} // namespace aas
@@ -0,0 +1,420 @@
+#include "rio_receiver.h"
+
+#include <ws2tcpip.h>
+
+#include <cstring>
+
+#include "aas/clock.h"
+#include "aas/control_channel.h"
+#include "aas/packet_header.h"
+#include "aas/timing.h"
+#include "clock_sync.h"
+#include "qos_monitor.h"
+
+namespace aas {
+
+namespace {
+
+// Region layout: receive payloads, receive addresses, send payloads, send
+// addresses, receive control data. One registration covers all five.
+constexpr std::size_t kAddrBytes = sizeof(SOCKADDR_INET);
+/// Room for the IP_TOS message (WSA_CMSG_SPACE(sizeof(INT)) is 24 on x64)
+/// and one more the stack might add.
+constexpr std::size_t kControlBytes = 64;
+constexpr std::size_t kRecvAddrOffset = RioReceiver::kSlots * kMaxDatagramBytes;
+constexpr std::size_t kSendDataOffset = kRecvAddrOffset + RioReceiver::kSlots * kAddrBytes;
+constexpr std::size_t kSendAddrOffset = kSendDataOffset + RioReceiver::kSendSlots * kMaxDatagramBytes;
+constexpr std::size_t kControlOffset = kSendAddrOffset + RioReceiver::kSendSlots * kAddrBytes;
+constexpr std::size_t kRegionBytes = kControlOffset + RioReceiver::kSlots * kControlBytes;
+
+/// Request contexts with this bit set are send completions.
+constexpr std::uintptr_t kSendContext = std::uintptr_t{1} << 31;
+
+static_assert(RioReceiver::kSendSlots <= 32, "send slots are tracked in a 32-bit mask");
+constexpr std::uint32_t kAllSendSlots =
+    static_cast<std::uint32_t>((std::uint64_t{1} << RioReceiver::kSendSlots) - 1);
+
+} // namespace
+
+RioReceiver::~RioReceiver() { close(); }
+
+bool RioReceiver::open(std::uint16_t port) {
+    close();
+
+    socket_ = ::WSASocketW(AF_INET, SOCK_DGRAM, IPPROTO_UDP, nullptr, 0, WSA_FLAG_REGISTERED_IO);
+    if (socket_ == INVALID_SOCKET) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (::bind(socket_, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    // Optional (Windows 10 1903 and later): without it the QoS reports
+    // only say the TOS is unknown.
+    const DWORD recvTos = 1;
+    tosAvailable_ = ::setsockopt(socket_, IPPROTO_IP, IP_RECVTOS, reinterpret_cast<const char*>(&recvTos),
+                                 sizeof(recvTos)) == 0;
+
+    GUID tableId = WSAID_MULTIPLE_RIO;
+    DWORD bytes = 0;
+    if (::WSAIoctl(socket_, SIO_GET_MULTIPLE_EXTENSION_FUNCTION_POINTER, &tableId, sizeof(tableId),
+                   &rio_, sizeof(rio_), &bytes, nullptr, nullptr) != 0) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    region_ = static_cast<std::uint8_t*>(
+        ::VirtualAlloc(nullptr, kRegionBytes, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (region_ == nullptr) {
+        lastError_ = static_cast<int>(::GetLastError());
+        close();
+        return false;
+    }
+    bufferId_ = rio_.RIORegisterBuffer(reinterpret_cast<PCHAR>(region_), static_cast<DWORD>(kRegionBytes));
+    if (bufferId_ == RIO_INVALID_BUFFERID) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    completionEvent_ = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    if (completionEvent_ == nullptr) {
+        lastError_ = static_cast<int>(::GetLastError());
+        close();
+        return false;
+    }
+    RIO_NOTIFICATION_COMPLETION notification{};
+    notification.Type = RIO_EVENT_COMPLETION;
+    notification.Event.EventHandle = completionEvent_;
+    notification.Event.NotifyReset = TRUE;
+    // Sized for every outstanding receive plus every send slot.
+    completionQueue_ =
+        rio_.RIOCreateCompletionQueue(static_cast<DWORD>(kSlots + kSendSlots), &notification);
+    if (completionQueue_ == RIO_INVALID_CQ) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+    requestQueue_ = rio_.RIOCreateRequestQueue(socket_, static_cast<ULONG>(kSlots), 1,
+                                               static_cast<ULONG>(kSendSlots), 1, completionQueue_,
+                                               completionQueue_, nullptr);
+    if (requestQueue_ == RIO_INVALID_RQ) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    for (std::uint32_t slot = 0; slot < kSlots; ++slot) {
+        if (!post(slot, RIO_MSG_DEFER)) {
+            close();
+            return false;
+        }
+    }
+    if (!rio_.RIOReceiveEx(requestQueue_, nullptr, 0, nullptr, nullptr, nullptr, nullptr,
+                           RIO_MSG_COMMIT_ONLY, nullptr)) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+
+    lastError_ = 0;
+    notifyArmed_ = false;
+    sendBusy_ = 0;
+    havePeer_ = false;
+    haveQosPeer_ = false;
+    haveControlPeer_ = false;
+    return true;
+}
+
+void RioReceiver::close() {
+    if (completionQueue_ != RIO_INVALID_CQ) {
+        rio_.RIOCloseCompletionQueue(completionQueue_);
+        completionQueue_ = RIO_INVALID_CQ;
+    }
+    // Closing the socket also frees its request queue.
+    if (socket_ != INVALID_SOCKET) {
+        ::closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+    requestQueue_ = RIO_INVALID_RQ;
+    if (bufferId_ != RIO_INVALID_BUFFERID) {
+        rio_.RIODeregisterBuffer(bufferId_);
+        bufferId_ = RIO_INVALID_BUFFERID;
+    }
+    if (region_ != nullptr) {
+        ::VirtualFree(region_, 0, MEM_RELEASE);
+        region_ = nullptr;
+    }
+    if (completionEvent_ != nullptr) {
+        ::CloseHandle(completionEvent_);
+        completionEvent_ = nullptr;
+    }
+}
+
+const SOCKADDR_INET& RioReceiver::peer(std::uint32_t slot) const {
+    return *reinterpret_cast<const SOCKADDR_INET*>(region_ + kRecvAddrOffset +
+                                                   static_cast<std::size_t>(slot) * kAddrBytes);
+}
+
+bool RioReceiver::receivedTos(std::uint32_t slot, std::uint8_t& tos) const {
+    const std::uint8_t* control = region_ + kControlOffset + static_cast<std::size_t>(slot) * kControlBytes;
+    std::size_t offset = 0;
+    while (offset + sizeof(WSACMSGHDR) <= kControlBytes) {
+        WSACMSGHDR header;
+        std::memcpy(&header, control + offset, sizeof(header));
+        if (header.cmsg_len < sizeof(WSACMSGHDR) || offset + header.cmsg_len > kControlBytes) {
+            break;  // end of the list (post() zeroes the first header)
+        }
+        if (header.cmsg_level == IPPROTO_IP && header.cmsg_type == IP_TOS) {
+            tos = control[offset + WSA_CMSGDATA_ALIGN(sizeof(WSACMSGHDR))];
+            return true;
+        }
+        offset += WSA_CMSGHDR_ALIGN(header.cmsg_len);
+    }
+    return false;
+}
+
+bool RioReceiver::post(std::uint32_t slot, DWORD flags) {
+    RIO_BUF buf{};
+    buf.BufferId = bufferId_;
+    buf.Offset = static_cast<ULONG>(static_cast<std::size_t>(slot) * kMaxDatagramBytes);
+    buf.Length = static_cast<ULONG>(kMaxDatagramBytes);
+    RIO_BUF remote{};
+    remote.BufferId = bufferId_;
+    remote.Offset = static_cast<ULONG>(kRecvAddrOffset + static_cast<std::size_t>(slot) * kAddrBytes);
+    remote.Length = static_cast<ULONG>(kAddrBytes);
+    RIO_BUF control{};
+    control.BufferId = bufferId_;
+    control.Offset = static_cast<ULONG>(kControlOffset + static_cast<std::size_t>(slot) * kControlBytes);
+    control.Length = static_cast<ULONG>(kControlBytes);
+    // The completion does not say how much control data came back, so an
+    // empty list must read as empty.
+    std::memset(region_ + control.Offset, 0, sizeof(WSACMSGHDR));
+    if (!rio_.RIOReceiveEx(requestQueue_, &buf, 1, nullptr, &remote, &control, nullptr, flags,
+                           reinterpret_cast<PVOID>(static_cast<std::uintptr_t>(slot)))) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+    return true;
+}
+
+void RioReceiver::commitPosts() {
+    rio_.RIOReceiveEx(requestQueue_, nullptr, 0, nullptr, nullptr, nullptr, nullptr,
+                      RIO_MSG_COMMIT_ONLY, nullptr);
+}
+
+bool RioReceiver::send(const std::uint8_t* data, std::size_t size, const SOCKADDR_INET& to) {
+    if (socket_ == INVALID_SOCKET || size > kMaxDatagramBytes) {
+        return false;
+    }
+    std::uint32_t index = 0;
+    while (index < kSendSlots && (sendBusy_ & (1u << index)) != 0) {
+        ++index;
+    }
+    if (index == kSendSlots) {
+        return false;
+    }
+
+    const std::size_t dataOffset = kSendDataOffset + index * kMaxDatagramBytes;
+    const std::size_t addrOffset = kSendAddrOffset + index * kAddrBytes;
+    std::memcpy(region_ + dataOffset, data, size);
+    std::memcpy(region_ + addrOffset, &to, kAddrBytes);
+
+    RIO_BUF buf{};
+    buf.BufferId = bufferId_;
+    buf.Offset = static_cast<ULONG>(dataOffset);
+    buf.Length = static_cast<ULONG>(size);
+    RIO_BUF remote{};
+    remote.BufferId = bufferId_;
+    remote.Offset = static_cast<ULONG>(addrOffset);
+    remote.Length = static_cast<ULONG>(kAddrBytes);
+    if (!rio_.RIOSendEx(requestQueue_, &buf, 1, nullptr, &remote, nullptr, nullptr, 0,
+                        reinterpret_cast<PVOID>(kSendContext | index))) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+    sendBusy_ |= 1u << index;
+    return true;
+}
+
+void RioReceiver::wake() {
+    if (completionEvent_ != nullptr) {
+        ::SetEvent(completionEvent_);
+    }
+}
+
+void RioReceiver::repostReturned() {
+    std::size_t posted = 0;
+    std::uint32_t slot = 0;
+    while (returned_.tryPop(slot)) {
+        if (post(slot, RIO_MSG_DEFER)) {
+            ++posted;
+        }
+    }
+    if (posted > 0) {
+        commitPosts();
+    }
+}
+
+std::size_t RioReceiver::inspect(std::uint32_t slot, std::size_t size, std::uint64_t arrivalUs) {
+    std::uint8_t* bytes = mutableData(slot);
+    PacketHeader header;
+    if (!readPacketHeader(bytes, size, header)) {
+        return 0;
+    }
+    if (header.hasFlag(kFlagTiming) && header.frameUnits == 0 &&
+        size >= kPacketHeaderBytes + kTimingMessageBytes) {
+        TimingMessage probe;
+        std::memcpy(&probe, bytes + size - kTimingMessageBytes, kTimingMessageBytes);
+        if (probe.kind == TimingKind::kProbe) {
+            // Echo on the path it came in on, and leave lastPeer_ alone:
+            // clock requests follow the media path, not the idle one.
+            probe.kind = TimingKind::kProbeEcho;
+            probe.t2 = arrivalUs;
+            probe.t3 = monotonicMicros();
+            std::uint8_t echo[kPacketHeaderBytes + kTimingMessageBytes];
+            send(echo, writeTimingDatagram(probe, header.streamId, echo), peer(slot));
+            return 0;
+        }
+    }
+    if (header.hasFlag(kFlagControl) && header.frameUnits == 0) {
+        if (control_ != nullptr && control_->onDatagram(bytes, size, arrivalUs)) {
+            controlPeer_ = peer(slot);
+            haveControlPeer_ = true;
+        }
+        return 0;
+    }
+    lastPeer_ = peer(slot);
+    lastStreamId_ = header.streamId;
+    havePeer_ = true;
+    if (qos_ != nullptr && header.frameUnits != 0) {
+        std::uint8_t tos = 0;
+        const bool haveTos = receivedTos(slot, tos);
+        if (qos_->onDatagram(header.streamId, header.sampleClock, arrivalUs, haveTos, tos)) {
+            qosPeer_ = lastPeer_;
+            haveQosPeer_ = true;
+        }
+    }
+
+    if (header.hasFlag(kFlagTiming)) {
+        TimingMessage message;
+        if (!stripTimingTrailer(bytes, size, message)) {
+            return 0;
+        }
+        if (clock_ != nullptr) {
+            clock_->onResponse(message, arrivalUs);
+        }
+    }
+    return header.frameUnits == 0 ? 0 : size;
+}
+
+std::size_t RioReceiver::drainCompletions() {
+    const ULONG count = rio_.RIODequeueCompletion(completionQueue_, results_,
+                                                  static_cast<ULONG>(kSlots + kSendSlots));
+    if (count == RIO_CORRUPT_CQ) {
+        lastError_ = WSAEINVAL;
+        return 0;
+    }
+
+    // One stamp per batch: completions dequeued together arrived within
+    // the same wake-up, well inside the jitter buffer's 250 us bins.
+    const std::uint64_t nowUs = monotonicMicros();
+    std::size_t published = 0;
+    std::size_t reposted = 0;
+    for (ULONG i = 0; i < count; ++i) {
+        const RIORESULT& result = results_[i];
+        const auto context = static_cast<std::uintptr_t>(result.RequestContext);
+        if ((context & kSendContext) != 0) {
+            sendBusy_ &= ~(1u << (context & ~kSendContext));
+            continue;
+        }
+        const auto slot = static_cast<std::uint32_t>(context);
+        std::size_t size = 0;
+        if (result.Status == 0 && result.BytesTransferred > 0) {
+            size = inspect(slot, result.BytesTransferred, nowUs);
+        }
+        RxDatagram* out = (size > 0) ? ready_.writeSlot() : nullptr;
+        if (out == nullptr) {
+            // Error (e.g. WSAECONNRESET from a stale ICMP), a timing-only
+            // datagram, or the decode thread is not keeping up: recycle the
+            // buffer immediately.
+            if (post(slot, RIO_MSG_DEFER)) {
+                ++reposted;
+            }
+            continue;
+        }
+        out->slot = slot;
+        out->size = static_cast<std::uint16_t>(size);
+        out->arrivalUs = nowUs;
+        ready_.publish();
+        ++published;
+    }
+    if (reposted > 0) {
+        commitPosts();
+    }
+    return published;
+}
+
+std::size_t RioReceiver::poll(DWORD timeoutMs) {
+    if (socket_ == INVALID_SOCKET) {
+        return 0;
+    }
+    repostReturned();
+
+    if (clock_ != nullptr && havePeer_) {
+        std::uint8_t request[kMaxDatagramBytes];
+        const std::size_t size = clock_->pollRequest(monotonicMicros(), lastStreamId_, request);
+        if (size > 0) {
+            send(request, size, lastPeer_);
+        }
+    }
+    if (qos_ != nullptr && haveQosPeer_) {
+        std::uint8_t report[kMaxDatagramBytes];
+        const std::size_t size = qos_->pollReport(monotonicMicros(), report);
+        if (size > 0) {
+            send(report, size, qosPeer_);
+        }
+    }
+    if (control_ != nullptr && (haveControlPeer_ || havePeer_)) {
+        // Stops early, keeping the rest queued, when the send slots run out.
+        std::uint8_t datagram[kMaxDatagramBytes];
+        const SOCKADDR_INET& to = haveControlPeer_ ? controlPeer_ : lastPeer_;
+        std::size_t size = 0;
+        while (sendBusy_ != kAllSendSlots &&
+               (size = control_->poll(monotonicMicros(), lastStreamId_, datagram)) > 0) {
+            send(datagram, size, to);
+        }
+    }
+
+    std::size_t published = drainCompletions();
+    if (published > 0) {
+        return published;
+    }
+
+    if (!notifyArmed_) {
+        // WSAEALREADY: still armed from before a wake() ended the wait.
+        const INT notified = rio_.RIONotify(completionQueue_);
+        if (notified != ERROR_SUCCESS && notified != WSAEALREADY) {
+            return 0;
+        }
+        notifyArmed_ = true;
+    }
+    if (::WaitForSingleObject(completionEvent_, timeoutMs) == WAIT_OBJECT_0) {
+        // RIONotify is one-shot; re-arm on the next empty poll. After a
+        // wake() it may still be armed, which the next RIONotify reports.
+        notifyArmed_ = false;
+        published = drainCompletions();
+    }
+    return published;
+}
+
+} // namespace aas
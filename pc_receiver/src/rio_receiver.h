@@ -0,0 +1,154 @@
+#pragma once
+
+#include <winsock2.h>
+#include <ws2ipdef.h>
+#include <mswsock.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/spsc_ring.h"
+
+namespace aas {
+
+class ClockSync;
+class ControlChannel;
+class QosMonitor;
+
+/// A datagram sitting in one of the receiver's registered buffers.
+struct RxDatagram {
+    std::uint32_t slot = 0;
+    std::uint16_t size = 0;
+    std::uint64_t arrivalUs = 0;
+};
+
+/// Receive stage of the PC pipeline on Registered I/O.
+///
+/// One registered region is carved into kSlots datagram buffers and every
+/// one of them is kept posted as an outstanding RIOReceiveEx, so the NIC
+/// driver writes packets (and their source addresses) straight into memory
+/// the decode thread reads. The receive thread calls poll(); completions are
+/// handed to the decode thread as slot descriptors through ready(), and the
+/// decode thread gives each slot back through returned() once the payload
+/// has been consumed (copied into the jitter buffer). The receive thread
+/// reposts returned slots, since a RIO request queue may only be driven from
+/// one thread; for the same reason send() is receive-thread only.
+///
+/// With a ClockSync attached, poll() also runs the clock exchange: it sends
+/// due timing requests to the most recent sender and strips timing trailers
+/// off incoming datagrams before the decode thread sees them. Path probes
+/// from the phone (docs/protocol.md, Path Probing) are echoed to their
+/// source address here, whether or not a ClockSync is attached.
+///
+/// Each receive also carries a control buffer for the IP_TOS byte
+/// (IP_RECVTOS). With a QosMonitor attached, poll() feeds it every media
+/// datagram's TOS and arrival and sends its reports back to where the
+/// monitored stream last came from (docs/protocol.md, QoS Reports).
+///
+/// With a ControlChannel attached, control datagrams (kFlagControl) are fed
+/// to it here and never reach the decode thread, and poll() sends whatever
+/// it has due to the address control last came from, or the media sender
+/// before that. Another thread that posts a command calls wake() so the
+/// command leaves within microseconds rather than at the next timeout.
+///
+/// WSAStartup must have been called by the application before open().
+class RioReceiver {
+public:
+    static constexpr std::size_t kSlots = 128;
+    static constexpr std::size_t kSendSlots = 8;
+    using ReadyRing = SpscRing<RxDatagram, kSlots>;
+    using ReturnRing = SpscRing<std::uint32_t, kSlots>;
+
+    RioReceiver() = default;
+    ~RioReceiver();
+    RioReceiver(const RioReceiver&) = delete;
+    RioReceiver& operator=(const RioReceiver&) = delete;
+
+    /// Binds a UDP socket to `port` on all interfaces and posts every
+    /// buffer. Returns false and records a WSA error code on failure.
+    bool open(std::uint16_t port);
+    void close();
+    bool isOpen() const { return socket_ != INVALID_SOCKET; }
+
+    void setClockSync(ClockSync* clock) { clock_ = clock; }
+    void setQosMonitor(QosMonitor* qos) { qos_ = qos; }
+    void setControlChannel(ControlChannel* control) { control_ = control; }
+    /// False when the stack refused IP_RECVTOS; reports then say the TOS
+    /// is unknown.
+    bool tosAvailable() const { return tosAvailable_; }
+
+    /// Receive thread only. Reposts returned slots, sends a due timing
+    /// request, then waits up to `timeoutMs` for completions and publishes
+    /// them to ready(). Returns the number of datagrams published.
+    std::size_t poll(DWORD timeoutMs);
+
+    /// Receive thread only. Queues one datagram to `to` from a registered
+    /// send buffer; returns false if all send buffers are in flight.
+    bool send(const std::uint8_t* data, std::size_t size, const SOCKADDR_INET& to);
+
+    /// Any thread. Ends the receive thread's current wait in poll() early.
+    void wake();
+
+    /// Stream id of the most recent media datagram.
+    std::uint8_t lastStreamId() const { return lastStreamId_; }
+
+    /// Decode thread: payload bytes of a slot taken from ready().
+    const std::uint8_t* data(std::uint32_t slot) const {
+        return region_ + static_cast<std::size_t>(slot) * kMaxDatagramBytes;
+    }
+
+    /// Source address of the datagram in `slot`.
+    const SOCKADDR_INET& peer(std::uint32_t slot) const;
+
+    /// TOS byte the datagram in `slot` arrived with, from its control data.
+    bool receivedTos(std::uint32_t slot, std::uint8_t& tos) const;
+
+    ReadyRing& ready() { return ready_; }
+    ReturnRing& returned() { return returned_; }
+
+    SOCKET socket() const { return socket_; }
+    int lastError() const { return lastError_; }
+
+private:
+    bool post(std::uint32_t slot, DWORD flags);
+    void commitPosts();
+    void repostReturned();
+    std::size_t drainCompletions();
+    /// Handles timing/no-audio datagrams on the receive thread. Returns the
+    /// size left for the decode thread, 0 if the slot should be recycled.
+    std::size_t inspect(std::uint32_t slot, std::size_t size, std::uint64_t arrivalUs);
+
+    std::uint8_t* mutableData(std::uint32_t slot) {
+        return region_ + static_cast<std::size_t>(slot) * kMaxDatagramBytes;
+    }
+
+    SOCKET socket_ = INVALID_SOCKET;
+    RIO_EXTENSION_FUNCTION_TABLE rio_{};
+    std::uint8_t* region_ = nullptr;
+    RIO_BUFFERID bufferId_ = RIO_INVALID_BUFFERID;
+    RIO_CQ completionQueue_ = RIO_INVALID_CQ;
+    RIO_RQ requestQueue_ = RIO_INVALID_RQ;
+    HANDLE completionEvent_ = nullptr;
+    bool notifyArmed_ = false;
+    int lastError_ = 0;
+
+    std::uint32_t sendBusy_ = 0;  // bit per send slot
+    ClockSync* clock_ = nullptr;
+    QosMonitor* qos_ = nullptr;
+    ControlChannel* control_ = nullptr;
+    bool tosAvailable_ = false;
+    bool havePeer_ = false;
+    SOCKADDR_INET lastPeer_{};
+    bool haveQosPeer_ = false;
+    SOCKADDR_INET qosPeer_{};
+    bool haveControlPeer_ = false;
+    SOCKADDR_INET controlPeer_{};
+    std::uint8_t lastStreamId_ = 0;
+
+    RIORESULT results_[kSlots + kSendSlots];
+    ReadyRing ready_;
+    ReturnRing returned_;
+};
+
+} // namespace aas
@@ -0,0 +1,35 @@
+#include "rt_thread.h"
+
+#include <avrt.h>
+
+#include "aas/rt_check_hooks.h"
+
+namespace aas {
+
+RtScope::RtScope(const RtThreadConfig& config)
+    : stats_(ThreadRegistry::instance().claim(config.role, config.budgetUs)) {
+    if (config.core >= 0 && ::SetThreadAffinityMask(::GetCurrentThread(), DWORD_PTR{1} << config.core) != 0) {
+        stats_.core.store(config.core, std::memory_order_relaxed);
+    }
+    DWORD taskIndex = 0;
+    task_ = ::AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+    if (task_ != nullptr) {
+        if (config.critical) {
+            ::AvSetMmThreadPriority(task_, AVRT_PRIORITY_CRITICAL);
+        }
+        stats_.grant.store(RtGrant::kMmcss, std::memory_order_relaxed);
+    } else if (::SetThreadPriority(::GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+        // MMCSS service disabled: the best a user-mode thread can do alone.
+        stats_.grant.store(RtGrant::kNice, std::memory_order_relaxed);
+    }
+    RtCheck::enterRealtime(config.role);
+}
+
+RtScope::~RtScope() {
+    RtCheck::leaveRealtime();
+    if (task_ != nullptr) {
+        ::AvRevertMmThreadCharacteristics(task_);
+    }
+}
+
+} // namespace aas
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <windows.h>
+
+#include <cstdint>
+#include <thread>
+#include <utility>
+
+#include "aas/clock.h"
+#include "aas/rt_check.h"
+#include "aas/thread_stats.h"
+
+namespace aas {
+
+/// Scheduling every receiver thread asks for. One place decides it, so a
+/// stage cannot forget MMCSS or run on the interrupt core by accident.
+struct RtThreadConfig {
+    ThreadRole role = ThreadRole::kCount;
+    /// Longest a cycle may stay busy before it counts as a deadline miss;
+    /// 0 = count cycles only.
+    std::uint32_t budgetUs = 0;
+    /// Logical core to pin to; -1 leaves placement to the scheduler.
+    int core = -1;
+    /// AVRT_PRIORITY_CRITICAL within the "Pro Audio" task (render paths);
+    /// otherwise the task's normal priority.
+    bool critical = false;
+};
+
+/// Applies an RtThreadConfig to the calling thread for the scope's
+/// lifetime and claims the thread's ThreadStats entry.
+///
+/// Every thread joins the MMCSS "Pro Audio" task: MMCSS raises it into the
+/// real-time priority band and keeps it there against the multimedia
+/// scheduler's throttling of ordinary high-priority threads. The task is
+/// released when the scope ends.
+class RtScope {
+public:
+    explicit RtScope(const RtThreadConfig& config);
+    ~RtScope();
+    RtScope(const RtScope&) = delete;
+    RtScope& operator=(const RtScope&) = delete;
+
+    ThreadStats& stats() { return stats_; }
+    RtGrant grant() const { return stats_.grant.load(std::memory_order_relaxed); }
+
+    /// Marks the start of a cycle's busy part (after the wait that ends
+    /// the previous one); returns the time to hand to end().
+    std::uint64_t begin() {
+        RtCheck::beginCycle();
+        return monotonicMicros();
+    }
+    /// Ends the cycle begun at `startUs`.
+    void end(std::uint64_t startUs) {
+        RtCheck::endCycle();
+        cycle(monotonicMicros() - startUs);
+    }
+
+    /// Ends one cycle that was busy for `activeUs`.
+    void cycle(std::uint64_t activeUs) { stats_.record(activeUs); }
+
+private:
+    ThreadStats& stats_;
+    HANDLE task_ = nullptr;
+};
+
+/// std::thread that runs `body(RtScope&)` under `config`.
+class RtThread {
+public:
+    RtThread() = default;
+    ~RtThread() { join(); }
+    RtThread(const RtThread&) = delete;
+    RtThread& operator=(const RtThread&) = delete;
+
+    template <typename Body>
+    void start(const RtThreadConfig& config, Body&& body) {
+        join();
+        thread_ = std::thread([config, body = std::forward<Body>(body)]() mutable {
+            RtScope scope(config);
+            body(scope);
+        });
+    }
+
+    bool joinable() const { return thread_.joinable(); }
+    void join() {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+private:
+    std::thread thread_;
+};
+
+} // namespace aas
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AAS_CONVERT_SSE2 1
+#endif
+
+namespace aas {
+
+/// Output sample formats the render backends accept from drivers.
+enum class DeviceSampleFormat : std::uint8_t {
+    kFloat32,
+    kInt32,  ///< full-scale 32-bit, also used for 24-in-32 containers
+    kInt24,  ///< packed 3-byte little-endian
+    kInt16,
+};
+
+inline constexpr std::size_t bytesPerSample(DeviceSampleFormat format) {
+    return format == DeviceSampleFormat::kInt16   ? 2
+           : format == DeviceSampleFormat::kInt24 ? 3
+                                                  : 4;
+}
+
+namespace detail {
+
+// Largest float below 1.0: scaled by 2^31 it still fits an int32.
+inline constexpr float kMaxBelowOne = 0.99999994f;
+
+inline float clampUnit(float v) { return std::min(std::max(v, -1.0f), kMaxBelowOne); }
+
+#if defined(AAS_CONVERT_SSE2)
+/// Four samples of one channel from an interleaved block of stride 1 or 2.
+/// Stride 2 reads eight floats, so the caller keeps one group in hand at
+/// the end of the buffer.
+inline __m128 loadChannel(const float* in, std::size_t stride) {
+    if (stride == 1) {
+        return _mm_loadu_ps(in);
+    }
+    return _mm_shuffle_ps(_mm_loadu_ps(in), _mm_loadu_ps(in + 4), _MM_SHUFFLE(2, 0, 2, 0));
+}
+#endif
+
+} // namespace detail
+
+/// Converts `frames` samples of one channel, read from float data with
+/// `stride` floats between consecutive samples, into a contiguous buffer
+/// of `format`. Stride 1 converts interleaved data in place of a channel
+/// loop; stride 2 extracts one side of a stereo block (ASIO half-buffers are
+/// planar). Both take the SSE2 path on x86; other strides and the packed
+/// 24-bit format are scalar.
+inline void convertChannel(const float* in, std::size_t stride, DeviceSampleFormat format, void* out,
+                           std::size_t frames) {
+    std::size_t i = 0;
+#if defined(AAS_CONVERT_SSE2)
+    if (stride <= 2 && format != DeviceSampleFormat::kInt24) {
+        // Stride 2 peeks one float past the group; stop a group early.
+        const std::size_t simdEnd = (stride == 1) ? frames : (frames > 0 ? frames - 1 : 0);
+        const __m128 lo = _mm_set1_ps(-1.0f);
+        const __m128 hi = _mm_set1_ps(detail::kMaxBelowOne);
+        switch (format) {
+        case DeviceSampleFormat::kFloat32: {
+            auto* dst = static_cast<float*>(out);
+            for (; i + 4 <= simdEnd; i += 4) {
+                _mm_storeu_ps(dst + i, detail::loadChannel(in + i * stride, stride));
+            }
+            break;
+        }
+        case DeviceSampleFormat::kInt32: {
+            auto* dst = static_cast<std::int32_t*>(out);
+            const __m128 scale = _mm_set1_ps(2147483648.0f);
+            for (; i + 4 <= simdEnd; i += 4) {
+                __m128 v = detail::loadChannel(in + i * stride, stride);
+                v = _mm_min_ps(_mm_max_ps(v, lo), hi);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_cvtps_epi32(_mm_mul_ps(v, scale)));
+            }
+            break;
+        }
+        case DeviceSampleFormat::kInt16: {
+            auto* dst = static_cast<std::int16_t*>(out);
+            const __m128 scale = _mm_set1_ps(32767.0f);
+            for (; i + 8 <= simdEnd; i += 8) {
+                const __m128 a = _mm_min_ps(_mm_max_ps(detail::loadChannel(in + i * stride, stride), lo), hi);
+                const __m128 b =
+                    _mm_min_ps(_mm_max_ps(detail::loadChannel(in + (i + 4) * stride, stride), lo), hi);
+                const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(_mm_mul_ps(a, scale)),
+                                                       _mm_cvtps_epi32(_mm_mul_ps(b, scale)));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+            }
+            break;
+        }
+        case DeviceSampleFormat::kInt24:
+            break;
+        }
+    }
+#endif
+
+    switch (format) {
+    case DeviceSampleFormat::kFloat32: {
+        auto* dst = static_cast<float*>(out);
+        for (; i < frames; ++i) {
+            dst[i] = in[i * stride];
+        }
+        break;
+    }
+    case DeviceSampleFormat::kInt32: {
+        auto* dst = static_cast<std::int32_t*>(out);
+        for (; i < frames; ++i) {
+            dst[i] = static_cast<std::int32_t>(std::lrintf(detail::clampUnit(in[i * stride]) * 2147483648.0f));
+        }
+        break;
+    }
+    case DeviceSampleFormat::kInt24: {
+        auto* dst = static_cast<std::uint8_t*>(out);
+        for (; i < frames; ++i) {
+            // Just below +1.0 rounds up to 2^23, which would wrap.
+            const auto v = std::min<std::int32_t>(
+                static_cast<std::int32_t>(std::lrintf(detail::clampUnit(in[i * stride]) * 8388608.0f)),
+                8388607);
+            dst[3 * i] = static_cast<std::uint8_t>(v);
+            dst[3 * i + 1] = static_cast<std::uint8_t>(v >> 8);
+            dst[3 * i + 2] = static_cast<std::uint8_t>(v >> 16);
+        }
+        break;
+    }
+    case DeviceSampleFormat::kInt16: {
+        auto* dst = static_cast<std::int16_t*>(out);
+        for (; i < frames; ++i) {
+            dst[i] = static_cast<std::int16_t>(std::lrintf(detail::clampUnit(in[i * stride]) * 32767.0f));
+        }
+        break;
+    }
+    }
+}
+
+} // namespace aas
@@ -0,0 +1,55 @@
+#include "shared_audio_output.h"
+
+#include <cstdint>
+
+namespace aas {
+
+SharedAudioOutput::~SharedAudioOutput() { close(); }
+
+bool SharedAudioOutput::open(const std::wstring& name, std::size_t slots) {
+    close();
+    const std::uint64_t bytes = sharedAudioBytes(slots);
+    mapping_ = ::CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                    static_cast<DWORD>(bytes >> 32), static_cast<DWORD>(bytes), name.c_str());
+    if (mapping_ == nullptr) {
+        lastError_ = ::GetLastError();
+        return false;
+    }
+    // An existing mapping (a consumer kept it open across a receiver
+    // restart) is reused; one too small for `slots` fails to map here.
+    view_ = ::MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, static_cast<SIZE_T>(bytes));
+    if (view_ == nullptr) {
+        lastError_ = ::GetLastError();
+        close();
+        return false;
+    }
+    bytes_ = static_cast<std::size_t>(bytes);
+    // init() writes every byte of the view, which also faults the pages in.
+    if (!writer_.init(view_, bytes_, slots)) {
+        lastError_ = ERROR_INVALID_PARAMETER;
+        close();
+        return false;
+    }
+    locked_ = ::VirtualLock(view_, bytes_) != 0;
+    lastError_ = 0;
+    return true;
+}
+
+void SharedAudioOutput::close() {
+    writer_ = SharedAudioWriter();
+    if (view_ != nullptr) {
+        if (locked_) {
+            ::VirtualUnlock(view_, bytes_);
+        }
+        ::UnmapViewOfFile(view_);
+        view_ = nullptr;
+    }
+    if (mapping_ != nullptr) {
+        ::CloseHandle(mapping_);
+        mapping_ = nullptr;
+    }
+    bytes_ = 0;
+    locked_ = false;
+}
+
+} // namespace aas
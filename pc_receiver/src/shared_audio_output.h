@@ -0,0 +1,57 @@
+#pragma once
+
+#include <windows.h>
+
+#include <cstddef>
+#include <string>
+
+#include "aas/shared_audio.h"
+
+namespace aas {
+
+/// Publishes one pipeline's decoded frames to a named, pagefile-backed file
+/// mapping that other processes on the machine read (docs/protocol.md,
+/// Shared-Memory Output).
+///
+/// A DAW plugin or OBS source maps it with SharedAudioClient and copies each
+/// 2.5 ms frame out with one memcpy, so nothing sits between the jitter
+/// buffer and the consumer but the decoder: no WASAPI output, no virtual
+/// cable and no second device buffer. Frames appear as the receiver's
+/// playout takes them, with the sender's sample clock.
+///
+/// open() and close() belong to a control thread while the pipeline's
+/// worker is stopped; the worker then publishes through writer(). The view
+/// is pre-faulted and, where the working set allows, locked, so publishing
+/// never page-faults.
+class SharedAudioOutput {
+public:
+    /// 160 ms: a consumer may fall this far behind before it is skipped
+    /// ahead.
+    static constexpr std::size_t kDefaultSlots = 64;
+
+    SharedAudioOutput() = default;
+    ~SharedAudioOutput();
+    SharedAudioOutput(const SharedAudioOutput&) = delete;
+    SharedAudioOutput& operator=(const SharedAudioOutput&) = delete;
+
+    /// Creates (or takes over) the mapping `name`, e.g. `Local\aas.0`.
+    /// Returns false and records the Win32 error on failure.
+    bool open(const std::wstring& name, std::size_t slots = kDefaultSlots);
+    void close();
+    bool isOpen() const { return view_ != nullptr; }
+
+    SharedAudioWriter& writer() { return writer_; }
+    /// False when VirtualLock refused the view; it is still pre-faulted.
+    bool locked() const { return locked_; }
+    DWORD lastError() const { return lastError_; }
+
+private:
+    HANDLE mapping_ = nullptr;
+    void* view_ = nullptr;
+    std::size_t bytes_ = 0;
+    bool locked_ = false;
+    DWORD lastError_ = 0;
+    SharedAudioWriter writer_;
+};
+
+} // namespace aas
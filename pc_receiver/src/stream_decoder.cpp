@@ -0,0 +1,134 @@
+#include "stream_decoder.h"
+
+#include <algorithm>
+
+#include "aas/lossless_codec.h"
+#include "aas/sample_format.h"
+
+namespace aas {
+
+bool StreamDecoder::decode(const Playout& playout, AudioFrame& out) {
+    switch (playout.action) {
+    case PlayoutAction::kWaiting:
+        return false;
+    case PlayoutAction::kNormal:
+        if (!decodePayload(*playout.primary, out)) {
+            conceal(out);
+            return true;
+        }
+        compressor_.carry(out);
+        break;
+    case PlayoutAction::kAccelerate:
+        if (decodePayload(*playout.primary, scratch_) && decodePayload(*playout.secondary, out)) {
+            const AudioFrame second = out;
+            compressor_.compress(scratch_, second, out);
+        } else {
+            conceal(out);
+            return true;
+        }
+        break;
+    case PlayoutAction::kConceal:
+    case PlayoutAction::kExpand:
+        conceal(out);
+        nextSampleClock_ = out.sampleClock + static_cast<std::uint32_t>(kFrameSamples);
+        return true;
+    case PlayoutAction::kComfortNoise:
+        out.sampleClock = nextSampleClock_;
+        compressor_.reset();
+        comfortNoise(out);
+        break;
+    }
+    plc_.onGoodFrame(out);
+    nextSampleClock_ = out.sampleClock + static_cast<std::uint32_t>(kFrameSamples);
+    return true;
+}
+
+bool StreamDecoder::decodePayload(const BufferedPacket& packet, AudioFrame& out) {
+    if (packet.silence) {
+        ComfortNoiseDescriptor cn;
+        if (!readComfortNoise(packet.payload, packet.size, cn)) {
+            ++decodeErrors_;
+            return false;
+        }
+        comfortNoise_.setDescriptor(cn);
+        out.sampleClock = packet.sampleClock;
+        comfortNoise(out);
+        return true;
+    }
+    if (codec_ == CodecId::kLossless) {
+        // Lossless frames are always one slot; batches use aggregates.
+        if (packet.units != 1 || !decodeLossless(packet.payload, packet.size, out)) {
+            ++decodeErrors_;
+            return false;
+        }
+        out.sampleClock = packet.sampleClock;
+        out.flags = 0;
+        out.captureUs = 0;
+        out.callbackUs = 0;
+        return true;
+    }
+    if (isOpus()) {
+        if (!opus_.decode(codec_, packet, out)) {
+            ++decodeErrors_;
+            return false;
+        }
+        return true;
+    }
+    if (codec_ != CodecId::kPcm16) {
+        // AAC is not in the codecs the receiver advertises; a sender that
+        // sends it anyway is counted here and concealed.
+        ++decodeErrors_;
+        return false;
+    }
+    // A longer PCM frame is stored once per slot; play this slot's part.
+    const std::size_t perChannel = kFrameSamples * sizeof(std::int16_t) * packet.units;
+    const std::size_t channels = perChannel == 0 ? 0 : packet.size / perChannel;
+    if (channels == 0 || channels > kMaxFrameChannels || packet.size != channels * perChannel ||
+        packet.part >= packet.units) {
+        ++decodeErrors_;
+        return false;
+    }
+    const std::uint8_t* pcm = packet.payload + kFrameSamples * channels * sizeof(std::int16_t) * packet.part;
+    out.sampleClock = packet.sampleClock;
+    out.channels = static_cast<std::uint16_t>(channels);
+    out.flags = 0;
+    out.captureUs = 0;
+    out.callbackUs = 0;
+    pcm16ToFloat(pcm, out.samples, kFrameSamples * channels);
+    return true;
+}
+
+void StreamDecoder::conceal(AudioFrame& out) {
+    // Concealment continues what was played, so anything the compressor
+    // still holds is dropped with the loss.
+    compressor_.reset();
+    // Opus continues from its own decoder state; the concealer then sees
+    // the result as a good frame, as it would a decoded one.
+    out.sampleClock = nextSampleClock_;
+    if (isOpus() && opus_.conceal(out)) {
+        plc_.onGoodFrame(out);
+    } else {
+        plc_.conceal(out);
+    }
+    concealed_.store(concealed_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void StreamDecoder::comfortNoise(AudioFrame& out) {
+    out.flags = 0;
+    out.captureUs = 0;
+    out.callbackUs = 0;
+    if (comfortNoise_.ready()) {
+        comfortNoise_.generate(out);
+    } else {
+        std::fill(out.samples, out.samples + kFrameSamples * out.channels, 0.0f);
+    }
+}
+
+void StreamDecoder::reset() {
+    plc_.reset();
+    compressor_.reset();
+    comfortNoise_.reset();
+    opus_.reset();
+}
+
+} // namespace aas
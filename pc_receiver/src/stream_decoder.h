@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/audio_format.h"
+#include "aas/comfort_noise.h"
+#include "aas/packet_header.h"
+#include "jitter_buffer.h"
+#include "opus_frame_decoder.h"
+#include "plc.h"
+#include "time_scale.h"
+
+namespace aas {
+
+/// Per-stream decode state: turns one jitter-buffer Playout into one
+/// AudioFrame.
+///
+/// PCM and lossless frames are decoded here, Opus and Opus multistream by
+/// the stream's OpusFrameDecoder behind decodePayload(). Lost and stretched
+/// frames come from the PacketLossConcealer, and every good frame passes
+/// through it so the first one after a gap is merged in without a step;
+/// Opus streams conceal with the decoder's own PLC instead, which carries
+/// on from its state. In DTX, silence
+/// descriptors and the skipped slots after them play shaped comfort noise
+/// from the ComfortNoiseGenerator, which also passes through the
+/// concealer, so a loss at speech onset extrapolates from the noise.
+/// Accelerated frames are pitch-aligned by the FrameCompressor, and decoded
+/// frames pass through it while it holds back the remainder of a cut.
+class StreamDecoder {
+public:
+    void setCodec(CodecId codec) { codec_ = codec; }
+    CodecId codec() const { return codec_; }
+
+    /// Produces the frame for `playout`. Returns false for kWaiting (no
+    /// frame).
+    bool decode(const Playout& playout, AudioFrame& out);
+
+    void reset();
+
+    std::uint64_t decodeErrors() const { return decodeErrors_; }
+    /// Frames produced by concealment (losses, expansions, decode errors).
+    std::uint64_t concealed() const { return concealed_.load(std::memory_order_relaxed); }
+
+private:
+    bool decodePayload(const BufferedPacket& packet, AudioFrame& out);
+    void conceal(AudioFrame& out);
+    void comfortNoise(AudioFrame& out);
+    bool isOpus() const { return codec_ == CodecId::kOpus || codec_ == CodecId::kOpusMultistream; }
+
+    CodecId codec_ = CodecId::kPcm16;
+    AudioFrame scratch_{};
+    PacketLossConcealer plc_;
+    FrameCompressor compressor_;
+    ComfortNoiseGenerator comfortNoise_;
+    OpusFrameDecoder opus_;
+    std::uint32_t nextSampleClock_ = 0;
+    std::uint64_t decodeErrors_ = 0;
+    std::atomic<std::uint64_t> concealed_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,89 @@
+#include "stream_mixer.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define AAS_MIXER_SSE 1
+#endif
+
+namespace aas {
+
+namespace {
+
+/// out[i] += gain * in[i]
+inline void mixAdd(float* out, const float* in, float gain, std::size_t count) {
+    std::size_t i = 0;
+#if defined(AAS_MIXER_SSE)
+    const __m128 g = _mm_set1_ps(gain);
+    for (; i + 8 <= count; i += 8) {
+        const __m128 a = _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(g, _mm_loadu_ps(in + i)));
+        const __m128 b = _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(g, _mm_loadu_ps(in + i + 4)));
+        _mm_storeu_ps(out + i, a);
+        _mm_storeu_ps(out + i + 4, b);
+    }
+#endif
+    for (; i < count; ++i) {
+        out[i] += gain * in[i];
+    }
+}
+
+} // namespace
+
+StreamMixer::StreamMixer(std::size_t maxPeriodFrames, std::size_t maxChannels)
+    : scratch_(maxPeriodFrames * maxChannels, 0.0f), maxFrames_(maxPeriodFrames) {}
+
+bool StreamMixer::attach(std::size_t slot, StreamPipeline* pipeline) {
+    if (slot >= kMaxStreams) {
+        return false;
+    }
+    slots_[slot].pipeline = pipeline;
+    return true;
+}
+
+void StreamMixer::setGain(std::size_t slot, float gain) {
+    if (slot < kMaxStreams) {
+        slots_[slot].gain.store(gain, std::memory_order_relaxed);
+    }
+}
+
+void StreamMixer::setMuted(std::size_t slot, bool muted) {
+    if (slot < kMaxStreams) {
+        slots_[slot].muted.store(muted, std::memory_order_relaxed);
+    }
+}
+
+void StreamMixer::render(float* out, std::size_t frames, std::size_t channels, std::uint64_t presentUs) {
+    frames = std::min(frames, maxFrames_);
+    const std::size_t samples = frames * channels;
+    std::memset(out, 0, samples * sizeof(float));
+    if (samples > scratch_.size()) {
+        return;
+    }
+
+    std::size_t active = 0;
+    for (Slot& slot : slots_) {
+        if (slot.pipeline == nullptr) {
+            continue;
+        }
+        if (!slot.pipeline->active()) {
+            if (slot.wasActive) {
+                slot.pipeline->ringSource().reset();
+                slot.wasActive = false;
+            }
+            continue;
+        }
+        slot.wasActive = true;
+        // A muted stream still renders so its drift loop and ring keep
+        // running; it just is not added.
+        slot.pipeline->source().render(scratch_.data(), frames, channels, presentUs);
+        if (!slot.muted.load(std::memory_order_relaxed)) {
+            mixAdd(out, scratch_.data(), slot.gain.load(std::memory_order_relaxed), samples);
+            ++active;
+        }
+    }
+    activeStreams_.store(active, std::memory_order_relaxed);
+}
+
+} // namespace aas
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/rt_arena.h"
+#include "render_source.h"
+#include "stream_pipeline.h"
+
+namespace aas {
+
+/// Mixes every active stream into one output device.
+///
+/// Streams are attached up front (one fixed slot each) so the render thread
+/// never sees a pipeline come or go; a slot whose pipeline is idle is
+/// skipped and its resampler reset once, so the stream restarts cleanly
+/// when the sender returns. Each stream renders into a scratch period and
+/// is accumulated with its gain by an SSE multiply-add (scalar elsewhere).
+/// Gains and mutes may be changed from any thread.
+class StreamMixer final : public RenderSource {
+public:
+    static constexpr std::size_t kMaxStreams = 8;
+
+    explicit StreamMixer(std::size_t maxPeriodFrames, std::size_t maxChannels = kMaxPlanarChannels);
+
+    /// Bytes the constructor allocates, for sizing the session RtArena.
+    static std::size_t storageBytes(std::size_t maxPeriodFrames, std::size_t maxChannels) {
+        return maxPeriodFrames * maxChannels * sizeof(float) + kCacheLineSize;
+    }
+
+    /// Control thread, before the renderer starts.
+    bool attach(std::size_t slot, StreamPipeline* pipeline);
+
+    void setGain(std::size_t slot, float gain);
+    void setMuted(std::size_t slot, bool muted);
+
+    void render(float* out, std::size_t frames, std::size_t channels, std::uint64_t presentUs) override;
+
+    /// Streams that contributed to the last period.
+    std::size_t activeStreams() const { return activeStreams_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        StreamPipeline* pipeline = nullptr;
+        std::atomic<float> gain{1.0f};
+        std::atomic<bool> muted{false};
+        bool wasActive = false;  // render thread only
+    };
+
+    std::array<Slot, kMaxStreams> slots_;
+    ArenaVector<float> scratch_;
+    std::size_t maxFrames_;
+    std::atomic<std::size_t> activeStreams_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,88 @@
+#include "stream_pipeline.h"
+
+#include "aas/clock.h"
+#include "aas/packet_header.h"
+
+namespace aas {
+
+StreamPipeline::StreamPipeline(std::size_t outputChannels, std::size_t maxPeriodFrames,
+                               const JitterBufferConfig& jitterConfig)
+    : jitter_(jitterConfig), source_(decoded_, outputChannels, maxPeriodFrames) {
+    source_.setJitterStats(&jitter_.stats());
+    source_.setTelemetry(&telemetry_);
+    jitter_.setDelayHistogram(&telemetry_.histogram(TelemetryStage::kNetwork));
+    source_.setTargetFillSamples(static_cast<double>(kDecodedLead * kFrameSamples));
+}
+
+std::size_t StreamPipeline::service(std::uint64_t nowUs) {
+    while (const StreamPacket* packet = inbox_.readSlot()) {
+        PacketHeader header;
+        if (readPacketHeader(packet->bytes, packet->size, header)) {
+            decoder_.setCodec(header.codec());
+        }
+        if (fec_.onDatagram(packet->bytes, packet->size, packet->arrivalUs, jitter_)) {
+            lastArrivalUs_ = packet->arrivalUs;
+            active_.store(true, std::memory_order_release);
+        }
+        inbox_.release();
+    }
+
+    if (!active_.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    // nowUs was taken before the inbox was drained, so the last arrival
+    // may be slightly newer than it.
+    if (nowUs > lastArrivalUs_ && nowUs - lastArrivalUs_ > kIdleTimeoutUs) {
+        resetDecodeSide();
+        active_.store(false, std::memory_order_release);
+        return 0;
+    }
+
+    std::size_t decoded = 0;
+    const std::size_t lead = decodedLead(source_.demandSamples());
+    while (decoded_.sizeApprox() < lead) {
+        AudioFrame* frame = decoded_.writeSlot();
+        if (frame == nullptr) {
+            break;
+        }
+        const Playout playout = jitter_.pop(nowUs);
+        if (playout.action == PlayoutAction::kWaiting) {
+            break;
+        }
+        telemetry_.record(TelemetryStage::kJitterDepth, jitter_.depthFrames() * kFrameDurationUs);
+        const std::uint64_t startUs = monotonicMicros();
+        decoder_.decode(playout, *frame);
+        ramp_.apply(*frame, gain_.load());
+        const std::uint64_t doneUs = monotonicMicros();
+        telemetry_.record(TelemetryStage::kDecode, doneUs - startUs);
+        if (shared_ != nullptr) {
+            shared_->publish(*frame, streamId(), doneUs);
+        }
+        decoded_.publish();
+        ++decoded;
+    }
+    return decoded;
+}
+
+TelemetryCounters StreamPipeline::counters() const {
+    const JitterBufferStats& jitter = jitter_.stats();
+    const FecDecoderStats& fec = fec_.stats();
+    TelemetryCounters counters{};
+    counterAt(counters, TelemetryCounter::kReceived) = jitter.received.load(std::memory_order_relaxed);
+    counterAt(counters, TelemetryCounter::kLate) = jitter.late.load(std::memory_order_relaxed);
+    counterAt(counters, TelemetryCounter::kLost) = jitter.lost.load(std::memory_order_relaxed);
+    counterAt(counters, TelemetryCounter::kRecoveredByFec) =
+        fec.recoveredByParity.load(std::memory_order_relaxed) +
+        fec.recoveredByRedundancy.load(std::memory_order_relaxed);
+    counterAt(counters, TelemetryCounter::kConcealed) = decoder_.concealed();
+    return counters;
+}
+
+void StreamPipeline::resetDecodeSide() {
+    jitter_.reset();
+    decoder_.reset();
+    fec_.reset();
+    ramp_.reset();
+}
+
+} // namespace aas
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "aas/datagram.h"
+#include "aas/gain_ramp.h"
+#include "aas/seqlock.h"
+#include "aas/shared_audio.h"
+#include "aas/spsc_ring.h"
+#include "aas/telemetry.h"
+#include "fec_decoder.h"
+#include "frame_ring_source.h"
+#include "jitter_buffer.h"
+#include "stream_decoder.h"
+
+namespace aas {
+
+/// A received datagram copied out of the receive buffers for one stream.
+struct StreamPacket {
+    std::uint64_t arrivalUs = 0;
+    std::uint16_t size = 0;
+    alignas(8) std::uint8_t bytes[kMaxDatagramBytes];
+};
+
+/// Everything the receiver keeps for one sender: inbox, FEC, jitter buffer,
+/// decoder, decoded-frame ring and drift resampler.
+///
+/// Three threads touch it, each through its own part:
+///   - the dispatch (receive) thread pushes into inbox();
+///   - exactly one decode-pool worker calls service(), which owns FEC, the
+///     jitter buffer and the decoder and produces decoded frames;
+///   - the render thread pulls source(), which owns the resampler.
+/// active() is the hand-off between the worker and the mixer: the worker
+/// clears it when the sender goes quiet, the mixer then resets its side.
+/// setGain() may be called from any one thread (the receive thread, for
+/// remote volume and pause); the worker ramps to it on decoded frames.
+///
+/// Receive-side latency on a clean link is the jitter buffer's target depth
+/// (one frame per 2.5 ms of observed delay spread, at least
+/// minDepthFrames), plus the decoded lead, plus the resampler's
+/// kGroupDelaySamples (0.25 ms), plus the device period and its buffering.
+/// The lead is only what the next render period will take from the ring,
+/// and at least kDecodedLead: one frame at periods up to about 2 ms, one or
+/// two at 128 frames.
+class StreamPipeline {
+public:
+    using Inbox = SpscRing<StreamPacket, 64>;
+    /// Fewest decoded frames kept ready ahead of the render thread.
+    static constexpr std::size_t kDecodedLead = 1;
+    /// Silence after which a stream is considered gone.
+    static constexpr std::uint64_t kIdleTimeoutUs = 2000000;
+
+    StreamPipeline(std::size_t outputChannels, std::size_t maxPeriodFrames,
+                   const JitterBufferConfig& jitterConfig = {});
+
+    /// Arena bytes one pipeline takes when created with RtArena::create():
+    /// the object (inbox, FEC, jitter slots, decoded ring) and its buffers.
+    static std::size_t arenaBytes(std::size_t outputChannels, std::size_t maxPeriodFrames) {
+        return sizeof(StreamPipeline) + alignof(StreamPipeline) +
+               FrameRingSource::storageBytes(outputChannels, maxPeriodFrames) +
+               OpusFrameDecoder::storageBytes();
+    }
+
+    /// Decoded frames to keep for a render side that will take
+    /// `demandSamples` from the ring next period.
+    static std::size_t decodedLead(std::size_t demandSamples) {
+        return std::max(kDecodedLead, (demandSamples + kFrameSamples - 1) / kFrameSamples);
+    }
+
+    Inbox& inbox() { return inbox_; }
+    RenderSource& source() { return source_; }
+    FrameRingSource& ringSource() { return source_; }
+
+    /// Decode-pool worker: drains the inbox into FEC and the jitter buffer,
+    /// then decodes until decodedLead() frames are queued. Returns the
+    /// number of frames decoded.
+    std::size_t service(std::uint64_t nowUs);
+
+    bool active() const { return active_.load(std::memory_order_acquire); }
+    std::uint8_t streamId() const { return streamId_.load(std::memory_order_relaxed); }
+    void setStreamId(std::uint8_t id) { streamId_.store(id, std::memory_order_relaxed); }
+
+    /// Remote volume and pause, applied sample-accurately after decode.
+    void setGain(const GainSetting& setting) { gain_.store(setting); }
+
+    /// Also publishes every decoded frame to a shared-memory output
+    /// (docs/protocol.md, Shared-Memory Output); null stops. Control
+    /// thread, while the worker is stopped.
+    void setSharedOutput(SharedAudioWriter* writer) { shared_ = writer; }
+
+    const JitterBufferStats& jitterStats() const { return jitter_.stats(); }
+    const FecDecoderStats& fecStats() const { return fec_.stats(); }
+
+    /// Stage histograms: network transit and jitter depth and decode time
+    /// from the worker, render margin from the render thread. Any thread
+    /// may read them (through a TelemetrySampler).
+    const StageTelemetry& telemetry() const { return telemetry_; }
+    /// Cumulative packet counters for TelemetrySampler::sample().
+    TelemetryCounters counters() const;
+
+private:
+    void resetDecodeSide();
+
+    StageTelemetry telemetry_;
+    Inbox inbox_;
+    FecDecoder fec_;
+    JitterBuffer jitter_;
+    StreamDecoder decoder_;
+    FrameRing decoded_;
+    FrameRingSource source_;
+    SeqLock<GainSetting> gain_;
+    GainRamp ramp_;
+    SharedAudioWriter* shared_ = nullptr;
+
+    std::uint64_t lastArrivalUs_ = 0;
+    std::atomic<bool> active_{false};
+    std::atomic<std::uint8_t> streamId_{0};
+};
+
+} // namespace aas
@@ -0,0 +1,48 @@
+#include "telemetry_channel.h"
+
+namespace aas {
+
+TelemetryChannel::~TelemetryChannel() { close(); }
+
+bool TelemetryChannel::open(const SOCKADDR_INET& collector) {
+    close();
+    socket_ = ::socket(collector.si_family, SOCK_DGRAM, IPPROTO_UDP);
+    if (socket_ == INVALID_SOCKET) {
+        lastError_ = ::WSAGetLastError();
+        return false;
+    }
+    u_long nonBlocking = 1;
+    if (::ioctlsocket(socket_, FIONBIO, &nonBlocking) != 0) {
+        lastError_ = ::WSAGetLastError();
+        close();
+        return false;
+    }
+    collector_ = collector;
+    lastError_ = 0;
+    return true;
+}
+
+void TelemetryChannel::close() {
+    if (socket_ != INVALID_SOCKET) {
+        ::closesocket(socket_);
+        socket_ = INVALID_SOCKET;
+    }
+}
+
+bool TelemetryChannel::send(const TelemetryReport& report) {
+    if (socket_ == INVALID_SOCKET) {
+        return false;
+    }
+    const int length = collector_.si_family == AF_INET6 ? sizeof(collector_.Ipv6) : sizeof(collector_.Ipv4);
+    const int sent = ::sendto(socket_, reinterpret_cast<const char*>(telemetryBytes(report)),
+                              static_cast<int>(kTelemetryReportBytes), 0,
+                              reinterpret_cast<const sockaddr*>(&collector_), length);
+    if (sent == SOCKET_ERROR) {
+        lastError_ = ::WSAGetLastError();
+        ++dropped_;
+        return false;
+    }
+    return true;
+}
+
+} // namespace aas
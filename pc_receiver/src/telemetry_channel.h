@@ -0,0 +1,44 @@
+#pragma once
+
+#include <winsock2.h>
+#include <ws2ipdef.h>
+
+#include <cstdint>
+
+#include "aas/telemetry.h"
+
+namespace aas {
+
+/// Optional stats side channel (docs/protocol.md, Telemetry Channel): sends
+/// TelemetryReports to a collector so a third machine can graph many
+/// sessions.
+///
+/// A plain non-blocking UDP socket, separate from the RIO media socket, so
+/// the reporting thread never touches the receive thread's request queue.
+/// A full socket buffer drops the report; the next one carries cumulative
+/// counters anyway. Reporting thread only.
+class TelemetryChannel {
+public:
+    TelemetryChannel() = default;
+    ~TelemetryChannel();
+    TelemetryChannel(const TelemetryChannel&) = delete;
+    TelemetryChannel& operator=(const TelemetryChannel&) = delete;
+
+    /// Returns false and records a WSA error code on failure.
+    bool open(const SOCKADDR_INET& collector);
+    void close();
+    bool isOpen() const { return socket_ != INVALID_SOCKET; }
+
+    bool send(const TelemetryReport& report);
+
+    std::uint64_t dropped() const { return dropped_; }
+    int lastError() const { return lastError_; }
+
+private:
+    SOCKET socket_ = INVALID_SOCKET;
+    SOCKADDR_INET collector_{};
+    std::uint64_t dropped_ = 0;
+    int lastError_ = 0;
+};
+
+} // namespace aas
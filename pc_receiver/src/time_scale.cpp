@@ -0,0 +1,142 @@
+#include "time_scale.h"
+
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "plc.h"
+
+namespace aas {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct CrossfadeTable {
+    std::array<float, FrameCompressor::kOverlapSamples> fadeIn{};
+
+    CrossfadeTable() {
+        for (std::size_t i = 0; i < fadeIn.size(); ++i) {
+            const double phase = (static_cast<double>(i) + 0.5) / fadeIn.size();
+            fadeIn[i] = static_cast<float>(0.5 - 0.5 * std::cos(kPi * phase));
+        }
+    }
+};
+
+// Built once during static initialisation, never on the audio thread.
+const CrossfadeTable kCrossfade;
+
+constexpr std::size_t kMaxInputSamples = FrameCompressor::kMaxHeldSamples + 2 * kFrameSamples;
+
+} // namespace
+
+void FrameCompressor::compress(const AudioFrame& first, const AudioFrame& second, AudioFrame& out) {
+    const std::size_t channels = first.channels;
+    if (channels != channels_) {
+        held_ = 0;
+        channels_ = channels;
+    }
+    out.sampleClock = first.sampleClock;
+    out.channels = first.channels;
+    out.flags = first.flags;
+    if (second.channels != channels) {
+        // A format change between the two: nothing to align, keep the newer.
+        std::memcpy(out.samples, second.samples, kFrameSamples * second.channels * sizeof(float));
+        out.channels = second.channels;
+        held_ = 0;
+        channels_ = second.channels;
+        return;
+    }
+
+    // The input is what is held followed by both frames.
+    const std::size_t total = held_ + 2 * kFrameSamples;
+    auto at = [&](std::size_t i, std::size_t ch) {
+        if (i < held_) {
+            return hold_[i * channels + ch];
+        }
+        i -= held_;
+        return i < kFrameSamples ? first.samples[i * channels + ch]
+                                 : second.samples[(i - kFrameSamples) * channels + ch];
+    };
+    float mono[kMaxInputSamples];
+    for (std::size_t i = 0; i < total; ++i) {
+        float sum = 0.0f;
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            sum += at(i, ch);
+        }
+        mono[i] = sum;
+    }
+
+    // The cut that leaves nothing held is tried first and kept unless a
+    // shorter one matches the start better, so the hold drains when it can.
+    const std::size_t maxCut = kFrameSamples + held_;
+    const std::size_t minCut = maxCut - kMaxHeldSamples;
+    std::size_t cut = maxCut;
+    float templateEnergy = 0.0f;
+    float candidateEnergy = 0.0f;
+    for (std::size_t i = 0; i < kOverlapSamples; ++i) {
+        templateEnergy += mono[i] * mono[i];
+        candidateEnergy += mono[maxCut + i] * mono[maxCut + i];
+    }
+    if (templateEnergy >= 1e-9f) {
+        float best = PacketLossConcealer::kMinCorrelation;
+        for (std::size_t c = maxCut;; --c) {
+            if (c < maxCut) {
+                candidateEnergy += mono[c] * mono[c] - mono[c + kOverlapSamples] * mono[c + kOverlapSamples];
+            }
+            float dot = 0.0f;
+            for (std::size_t i = 0; i < kOverlapSamples; ++i) {
+                dot += mono[i] * mono[c + i];
+            }
+            if (dot > 0.0f && candidateEnergy > 1e-9f) {
+                const float corr = dot / std::sqrt(templateEnergy * candidateEnergy);
+                if (corr > best) {
+                    best = corr;
+                    cut = c;
+                }
+            }
+            if (c == minCut) {
+                break;
+            }
+        }
+    }
+
+    // Crossfade from the start of the input into the signal `cut` later.
+    for (std::size_t i = 0; i < kFrameSamples; ++i) {
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            float s = at(cut + i, ch);
+            if (i < kOverlapSamples) {
+                const float in = kCrossfade.fadeIn[i];
+                s = in * s + (1.0f - in) * at(i, ch);
+            }
+            out.samples[i * channels + ch] = s;
+        }
+    }
+    // The rest lies in the two frames, never in the old hold.
+    const std::size_t held = total - cut - kFrameSamples;
+    for (std::size_t i = 0; i < held; ++i) {
+        for (std::size_t ch = 0; ch < channels; ++ch) {
+            hold_[i * channels + ch] = at(cut + kFrameSamples + i, ch);
+        }
+    }
+    held_ = held;
+}
+
+void FrameCompressor::carry(AudioFrame& frame) {
+    if (held_ == 0) {
+        return;
+    }
+    if (frame.channels != channels_) {
+        held_ = 0;
+        return;
+    }
+    const std::size_t heldValues = held_ * channels_;
+    const std::size_t frameValues = kFrameSamples * channels_;
+    float tail[kMaxHeldSamples * kMaxFrameChannels];
+    std::memcpy(tail, frame.samples + frameValues - heldValues, heldValues * sizeof(float));
+    std::memmove(frame.samples + heldValues, frame.samples, (frameValues - heldValues) * sizeof(float));
+    std::memcpy(frame.samples, hold_, heldValues * sizeof(float));
+    std::memcpy(hold_, tail, heldValues * sizeof(float));
+}
+
+} // namespace aas
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+
+#include "aas/audio_format.h"
+
+namespace aas {
+
+/// Time-scale compression used when the jitter buffer drains excess depth
+/// (PlayoutAction::kAccelerate): two consecutive decoded frames become one.
+///
+/// Cutting exactly one frame cannot stay in phase with periodic content: a
+/// 1 kHz tone is 2.5 periods per frame, so blending the two frames cancels
+/// it. The cut is therefore pitch-aligned as in WSOLA. Its length is chosen
+/// between kFrameSamples - kMaxHeldSamples and kFrameSamples plus whatever
+/// is already held back, by the same normalised cross-correlation the
+/// PacketLossConcealer uses, and the two sides are crossfaded over
+/// kOverlapSamples. What the cut leaves beyond one frame is held and played
+/// ahead of the next frames through carry(), so the output still joins the
+/// frames either side without a step and, over successive accelerations,
+/// drains exactly one frame each. Unpitched or silent content takes the
+/// longest cut, which also empties the hold.
+///
+/// The hold adds up to kMaxHeldSamples (1.25 ms) of latency while it is
+/// non-empty. No allocation. Decode thread only.
+class FrameCompressor {
+public:
+    static constexpr std::size_t kOverlapSamples = kFrameSamples / 2;
+    static constexpr std::size_t kMaxHeldSamples = kFrameSamples / 2;  // covers 800 Hz and up
+
+    /// Writes the frame that replaces `first` and `second`.
+    void compress(const AudioFrame& first, const AudioFrame& second, AudioFrame& out);
+    /// Plays `frame` behind the held samples; a no-op while none are held.
+    void carry(AudioFrame& frame);
+    /// Drops the held samples (concealment and comfort noise start afresh).
+    void reset() { held_ = 0; }
+
+    std::size_t heldSamples() const { return held_; }
+
+private:
+    float hold_[kMaxHeldSamples * kMaxFrameChannels] = {};
+    std::size_t held_ = 0;  // samples per channel in hold_
+    std::size_t channels_ = 0;
+};
+
+} // namespace aas
@@ -0,0 +1,386 @@
+#include "wasapi_renderer.h"
+
+#include <ksmedia.h>
+#include <mmreg.h>
+
+#include <algorithm>
+
+#include "aas/audio_format.h"
+#include "aas/clock.h"
+#include "rt_thread.h"
+#include "sample_convert.h"
+
+namespace aas {
+
+namespace {
+
+/// A device that has not signalled for this long has stalled or gone.
+constexpr DWORD kEventTimeoutMs = 200;
+
+REFERENCE_TIME framesToHns(std::uint32_t frames) {
+    return static_cast<REFERENCE_TIME>(10000000.0 * frames / kSampleRateHz + 0.5);
+}
+
+/// Speaker mask for the pipeline's WAVE-order layouts (aas/opus_layout.h
+/// lists them); mask bit order is WAVE order, so the samples need no
+/// reordering. Other counts are left unassigned for the driver to place.
+DWORD channelMask(std::uint16_t channels) {
+    switch (channels) {
+    case 1: return SPEAKER_FRONT_CENTER;
+    case 2: return KSAUDIO_SPEAKER_STEREO;
+    case 3: return KSAUDIO_SPEAKER_STEREO | SPEAKER_FRONT_CENTER;
+    case 4: return KSAUDIO_SPEAKER_QUAD;
+    case 5: return KSAUDIO_SPEAKER_QUAD | SPEAKER_FRONT_CENTER;
+    case 6: return KSAUDIO_SPEAKER_5POINT1;
+    case 7: return KSAUDIO_SPEAKER_5POINT1_SURROUND | SPEAKER_BACK_CENTER;
+    case 8: return KSAUDIO_SPEAKER_7POINT1_SURROUND;
+    default: return 0;
+    }
+}
+
+WAVEFORMATEXTENSIBLE makeFormat(bool isFloat, std::uint16_t containerBits, std::uint16_t validBits,
+                                std::uint16_t channels) {
+    WAVEFORMATEXTENSIBLE format{};
+    format.Format.wFormatTag = WAVE_FORMAT_EXTENSIBLE;
+    format.Format.nChannels = channels;
+    format.Format.nSamplesPerSec = kSampleRateHz;
+    format.Format.wBitsPerSample = containerBits;
+    format.Format.nBlockAlign = static_cast<WORD>(channels * containerBits / 8);
+    format.Format.nAvgBytesPerSec = kSampleRateHz * format.Format.nBlockAlign;
+    format.Format.cbSize = sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX);
+    format.Samples.wValidBitsPerSample = validBits;
+    format.dwChannelMask = channelMask(channels);
+    format.SubFormat = isFloat ? KSDATAFORMAT_SUBTYPE_IEEE_FLOAT : KSDATAFORMAT_SUBTYPE_PCM;
+    return format;
+}
+
+} // namespace
+
+WasapiRenderer::~WasapiRenderer() { close(); }
+
+bool WasapiRenderer::open(const WasapiConfig& config, RenderSource& source) {
+    close();
+    config_ = config;
+    source_ = &source;
+    channels_ = std::max<std::uint16_t>(config.channels, 1);
+
+    Microsoft::WRL::ComPtr<IMMDeviceEnumerator> enumerator;
+    lastError_ = ::CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                                    IID_PPV_ARGS(&enumerator));
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    Microsoft::WRL::ComPtr<IMMDevice> device;
+    lastError_ = config.deviceId.empty()
+                     ? enumerator->GetDefaultAudioEndpoint(eRender, eConsole, &device)
+                     : enumerator->GetDevice(config.deviceId.c_str(), &device);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+
+    event_ = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+    stopEvent_ = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+    if (event_ == nullptr || stopEvent_ == nullptr) {
+        lastError_ = HRESULT_FROM_WIN32(::GetLastError());
+        close();
+        return false;
+    }
+
+    bool ok = false;
+    if (config.mode == WasapiMode::kExclusive) {
+        ok = openExclusive(device.Get());
+        if (!ok && config.allowSharedFallback) {
+            client_.Reset();
+            ok = openShared(device.Get());
+        }
+    } else {
+        ok = openShared(device.Get());
+    }
+    if (!ok || !finishOpen()) {
+        const HRESULT error = lastError_;
+        close();
+        lastError_ = error;
+        return false;
+    }
+    return true;
+}
+
+bool WasapiRenderer::openExclusive(IMMDevice* device) {
+    lastError_ = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                  reinterpret_cast<void**>(client_.ReleaseAndGetAddressOf()));
+    if (FAILED(lastError_)) {
+        return false;
+    }
+
+    // Exclusive mode takes the device's own sample formats; prefer float so
+    // the render callback can write straight into the device buffer.
+    struct Candidate {
+        SampleType type;
+        bool isFloat;
+        std::uint16_t containerBits;
+        std::uint16_t validBits;
+    };
+    constexpr Candidate kCandidates[] = {
+        {SampleType::kFloat32, true, 32, 32},
+        {SampleType::kInt32, false, 32, 24},
+        {SampleType::kInt32, false, 32, 32},
+        {SampleType::kInt16, false, 16, 16},
+    };
+    WAVEFORMATEXTENSIBLE format{};
+    bool found = false;
+    for (const Candidate& c : kCandidates) {
+        format = makeFormat(c.isFloat, c.containerBits, c.validBits, channels_);
+        if (client_->IsFormatSupported(AUDCLNT_SHAREMODE_EXCLUSIVE, &format.Format, nullptr) == S_OK) {
+            sampleType_ = c.type;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        lastError_ = AUDCLNT_E_UNSUPPORTED_FORMAT;
+        return false;
+    }
+
+    REFERENCE_TIME defaultPeriod = 0;
+    REFERENCE_TIME minimumPeriod = 0;
+    lastError_ = client_->GetDevicePeriod(&defaultPeriod, &minimumPeriod);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    REFERENCE_TIME period = std::max(minimumPeriod, framesToHns(config_.periodFrames));
+    const DWORD flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK | AUDCLNT_STREAMFLAGS_NOPERSIST;
+    lastError_ = client_->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, flags, period, period,
+                                     &format.Format, nullptr);
+    if (lastError_ == AUDCLNT_E_BUFFER_SIZE_NOT_ALIGNED) {
+        // The documented retry: take the aligned size the failed call
+        // reports and initialise a fresh client with exactly that period.
+        UINT32 alignedFrames = 0;
+        lastError_ = client_->GetBufferSize(&alignedFrames);
+        if (FAILED(lastError_)) {
+            return false;
+        }
+        period = framesToHns(alignedFrames);
+        lastError_ = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                      reinterpret_cast<void**>(client_.ReleaseAndGetAddressOf()));
+        if (FAILED(lastError_)) {
+            return false;
+        }
+        lastError_ = client_->Initialize(AUDCLNT_SHAREMODE_EXCLUSIVE, flags, period, period,
+                                         &format.Format, nullptr);
+    }
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    mode_ = WasapiMode::kExclusive;
+    return true;
+}
+
+bool WasapiRenderer::openShared(IMMDevice* device) {
+    // IAudioClient3 (Windows 10+) is what allows a shared period below the
+    // engine default of 10 ms.
+    Microsoft::WRL::ComPtr<IAudioClient3> client;
+    lastError_ = device->Activate(__uuidof(IAudioClient3), CLSCTX_ALL, nullptr,
+                                  reinterpret_cast<void**>(client.GetAddressOf()));
+    if (FAILED(lastError_)) {
+        return false;
+    }
+
+    // The shared engine will not resample for a low-latency stream, so the
+    // 48 kHz float format must be one the mixer already runs at.
+    WAVEFORMATEXTENSIBLE format = makeFormat(true, 32, 32, channels_);
+    WAVEFORMATEX* closest = nullptr;
+    lastError_ = client->IsFormatSupported(AUDCLNT_SHAREMODE_SHARED, &format.Format, &closest);
+    ::CoTaskMemFree(closest);
+    if (lastError_ != S_OK) {
+        lastError_ = AUDCLNT_E_UNSUPPORTED_FORMAT;
+        return false;
+    }
+
+    UINT32 defaultFrames = 0;
+    UINT32 fundamentalFrames = 0;
+    UINT32 minFrames = 0;
+    UINT32 maxFrames = 0;
+    lastError_ = client->GetSharedModeEnginePeriod(&format.Format, &defaultFrames, &fundamentalFrames,
+                                                    &minFrames, &maxFrames);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    std::uint32_t frames = config_.periodFrames;
+    if (fundamentalFrames > 0) {
+        frames = (frames + fundamentalFrames - 1) / fundamentalFrames * fundamentalFrames;
+    }
+    frames = std::clamp<std::uint32_t>(frames, minFrames, maxFrames);
+
+    lastError_ = client->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, frames,
+                                                     &format.Format, nullptr);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    client_ = client;
+    sampleType_ = SampleType::kFloat32;
+    periodFrames_ = frames;
+    mode_ = WasapiMode::kSharedLowLatency;
+    return true;
+}
+
+bool WasapiRenderer::finishOpen() {
+    lastError_ = client_->SetEventHandle(event_);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    UINT32 bufferFrames = 0;
+    lastError_ = client_->GetBufferSize(&bufferFrames);
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    bufferFrames_ = bufferFrames;
+    if (mode_ == WasapiMode::kExclusive) {
+        // Event-driven exclusive streams ping-pong between two buffers of
+        // exactly one period.
+        periodFrames_ = bufferFrames_;
+    }
+    lastError_ = client_->GetService(IID_PPV_ARGS(&renderClient_));
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    REFERENCE_TIME streamLatency = 0;
+    if (SUCCEEDED(client_->GetStreamLatency(&streamLatency))) {
+        streamLatencyUs_ = static_cast<std::uint64_t>(streamLatency / 10);
+    }
+    outputLatencyUs_ = static_cast<std::uint64_t>(periodFrames_) * 1000000u / kSampleRateHz +
+                       streamLatencyUs_;
+    scratch_.assign(static_cast<std::size_t>(bufferFrames_) * channels_, 0.0f);
+    return true;
+}
+
+bool WasapiRenderer::start() {
+    if (client_ == nullptr || thread_.joinable()) {
+        return false;
+    }
+    // One period of silence queued ahead so the first event has something
+    // to play while the render thread produces the next.
+    BYTE* data = nullptr;
+    if (SUCCEEDED(renderClient_->GetBuffer(periodFrames_, &data))) {
+        renderClient_->ReleaseBuffer(periodFrames_, AUDCLNT_BUFFERFLAGS_SILENT);
+    }
+    ::ResetEvent(stopEvent_);
+    deviceLost_.store(false, std::memory_order_release);
+    lastError_ = client_->Start();
+    if (FAILED(lastError_)) {
+        return false;
+    }
+    thread_ = std::thread(&WasapiRenderer::run, this);
+    return true;
+}
+
+void WasapiRenderer::stop() {
+    if (thread_.joinable()) {
+        ::SetEvent(stopEvent_);
+        thread_.join();
+    }
+    if (client_ != nullptr) {
+        client_->Stop();
+        client_->Reset();
+    }
+}
+
+void WasapiRenderer::close() {
+    stop();
+    renderClient_.Reset();
+    client_.Reset();
+    if (event_ != nullptr) {
+        ::CloseHandle(event_);
+        event_ = nullptr;
+    }
+    if (stopEvent_ != nullptr) {
+        ::CloseHandle(stopEvent_);
+        stopEvent_ = nullptr;
+    }
+}
+
+void WasapiRenderer::run() {
+    ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    RtThreadConfig config;
+    config.role = ThreadRole::kRender;
+    // Filling a period must finish well inside it; half a period leaves the
+    // device its margin.
+    config.budgetUs = static_cast<std::uint32_t>(periodFrames_ * 1000000ull / kSampleRateHz / 2);
+    config.critical = true;
+    RtScope rt(config);
+
+    const HANDLE waits[2] = {stopEvent_, event_};
+    for (;;) {
+        const DWORD signalled = ::WaitForMultipleObjects(2, waits, FALSE, kEventTimeoutMs);
+        if (signalled == WAIT_OBJECT_0) {
+            break;
+        }
+        if (signalled != WAIT_OBJECT_0 + 1) {
+            glitches_.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        const std::uint64_t wokeUs = rt.begin();
+
+        std::uint32_t frames = periodFrames_;
+        std::uint32_t queued = periodFrames_;
+        if (mode_ == WasapiMode::kSharedLowLatency) {
+            UINT32 padding = 0;
+            const HRESULT hr = client_->GetCurrentPadding(&padding);
+            if (hr == AUDCLNT_E_DEVICE_INVALIDATED) {
+                deviceLost_.store(true, std::memory_order_release);
+                break;
+            }
+            // Keep one period playing and one queued; filling the whole
+            // shared buffer would add its full length to the latency.
+            const std::uint32_t target = std::min(bufferFrames_, 2 * periodFrames_);
+            frames = (padding < target) ? target - padding : 0;
+            queued = padding;
+        }
+        if (frames > 0 && !renderPeriod(frames, queued)) {
+            break;
+        }
+        rt.end(wokeUs);
+    }
+    ::CoUninitialize();
+}
+
+bool WasapiRenderer::renderPeriod(std::uint32_t frames, std::uint32_t queuedFrames) {
+    BYTE* data = nullptr;
+    HRESULT hr = renderClient_->GetBuffer(frames, &data);
+    if (FAILED(hr)) {
+        if (hr == AUDCLNT_E_DEVICE_INVALIDATED) {
+            deviceLost_.store(true, std::memory_order_release);
+            return false;
+        }
+        glitches_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    const std::uint64_t presentUs = monotonicMicros() +
+                                    static_cast<std::uint64_t>(queuedFrames) * 1000000u / kSampleRateHz +
+                                    streamLatencyUs_;
+    if (sampleType_ == SampleType::kFloat32) {
+        source_->render(reinterpret_cast<float*>(data), frames, channels_, presentUs);
+    } else {
+        // Interleaved in and out, so the whole period converts as one
+        // stride-1 run.
+        source_->render(scratch_.data(), frames, channels_, presentUs);
+        convertChannel(scratch_.data(), 1,
+                       sampleType_ == SampleType::kInt32 ? DeviceSampleFormat::kInt32
+                                                         : DeviceSampleFormat::kInt16,
+                       data, static_cast<std::size_t>(frames) * channels_);
+    }
+
+    hr = renderClient_->ReleaseBuffer(frames, 0);
+    if (FAILED(hr)) {
+        if (hr == AUDCLNT_E_DEVICE_INVALIDATED) {
+            deviceLost_.store(true, std::memory_order_release);
+            return false;
+        }
+        glitches_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    periods_.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+} // namespace aas
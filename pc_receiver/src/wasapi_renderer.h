@@ -0,0 +1,115 @@
+#pragma once
+
+#include <windows.h>
+#include <audioclient.h>
+#include <mmdeviceapi.h>
+#include <wrl/client.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "render_source.h"
+
+namespace aas {
+
+enum class WasapiMode : std::uint8_t {
+    /// Exclusive, event-driven: one device period per event, no mixer.
+    kExclusive,
+    /// Shared through IAudioClient3 at the engine's minimum period.
+    kSharedLowLatency,
+};
+
+struct WasapiConfig {
+    /// Endpoint id from IMMDevice::GetId; empty selects the default render
+    /// endpoint.
+    std::wstring deviceId;
+    WasapiMode mode = WasapiMode::kExclusive;
+    /// Requested period; rounded to what the device supports.
+    std::uint32_t periodFrames = 64;
+    std::uint16_t channels = 2;
+    /// If exclusive mode is refused (device busy, format unsupported, policy
+    /// disabled), retry in low-latency shared mode.
+    bool allowSharedFallback = true;
+};
+
+/// Native WASAPI render backend for the direct 64-128 sample path.
+///
+/// PortAudio's WASAPI host adds its own buffer and a thread hop between the
+/// device event and the user callback; here the render thread waits on the
+/// device event itself, under MMCSS "Pro Audio", and calls the RenderSource
+/// straight into the buffer returned by IAudioRenderClient::GetBuffer (via
+/// one float scratch period when the device format is integer). PortAudio
+/// remains the compatibility backend for devices this one cannot open.
+///
+/// open() and close() run on a control thread with COM initialised (MTA);
+/// the render thread joins the MTA itself.
+class WasapiRenderer {
+public:
+    WasapiRenderer() = default;
+    ~WasapiRenderer();
+    WasapiRenderer(const WasapiRenderer&) = delete;
+    WasapiRenderer& operator=(const WasapiRenderer&) = delete;
+
+    /// Opens the endpoint and configures the stream. Returns false and
+    /// records the HRESULT on failure.
+    bool open(const WasapiConfig& config, RenderSource& source);
+    bool start();
+    void stop();
+    void close();
+
+    bool isOpen() const { return client_ != nullptr; }
+    /// Mode actually in use after fallback.
+    WasapiMode mode() const { return mode_; }
+    std::uint32_t periodFrames() const { return periodFrames_; }
+    std::uint32_t bufferFrames() const { return bufferFrames_; }
+    std::uint16_t channels() const { return channels_; }
+    /// Device period plus the stream latency WASAPI reports, in us; the
+    /// playback figure the latency budget should be checked against.
+    std::uint64_t outputLatencyUs() const { return outputLatencyUs_; }
+    HRESULT lastError() const { return lastError_; }
+
+    std::uint64_t periods() const { return periods_.load(std::memory_order_relaxed); }
+    /// Waits that timed out without a device event (device stalled or
+    /// removed) and render errors.
+    std::uint64_t glitches() const { return glitches_.load(std::memory_order_relaxed); }
+    /// Set once the endpoint has been invalidated (unplugged, format change);
+    /// the owner must close() and reopen.
+    bool deviceLost() const { return deviceLost_.load(std::memory_order_acquire); }
+
+private:
+    enum class SampleType : std::uint8_t { kFloat32, kInt32, kInt16 };
+
+    bool openExclusive(IMMDevice* device);
+    bool openShared(IMMDevice* device);
+    bool finishOpen();
+    void run();
+    bool renderPeriod(std::uint32_t frames, std::uint32_t queuedFrames);
+
+    WasapiConfig config_;
+    RenderSource* source_ = nullptr;
+    Microsoft::WRL::ComPtr<IAudioClient> client_;
+    Microsoft::WRL::ComPtr<IAudioRenderClient> renderClient_;
+    HANDLE event_ = nullptr;
+    HANDLE stopEvent_ = nullptr;
+    std::thread thread_;
+
+    WasapiMode mode_ = WasapiMode::kExclusive;
+    SampleType sampleType_ = SampleType::kFloat32;
+    std::uint16_t channels_ = 0;
+    std::uint32_t periodFrames_ = 0;
+    std::uint32_t bufferFrames_ = 0;
+    std::uint64_t outputLatencyUs_ = 0;
+    std::uint64_t streamLatencyUs_ = 0;
+    HRESULT lastError_ = S_OK;
+    std::vector<float> scratch_;
+
+    std::atomic<std::uint64_t> periods_{0};
+    std::atomic<std::uint64_t> glitches_{0};
+    std::atomic<bool> deviceLost_{false};
+};
+
+} // namespace aas